@@ -22,4 +22,9 @@ include "Walnut/Build-Walnut-Headless-External.lua"
 group "App"
     include "Cubed-Common/Build-Cubed-Common-Headless.lua"
     include "Cubed-Server/Build-Cubed-Server-Headless.lua"
+group ""
+
+group "Tools"
+    include "Cubed-LoadTest/Build-Cubed-LoadTest.lua"
+    include "Cubed-Tests/Build-Cubed-Tests.lua"
 group ""
\ No newline at end of file
@@ -4,8 +4,10 @@ layout(location = 0) out vec4 out_color;
 
 layout(location = 0) in vec3 in_color;
 layout(location = 1) in vec3 in_normal;
+layout(location = 2) in vec3 in_texcoord;
 
-layout(binding = 0) uniform sampler2D u_Texture;
+// one layer per block type
+layout(binding = 0) uniform sampler2DArray u_Texture;
 
 void main()
 {
@@ -13,7 +15,7 @@ void main()
 
 	float intensity = max(dot(in_normal, lightDir), 0.15);
 
-	vec4 textureSample = texture(u_Texture, vec2(0, 0));
+	vec4 textureSample = texture(u_Texture, in_texcoord);
 
 	out_color = vec4(vec3(intensity) * textureSample.rgb, 1.0);
-}
\ No newline at end of file
+}
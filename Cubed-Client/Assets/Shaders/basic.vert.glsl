@@ -2,24 +2,37 @@
 
 layout(location = 0) in vec3 a_Position;
 layout(location = 1) in vec3 a_Normal;
+layout(location = 6) in uint a_Material;
+
+// per instance, one per cube
+layout(location = 2) in mat4 a_Transform;
+layout(location = 7) in uint a_InstanceMaterial;
 
 layout(location = 0) out vec3 out_color;
 layout(location = 1) out vec3 out_normal;
+layout(location = 2) out vec3 out_texcoord; // xy on the face, z is the array layer
 
-layout(push_constant) uniform PushConstants
+// per frame, every frame in flight has its own
+layout(binding = 1) uniform FrameUniforms
 {
 	mat4 ViewProjection;
-    mat4 Transform;
-} u_PushConstants;
+} u_Frame;
 
 void main()
 {
-    gl_Position = u_PushConstants.ViewProjection 
-                * u_PushConstants.Transform 
+    gl_Position = u_Frame.ViewProjection 
+                * a_Transform 
                 * vec4(a_Position, 1.0);
     // mat3 of transform to ignore translation and focus on rotation
     // transpose and inverse in case object does not scale uniformly
     // normalize to considering scaling
-    out_normal = normalize(transpose(inverse(mat3(u_PushConstants.Transform))) * a_Normal);
+    out_normal = normalize(transpose(inverse(mat3(a_Transform))) * a_Normal);
     out_color = a_Normal * 0.5 + 0.5;
+
+    // faces are axis aligned in model space, so the two axes along the face are the texture
+    // coordinates, one repeat per block (chunk vertices are in blocks, cubes are a block wide)
+    vec3 axis = abs(a_Normal);
+    vec2 uv = axis.x > 0.5 ? a_Position.zy : (axis.y > 0.5 ? a_Position.xz : a_Position.xy);
+    // one of the two is always 0, chunks set it per vertex and cubes per instance
+    out_texcoord = vec3(uv, float(a_Material + a_InstanceMaterial));
 }
@@ -0,0 +1,229 @@
+#include "ChunkMeshScheduler.h"
+
+#include <algorithm>
+
+// cubed-common include
+#include "JobSystem.h"
+#include "Profiler.h"
+
+namespace Cubed
+{
+	ChunkMeshScheduler::ChunkMeshScheduler(const ChunkMeshSettings& settings)
+		: m_Settings(settings)
+	{
+		// meshing can't run inline, there is always at least one worker
+		uint32_t workerCount = m_Settings.WorkerCount ? m_Settings.WorkerCount : std::max(JobSystem::GetDefaultWorkerCount(), 1u);
+
+		// room for JobsPerWorker to be turned up a fair bit at runtime
+		m_Results = std::make_unique<MPSCQueue<Result>>(workerCount * std::max(m_Settings.JobsPerWorker, 8u));
+
+		m_Workers.reserve(workerCount);
+		for (uint32_t i = 0; i < workerCount; i++)
+			m_Workers.emplace_back([this]() { WorkerMain(); });
+	}
+
+	ChunkMeshScheduler::~ChunkMeshScheduler()
+	{
+		{
+			std::scoped_lock<std::mutex> lock(m_JobMutex);
+			m_Running = false;
+		}
+		m_JobCondition.notify_all();
+
+		for (std::thread& worker : m_Workers)
+			worker.join();
+	}
+
+	void ChunkMeshScheduler::MarkDirty(const ChunkCoord& coord)
+	{
+		auto [it, inserted] = m_States.try_emplace(coord);
+		ChunkState& state = it->second;
+
+		// anything still in flight from before the chunk was (re)added is stale
+		if (inserted)
+			state.UploadedVersion = m_NextVersion;
+
+		state.Version = ++m_NextVersion;
+		if (!state.Pending)
+		{
+			// latency counts from the first mark, later ones just join it
+			state.Pending = true;
+			state.DirtyTime = Clock::now();
+			m_Pending.push_back(coord);
+		}
+	}
+
+	void ChunkMeshScheduler::Remove(const ChunkCoord& coord)
+	{
+		// the entry left in m_Pending gets skipped once its state is gone
+		m_States.erase(coord);
+	}
+
+	void ChunkMeshScheduler::UpdateLods(const glm::vec3& cameraPosition)
+	{
+		if (m_Settings.LodDistance <= 0.0f)
+			return;
+
+		for (auto& [coord, state] : m_States)
+		{
+			glm::vec3 offset = coord.GetWorldPosition() + glm::vec3(ChunkSize * 0.5f) - cameraPosition;
+			float bands = glm::length(offset) / m_Settings.LodDistance;
+
+			// half a chunk either way of the boundary before switching, so a camera sitting
+			// on it doesn't keep remeshing the same chunks
+			float margin = ChunkSize * 0.5f / m_Settings.LodDistance;
+			uint32_t lod = state.Lod;
+			if (bands > lod + 1 + margin || bands < lod - margin)
+				lod = std::min((uint32_t)bands, ChunkMesher::MaxLod);
+
+			if (lod != state.Lod)
+			{
+				state.Lod = lod;
+				MarkDirty(coord);
+			}
+		}
+	}
+
+	void ChunkMeshScheduler::Dispatch(const glm::vec3& cameraPosition, const ChunkMap& chunks)
+	{
+		UpdateLods(cameraPosition);
+
+		uint32_t maxInFlight = std::min<uint32_t>(GetMaxInFlight(), (uint32_t)m_Results->GetCapacity());
+		if (m_InFlight < maxInFlight && !m_Pending.empty())
+		{
+			// distance to the middle of the chunk
+			auto distance = [&cameraPosition](const ChunkCoord& coord)
+			{
+				glm::vec3 offset = coord.GetWorldPosition() + glm::vec3(ChunkSize * 0.5f) - cameraPosition;
+				return glm::dot(offset, offset);
+			};
+			std::sort(m_Pending.begin(), m_Pending.end(), [&](const ChunkCoord& a, const ChunkCoord& b) { return distance(a) < distance(b); });
+
+			auto find = [&chunks](const ChunkCoord& coord)
+			{
+				auto it = chunks.find(coord);
+				return it != chunks.end() ? it->second : nullptr;
+			};
+
+			size_t taken = 0;
+			{
+				std::scoped_lock<std::mutex> lock(m_JobMutex);
+				for (; taken < m_Pending.size() && m_InFlight < maxInFlight; taken++)
+				{
+					const ChunkCoord& coord = m_Pending[taken];
+					auto it = m_States.find(coord);
+					if (it == m_States.end() || !it->second.Pending)
+						continue;
+
+					ChunkState& state = it->second;
+					state.Pending = false;
+
+					Job job;
+					job.Center = find(coord);
+					if (!job.Center)
+						continue;
+
+					job.Coord = coord;
+					job.Version = state.Version;
+					job.Lod = state.Lod;
+					job.DirtyTime = state.DirtyTime;
+					job.Neighbours = {
+						find({ coord.X + 1, coord.Y, coord.Z }), find({ coord.X - 1, coord.Y, coord.Z }),
+						find({ coord.X, coord.Y + 1, coord.Z }), find({ coord.X, coord.Y - 1, coord.Z }),
+						find({ coord.X, coord.Y, coord.Z + 1 }), find({ coord.X, coord.Y, coord.Z - 1 })
+					};
+
+					m_Jobs.push_back(std::move(job));
+					m_InFlight++;
+				}
+			}
+			m_JobCondition.notify_all();
+
+			m_Pending.erase(m_Pending.begin(), m_Pending.begin() + taken);
+		}
+
+		std::scoped_lock<std::mutex> lock(m_JobMutex);
+		m_Statistics.Pending = (uint32_t)m_Pending.size();
+		m_Statistics.QueueDepth = (uint32_t)m_Jobs.size();
+		m_Statistics.InFlight = m_InFlight;
+	}
+
+	void ChunkMeshScheduler::Collect(Renderer& renderer)
+	{
+		Clock::time_point now = Clock::now();
+
+		m_Statistics.Uploads = 0;
+		Result result;
+		while (m_Statistics.Uploads < m_Settings.MaxUploadsPerFrame && m_Results->Pop(result))
+		{
+			m_InFlight--;
+			m_Statistics.MeshesBuilt++;
+
+			auto it = m_States.find(result.Coord);
+			if (it == m_States.end() || result.Version <= it->second.UploadedVersion)
+			{
+				m_Statistics.StaleMeshes++;
+				continue;
+			}
+
+			renderer.UploadChunkMesh(result.Coord, result.Mesh);
+			it->second.UploadedVersion = result.Version;
+			m_Statistics.Uploads++;
+
+			float latency = std::chrono::duration<float, std::milli>(now - result.DirtyTime).count();
+			m_WindowCount++;
+			m_WindowLatency += latency;
+			m_WindowMaxLatency = std::max(m_WindowMaxLatency, latency);
+			m_WindowMeshTime += result.MeshTime;
+		}
+
+		if (now - m_WindowStart >= std::chrono::seconds(1))
+		{
+			float perMesh = 1.0f / std::max(m_WindowCount, 1u);
+			m_Statistics.AverageLatency = m_WindowLatency * perMesh;
+			m_Statistics.MaxLatency = m_WindowMaxLatency;
+			m_Statistics.AverageMeshTime = m_WindowMeshTime * perMesh;
+
+			m_WindowStart = now;
+			m_WindowCount = 0;
+			m_WindowLatency = m_WindowMaxLatency = m_WindowMeshTime = 0.0f;
+		}
+	}
+
+	void ChunkMeshScheduler::WorkerMain()
+	{
+		CUBED_PROFILE_THREAD("Mesh Worker");
+
+		ChunkMesher mesher;
+		for (;;)
+		{
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(m_JobMutex);
+				m_JobCondition.wait(lock, [this]() { return !m_Running || !m_Jobs.empty(); });
+				if (!m_Running)
+					return;
+
+				job = std::move(m_Jobs.front());
+				m_Jobs.pop_front();
+			}
+
+			ChunkNeighbours neighbours;
+			for (size_t i = 0; i < neighbours.size(); i++)
+				neighbours[i] = job.Neighbours[i].get();
+
+			Result result;
+			result.Coord = job.Coord;
+			result.Version = job.Version;
+			result.DirtyTime = job.DirtyTime;
+
+			CUBED_PROFILE_ZONE("ChunkMesher::Build");
+			Clock::time_point start = Clock::now();
+			mesher.Build(*job.Center, neighbours, result.Mesh, job.Lod);
+			result.MeshTime = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+
+			// can't fail, the main thread never has more jobs out than the queue holds
+			m_Results->Push(std::move(result));
+		}
+	}
+}
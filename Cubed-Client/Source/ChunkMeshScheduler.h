@@ -0,0 +1,142 @@
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "Renderer/Renderer.h"
+
+// cubed-common include
+#include "Chunk.h"
+#include "ChunkMesher.h"
+#include "MPSCQueue.h"
+
+namespace Cubed
+{
+	struct ChunkMeshSettings
+	{
+		uint32_t WorkerCount = 0;         // 0 = one per hardware thread, minus the main thread
+		uint32_t JobsPerWorker = 2;       // handed out at once, more would just let priorities go stale
+		uint32_t MaxUploadsPerFrame = 8;  // finished meshes past this wait for the next frame
+		float LodDistance = 160.0f;       // blocks, every step this far out from the camera halves the detail
+	};
+
+	//
+	// ChunkMeshScheduler - meshes dirty chunks on background threads
+	//
+	// Dirty chunks wait on the main thread and every frame the ones closest to the camera are
+	// handed to the workers, only a couple per worker at a time so the order keeps up with
+	// the camera. Workers get their own references to the chunk and its neighbours (chunks are
+	// immutable once loaded) and push finished meshes onto a lock-free queue, which the main
+	// thread drains a few meshes per frame so uploads never spike the frame time.
+	//
+	// Chunks further from the camera get meshed at lower detail (see ChunkMesher), a chunk
+	// that crosses into a different detail band gets remeshed like any other dirty chunk.
+	//
+	// Each dirty mark gets a new version. A mesh that finishes after its chunk was removed,
+	// or after a newer mesh of the same chunk was already uploaded, is thrown away.
+	//
+	class ChunkMeshScheduler
+	{
+	public:
+		struct Statistics
+		{
+			uint32_t Pending = 0;        // dirty, waiting for a worker
+			uint32_t QueueDepth = 0;     // handed to the workers but not started yet
+			uint32_t InFlight = 0;       // handed to the workers and not uploaded yet
+			uint32_t Uploads = 0;        // last frame
+			uint64_t MeshesBuilt = 0;
+			uint64_t StaleMeshes = 0;
+
+			// over the last second, latency is from being marked dirty to being uploaded
+			float AverageLatency = 0.0f; // ms
+			float MaxLatency = 0.0f;     // ms
+			float AverageMeshTime = 0.0f; // ms spent meshing on a worker
+		};
+	public:
+		explicit ChunkMeshScheduler(const ChunkMeshSettings& settings = {});
+		~ChunkMeshScheduler();
+
+		ChunkMeshScheduler(const ChunkMeshScheduler&) = delete;
+		ChunkMeshScheduler& operator=(const ChunkMeshScheduler&) = delete;
+
+		// main thread only from here on
+		void MarkDirty(const ChunkCoord& coord);
+		void Remove(const ChunkCoord& coord);
+
+		// picks each chunk's detail and hands the nearest dirty chunks to the workers
+		void Dispatch(const glm::vec3& cameraPosition, const ChunkMap& chunks);
+		// uploads up to MaxUploadsPerFrame finished meshes
+		void Collect(Renderer& renderer);
+
+		ChunkMeshSettings& GetSettings() { return m_Settings; }
+		const Statistics& GetStatistics() const { return m_Statistics; }
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		struct ChunkState
+		{
+			uint64_t Version = 0;          // of the latest dirty mark
+			uint64_t UploadedVersion = 0;  // meshes up to this version are stale
+			uint32_t Lod = 0;
+			bool Pending = false;
+			Clock::time_point DirtyTime;
+		};
+
+		struct Job
+		{
+			ChunkCoord Coord;
+			uint64_t Version = 0;
+			uint32_t Lod = 0;
+			std::shared_ptr<const Chunk> Center;
+			std::array<std::shared_ptr<const Chunk>, 6> Neighbours;
+			Clock::time_point DirtyTime;
+		};
+
+		struct Result
+		{
+			ChunkCoord Coord;
+			uint64_t Version = 0;
+			ChunkMesh Mesh;
+			Clock::time_point DirtyTime;
+			float MeshTime = 0.0f; // ms
+		};
+	private:
+		void WorkerMain();
+		void UpdateLods(const glm::vec3& cameraPosition);
+		uint32_t GetMaxInFlight() const { return (uint32_t)m_Workers.size() * m_Settings.JobsPerWorker; }
+	private:
+		ChunkMeshSettings m_Settings;
+
+		// main thread
+		std::unordered_map<ChunkCoord, ChunkState, ChunkCoordHash> m_States;
+		std::vector<ChunkCoord> m_Pending;
+		uint64_t m_NextVersion = 0;
+		uint32_t m_InFlight = 0;
+
+		// main thread -> workers, nearest first
+		std::mutex m_JobMutex;
+		std::condition_variable m_JobCondition;
+		std::deque<Job> m_Jobs;
+		bool m_Running = true;
+
+		// workers -> main thread, never fills up since at most GetMaxInFlight() jobs are out
+		std::unique_ptr<MPSCQueue<Result>> m_Results;
+
+		std::vector<std::thread> m_Workers;
+
+		Statistics m_Statistics;
+		Clock::time_point m_WindowStart = Clock::now();
+		uint32_t m_WindowCount = 0;
+		float m_WindowLatency = 0.0f, m_WindowMaxLatency = 0.0f, m_WindowMeshTime = 0.0f;
+	};
+}
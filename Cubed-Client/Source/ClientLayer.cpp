@@ -13,15 +13,25 @@
 
 // for processing data to and from the server
 #include "Walnut/Serialization/BufferStream.h"
+#include "Walnut/Core/Log.h"
 
 // cubed-common include
+#include "ChunkCompression.h"
+#include "PacketBuffer.h"
+#include "Profiler.h"
 #include "ServerPacket.h"
 
+#include <cmath>
+#include <cstring>
+
 using namespace Walnut;
 
 namespace Cubed
 {
-	static Walnut::Buffer s_ScratchBuffer;
+	static bool ReadChunkCoord(StreamReader& stream, ChunkCoord& coord)
+	{
+		return stream.ReadRaw<int32_t>(coord.X) && stream.ReadRaw<int32_t>(coord.Y) && stream.ReadRaw<int32_t>(coord.Z);
+	}
 
 	// draw a simple rectangle
 	static void DrawRect(glm::vec2 position, glm::vec2 size, uint32_t color)
@@ -33,107 +43,328 @@ namespace Cubed
 		drawList->AddRectFilled(min, max, color);
 	}
 
+	ClientLayer::ClientLayer(const ClientSettings& settings)
+		: m_Settings(settings)
+	{
+	}
+
 	void ClientLayer::OnAttach()
 	{
-		s_ScratchBuffer.Allocate((uint64_t)(10 * 1024) * 1024); // 10MB of scratch buffer
+		CUBED_PROFILE_THREAD("Main");
+
+		m_StartTime = std::chrono::steady_clock::now();
 
 		// set callback function to local private function
 		m_Client.SetDataReceivedCallback([this](const Walnut::Buffer buffer) { OnDataReceived(buffer); });
 
-		m_Renderer.Init();
+		m_Renderer.Init(m_Settings.Renderer);
+	}
+
+	void ClientLayer::UpdateWorld()
+	{
+		// the server won't tell us about anything anymore, what we have is stale
+		if (m_Client.GetConnectionStatus() != Client::ConnectionStatus::Connected)
+		{
+			if (!m_Chunks.empty())
+				ClearWorld();
+			return;
+		}
+
+		m_ChunkUpdateMutex.lock();
+		std::swap(m_ChunkUpdates, m_AppliedChunkUpdates);
+		m_ChunkUpdateMutex.unlock();
+
+		for (ChunkUpdate& update : m_AppliedChunkUpdates)
+		{
+			switch (update.UpdateType)
+			{
+			case ChunkUpdate::Type::Load:
+				m_Chunks[update.Coord] = std::move(update.Blocks);
+				m_ChunkVersions[update.Coord] = update.Version;
+				m_WorldStats.ChunksReceived++;
+				m_WorldStats.ChunkBytesReceived += update.PacketSize;
+				m_WorldStats.Streaming = true;
+
+				// neighbours can hide the faces they share with it now
+				m_MeshScheduler.MarkDirty(update.Coord);
+				MarkNeighboursDirty(update.Coord);
+				break;
+			case ChunkUpdate::Type::Unload:
+				if (!m_Chunks.erase(update.Coord))
+					break;
+
+				m_ChunkVersions.erase(update.Coord);
+				m_MeshScheduler.Remove(update.Coord);
+				m_Renderer.RemoveChunkMesh(update.Coord);
+				MarkNeighboursDirty(update.Coord);
+				break;
+			case ChunkUpdate::Type::Edits:
+			{
+				m_WorldStats.EditsReceived += update.Edits.size();
+
+				auto it = m_Chunks.find(update.Coord);
+				auto version = m_ChunkVersions.find(update.Coord);
+				if (it == m_Chunks.end() || version == m_ChunkVersions.end() || version->second != update.FromVersion)
+				{
+					m_WorldStats.StaleEdits++;
+					break;
+				}
+
+				// the mesher may still be working on the old one, so edit a copy
+				auto blocks = std::make_shared<Chunk>(*it->second);
+				bool border = false;
+				for (const BlockEdit& edit : update.Edits)
+				{
+					uint32_t x = edit.Index % ChunkSize, y = edit.Index / ChunkSize % ChunkSize, z = edit.Index / (ChunkSize * ChunkSize);
+					blocks->Set(x, y, z, edit.Block);
+					border |= x == 0 || y == 0 || z == 0 || x == ChunkSize - 1 || y == ChunkSize - 1 || z == ChunkSize - 1;
+				}
+
+				it->second = std::move(blocks);
+				version->second = update.Version;
+				m_MeshScheduler.MarkDirty(update.Coord);
+				if (border)
+					MarkNeighboursDirty(update.Coord);
+				break;
+			}
+			case ChunkUpdate::Type::StreamIdle:
+				if (m_WorldStats.Streaming && m_WorldStats.InitialLoadTime == 0.0f)
+					m_WorldStats.InitialLoadTime = std::chrono::duration<float>(std::chrono::steady_clock::now() - m_ConnectTime).count();
+				m_WorldStats.Streaming = false;
+				break;
+			default:
+				break;
+			}
+		}
+		m_AppliedChunkUpdates.clear();
+	}
+
+	void ClientLayer::ClearWorld()
+	{
+		for (const auto& [coord, chunk] : m_Chunks)
+		{
+			m_MeshScheduler.Remove(coord);
+			m_Renderer.RemoveChunkMesh(coord);
+		}
+		m_Chunks.clear();
+		m_ChunkVersions.clear();
+
+		std::scoped_lock<std::mutex> lock(m_ChunkUpdateMutex);
+		m_ChunkUpdates.clear();
+	}
+
+	void ClientLayer::SendSetBlock(const glm::ivec3& position, BlockID block)
+	{
+		PacketBuffer packet = PacketBuffer::Allocate(sizeof(PacketType) + sizeof(int32_t) * 3 + sizeof(BlockID));
+		BufferStreamWriter stream(packet.GetBuffer());
+		stream.WriteRaw(PacketType::SetBlock);
+		stream.WriteRaw<int32_t>(position.x);
+		stream.WriteRaw<int32_t>(position.y);
+		stream.WriteRaw<int32_t>(position.z);
+		stream.WriteRaw<BlockID>(block);
+		m_Client.SendBuffer(stream.GetBuffer());
+	}
+
+	void ClientLayer::MarkNeighboursDirty(const ChunkCoord& coord)
+	{
+		for (const ChunkCoord& neighbour : {
+			ChunkCoord{ coord.X + 1, coord.Y, coord.Z }, ChunkCoord{ coord.X - 1, coord.Y, coord.Z },
+			ChunkCoord{ coord.X, coord.Y + 1, coord.Z }, ChunkCoord{ coord.X, coord.Y - 1, coord.Z },
+			ChunkCoord{ coord.X, coord.Y, coord.Z + 1 }, ChunkCoord{ coord.X, coord.Y, coord.Z - 1 } })
+		{
+			if (m_Chunks.contains(neighbour))
+				m_MeshScheduler.MarkDirty(neighbour);
+		}
+	}
+
+	double ClientLayer::GetLocalTime() const
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_StartTime).count();
 	}
 
+	void ClientLayer::ReportStartup()
+	{
+		m_StartupReported = true;
+
+		float firstFrame = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - m_Settings.ProcessStart).count();
+		Renderer::InitStatistics init = m_Renderer.GetInitStatistics();
+		WL_INFO_TAG("Client", "First frame {:.1f}ms after process start, {} pipeline cache ({})", firstFrame,
+			init.PipelineCache.Warm ? "warm" : "cold", init.PipelineCache.Status);
+		WL_INFO_TAG("Client", "  renderer init {:.1f}ms: shaders {:.2f}ms, pipeline cache load {:.2f}ms, {} pipelines {:.2f}ms",
+			init.InitTime, init.ShaderLoadTime, init.PipelineCache.LoadTime, init.PipelineCache.PipelinesCreated, init.PipelineCache.CreateTime);
+
+		if (m_Settings.StartupBenchmark)
+			Application::Get().Close();
+	}
 
 	void ClientLayer::OnDetach() 
 	{
-		s_ScratchBuffer.Release();
 	}
 
 	void ClientLayer::OnUpdate(float ts)
 	{
+		CUBED_PROFILE_ZONE("ClientLayer::OnUpdate");
+
+		// the first frame has been submitted and presented by the time the next update comes around
+		if (m_FramesRendered > 0 && !m_StartupReported)
+			ReportStartup();
+
+		// terrain from the server, meshed in the background nearest first
+		UpdateWorld();
+		m_MeshScheduler.Dispatch(m_Camera.Position, m_Chunks);
+
 		// if not connected, ignore movement
 	/*	if (m_Client.GetConnectionStatus() != Client::ConnectionStatus::Connected)
 			return;*/
 
 		// read wasd inputs on update  to move square
-		glm::vec2 dir{ 0.0f, 0.0f };
+		PlayerInput input;
 		if (Input::IsKeyDown(KeyCode::W))
 		{
-			dir.y = -1;
+			input.MoveY = -1;
 		}
 		else if (Input::IsKeyDown(KeyCode::S))
 		{
-			dir.y = 1;
+			input.MoveY = 1;
 		}
 
 
 		if (Input::IsKeyDown(KeyCode::A))
 		{
-			dir.x = -1;
+			input.MoveX = -1;
 		}
 		else if (Input::IsKeyDown(KeyCode::D))
 		{
-			dir.x = 1;
+			input.MoveX = 1;
 		}
 
-		if (glm::length(dir) > 0.0f)
+		// snap back to wherever the server says we are before predicting any further
+		Reconcile();
+
+		bool connected = m_Client.GetConnectionStatus() == Client::ConnectionStatus::Connected;
+		if (!connected)
+			m_PendingInputs.Clear();
+
+		// movement runs in fixed steps, exactly like it does on the server
+		std::array<PlayerInput, MaxInputsPerPacket> newInputs;
+		uint32_t newInputCount = 0;
+
+		m_InputAccumulator = glm::min(m_InputAccumulator + ts, PlayerInputInterval * MaxInputsPerPacket);
+		while (m_InputAccumulator >= PlayerInputInterval)
 		{
-			// avoid longer diagonals
-			dir = glm::normalize(dir);
-			
-			m_PlayerVelocity = dir * speed;
+			m_InputAccumulator -= PlayerInputInterval;
+
+			input.Sequence = m_NextInputSequence++;
+			ApplyPlayerInput(m_Player, input, m_MovementSettings);
+
+			if (connected)
+			{
+				m_PendingInputs.Push(input);
+				newInputs[newInputCount++] = input;
+			}
 		}
 
-		m_PlayerPosition += m_PlayerVelocity * ts;
+		if (newInputCount > 0)
+		{
+			// send our inputs to the server, it simulates them the same way we just did
+			PacketBuffer packet = PacketBuffer::Allocate(sizeof(PacketType) + sizeof(uint32_t) * 3 + MaxInputsPerPacket);
+			BufferStreamWriter stream(packet.GetBuffer());
+			stream.WriteRaw(PacketType::ClientInput);
 
-		m_PlayerVelocity = glm::mix(m_PlayerVelocity, glm::vec2(0.0f), friction * ts); // lerp decay at a rate of 10f
+			BitWriter bits(stream);
 
-		m_PlayerRotation.y += ts * 20.0f;
+			// acknowledge latest snapshot so the server can use it as a delta baseline
+			m_PlayerDataMutex.lock();
+			bits.WriteVarUInt(m_LastSnapshotID);
+			m_PlayerDataMutex.unlock();
 
-		if (m_Client.GetConnectionStatus() == Client::ConnectionStatus::Connected)
-		{
+			WritePlayerInputs(bits, newInputs.data(), newInputCount);
 
-			// send player data to server
-			BufferStreamWriter stream(s_ScratchBuffer);
-			stream.WriteRaw(PacketType::ClientUpdate);
-			stream.WriteRaw<glm::vec2>(m_PlayerPosition);
-			stream.WriteRaw<glm::vec2>(m_PlayerVelocity);
+			bits.Flush();
 			m_Client.SendBuffer(stream.GetBuffer());
 		}
 	}
 
+	void ClientLayer::Reconcile()
+	{
+		m_PlayerDataMutex.lock();
+		ServerCorrection correction = m_ServerCorrection;
+		m_ServerCorrection.Pending = false;
+		m_PlayerDataMutex.unlock();
+
+		if (!correction.Pending)
+			return;
+
+		// replay what the server hasn't seen yet on top of its state, with deterministic movement
+		// this lands exactly where we predicted unless the server disagreed about something
+		PlayerData replayed = m_PendingInputs.Reconcile(correction.Player, correction.LastProcessedInput, m_MovementSettings);
+
+		if (std::memcmp(&replayed, &m_Player, sizeof(PlayerData)) != 0)
+		{
+			m_PredictionStats.Mispredictions++;
+			m_PredictionStats.LastCorrection = glm::length(replayed.Position - m_Player.Position);
+		}
+		m_PredictionStats.Reconciliations++;
+
+		m_Player = replayed;
+	}
+
 	void ClientLayer::OnRender()
 	{
+		CUBED_PROFILE_ZONE("ClientLayer::OnRender");
+
 		// 1. bind pipeline
 		// 2. bind vertex/index buffers
 		// 3. draw call
 
 		m_Renderer.BeginScene(m_Camera);
 
+		m_MeshScheduler.Collect(m_Renderer);
+		m_Renderer.RenderChunks();
+
 		//Client::ConnectionStatus connectionStatus = m_Client.GetConnectionStatus();
 		//if (connectionStatus == Client::ConnectionStatus::Connected)
 		{
+			CUBED_PROFILE_ZONE("ClientLayer::SubmitPlayers");
+
 			// draw self
-			m_Renderer.RenderCube(glm::vec3(m_PlayerPosition.x, 0.5f, m_PlayerPosition.y), m_PlayerRotation);
+			m_Renderer.SubmitCube(glm::vec3(m_Player.Position.x, 0.5f, m_Player.Position.y), m_Player.Rotation);
 
-			// read other players' data
+			// where everyone else is right now, smoothed between the snapshots we received
 			m_PlayerDataMutex.lock();
-			std::map<uint32_t, PlayerData> playerData = m_PlayerData;
+			m_InterpolationStats = m_Interpolation.Sample(GetLocalTime(), m_RenderPlayers);
 			m_PlayerDataMutex.unlock();
 
+			const std::vector<uint32_t>& ids = m_RenderPlayers.GetIDs();
+			const std::vector<glm::vec2>& positions = m_RenderPlayers.GetPositions();
+			const std::vector<glm::vec3>& rotations = m_RenderPlayers.GetRotations();
+
 			// process data freely outside of lock
-			for (const auto& [id, data] : playerData)
+			for (size_t i = 0; i < ids.size(); i++)
 			{
 				// skip ourselves
-				if (id == m_PlayerID)
+				if (ids[i] == m_PlayerID)
 					continue;
 
-				// draw other players (do not have rotation data so set to 0)
-				m_Renderer.RenderCube(glm::vec3(data.Position.x, 0.5f, data.Position.y), {0.0f, 0.0f, 0.0f});
+				// draw other players
+				m_Renderer.SubmitCube(glm::vec3(positions[i].x, 0.5f, positions[i].y), rotations[i]);
+			}
+		}
+
+		// stress grid for measuring how the renderer scales with cube count
+		if (m_BenchmarkCubeCount > 0)
+		{
+			CUBED_PROFILE_ZONE("ClientLayer::SubmitBenchmarkCubes");
+			int gridSize = (int)std::ceil(std::sqrt((float)m_BenchmarkCubeCount));
+			for (int i = 0; i < m_BenchmarkCubeCount; i++)
+			{
+				glm::vec3 position((float)(i % gridSize - gridSize / 2) * 1.5f, -1.0f, -(float)(i / gridSize) * 1.5f);
+				m_Renderer.SubmitCube(position, glm::vec3(0.0f, (float)i * 7.0f, 0.0f));
 			}
 		}
 
 		m_Renderer.EndScene(m_Camera);
+		m_FramesRendered++;
 	}
 
 	void ClientLayer::OnUIRender()
@@ -145,22 +376,24 @@ namespace Cubed
 			{
 
 				// draw self
-				DrawRect(m_PlayerPosition, { 50.0f, 50.0f }, 0xffff00ff);
+				DrawRect(m_Player.Position, { 50.0f, 50.0f }, 0xffff00ff);
 
 				// read other players' data
+				// only the dense arrays we need, no lookup tables
 				m_PlayerDataMutex.lock();
-				std::map<uint32_t, PlayerData> playerData = m_PlayerData;
+				std::vector<uint32_t> ids = m_PlayerData.GetIDs();
+				std::vector<glm::vec2> positions = m_PlayerData.GetPositions();
 				m_PlayerDataMutex.unlock();
 
 				// process data freely outside of lock
-				for (const auto& [id, data] : playerData)
+				for (size_t i = 0; i < ids.size(); i++)
 				{
 					// skip ourselves
-					if (id == m_PlayerID)
+					if (ids[i] == m_PlayerID)
 						continue;
 
 					// draw other players
-					DrawRect(data.Position, { 50.0f, 50.0f }, 0xff00ff00);
+					DrawRect(positions[i], { 50.0f, 50.0f }, 0xff00ff00);
 				}
 			}
 		}
@@ -178,6 +411,8 @@ namespace Cubed
 			if (ImGui::Button("Connect"))
 			{
 				m_Client.ConnectToServer(m_serverAddress);
+				m_ConnectTime = std::chrono::steady_clock::now();
+				m_WorldStats = {};
 			}
 
 			ImGui::End();
@@ -186,20 +421,70 @@ namespace Cubed
 		m_Renderer.RenderUI();
 
 		ImGui::Begin("Controls");
-		ImGui::DragFloat3("Player Position", glm::value_ptr(m_PlayerPosition), 0.05f);
-		ImGui::DragFloat3("Player Rotation", glm::value_ptr(m_PlayerRotation), 0.05f);
+		ImGui::DragFloat2("Player Position", glm::value_ptr(m_Player.Position), 0.05f);
+		ImGui::DragFloat3("Player Rotation", glm::value_ptr(m_Player.Rotation), 0.05f);
 
 		ImGui::DragFloat3("Camera Position", glm::value_ptr(m_Camera.Position), 0.05f);
 		ImGui::DragFloat3("Camera Rotation", glm::value_ptr(m_Camera.Rotation), 0.05f);
+		ImGui::DragInt("Benchmark Cubes", &m_BenchmarkCubeCount, 10.0f, 0, 1000000);
+
+		ImGui::Text("World: %zu chunks, %llu received (%llu KB), %llu edits (%llu stale), %s", m_Chunks.size(),
+			(unsigned long long)m_WorldStats.ChunksReceived, (unsigned long long)(m_WorldStats.ChunkBytesReceived / 1024),
+			(unsigned long long)m_WorldStats.EditsReceived, (unsigned long long)m_WorldStats.StaleEdits,
+			m_WorldStats.Streaming ? "streaming" : "up to date");
+		if (m_WorldStats.InitialLoadTime > 0.0f)
+			ImGui::Text("Everything in range arrived %.2fs after connecting", m_WorldStats.InitialLoadTime);
+
+		ImGui::DragInt3("Edit Block Position", glm::value_ptr(m_EditPosition), 0.1f);
+		ImGui::InputInt("Edit Block", &m_EditBlock);
+		if (ImGui::Button("Set Block"))
+			SendSetBlock(m_EditPosition, (BlockID)glm::clamp(m_EditBlock, 0, (int)UINT16_MAX));
+
+		ChunkMeshSettings& meshSettings = m_MeshScheduler.GetSettings();
+		ImGui::DragScalar("Mesh Uploads Per Frame", ImGuiDataType_U32, &meshSettings.MaxUploadsPerFrame, 0.1f);
+		ImGui::DragFloat("Mesh LOD Distance", &meshSettings.LodDistance, 1.0f, 0.0f, 1000.0f);
+		const ChunkMeshScheduler::Statistics& meshStats = m_MeshScheduler.GetStatistics();
+		ImGui::Text("Chunk meshing: %u pending, %u queued, %u in flight, %u uploaded this frame",
+			meshStats.Pending, meshStats.QueueDepth, meshStats.InFlight, meshStats.Uploads);
+		ImGui::Text("Mesh latency: avg %.2fms, max %.2fms, %.3fms meshing (%llu built, %llu stale)",
+			meshStats.AverageLatency, meshStats.MaxLatency, meshStats.AverageMeshTime,
+			(unsigned long long)meshStats.MeshesBuilt, (unsigned long long)meshStats.StaleMeshes);
+
+		m_PlayerDataMutex.lock();
+		InterpolationSettings& interpolation = m_Interpolation.GetSettings();
+		ImGui::DragFloat("Interpolation Delay", &interpolation.Delay, 0.005f, 0.0f, 1.0f);
+		ImGui::DragFloat("Max Extrapolation", &interpolation.MaxExtrapolation, 0.005f, 0.0f, 1.0f);
+		m_PlayerDataMutex.unlock();
+
+		ImGui::Text("Interpolated %u, extrapolated %u, clamped %u", m_InterpolationStats.Interpolated,
+			m_InterpolationStats.Extrapolated, m_InterpolationStats.Clamped);
+		ImGui::Text("Inputs in flight %zu, reconciled %llu, mispredicted %llu (last off by %.3f)", m_PendingInputs.Size(),
+			(unsigned long long)m_PredictionStats.Reconciliations, (unsigned long long)m_PredictionStats.Mispredictions,
+			m_PredictionStats.LastCorrection);
+
+#if CUBED_PROFILING
+		// the last few seconds of every thread, open it in chrome://tracing or ui.perfetto.dev
+		if (ImGui::Button("Save Profile"))
+		{
+			if (Profiler::WriteChromeTrace("ClientProfile.json"))
+				WL_INFO_TAG("Client", "Wrote profile to ClientProfile.json");
+			else
+				WL_WARN_TAG("Client", "Could not write profile to ClientProfile.json");
+		}
+#endif
 		ImGui::End();
 	}
 
 	void ClientLayer::OnDataReceived(const Walnut::Buffer buffer)
 	{
+		CUBED_PROFILE_ZONE("ClientLayer::OnDataReceived");
+
 		BufferStreamReader stream(buffer);
 
 		PacketType type;
-		stream.ReadRaw(type);
+		if (!stream.ReadRaw(type))
+			return;
+
 		switch (type)
 		{
 		case PacketType::ClientConnect:
@@ -209,12 +494,110 @@ namespace Cubed
 			//WL_INFO("We say our ID is {}", m_Client.GetID());
 			break;
 		case PacketType::ClientUpdate:
-			// list of other clients
-			m_PlayerDataMutex.lock();
-			stream.ReadMap(m_PlayerData);
-			m_PlayerDataMutex.unlock();
+		{
+			// list of other clients, delta compressed against an older snapshot
+			uint32_t snapshotID, baselineID, serverTime, lastProcessedInput;
+			PlayerData serverPlayer;
+			// a truncated header would hand reconciliation garbage to rewind our player to
+			if (!stream.ReadRaw<uint32_t>(snapshotID) || !stream.ReadRaw<uint32_t>(baselineID) || !stream.ReadRaw<uint32_t>(serverTime)
+				|| !stream.ReadRaw<uint32_t>(lastProcessedInput) || !stream.ReadRaw<PlayerData>(serverPlayer))
+				break;
+
+			std::scoped_lock<std::mutex> lock(m_PlayerDataMutex);
+
+			// our own player, picked up by the main thread on its next update
+			m_ServerCorrection = { lastProcessedInput, serverPlayer, true };
+
+			static const EntityStore s_EmptyBaseline;
+			const EntityStore* baseline = &s_EmptyBaseline;
+			if (baselineID != NoSnapshotBaseline)
+			{
+				const Snapshot& history = m_SnapshotHistory[baselineID % m_SnapshotHistory.size()];
+				// baseline fell out of history, wait for the server to resync us
+				if (history.ID != baselineID)
+					break;
+
+				baseline = &history.Players;
+			}
+
+			// invalidate the slot first in case the packet turns out to be truncated
+			Snapshot& snapshot = m_SnapshotHistory[snapshotID % m_SnapshotHistory.size()];
+			EntityStore players;
+			snapshot.ID = NoSnapshotBaseline;
+			if (!ReadSnapshotDelta(stream, *baseline, m_PlayerQuantization, players))
+				break;
+
+			snapshot.ID = snapshotID;
+			snapshot.Players = std::move(players);
+			m_Interpolation.PushSnapshot(serverTime / 1000.0, GetLocalTime(), snapshot.Players);
+			m_LastSnapshotID = snapshotID;
+			m_PlayerData = snapshot.Players;
+			break;
+		}
+		case PacketType::ChunkData:
+		{
+			// decoded here so the main thread only has to swap it in
+			ChunkUpdate update{ .UpdateType = ChunkUpdate::Type::Load };
+			auto blocks = std::make_shared<Chunk>();
+			if (!ReadChunkCoord(stream, update.Coord) || !stream.ReadRaw<uint32_t>(update.Version))
+				break;
+
+			uint64_t offset = stream.GetStreamPosition();
+			if (!DecompressChunk(buffer.Data + offset, buffer.Size - offset, *blocks))
+				break;
+
+			update.Blocks = std::move(blocks);
+			update.PacketSize = buffer.Size;
+
+			std::scoped_lock<std::mutex> lock(m_ChunkUpdateMutex);
+			m_ChunkUpdates.push_back(std::move(update));
+			break;
+		}
+		case PacketType::ChunkUnload:
+		{
+			ChunkUpdate update{ .UpdateType = ChunkUpdate::Type::Unload };
+			if (!ReadChunkCoord(stream, update.Coord))
+				break;
+
+			std::scoped_lock<std::mutex> lock(m_ChunkUpdateMutex);
+			m_ChunkUpdates.push_back(std::move(update));
+			break;
+		}
+		case PacketType::ChunkEdits:
+		{
+			ChunkUpdate update{ .UpdateType = ChunkUpdate::Type::Edits };
+			if (!ReadChunkCoord(stream, update.Coord) || !stream.ReadRaw<uint32_t>(update.FromVersion) || !stream.ReadRaw<uint32_t>(update.Version))
+				break;
+
+			BitReader bits(stream);
+			uint32_t count;
+			if (!bits.ReadVarUInt(count) || count > ChunkVolume)
+				break;
+
+			update.Edits.resize(count);
+			bool valid = true;
+			for (BlockEdit& edit : update.Edits)
+			{
+				uint32_t block;
+				valid = bits.ReadVarUInt(edit.Index) && bits.ReadVarUInt(block) && edit.Index < ChunkVolume && block <= UINT16_MAX;
+				if (!valid)
+					break;
+
+				edit.Block = (BlockID)block;
+			}
+			if (!valid)
+				break;
+
+			std::scoped_lock<std::mutex> lock(m_ChunkUpdateMutex);
+			m_ChunkUpdates.push_back(std::move(update));
 			break;
-			
+		}
+		case PacketType::ChunkStreamIdle:
+		{
+			std::scoped_lock<std::mutex> lock(m_ChunkUpdateMutex);
+			m_ChunkUpdates.push_back({ .UpdateType = ChunkUpdate::Type::StreamIdle });
+			break;
+		}
 		}
 	}
 
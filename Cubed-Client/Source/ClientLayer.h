@@ -5,15 +5,38 @@
 #include "Walnut/Layer.h"
 
 #include "Renderer/Renderer.h"
+#include "ChunkMeshScheduler.h"
+
+// cubed-common include
+#include "Chunk.h"
+#include "Interpolation.h"
+#include "PlayerMovement.h"
+#include "Snapshot.h"
 
 #include <glm/glm.hpp>
 
+#include <array>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 namespace Cubed 
 {
 
+	struct ClientSettings
+	{
+		RendererSettings Renderer;
+		bool StartupBenchmark = false; // quit once the first frame is out
+		std::chrono::steady_clock::time_point ProcessStart = std::chrono::steady_clock::now();
+	};
+
 	class ClientLayer : public Walnut::Layer
 	{
 	public:
+		ClientLayer(const ClientSettings& settings = {});
+
 		virtual void OnAttach() override;
 		virtual void OnDetach() override;
 
@@ -22,30 +45,113 @@ namespace Cubed
 		virtual void OnUIRender() override;
 	private:
 		void OnDataReceived(const Walnut::Buffer buffer);
+
+		// replays inputs the server hasn't applied yet on top of its latest state for us
+		void Reconcile();
+
+		// seconds since OnAttach, the clock snapshots and interpolation are measured against
+		double GetLocalTime() const;
+
+		// applies chunks, unloads and edits the server sent since the last frame
+		void UpdateWorld();
+		void ClearWorld();
+		void MarkNeighboursDirty(const ChunkCoord& coord);
+
+		void SendSetBlock(const glm::ivec3& position, BlockID block);
+
+		// logs how long it took from process start until the first frame was out
+		void ReportStartup();
 	private:
+		ClientSettings m_Settings;
+		uint64_t m_FramesRendered = 0;
+		bool m_StartupReported = false;
+
 		Renderer m_Renderer;
 		Camera m_Camera;
+		int m_BenchmarkCubeCount = 0; // extra cubes drawn to measure renderer throughput
+
+		// the server decides what's in the world and which part of it we get to see
+		ChunkMap m_Chunks;
+		std::unordered_map<ChunkCoord, uint32_t, ChunkCoordHash> m_ChunkVersions;
+		ChunkMeshScheduler m_MeshScheduler;
+
+		// decoded on the network thread, applied in order on the main thread
+		struct ChunkUpdate
+		{
+			enum class Type : uint8_t { None = 0, Load, Unload, Edits, StreamIdle };
 
-		glm::vec2 m_PlayerPosition{ 0, 0 };
-		glm::vec3 m_PlayerRotation{ 30.0f, 45.0f, 0 }; // in degrees
-		glm::vec2 m_PlayerVelocity{ 0, 0 };
+			Type UpdateType = Type::None;
+			ChunkCoord Coord;
+			uint32_t FromVersion = 0;
+			uint32_t Version = 0;
+			std::shared_ptr<const Chunk> Blocks;
+			std::vector<BlockEdit> Edits;
+			uint64_t PacketSize = 0;
+		};
+		std::mutex m_ChunkUpdateMutex;
+		std::vector<ChunkUpdate> m_ChunkUpdates;
+		std::vector<ChunkUpdate> m_AppliedChunkUpdates; // swapped with the above each frame
+
+		// main thread only
+		struct WorldStats
+		{
+			uint64_t ChunksReceived = 0;
+			uint64_t ChunkBytesReceived = 0;
+			uint64_t EditsReceived = 0;
+			uint64_t StaleEdits = 0; // for a chunk we don't have at the version they build on
+			bool Streaming = false;  // server still has chunks in range to send us
+			float InitialLoadTime = 0.0f; // seconds from connecting until everything in range arrived
+		} m_WorldStats;
+		std::chrono::steady_clock::time_point m_ConnectTime;
+
+		glm::ivec3 m_EditPosition{ 0, -1, 0 };
+		int m_EditBlock = 0;
 
-		const float speed = 150.0f;
-		const float friction = 10.0f;
+		// predicted locally from our inputs, the server has the final say
+		PlayerData m_Player = GetSpawnPlayerData();
+		MovementSettings m_MovementSettings;
+
+		float m_InputAccumulator = 0.0f;
+		uint32_t m_NextInputSequence = 1;
+		PendingInputs m_PendingInputs;
+
+		struct PredictionStats
+		{
+			uint64_t Reconciliations = 0;
+			uint64_t Mispredictions = 0; // replayed state wasn't bit-identical to the prediction
+			float LastCorrection = 0.0f;
+		} m_PredictionStats;
 
 		std::string m_serverAddress;
 
 		Walnut::Client m_Client;
 		uint32_t m_PlayerID;
 
-		struct PlayerData
-		{
-			glm::vec2 Position;
-			glm::vec2 Velocity;
-		};
-
 		// lock-safe map
 		std::mutex m_PlayerDataMutex;
-		std::map<uint32_t, PlayerData> m_PlayerData;
+		EntityStore m_PlayerData;
+
+		// latest authoritative state of our own player (guarded by m_PlayerDataMutex)
+		struct ServerCorrection
+		{
+			uint32_t LastProcessedInput = 0;
+			PlayerData Player;
+			bool Pending = false;
+		} m_ServerCorrection;
+
+		// recently received snapshots, indexed by ID, so server deltas can be applied to
+		// whichever one the server picked as a baseline (guarded by m_PlayerDataMutex)
+		std::array<Snapshot, 32> m_SnapshotHistory;
+		uint32_t m_LastSnapshotID = NoSnapshotBaseline;
+
+		// has to match the server's
+		PlayerQuantization m_PlayerQuantization;
+
+		// remote players are drawn a little in the past, smoothed between snapshots
+		// (buffer guarded by m_PlayerDataMutex, the rest only touched on the main thread)
+		InterpolationBuffer m_Interpolation;
+		InterpolationBuffer::Statistics m_InterpolationStats;
+		EntityStore m_RenderPlayers;
+		std::chrono::steady_clock::time_point m_StartTime;
 	};
 }
\ No newline at end of file
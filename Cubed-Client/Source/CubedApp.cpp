@@ -3,14 +3,62 @@
 
 #include "ClientLayer.h"
 
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+
+// as close to process start as we can measure from, time to first frame counts from here
+static const std::chrono::steady_clock::time_point s_ProcessStart = std::chrono::steady_clock::now();
+
+// Cubed-Client [--startup-bench] [--cold-start] [--frames-in-flight <n>]
+//   --startup-bench     logs the time to the first frame and quits
+//   --cold-start        ignores the pipeline cache on disk (it is still written)
+//   --frames-in-flight  how far the CPU may get ahead of the GPU, 1 turns overlap off
+static bool ParseArguments(int argc, char** argv, Cubed::ClientSettings& settings)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string_view option = argv[i];
+		if (option == "--startup-bench")
+			settings.StartupBenchmark = true;
+		else if (option == "--cold-start")
+			settings.Renderer.IgnorePipelineCache = true;
+		else if (option == "--frames-in-flight" && i + 1 < argc)
+		{
+			std::string_view value = argv[++i];
+			uint32_t& frames = settings.Renderer.FramesInFlight;
+			auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), frames);
+			if (error != std::errc() || end != value.data() + value.size() || frames < 1 || frames > Cubed::Renderer::MaxFramesInFlight)
+			{
+				std::cerr << "Invalid option " << option << ' ' << value << std::endl;
+				return false;
+			}
+		}
+		else
+		{
+			std::cerr << "Invalid option " << option << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
 Walnut::Application* Walnut::CreateApplication(int argc, char** argv)
 {
+	Cubed::ClientSettings settings;
+	settings.ProcessStart = s_ProcessStart;
+	if (!ParseArguments(argc, argv, settings))
+		std::exit(1);
+
 	Walnut::ApplicationSpecification spec;
 	spec.Name = "Walnut Example";
 	spec.CustomTitlebar = false;
 	spec.UseDockspace = false;
 
 	Walnut::Application* app = new Walnut::Application(spec);
-	app->PushLayer<Cubed::ClientLayer>();
+	app->PushLayer(std::make_shared<Cubed::ClientLayer>(settings));
 	return app;
-}
\ No newline at end of file
+}
@@ -0,0 +1,277 @@
+#include "GPUAllocator.h"
+
+#include "Walnut/Core/Log.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace Cubed {
+
+	// preferred block sizes, small heaps (like a 256MB BAR heap) get smaller blocks
+	static constexpr VkDeviceSize s_DeviceLocalBlockSize = 64ull * 1024 * 1024;
+	static constexpr VkDeviceSize s_HostVisibleBlockSize = 16ull * 1024 * 1024;
+
+	static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	GPUAllocator& GetGPUAllocator()
+	{
+		static GPUAllocator s_Allocator;
+		return s_Allocator;
+	}
+
+	void GPUAllocator::Init()
+	{
+		VkPhysicalDevice physicalDevice = GetVulkanInfo()->PhysicalDevice;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_MemoryProperties);
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		m_NonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+		m_Initialized = true;
+	}
+
+	GPUAllocator::Pool& GPUAllocator::GetPool(uint32_t memoryType, GPUResourceKind kind, uint32_t& outIndex)
+	{
+		for (uint32_t i = 0; i < (uint32_t)m_Pools.size(); i++)
+		{
+			if (m_Pools[i].MemoryType == memoryType && m_Pools[i].Kind == kind)
+			{
+				outIndex = i;
+				return m_Pools[i];
+			}
+		}
+
+		outIndex = (uint32_t)m_Pools.size();
+		Pool& pool = m_Pools.emplace_back();
+		pool.MemoryType = memoryType;
+		pool.Properties = m_MemoryProperties.memoryTypes[memoryType].propertyFlags;
+		pool.Kind = kind;
+		return pool;
+	}
+
+	bool GPUAllocator::AllocateBlock(Pool& pool, VkDeviceSize size, bool dedicated, uint32_t& outIndex)
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+
+		VkMemoryAllocateInfo allocInfo {
+			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+			.allocationSize = size,
+			.memoryTypeIndex = pool.MemoryType
+		};
+
+		Block block;
+		VkResult result = vkAllocateMemory(device, &allocInfo, nullptr, &block.Memory);
+		if (result != VK_SUCCESS)
+		{
+			WL_ERROR("Could not allocate {} bytes of device memory! {}", size, vkb::to_string(result));
+			return false;
+		}
+
+		if (pool.Properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+			VK_CHECK(vkMapMemory(device, block.Memory, 0, VK_WHOLE_SIZE, 0, (void**)&block.Mapped));
+
+		block.Allocator = std::make_unique<FreeListAllocator>(size);
+		block.Dedicated = dedicated;
+		m_DeviceAllocations++;
+
+		// reuse the slot of a block freed earlier, so existing allocations keep their index
+		auto it = std::find_if(pool.Blocks.begin(), pool.Blocks.end(), [](const Block& other) { return !other.Allocator; });
+		outIndex = (uint32_t)(it - pool.Blocks.begin());
+		if (it == pool.Blocks.end())
+			pool.Blocks.push_back(std::move(block));
+		else
+			*it = std::move(block);
+
+		return true;
+	}
+
+	void GPUAllocator::FreeBlock(Block& block)
+	{
+		// freeing the memory unmaps it too
+		vkFreeMemory(GetVulkanInfo()->Device, block.Memory, nullptr);
+		block = {};
+		m_DeviceAllocations--;
+	}
+
+	GPUAllocation GPUAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, GPUResourceKind kind)
+	{
+		std::scoped_lock<std::mutex> lock(m_Mutex);
+		if (!m_Initialized)
+			Init();
+
+		// first type that has everything asked for, same as Renderer::GetVulkanMemoryType
+		uint32_t memoryType = UINT32_MAX;
+		for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++)
+		{
+			if ((m_MemoryProperties.memoryTypes[i].propertyFlags & properties) == properties && requirements.memoryTypeBits & (1 << i))
+			{
+				memoryType = i;
+				break;
+			}
+		}
+
+		if (memoryType == UINT32_MAX)
+		{
+			WL_ERROR("No memory type with properties {} for this resource!", properties);
+			return {};
+		}
+
+		uint32_t poolIndex;
+		Pool& pool = GetPool(memoryType, kind, poolIndex);
+
+		// non-coherent memory is flushed in whole atoms, so no two allocations can share one
+		VkDeviceSize size = requirements.size;
+		VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+		bool hostVisible = pool.Properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		if (hostVisible && !(pool.Properties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+		{
+			alignment = std::max(alignment, m_NonCoherentAtomSize);
+			size = AlignUp(size, m_NonCoherentAtomSize);
+		}
+
+		VkDeviceSize heapSize = m_MemoryProperties.memoryHeaps[m_MemoryProperties.memoryTypes[memoryType].heapIndex].size;
+		VkDeviceSize blockSize = std::min(hostVisible ? s_HostVisibleBlockSize : s_DeviceLocalBlockSize, std::bit_floor(heapSize / 8));
+
+		uint32_t blockIndex = UINT32_MAX;
+		uint64_t offset = FreeListAllocator::InvalidOffset;
+		if (size > blockSize / 2)
+		{
+			if (!AllocateBlock(pool, size, true, blockIndex))
+				return {};
+			offset = pool.Blocks[blockIndex].Allocator->Allocate(size, alignment);
+		}
+		else
+		{
+			for (uint32_t i = 0; i < (uint32_t)pool.Blocks.size() && offset == FreeListAllocator::InvalidOffset; i++)
+			{
+				Block& block = pool.Blocks[i];
+				if (!block.Allocator || block.Dedicated)
+					continue;
+
+				offset = block.Allocator->Allocate(size, alignment);
+				blockIndex = i;
+			}
+
+			if (offset == FreeListAllocator::InvalidOffset)
+			{
+				if (!AllocateBlock(pool, blockSize, false, blockIndex))
+					return {};
+				offset = pool.Blocks[blockIndex].Allocator->Allocate(size, alignment);
+			}
+		}
+
+		const Block& block = pool.Blocks[blockIndex];
+
+		GPUAllocation allocation;
+		allocation.Memory = block.Memory;
+		allocation.Offset = offset;
+		allocation.Size = size;
+		allocation.Mapped = block.Mapped ? block.Mapped + offset : nullptr;
+		allocation.Pool = poolIndex;
+		allocation.Block = blockIndex;
+		return allocation;
+	}
+
+	void GPUAllocator::Free(const GPUAllocation& allocation)
+	{
+		std::scoped_lock<std::mutex> lock(m_Mutex);
+
+		// everything was already released by Shutdown
+		if (!allocation || allocation.Pool >= m_Pools.size())
+			return;
+
+		Pool& pool = m_Pools[allocation.Pool];
+		Block& block = pool.Blocks[allocation.Block];
+		if (!block.Allocator)
+			return;
+
+		block.Allocator->Free(allocation.Offset);
+		if (!block.Allocator->IsEmpty())
+			return;
+
+		// hang on to one empty block per pool so allocating and freeing a single resource
+		// doesn't go back and forth to the driver, this one goes if another is already empty
+		bool spareBlock = std::any_of(pool.Blocks.begin(), pool.Blocks.end(), [&block](const Block& other)
+		{
+			return &other != &block && other.Allocator && !other.Dedicated && other.Allocator->IsEmpty();
+		});
+
+		if (block.Dedicated || spareBlock)
+			FreeBlock(block);
+	}
+
+	void GPUAllocator::Flush(const GPUAllocation& allocation)
+	{
+		std::scoped_lock<std::mutex> lock(m_Mutex);
+		if (!allocation.Mapped || allocation.Pool >= m_Pools.size())
+			return;
+
+		if (m_Pools[allocation.Pool].Properties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+			return;
+
+		VkMappedMemoryRange range {
+			.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+			.memory = allocation.Memory,
+			.offset = allocation.Offset,
+			.size = allocation.Size
+		};
+		VK_CHECK(vkFlushMappedMemoryRanges(GetVulkanInfo()->Device, 1, &range));
+	}
+
+	void GPUAllocator::Shutdown()
+	{
+		std::scoped_lock<std::mutex> lock(m_Mutex);
+		for (Pool& pool : m_Pools)
+		{
+			for (Block& block : pool.Blocks)
+			{
+				if (block.Allocator)
+					FreeBlock(block);
+			}
+		}
+
+		m_Pools.clear();
+		m_Initialized = false;
+	}
+
+	GPUAllocator::Statistics GPUAllocator::GetStatistics()
+	{
+		std::scoped_lock<std::mutex> lock(m_Mutex);
+
+		Statistics stats;
+		stats.DeviceAllocations = m_DeviceAllocations;
+		for (const Pool& pool : m_Pools)
+		{
+			PoolStatistics& poolStats = stats.Pools.emplace_back();
+			poolStats.MemoryType = pool.MemoryType;
+			poolStats.DeviceLocal = pool.Properties & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+			poolStats.HostVisible = pool.Properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+			poolStats.Kind = pool.Kind;
+
+			for (const Block& block : pool.Blocks)
+			{
+				if (!block.Allocator)
+					continue;
+
+				FreeListAllocator::Statistics blockStats = block.Allocator->GetStatistics();
+				poolStats.Blocks++;
+				poolStats.Usage.Size += blockStats.Size;
+				poolStats.Usage.Used += blockStats.Used;
+				poolStats.Usage.Allocations += blockStats.Allocations;
+				poolStats.Usage.FreeRanges += blockStats.FreeRanges;
+				poolStats.Usage.LargestFreeRange = std::max(poolStats.Usage.LargestFreeRange, blockStats.LargestFreeRange);
+			}
+
+			stats.Reserved += poolStats.Usage.Size;
+			stats.Used += poolStats.Usage.Used;
+			stats.Allocations += poolStats.Usage.Allocations;
+		}
+
+		return stats;
+	}
+
+}
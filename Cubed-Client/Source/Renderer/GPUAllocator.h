@@ -0,0 +1,118 @@
+#pragma once
+
+#include "Vulkan.h"
+
+// cubed-common include
+#include "FreeListAllocator.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Cubed {
+
+	// buffers and optimally tiled images never share a block, so bufferImageGranularity
+	// never has to be thought about
+	enum class GPUResourceKind : uint8_t
+	{
+		Buffer = 0, Image
+	};
+
+	struct GPUAllocation
+	{
+		VkDeviceMemory Memory = VK_NULL_HANDLE;
+		VkDeviceSize Offset = 0;
+		VkDeviceSize Size = 0;
+		void* Mapped = nullptr; // host visible memory stays mapped, nullptr otherwise
+
+		uint32_t Pool = UINT32_MAX;
+		uint32_t Block = UINT32_MAX;
+
+		explicit operator bool() const { return Memory != VK_NULL_HANDLE; }
+	};
+
+	//
+	// GPUAllocator - sub-allocates buffers and images out of a few big device memory blocks
+	//
+	// Drivers cap the number of live vkAllocateMemory allocations (often at 4096) and each
+	// one is slow, so memory is taken from the driver in large blocks and resources get
+	// aligned ranges of those. There is a pool per memory type and resource kind, which keeps
+	// device local and host visible memory apart. Host visible blocks are mapped once when
+	// created, so allocations from them are always mapped. Anything bigger than half a block
+	// gets a block of its own, which is given back as soon as it is freed.
+	//
+	class GPUAllocator
+	{
+	public:
+		struct PoolStatistics
+		{
+			uint32_t MemoryType = 0;
+			bool DeviceLocal = false;
+			bool HostVisible = false;
+			GPUResourceKind Kind = GPUResourceKind::Buffer;
+			uint32_t Blocks = 0;
+			FreeListAllocator::Statistics Usage; // summed over every block, except LargestFreeRange
+		};
+
+		struct Statistics
+		{
+			uint32_t DeviceAllocations = 0; // live vkAllocateMemory allocations
+			uint64_t Reserved = 0;
+			uint64_t Used = 0;
+			uint32_t Allocations = 0;
+			std::vector<PoolStatistics> Pools;
+		};
+	public:
+		// Shutdown has to be called while the device is still around, the destructor can't
+		GPUAllocator() = default;
+
+		GPUAllocator(const GPUAllocator&) = delete;
+		GPUAllocator& operator=(const GPUAllocator&) = delete;
+
+		// returns an empty allocation if no memory type fits or the device is out of memory
+		GPUAllocation Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, GPUResourceKind kind);
+		void Free(const GPUAllocation& allocation);
+
+		// makes host writes visible to the device, does nothing for coherent memory
+		void Flush(const GPUAllocation& allocation);
+
+		// frees every block, whatever is still allocated becomes invalid
+		void Shutdown();
+
+		Statistics GetStatistics();
+	private:
+		struct Block
+		{
+			VkDeviceMemory Memory = VK_NULL_HANDLE;
+			uint8_t* Mapped = nullptr;
+			std::unique_ptr<FreeListAllocator> Allocator;
+			bool Dedicated = false;
+		};
+
+		struct Pool
+		{
+			uint32_t MemoryType = 0;
+			VkMemoryPropertyFlags Properties = 0;
+			GPUResourceKind Kind = GPUResourceKind::Buffer;
+			std::vector<Block> Blocks; // freed slots are left empty and reused
+		};
+	private:
+		void Init();
+		Pool& GetPool(uint32_t memoryType, GPUResourceKind kind, uint32_t& outIndex);
+		bool AllocateBlock(Pool& pool, VkDeviceSize size, bool dedicated, uint32_t& outIndex);
+		void FreeBlock(Block& block);
+	private:
+		std::mutex m_Mutex;
+		bool m_Initialized = false;
+
+		VkPhysicalDeviceMemoryProperties m_MemoryProperties{};
+		VkDeviceSize m_NonCoherentAtomSize = 1;
+
+		std::vector<Pool> m_Pools;
+		uint32_t m_DeviceAllocations = 0;
+	};
+
+	// shared by everything that creates Vulkan resources, like GetVulkanInfo
+	GPUAllocator& GetGPUAllocator();
+
+}
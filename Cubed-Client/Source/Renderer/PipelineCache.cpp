@@ -0,0 +1,194 @@
+#include "PipelineCache.h"
+
+#include "Walnut/Core/Log.h"
+
+// cubed-common include
+#include "JobSystem.h"
+#include "MappedFile.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace Cubed {
+
+	using Clock = std::chrono::steady_clock;
+
+	static float MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+	}
+
+	void PipelineCache::Init(const std::filesystem::path& path, bool ignoreFile)
+	{
+		Clock::time_point start = Clock::now();
+
+		VkDevice device = GetVulkanInfo()->Device;
+		vkGetPhysicalDeviceProperties(GetVulkanInfo()->PhysicalDevice, &m_DeviceProperties);
+		m_Path = path;
+
+		// the file only has to stay mapped until the driver has copied it into the cache
+		MappedFile file;
+		const uint8_t* data = nullptr;
+		uint64_t dataSize = 0;
+		if (ignoreFile)
+			m_Statistics.Status = "ignored";
+		else if (!file.Open(path))
+			m_Statistics.Status = "no cache file";
+		else
+			Validate(file.GetData(), file.GetSize(), data, dataSize);
+
+		VkPipelineCacheCreateInfo cacheInfo {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+			.initialDataSize = (size_t)dataSize,
+			.pInitialData = data
+		};
+		VkResult result = vkCreatePipelineCache(device, &cacheInfo, nullptr, &m_Cache);
+		if (result != VK_SUCCESS && data)
+		{
+			// the header looked right, but the driver didn't like what came after it
+			m_Statistics.Status = "rejected by driver";
+			cacheInfo.initialDataSize = 0;
+			cacheInfo.pInitialData = nullptr;
+			result = vkCreatePipelineCache(device, &cacheInfo, nullptr, &m_Cache);
+			data = nullptr;
+		}
+		VK_CHECK(result);
+
+		m_Statistics.Warm = data != nullptr;
+		m_Statistics.LoadedSize = m_Statistics.Warm ? dataSize : 0;
+		m_SavedDataSize = (size_t)m_Statistics.LoadedSize;
+		m_Statistics.LoadTime = MillisecondsSince(start);
+
+		WL_INFO_TAG("Renderer", "Pipeline cache {}: {} ({} bytes, {:.2f}ms)", m_Path.string(),
+			m_Statistics.Status, m_Statistics.LoadedSize, m_Statistics.LoadTime);
+	}
+
+	void PipelineCache::Shutdown()
+	{
+		if (m_Cache == VK_NULL_HANDLE)
+			return;
+
+		size_t size = 0;
+		VK_CHECK(vkGetPipelineCacheData(GetVulkanInfo()->Device, m_Cache, &size, nullptr));
+		if (size != m_SavedDataSize)
+			Save();
+
+		vkDestroyPipelineCache(GetVulkanInfo()->Device, m_Cache, nullptr);
+		m_Cache = VK_NULL_HANDLE;
+	}
+
+	bool PipelineCache::Save()
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+
+		// the size can't change in between, nothing else creates pipelines while this runs
+		size_t size = 0;
+		VK_CHECK(vkGetPipelineCacheData(device, m_Cache, &size, nullptr));
+		std::vector<uint8_t> data(size);
+		VK_CHECK(vkGetPipelineCacheData(device, m_Cache, &size, data.data()));
+
+		FileHeader header {
+			.Magic = s_Magic,
+			.Version = s_Version,
+			.DriverVersion = m_DeviceProperties.driverVersion,
+			.Checksum = Checksum(data.data(), size),
+			.DataSize = size
+		};
+
+		std::filesystem::path temporaryPath = m_Path;
+		temporaryPath += ".tmp";
+		{
+			std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+			stream.write((const char*)&header, sizeof(header));
+			stream.write((const char*)data.data(), size);
+			if (!stream)
+			{
+				WL_ERROR("Could not write pipeline cache! {}", temporaryPath.string());
+				return false;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(temporaryPath, m_Path, error);
+		if (error)
+		{
+			WL_ERROR("Could not replace pipeline cache! {} ({})", m_Path.string(), error.message());
+			std::filesystem::remove(temporaryPath, error);
+			return false;
+		}
+
+		m_SavedDataSize = size;
+		m_Statistics.SavedSize = size;
+		return true;
+	}
+
+	void PipelineCache::CreateGraphicsPipelines(JobSystem& jobs, std::span<const VkGraphicsPipelineCreateInfo> createInfos, VkPipeline* outPipelines)
+	{
+		Clock::time_point start = Clock::now();
+
+		VkDevice device = GetVulkanInfo()->Device;
+		jobs.ParallelFor((uint32_t)createInfos.size(), [&](uint32_t i)
+		{
+			VK_CHECK(vkCreateGraphicsPipelines(device, m_Cache, 1, &createInfos[i], nullptr, &outPipelines[i]));
+		});
+
+		m_Statistics.PipelinesCreated += (uint32_t)createInfos.size();
+		m_Statistics.CreateTime += MillisecondsSince(start);
+
+		// saved right away on a cold start, so even a run that never shuts down cleanly leaves one behind
+		size_t size = 0;
+		VK_CHECK(vkGetPipelineCacheData(device, m_Cache, &size, nullptr));
+		if (size != m_SavedDataSize)
+			Save();
+	}
+
+	bool PipelineCache::Validate(const uint8_t* file, uint64_t size, const uint8_t*& outData, uint64_t& outDataSize)
+	{
+		FileHeader header;
+		VkPipelineCacheHeaderVersionOne driverHeader;
+		if (size < sizeof(header) + sizeof(driverHeader))
+		{
+			m_Statistics.Status = "truncated";
+			return false;
+		}
+
+		memcpy(&header, file, sizeof(header));
+		memcpy(&driverHeader, file + sizeof(header), sizeof(driverHeader));
+		const uint8_t* data = file + sizeof(header);
+
+		if (header.Magic != s_Magic || header.Version != s_Version)
+			m_Statistics.Status = "not a pipeline cache of this version";
+		else if (header.DataSize != size - sizeof(header))
+			m_Statistics.Status = "truncated";
+		else if (header.Checksum != Checksum(data, header.DataSize))
+			m_Statistics.Status = "corrupt";
+		else if (driverHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || driverHeader.headerSize < sizeof(driverHeader))
+			m_Statistics.Status = "unknown driver header";
+		else if (driverHeader.vendorID != m_DeviceProperties.vendorID || driverHeader.deviceID != m_DeviceProperties.deviceID
+			|| memcmp(driverHeader.pipelineCacheUUID, m_DeviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+			m_Statistics.Status = "made by another device";
+		else if (header.DriverVersion != m_DeviceProperties.driverVersion)
+			m_Statistics.Status = "made by another driver version";
+		else
+		{
+			m_Statistics.Status = "loaded";
+			outData = data;
+			outDataSize = header.DataSize;
+			return true;
+		}
+
+		return false;
+	}
+
+	uint32_t PipelineCache::Checksum(const uint8_t* data, uint64_t size)
+	{
+		// FNV-1a, only has to catch a damaged file
+		uint32_t hash = 2166136261u;
+		for (uint64_t i = 0; i < size; i++)
+			hash = (hash ^ data[i]) * 16777619u;
+		return hash;
+	}
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Vulkan.h"
+
+#include <filesystem>
+#include <span>
+
+namespace Cubed {
+
+	class JobSystem;
+
+	//
+	// PipelineCache - VkPipelineCache that outlives the process
+	//
+	// Compiling shaders into a pipeline is most of what creating one costs, and drivers can
+	// skip it for anything already in the cache. The cache data is saved to disk behind a small
+	// header of our own (size, checksum, driver version) and only given back to the driver if
+	// that header and the driver's own one match this device, so a stale or damaged file from
+	// another GPU or driver just means starting cold. The file is written to a temporary and
+	// renamed over the old one, so a crash while saving can't leave half a cache behind.
+	//
+	class PipelineCache
+	{
+	public:
+		struct Statistics
+		{
+			bool Warm = false;                 // started from a valid cache file
+			const char* Status = "not loaded"; // why the file was or wasn't used
+			uint64_t LoadedSize = 0;
+			uint64_t SavedSize = 0;
+			uint32_t PipelinesCreated = 0;
+			float LoadTime = 0.0f;             // ms reading and validating the file
+			float CreateTime = 0.0f;           // ms spent in pipeline creation
+		};
+	public:
+		// ignoreFile starts cold whatever is on disk, the result is still saved
+		void Init(const std::filesystem::path& path, bool ignoreFile = false);
+		// saves if anything was added since the last save, then destroys the cache
+		void Shutdown();
+
+		bool Save();
+
+		// creates every pipeline at once, spread over jobs. Pipeline creation is free threaded
+		// and so is the cache, so each one compiles on a thread of its own
+		void CreateGraphicsPipelines(JobSystem& jobs, std::span<const VkGraphicsPipelineCreateInfo> createInfos, VkPipeline* outPipelines);
+
+		VkPipelineCache GetHandle() const { return m_Cache; }
+		const Statistics& GetStatistics() const { return m_Statistics; }
+	private:
+		// written before the driver's data, which starts with a VkPipelineCacheHeaderVersionOne
+		struct FileHeader
+		{
+			uint32_t Magic = 0;
+			uint32_t Version = 0;
+			uint32_t DriverVersion = 0;
+			uint32_t Checksum = 0; // of the driver's data
+			uint64_t DataSize = 0;
+		};
+
+		static constexpr uint32_t s_Magic = 0x4f535043; // "CPSO"
+		static constexpr uint32_t s_Version = 1;
+	private:
+		// the file's cache data if it is valid for this device, sets the status either way
+		bool Validate(const uint8_t* file, uint64_t size, const uint8_t*& outData, uint64_t& outDataSize);
+		static uint32_t Checksum(const uint8_t* data, uint64_t size);
+	private:
+		VkPipelineCache m_Cache = VK_NULL_HANDLE;
+		std::filesystem::path m_Path;
+		VkPhysicalDeviceProperties m_DeviceProperties{};
+
+		// size of the cache data when last loaded or saved, it only grows as pipelines are added
+		size_t m_SavedDataSize = 0;
+
+		Statistics m_Statistics;
+	};
+
+}
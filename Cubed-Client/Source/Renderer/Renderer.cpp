@@ -6,14 +6,64 @@
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtx/euler_angles.hpp"
 
+// cubed-common include
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <cstring>
 
 namespace Cubed {
 
+	// dynamic arena size per frame before the first one has to grow
+	static constexpr VkDeviceSize s_InitialArenaCapacity = 256 * 1024;
+
+	static_assert(sizeof(ChunkVertex) == sizeof(Vertex) && offsetof(ChunkVertex, Normal) == offsetof(Vertex, Normal)
+		&& offsetof(ChunkVertex, Material) == offsetof(Vertex, Material), "chunk meshes are drawn with the cube pipeline");
+
+	// cheap per pixel noise for the placeholder block textures
+	static uint32_t HashPixel(uint32_t x, uint32_t y, uint32_t seed)
+	{
+		uint32_t h = x * 374761393u + y * 668265263u + seed * 2246822519u;
+		h = (h ^ (h >> 13)) * 1274126177u;
+		return h ^ (h >> 16);
+	}
+
 	Renderer::~Renderer()
 	{
 		VkDevice device = GetVulkanInfo()->Device;
+
+		// everything goes back to the allocator at once below, so nothing can still be in use
+		vkDeviceWaitIdle(device);
+
 		vkDestroyDescriptorPool(device, m_DescriptorPool, nullptr);
+
+		DestroyBuffer(m_VertexBuffer);
+		DestroyBuffer(m_IndexBuffer);
+
+		for (FrameContext& frame : m_Frames)
+		{
+			DestroyBuffer(frame.Arena);
+			DestroyBuffer(frame.Uniforms);
+			vkDestroyFence(device, frame.Fence, nullptr);
+			vkDestroyQueryPool(device, frame.Timestamps, nullptr);
+		}
+
+		for (auto& [coord, chunkMesh] : m_ChunkMeshes)
+		{
+			DestroyBuffer(chunkMesh.VertexBuffer);
+			DestroyBuffer(chunkMesh.IndexBuffer);
+		}
+
+		m_BlockTextures.reset();
+		m_Staging.Shutdown();
+		m_PipelineCache.Shutdown();
+
+		// buffers still waiting on a deferred free only have their handles destroyed after this
+		GetGPUAllocator().Shutdown();
 	}
 
 	// ripped from imgui implementation of vulkan
@@ -29,24 +79,37 @@ namespace Cubed {
 		return 0xFFFFFFFF; // Unable to find memoryType
 	}
 
-	void Renderer::Init()
+	void Renderer::Init(const RendererSettings& settings)
 	{
+		auto start = std::chrono::steady_clock::now();
+		m_Settings = settings;
+
+		m_Staging.Init();
+
 		// create texture shared ptr
-		uint32_t color = 0xffff00ff;
-		m_Texture = std::make_shared<Texture>(1, 1, Walnut::Buffer(&color, sizeof(uint32_t)));
+		InitBlockTextures();
 
 		// create descriptor set layout
 		VkDevice device = GetVulkanInfo()->Device;
-		VkDescriptorSetLayoutBinding binding[1] = {};
+		VkDescriptorSetLayoutBinding binding[2] = {};
 		binding[0] =
 		{
+			.binding = 0,
 			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
 			.descriptorCount = 1,
 			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
 		}; 
+		// frame uniforms, view projection and the like
+		binding[1] =
+		{
+			.binding = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_VERTEX_BIT
+		};
 		VkDescriptorSetLayoutCreateInfo info {
 			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-			.bindingCount = 1,
+			.bindingCount = 2,
 			.pBindings = binding
 		};
 
@@ -79,30 +142,21 @@ namespace Cubed {
 			VK_CHECK(vkCreateDescriptorPool(device, &pool_info, nullptr, &m_DescriptorPool));
 		}
 
-		// create descriptor set
-		VkDescriptorSetAllocateInfo allocInfo
-		{
-			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-			.descriptorPool = m_DescriptorPool,
-			.descriptorSetCount = 1,
-			.pSetLayouts = &m_DescriptorSetLayout
-		};
-		vkAllocateDescriptorSets(device, &allocInfo, &m_DescriptorSet);
-
-		VkWriteDescriptorSet wds{
-			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-			.dstSet = m_DescriptorSet,
-			.dstBinding = 0,
-			.descriptorCount = 1,
-			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-			.pImageInfo = &m_Texture->GetImageInfo()  // set texture 0 into descriptor set
-		};
-
-		vkUpdateDescriptorSets(device, 1, &wds, 0, nullptr);
+		// descriptor sets, uniforms and dynamic memory for every frame in flight
+		InitFrameContexts();
 
 		InitBuffers();
 		InitPipeline();
-		
+
+		// the texture and cube geometry, done by the time the first frame is drawn
+		m_Staging.Submit();
+
+		m_InitTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	Renderer::InitStatistics Renderer::GetInitStatistics() const
+	{
+		return { m_InitTime, m_ShaderLoadTime, m_PipelineCache.GetStatistics() };
 	}
 
 	void Renderer::Shutdown()
@@ -110,8 +164,176 @@ namespace Cubed {
 
 	}
 
+	void Renderer::InitFrameContexts()
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+
+		// time stamps only mean something if the queue keeps some bits of them
+		uint32_t queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(GetVulkanInfo()->PhysicalDevice, &queueFamilyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(GetVulkanInfo()->PhysicalDevice, &queueFamilyCount, queueFamilies.data());
+		uint32_t timestampBits = queueFamilies[GetVulkanInfo()->QueueFamily].timestampValidBits;
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(GetVulkanInfo()->PhysicalDevice, &properties);
+		m_TimestampPeriod = properties.limits.timestampPeriod;
+		m_TimestampMask = timestampBits >= 64 ? ~0ull : (1ull << timestampBits) - 1;
+
+		m_Frames.resize(std::clamp(m_Settings.FramesInFlight, 1u, MaxFramesInFlight));
+		for (FrameContext& frame : m_Frames)
+		{
+			frame.Uniforms.Usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+			CreateOrResizeBuffer(frame.Uniforms, sizeof(FrameUniforms), VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			GrowArena(frame, s_InitialArenaCapacity);
+
+			// create descriptor set
+			VkDescriptorSetAllocateInfo allocInfo
+			{
+				.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+				.descriptorPool = m_DescriptorPool,
+				.descriptorSetCount = 1,
+				.pSetLayouts = &m_DescriptorSetLayout
+			};
+			vkAllocateDescriptorSets(device, &allocInfo, &frame.DescriptorSet);
+
+			VkDescriptorBufferInfo uniformInfo { .buffer = frame.Uniforms.Handle, .offset = 0, .range = sizeof(FrameUniforms) };
+			std::array<VkWriteDescriptorSet, 2> wds;
+			wds[0] = {
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstSet = frame.DescriptorSet,
+				.dstBinding = 0,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.pImageInfo = &m_BlockTextures->GetImageInfo()  // set texture 0 into descriptor set
+			};
+			wds[1] = {
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstSet = frame.DescriptorSet,
+				.dstBinding = 1,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+				.pBufferInfo = &uniformInfo
+			};
+			vkUpdateDescriptorSets(device, (uint32_t)wds.size(), wds.data(), 0, nullptr);
+
+			VkFenceCreateInfo fenceInfo { .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+			VK_CHECK(vkCreateFence(device, &fenceInfo, nullptr, &frame.Fence));
+
+			if (timestampBits > 0)
+			{
+				VkQueryPoolCreateInfo queryInfo {
+					.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+					.queryType = VK_QUERY_TYPE_TIMESTAMP,
+					.queryCount = 2
+				};
+				VK_CHECK(vkCreateQueryPool(device, &queryInfo, nullptr, &frame.Timestamps));
+			}
+		}
+
+		m_OverlapWindowStart = std::chrono::steady_clock::now();
+	}
+
+	void Renderer::AcquireFrameContext(FrameContext& frame)
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+
+		// the other contexts' frames the GPU hasn't finished yet, anything above 0 means the CPU
+		// is recording while the GPU is still drawing
+		for (FrameContext& other : m_Frames)
+		{
+			if (&other != &frame && other.FenceSubmitted && vkGetFenceStatus(device, other.Fence) == VK_NOT_READY)
+				m_FrameStatistics.FramesInFlight++;
+		}
+
+		if (!frame.FenceSubmitted)
+			return;
+
+		if (vkGetFenceStatus(device, frame.Fence) == VK_NOT_READY)
+		{
+			// the CPU is a full set of frames ahead, this is where it waits for the GPU
+			auto waitStart = std::chrono::steady_clock::now();
+			VK_CHECK(vkWaitForFences(device, 1, &frame.Fence, VK_TRUE, UINT64_MAX));
+			m_FrameStatistics.FrameWaitTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+		}
+		VK_CHECK(vkResetFences(device, 1, &frame.Fence));
+		frame.FenceSubmitted = false;
+
+		if (frame.TimestampsWritten)
+		{
+			uint64_t timestamps[2];
+			if (vkGetQueryPoolResults(device, frame.Timestamps, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+				m_FrameStatistics.GPUTime = (float)((timestamps[1] - timestamps[0]) & m_TimestampMask) * m_TimestampPeriod / 1e6f;
+			frame.TimestampsWritten = false;
+		}
+	}
+
+	void Renderer::InitBlockTextures()
+	{
+		m_BlockTextures = std::make_shared<Texture>(TextureSpecification{
+			.Width = BlockTextureSize,
+			.Height = BlockTextureSize,
+			.Layers = BlockTextureLayers,
+			.GenerateMips = true,
+			.MagFilter = VK_FILTER_NEAREST // blocky up close
+		});
+
+		// placeholders until there are real textures to load, a base colour with some grain.
+		// Layer 0 stays magenta, that's what cubes without a material look like
+		struct BlockColor { BlockID Block; glm::vec3 Color; };
+		const BlockColor colors[] = {
+			{ 1, { 0.50f, 0.50f, 0.52f } }, // stone
+			{ 2, { 0.30f, 0.60f, 0.20f } }, // grass
+			{ 3, { 0.45f, 0.30f, 0.18f } }, // dirt
+			{ 4, { 0.86f, 0.80f, 0.55f } }, // sand
+			{ 5, { 0.95f, 0.95f, 0.97f } }, // snow
+			{ 6, { 0.20f, 0.35f, 0.75f } }  // water
+		};
+
+		std::vector<uint32_t> pixels(BlockTextureSize * BlockTextureSize);
+		for (const BlockColor& block : colors)
+		{
+			for (uint32_t y = 0; y < BlockTextureSize; y++)
+			{
+				for (uint32_t x = 0; x < BlockTextureSize; x++)
+				{
+					float grain = 0.85f + 0.3f * (float)(HashPixel(x, y, block.Block) & 0xff) / 255.0f;
+					glm::vec3 color = glm::clamp(block.Color * grain, glm::vec3(0.0f), glm::vec3(1.0f)) * 255.0f;
+					pixels[x + y * BlockTextureSize] = 0xff000000 | ((uint32_t)color.b << 16) | ((uint32_t)color.g << 8) | (uint32_t)color.r;
+				}
+			}
+			SetBlockTexture(block.Block, Walnut::Buffer(pixels.data(), pixels.size() * sizeof(uint32_t)));
+		}
+
+		// every layer in one go, the texture has to be readable before the first frame anyway
+		m_BlockTextures->Flush(m_Staging);
+	}
+
+	void Renderer::SetBlockTexture(BlockID block, Walnut::Buffer pixels)
+	{
+		m_BlockTextures->SetLayer(std::min<uint32_t>(block, BlockTextureLayers - 1), pixels);
+	}
+
 	void Renderer::BeginScene(const Camera& camera)
 	{
+		CUBED_PROFILE_ZONE("Renderer::BeginScene");
+
+		m_Staging.Update();
+		m_FrameStatistics = {};
+
+		// Walnut has submitted the last frame by now, a fence behind it on the queue signals
+		// once it (and everything before it) is done
+		VkQueue queue = GetVulkanInfo()->Queue;
+		if (m_Frame)
+		{
+			VK_CHECK(vkQueueSubmit(queue, 0, nullptr, m_Frame->Fence));
+			m_Frame->FenceSubmitted = true;
+		}
+
+		m_Frame = &m_Frames[m_FrameNumber++ % m_Frames.size()];
+		AcquireFrameContext(*m_Frame);
+		m_Frame->ArenaUsed = 0;
+
 		auto wd = Walnut::Application::GetMainWindowData();
 		float viewportHeight = (float)wd->Height;
 		float viewportWidth = (float)wd->Width;
@@ -122,8 +344,13 @@ namespace Cubed {
 		glm::mat4 cameraTransform = glm::translate(glm::mat4(1.0f), camera.Position)
 			* glm::eulerAngleXYZ(glm::radians(camera.Rotation.x), glm::radians(camera.Rotation.y), glm::radians(camera.Rotation.z));
 
-		m_PushConstants.ViewProjection = glm::perspectiveFov(glm::radians(45.0f), viewportWidth, viewportHeight, 0.1f, 1000.0f)
+		FrameUniforms uniforms;
+		uniforms.ViewProjection = glm::perspectiveFov(glm::radians(45.0f), viewportWidth, viewportHeight, 0.1f, 1000.0f)
 			* glm::inverse(cameraTransform);
+		memcpy(m_Frame->Uniforms.Allocation.Mapped, &uniforms, sizeof(uniforms));
+
+		m_Frustum = Frustum::FromViewProjection(uniforms.ViewProjection);
+		m_CameraPosition = camera.Position;
 
 		// set viewport for drawing later
 		// y and height are wonky because we flip the viewport to make it look "normal"
@@ -140,49 +367,303 @@ namespace Cubed {
 			.extent = {.width = (uint32_t)wd->Width, .height = (uint32_t)wd->Height} };
 		// Set scissor dynamically
 		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+		// GPU time stamps around everything the renderer records, reset outside the render pass
+		// in the staging batch, which is submitted ahead of the frame
+		if (m_Frame->Timestamps)
+		{
+			vkCmdResetQueryPool(m_Staging.GetCommandBuffer(), m_Frame->Timestamps, 0, 2);
+			vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_Frame->Timestamps, 0);
+		}
+
+		// how often the CPU got to start a frame while the GPU was still busy
+		m_OverlapWindowFrames++;
+		m_OverlappedFrames += m_FrameStatistics.FramesInFlight > 0;
+		float windowTime = std::chrono::duration<float>(std::chrono::steady_clock::now() - m_OverlapWindowStart).count();
+		if (windowTime >= 1.0f)
+		{
+			m_OverlapRatio = (float)m_OverlappedFrames / (float)m_OverlapWindowFrames;
+			m_OverlapWindowStart = std::chrono::steady_clock::now();
+			m_OverlapWindowFrames = m_OverlappedFrames = 0;
+		}
+
+		m_SceneStartTime = std::chrono::steady_clock::now();
 	}
 
 	void Renderer::EndScene(const Camera& camera)
 	{
+		CUBED_PROFILE_ZONE("Renderer::EndScene");
 
+		FlushBatch();
+
+		// block textures replaced during the frame, all in the same batch
+		m_BlockTextures->Flush(m_Staging);
+
+		if (m_Frame->Timestamps)
+		{
+			vkCmdWriteTimestamp(Walnut::Application::GetActiveCommandBuffer(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_Frame->Timestamps, 1);
+			m_Frame->TimestampsWritten = true;
+		}
+
+		// this frame's uploads have to go in before Walnut submits the frame that draws them
+		m_Staging.Submit();
+
+		m_FrameStatistics.DynamicUsed = m_Frame->ArenaUsed;
+		m_FrameStatistics.DynamicCapacity = m_Frame->Arena.Size;
+		m_FrameStatistics.OverlapRatio = m_OverlapRatio;
+		m_FrameStatistics.SceneTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - m_SceneStartTime).count();
+		m_Statistics = m_FrameStatistics;
 	}
 
-	// same for camera but uses position instead of m_CubePosition
-	void Renderer::RenderCube(const glm::vec3& position, const glm::vec3& rotation)
+	Renderer::DynamicAllocation Renderer::AllocateDynamic(VkDeviceSize size, VkDeviceSize alignment)
 	{
-		// apply cube position and rotation transforms
-		m_PushConstants.Transform = glm::translate(glm::mat4(1.0f), position)
-			* glm::eulerAngleXYZ(glm::radians(rotation.x), glm::radians(rotation.y), glm::radians(rotation.z));
+		FrameContext& frame = *m_Frame;
+		VkDeviceSize offset = (frame.ArenaUsed + alignment - 1) / alignment * alignment;
+		if (offset + size > frame.Arena.Size)
+		{
+			// everything in the old arena has been recorded already, it stays alive until the GPU is done with it.
+			// Sized for the whole frame so far, so the next frame fits without growing again
+			GrowArena(frame, offset + size);
+			offset = 0;
+		}
 
-		VkCommandBuffer commandBuffer = Walnut::Application::GetActiveCommandBuffer();
+		frame.ArenaUsed = offset + size;
+		return { frame.Arena.Handle, offset, frame.ArenaMapped + offset };
+	}
+
+	void Renderer::SubmitCube(const glm::vec3& position, const glm::vec3& rotation, uint32_t material)
+	{
+		m_CubeBatch.Add(position, rotation, material);
+	}
 
+	void Renderer::BindPipeline(VkCommandBuffer commandBuffer)
+	{
 		// Bind the graphics pipeline (no render pass in our renderer, so keep here)
 		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline);
 
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_DescriptorSet, 0, nullptr);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_Frame->DescriptorSet, 0, nullptr);
+	}
+
+	void Renderer::FlushBatch()
+	{
+		uint32_t count = m_CubeBatch.Size();
+		if (count == 0)
+			return;
+
+		// cubes are only ever drawn from here, SubmitCube is too small to time on its own
+		CUBED_PROFILE_ZONE("Renderer::FlushBatch");
+
+		auto cullStart = std::chrono::steady_clock::now();
+
+		uint32_t visibleCount = m_CubeBatch.Cull(m_CullingSettings.Enabled ? &m_Frustum : nullptr);
+		m_FrameStatistics.CubesSubmitted += count;
+		m_FrameStatistics.CubesCulled += count - visibleCount;
+
+		if (visibleCount > 0)
+		{
+			// written straight into mapped memory, never read back
+			DynamicAllocation instances = AllocateDynamic(visibleCount * sizeof(CubeInstance));
+			m_FrameStatistics.CubesLowDetail += m_CubeBatch.WriteInstances((CubeInstance*)instances.Mapped, m_CameraPosition, m_CullingSettings.CubeLodDistance);
+
+			VkCommandBuffer commandBuffer = Walnut::Application::GetActiveCommandBuffer();
+			BindPipeline(commandBuffer);
+
+			// cube vertices on binding 0, per instance transforms on binding 1
+			std::array<VkBuffer, 2> vertexBuffers = { m_VertexBuffer.Handle, instances.Buffer };
+			std::array<VkDeviceSize, 2> offsets = { 0, instances.Offset };
+			vkCmdBindVertexBuffers(commandBuffer, 0, (uint32_t)vertexBuffers.size(), vertexBuffers.data(), offsets.data());
+			vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer.Handle, 0, VK_INDEX_TYPE_UINT32);
+
+			// every visible cube in the batch in one go
+			vkCmdDrawIndexed(commandBuffer, 36, visibleCount, 0, 0, 0);
+
+			m_FrameStatistics.CubesDrawn += visibleCount;
+			m_FrameStatistics.DrawCalls++;
+		}
+
+		m_CubeBatch.Clear();
+		m_FrameStatistics.CullTime += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - cullStart).count();
+	}
+
+	void Renderer::UploadChunkMesh(const ChunkCoord& coord, const ChunkMesh& mesh)
+	{
+		CUBED_PROFILE_ZONE("Renderer::UploadChunkMesh");
+
+		RemoveChunkMesh(coord);
+		if (mesh.Empty())
+			return;
+
+		ChunkMeshBuffers& chunkMesh = m_ChunkMeshes[coord];
+		chunkMesh.IndexCount = (uint32_t)mesh.Indices.size();
+		chunkMesh.Lod = mesh.Lod;
+
+		uint64_t vertexSize = mesh.Vertices.size() * sizeof(ChunkVertex);
+		uint64_t indexSize = mesh.Indices.size() * sizeof(uint32_t);
+
+		chunkMesh.VertexBuffer.Usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		CreateOrResizeBuffer(chunkMesh.VertexBuffer, vertexSize);
+
+		chunkMesh.IndexBuffer.Usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		CreateOrResizeBuffer(chunkMesh.IndexBuffer, indexSize);
+
+		// same as the cube buffers, copied over by the GPU before this frame draws
+		m_Staging.UploadBuffer(chunkMesh.VertexBuffer.Handle, 0, mesh.Vertices.data(), vertexSize);
+		m_Staging.UploadBuffer(chunkMesh.IndexBuffer.Handle, 0, mesh.Indices.data(), indexSize);
+	}
+
+	void Renderer::RemoveChunkMesh(const ChunkCoord& coord)
+	{
+		auto it = m_ChunkMeshes.find(coord);
+		if (it == m_ChunkMeshes.end())
+			return;
+
+		// an earlier frame might still be drawing it
+		DestroyBufferDeferred(it->second.VertexBuffer);
+		DestroyBufferDeferred(it->second.IndexBuffer);
+		m_ChunkMeshes.erase(it);
+	}
+
+	void Renderer::RenderChunks()
+	{
+		// cubes submitted before this get drawn before the chunks, same as without batching
+		FlushBatch();
+
+		if (m_ChunkMeshes.empty())
+			return;
+
+		CUBED_PROFILE_ZONE("Renderer::RenderChunks");
+
+		auto cullStart = std::chrono::steady_clock::now();
+
+		m_ChunkDrawList.clear();
+		m_ChunkBounds.Clear();
+		for (const auto& [coord, chunkMesh] : m_ChunkMeshes)
+		{
+			glm::vec3 min = coord.GetWorldPosition();
+			m_ChunkDrawList.push_back({ coord, &chunkMesh });
+			m_ChunkBounds.Add(min, min + glm::vec3((float)ChunkSize));
+		}
+
+		uint32_t count = (uint32_t)m_ChunkDrawList.size();
+		m_Visibility.resize(count);
+		uint32_t visibleCount = count;
+		if (m_CullingSettings.Enabled)
+			visibleCount = m_Frustum.CullBoxes(m_ChunkBounds, m_Visibility.data());
+		else
+			std::fill(m_Visibility.begin(), m_Visibility.end(), (uint8_t)1);
+
+		m_FrameStatistics.ChunksSubmitted += count;
+		m_FrameStatistics.ChunksCulled += count - visibleCount;
+		m_FrameStatistics.CullTime += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - cullStart).count();
 
-		// use push constants to move cube
-		vkCmdPushConstants(commandBuffer, m_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &m_PushConstants);
+		if (visibleCount == 0)
+			return;
 
-		// bind vertex buffer and index buffer
-		VkDeviceSize offset{ 0 };
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_VertexBuffer.Handle, &offset);
-		vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer.Handle, offset, VK_INDEX_TYPE_UINT32);
+		// one instance per visible chunk, taken up front so the instance buffer can't change halfway
+		DynamicAllocation instances = AllocateDynamic(visibleCount * sizeof(CubeInstance));
+		CubeInstance* instanceData = (CubeInstance*)instances.Mapped;
+		uint32_t instance = 0;
 
-		// Draw three vertices with one instance from the currently bound vertex bound.
-		vkCmdDrawIndexed(commandBuffer, 36, 1, 0, 0, 0);
+		VkCommandBuffer commandBuffer = Walnut::Application::GetActiveCommandBuffer();
+		BindPipeline(commandBuffer);
+
+		VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers(commandBuffer, 1, 1, &instances.Buffer, &instances.Offset);
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (!m_Visibility[i])
+				continue;
+
+			const auto& [coord, chunkMesh] = m_ChunkDrawList[i];
+
+			// chunk vertices are relative to its corner, the instance transform moves it into place
+			// materials come from the vertices
+			instanceData[instance] = { glm::translate(glm::mat4(1.0f), coord.GetWorldPosition()), 0 };
+
+			vkCmdBindVertexBuffers(commandBuffer, 0, 1, &chunkMesh->VertexBuffer.Handle, &offset);
+			vkCmdBindIndexBuffer(commandBuffer, chunkMesh->IndexBuffer.Handle, 0, VK_INDEX_TYPE_UINT32);
+
+			vkCmdDrawIndexed(commandBuffer, chunkMesh->IndexCount, 1, 0, 0, instance);
+			instance++;
+
+			m_FrameStatistics.DrawCalls++;
+			m_FrameStatistics.Chunks++;
+			m_FrameStatistics.ChunksLowDetail += chunkMesh->Lod > 0;
+			m_FrameStatistics.ChunkTriangles += chunkMesh->IndexCount / 3;
+		}
 	}
 
 	void Renderer::RenderUI()
 	{
+		ImGui::Begin("Renderer");
+		ImGui::Checkbox("Frustum Culling", &m_CullingSettings.Enabled);
+		ImGui::DragFloat("Cube LOD Distance", &m_CullingSettings.CubeLodDistance, 1.0f, 0.0f, 1000.0f);
+		ImGui::Text("Cubes: %u submitted, %u culled, %u drawn (%u low detail)", m_Statistics.CubesSubmitted,
+			m_Statistics.CubesCulled, m_Statistics.CubesDrawn, m_Statistics.CubesLowDetail);
+		ImGui::Text("Chunks: %u submitted, %u culled, %u drawn (%u low detail, %llu triangles)", m_Statistics.ChunksSubmitted,
+			m_Statistics.ChunksCulled, m_Statistics.Chunks, m_Statistics.ChunksLowDetail, (unsigned long long)m_Statistics.ChunkTriangles);
+		ImGui::Text("Draw calls: %u", m_Statistics.DrawCalls);
+		ImGui::Text("Dynamic arena: %.1f / %.1f KB", m_Statistics.DynamicUsed / 1024.0f, m_Statistics.DynamicCapacity / 1024.0f);
+		ImGui::Text("Culling CPU time: %.3fms", m_Statistics.CullTime);
+		ImGui::Text("Scene CPU time: %.3fms", m_Statistics.SceneTime);
+		ImGui::Text("GPU time: %.3fms", m_Statistics.GPUTime);
+		ImGui::Text("Frames in flight: %u of %u (%.0f%% of frames overlapped the GPU), waited %.3fms",
+			m_Statistics.FramesInFlight + 1, (uint32_t)m_Frames.size(), m_Statistics.OverlapRatio * 100.0f, m_Statistics.FrameWaitTime);
+
+		const PipelineCache::Statistics& pipelineCache = m_PipelineCache.GetStatistics();
+		ImGui::Separator();
+		ImGui::Text("Block textures: %u layers, %u mips, %llu layer uploads", BlockTextureLayers, m_BlockTextures->GetMipLevels(),
+			(unsigned long long)m_BlockTextures->GetLayersUploaded());
+		ImGui::Text("Init: %.2fms (shaders %.2fms, %u pipelines %.2fms)", m_InitTime, m_ShaderLoadTime,
+			pipelineCache.PipelinesCreated, pipelineCache.CreateTime);
+		ImGui::Text("Pipeline cache: %s, %s (%.1f KB loaded, %.1f KB saved)", pipelineCache.Warm ? "warm" : "cold",
+			pipelineCache.Status, pipelineCache.LoadedSize / 1024.0f, pipelineCache.SavedSize / 1024.0f);
+
+		const StagingRing::Statistics& uploads = m_Staging.GetStatistics();
+		ImGui::Separator();
+		ImGui::Text("Uploads: %.2f MB/s, %llu submissions", uploads.Throughput, (unsigned long long)uploads.Submissions);
+		ImGui::Text("Staging ring: %.2f / %.2f MB in use, %u batches in flight", uploads.InUse / (1024.0f * 1024.0f),
+			uploads.Capacity / (1024.0f * 1024.0f), uploads.BatchesInFlight);
+		ImGui::Text("Upload stalls: %u (%.3fms) last second, %llu oversized", uploads.Stalls, uploads.StallTime,
+			(unsigned long long)uploads.OversizedUploads);
+
+		GPUAllocator::Statistics memory = GetGPUAllocator().GetStatistics();
+		ImGui::Separator();
+		ImGui::Text("Device allocations: %u (%u resources)", memory.DeviceAllocations, memory.Allocations);
+		ImGui::Text("GPU memory: %.2f / %.2f MB used", memory.Used / (1024.0f * 1024.0f), memory.Reserved / (1024.0f * 1024.0f));
+		for (const GPUAllocator::PoolStatistics& pool : memory.Pools)
+		{
+			ImGui::Text("  type %u %s%s%s: %u blocks, %.2f / %.2f MB, %u free ranges, %.0f%% fragmented", pool.MemoryType,
+				pool.Kind == GPUResourceKind::Image ? "images" : "buffers",
+				pool.DeviceLocal ? " device" : "", pool.HostVisible ? " host" : "",
+				pool.Blocks, pool.Usage.Used / (1024.0f * 1024.0f), pool.Usage.Size / (1024.0f * 1024.0f),
+				pool.Usage.FreeRanges, pool.Usage.GetFragmentation() * 100.0f);
+		}
+		ImGui::End();
+	}
+
+	void Renderer::GrowArena(FrameContext& frame, VkDeviceSize minCapacity)
+	{
+		// the old buffer may still be referenced by this frame's commands
+		if (frame.Arena.Handle)
+			DestroyBufferDeferred(frame.Arena);
 
+		VkDeviceSize capacity = std::bit_ceil(std::max(minCapacity, s_InitialArenaCapacity));
+
+		// coherent so the writes don't have to be flushed before the frame is submitted
+		frame.Arena = {};
+		frame.Arena.Usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+		CreateOrResizeBuffer(frame.Arena, capacity, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		frame.ArenaMapped = (uint8_t*)frame.Arena.Allocation.Mapped;
+
+		// nothing in the new buffer yet
+		frame.ArenaUsed = 0;
 	}
 
 
 	void Renderer::InitBuffers()
 	{
-		VkDevice device = GetVulkanInfo()->Device;
-
 		// create data to store in buffers
 		std::array<Vertex, 24> vertexData;
 		// front
@@ -236,74 +717,42 @@ namespace Cubed {
 			offset += 4;
 		}
 
-		// create buffers on cpu
-		m_VertexBuffer.Usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+		// create buffers in device local memory
+		m_VertexBuffer.Usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 		CreateOrResizeBuffer(m_VertexBuffer, vertexData.size() * sizeof(Vertex));
 
-		m_IndexBuffer.Usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+		m_IndexBuffer.Usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 		CreateOrResizeBuffer(m_IndexBuffer, indicies.size() * sizeof(uint32_t));
 
-		// create buffers on gpu and copy data to them
+		// and copy the data to them through the staging ring
 		// - vertex buffer
-		glm::vec3* vbMemory = nullptr;
-		VK_CHECK(vkMapMemory(device, m_VertexBuffer.Memory, 0, vertexData.size() * sizeof(Vertex), 0, (void**)&vbMemory));
-		memcpy(vbMemory, vertexData.data(), vertexData.size() * sizeof(Vertex));
+		m_Staging.UploadBuffer(m_VertexBuffer.Handle, 0, vertexData.data(), vertexData.size() * sizeof(Vertex));
 
 		// - index buffer
-		uint32_t* ibMemory = nullptr;
-		VK_CHECK(vkMapMemory(device, m_IndexBuffer.Memory, 0, indicies.size() * sizeof(uint32_t), 0, (void**)&ibMemory));
-		memcpy(ibMemory, indicies.data(), indicies.size() * sizeof(uint32_t));
-
-		// once the GPU gets the buffers, clear them on CPU side (flush then unmap)
-		VkMappedMemoryRange range[2] = {};
-		range[0] =
-		{
-			.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
-			.memory = m_VertexBuffer.Memory,
-			.size = VK_WHOLE_SIZE
-		};
-		range[1] =
-		{
-			.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
-			.memory = m_IndexBuffer.Memory,
-			.size = VK_WHOLE_SIZE
-		};
-		
-		VK_CHECK(vkFlushMappedMemoryRanges(device, 2, range));
-		vkUnmapMemory(device, m_VertexBuffer.Memory);
-		vkUnmapMemory(device, m_IndexBuffer.Memory);
+		m_Staging.UploadBuffer(m_IndexBuffer.Handle, 0, indicies.data(), indicies.size() * sizeof(uint32_t));
 
 	}
 
 	VkShaderModule Renderer::LoadShader(const std::filesystem::path& path)
 	{
-		std::ifstream stream(path, std::ios::binary);
-		if (!stream) // if not good or is not open
+		// mapped rather than read, the driver copies the code out of it while creating the module
+		MappedFile file;
+		if (!file.Open(path))
 		{
 			WL_ERROR("Could not open file! {}", path.string());
 			return nullptr;
 		}
 
-		// determine length of file, then return to beginning
-		stream.seekg(0, std::ios_base::end);
-		std::streampos size = stream.tellg();
-		stream.seekg(0, std::ios_base::beg);
-
-		// size is in bytes so use char
-		std::vector<char> buffer(size);
-
-		// copy file to buffer
-		if (!stream.read(buffer.data(), size))
+		// SPIR-V is made of 32 bit words, anything else is not a shader
+		if (file.GetSize() == 0 || file.GetSize() % sizeof(uint32_t) != 0)
 		{
-			WL_ERROR("Could not read file! {}", path.string());
+			WL_ERROR("Not a SPIR-V file! {}", path.string());
 			return nullptr;
 		}
-		 
-		stream.close();
 
 		VkShaderModuleCreateInfo shaderModuleCI{ VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
-		shaderModuleCI.pCode = (uint32_t*)buffer.data();
-		shaderModuleCI.codeSize = buffer.size();
+		shaderModuleCI.pCode = (const uint32_t*)file.GetData();
+		shaderModuleCI.codeSize = (size_t)file.GetSize();
 
 		// create shader module and check if it worked
 		VkDevice device = GetVulkanInfo()->Device;
@@ -321,20 +770,22 @@ namespace Cubed {
 		VkDevice device = GetVulkanInfo()->Device;
 		VkRenderPass renderPass = Walnut::Application::GetMainWindowData()->RenderPass;
 
-		// create pipeline with push constant information for viewprojection and transform matricies
-		std::array<VkPushConstantRange, 1> pushConstantRanges;
-		pushConstantRanges[0] = {
-			.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
-			.offset = 0,
-			.size = sizeof(glm::mat4) * 2
-		};
+		// shaders load and pipelines compile side by side, one job each
+		JobSystem jobs(std::min(JobSystem::GetDefaultWorkerCount(), 3u));
 
+		auto shaderStart = std::chrono::steady_clock::now();
+		std::array<std::filesystem::path, 2> shaderPaths{ "Assets/Shaders/bin/basic.vert.spirv", "Assets/Shaders/bin/basic.frag.spirv" };
+		std::array<VkShaderModule, 2> shaderModules{};
+		jobs.ParallelFor((uint32_t)shaderPaths.size(), [&](uint32_t i) { shaderModules[i] = LoadShader(shaderPaths[i]); });
+		m_ShaderLoadTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - shaderStart).count();
+
+		m_PipelineCache.Init(m_Settings.PipelineCachePath, m_Settings.IgnorePipelineCache);
+
+		// create pipeline, viewprojection comes from the frame's uniform buffer and transforms come per instance
 		VkPipelineLayoutCreateInfo layout_info{
-			.flags = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
 			.setLayoutCount = 1,
-			.pSetLayouts = &m_DescriptorSetLayout,
-			.pushConstantRangeCount = (uint32_t)pushConstantRanges.size(),
-			.pPushConstantRanges = pushConstantRanges.data(),
+			.pSetLayouts = &m_DescriptorSetLayout
 		};
 
 		VK_CHECK(vkCreatePipelineLayout(device, &layout_info, nullptr, &m_PipelineLayout));
@@ -348,15 +799,20 @@ namespace Cubed {
 		};
 
 		// pulled from IMGUI's implementation of Vulkan - vertex input setup
-		std::array<VkVertexInputBindingDescription, 1> binding_desc;
+		std::array<VkVertexInputBindingDescription, 2> binding_desc;
 		binding_desc[0] = {
 			.binding = 0,
 			.stride = sizeof(Vertex),
 			.inputRate = VK_VERTEX_INPUT_RATE_VERTEX
 		};
+		binding_desc[1] = {
+			.binding = 1,
+			.stride = sizeof(CubeInstance),
+			.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE
+		};
 
 		// assign attributes to send to vertex shader
-		std::array<VkVertexInputAttributeDescription, 2> attribute_desc;
+		std::array<VkVertexInputAttributeDescription, 8> attribute_desc;
 		// vertex position
 		attribute_desc[0] = {
 			.location = 0,
@@ -371,6 +827,29 @@ namespace Cubed {
 			.format = VK_FORMAT_R32G32B32_SFLOAT,
 			.offset = (uint32_t)offsetof(Vertex, Normal)
 		};
+		// instance transform, a mat4 takes up one location per column
+		for (uint32_t column = 0; column < 4; column++)
+		{
+			attribute_desc[2 + column] = {
+				.location = 2 + column,
+				.binding = binding_desc[1].binding,
+				.format = VK_FORMAT_R32G32B32A32_SFLOAT,
+				.offset = (uint32_t)(offsetof(CubeInstance, Transform) + sizeof(glm::vec4) * column)
+			};
+		}
+		// block texture layer, per vertex for chunks and per instance for cubes
+		attribute_desc[6] = {
+			.location = 6,
+			.binding = binding_desc[0].binding,
+			.format = VK_FORMAT_R32_UINT,
+			.offset = (uint32_t)offsetof(Vertex, Material)
+		};
+		attribute_desc[7] = {
+			.location = 7,
+			.binding = binding_desc[1].binding,
+			.format = VK_FORMAT_R32_UINT,
+			.offset = (uint32_t)offsetof(CubeInstance, Material)
+		};
 
 
 		VkPipelineVertexInputStateCreateInfo vertex_input{
@@ -426,14 +905,14 @@ namespace Cubed {
 		shader_stages[0] = {
 			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
 			.stage = VK_SHADER_STAGE_VERTEX_BIT,
-			.module = LoadShader("Assets/Shaders/bin/basic.vert.spirv"),
+			.module = shaderModules[0],
 			.pName = "main" };
 
 		// Fragment stage of the pipeline
 		shader_stages[1] = {
 			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
 			.stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-			.module = LoadShader("Assets/Shaders/bin/basic.frag.spirv"),
+			.module = shaderModules[1],
 			.pName = "main" };
 
 		VkGraphicsPipelineCreateInfo pipe {
@@ -452,21 +931,39 @@ namespace Cubed {
 			.renderPass = renderPass             // We need to specify the render pass up front
 		};
 
-		VK_CHECK(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipe, nullptr, &m_GraphicsPipeline));
+		// new pipelines go in here alongside it, so they all compile at once
+		std::array<VkGraphicsPipelineCreateInfo, 1> pipelines{ pipe };
+		m_PipelineCache.CreateGraphicsPipelines(jobs, pipelines, &m_GraphicsPipeline);
 
 		// Pipeline is baked, we can delete the shader modules now.
-		vkDestroyShaderModule(device, shader_stages[0].module, nullptr);
-		vkDestroyShaderModule(device, shader_stages[1].module, nullptr);
+		for (VkShaderModule shaderModule : shaderModules)
+			vkDestroyShaderModule(device, shaderModule, nullptr);
+	}
+
+	void Renderer::DestroyBuffer(Buffer& buffer)
+	{
+		if (buffer.Handle != VK_NULL_HANDLE)
+			vkDestroyBuffer(GetVulkanInfo()->Device, buffer.Handle, nullptr);
+		GetGPUAllocator().Free(buffer.Allocation);
+
+		buffer.Handle = VK_NULL_HANDLE;
+		buffer.Allocation = {};
+		buffer.Size = 0;
 	}
 
-	void Renderer::CreateOrResizeBuffer(Buffer& buffer, uint64_t newSize)
+	void Renderer::DestroyBufferDeferred(const Buffer& buffer)
+	{
+		Walnut::Application::SubmitResourceFree([buffer]() mutable
+		{
+			DestroyBuffer(buffer);
+		});
+	}
+
+	void Renderer::CreateOrResizeBuffer(Buffer& buffer, uint64_t newSize, VkMemoryPropertyFlags properties)
 	{
 		VkDevice device = GetVulkanInfo()->Device;
 
-		if (buffer.Handle != VK_NULL_HANDLE)
-			vkDestroyBuffer(device, buffer.Handle, nullptr);
-		if (buffer.Memory != VK_NULL_HANDLE)
-			vkFreeMemory(device, buffer.Memory, nullptr);
+		DestroyBuffer(buffer);
 
 		// create buffer
 		VkBufferCreateInfo bufferCI { 
@@ -482,16 +979,10 @@ namespace Cubed {
 		//
 		VkMemoryRequirements req;
 		vkGetBufferMemoryRequirements(device, buffer.Handle, &req);
-		//bd->BufferMemoryAlignment = (bd->BufferMemoryAlignment > req.alignment) ? bd->BufferMemoryAlignment : req.alignment;
-		VkMemoryAllocateInfo alloc_info {
-			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-			.allocationSize = req.size,
-			.memoryTypeIndex = GetVulkanMemoryType(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, req.memoryTypeBits)
-		};
-		
-		VK_CHECK(vkAllocateMemory(device, &alloc_info, nullptr, &buffer.Memory));
+		// a range of one of the allocator's blocks rather than an allocation of its own
+		buffer.Allocation = GetGPUAllocator().Allocate(req, properties, GPUResourceKind::Buffer);
 
-		VK_CHECK(vkBindBufferMemory(device, buffer.Handle, buffer.Memory, 0));
+		VK_CHECK(vkBindBufferMemory(device, buffer.Handle, buffer.Allocation.Memory, buffer.Allocation.Offset));
 		buffer.Size = req.size;
 	}
 
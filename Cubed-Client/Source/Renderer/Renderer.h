@@ -1,21 +1,32 @@
 #pragma once
 
 #include "Vulkan.h"
+#include "GPUAllocator.h"
+#include "StagingRing.h"
+#include "PipelineCache.h"
 
 #include "Texture.h"
 
+// cubed-common include
+#include "ChunkMesher.h"
+#include "CubeBatch.h"
+#include "Frustum.h"
+
 #include "glm/glm.hpp"
 
-#include <fstream>
+#include <chrono>
+#include <filesystem>
+#include <unordered_map>
+#include <vector>
 
 namespace Cubed {
 
 	struct Buffer
 	{
 		VkBuffer Handle = nullptr;
-		VkDeviceMemory Memory = nullptr;
+		GPUAllocation Allocation; // host visible buffers are mapped for as long as they live
 		VkDeviceSize Size = 0;
-		VkBufferUsageFlagBits Usage = VK_BUFFER_USAGE_FLAG_BITS_MAX_ENUM;
+		VkBufferUsageFlags Usage = 0;
 	};
 
 	struct Camera
@@ -28,12 +39,22 @@ namespace Cubed {
 	{
 		glm::vec3 Position;
 		glm::vec3 Normal;
+		uint32_t Material = 0; // layer of the block texture array, added to the instance's
+	};
+
+	struct RendererSettings
+	{
+		std::filesystem::path PipelineCachePath = "PipelineCache.bin";
+		bool IgnorePipelineCache = false; // start cold, to measure what the cache saves
+		uint32_t FramesInFlight = 2;      // frames the CPU can get ahead of the GPU, at most MaxFramesInFlight
 	};
 
 	class Renderer
 	{
 	public:
-		void Init();
+		static constexpr uint32_t MaxFramesInFlight = 4;
+
+		void Init(const RendererSettings& settings = {});
 		void Shutdown();
 
 		~Renderer();
@@ -42,38 +63,175 @@ namespace Cubed {
 		void EndScene(const Camera& camera);
 
 		void Render();
-		void RenderCube(const glm::vec3& position, const glm::vec3& rotation);
+
+		// queues a cube into the current batch, nothing is recorded until the batch is flushed.
+		// material picks the block texture, 0 is the untextured look
+		void SubmitCube(const glm::vec3& position, const glm::vec3& rotation, uint32_t material = 0);
+		// culls everything submitted since the last flush and records one instanced draw for
+		// what's left (EndScene flushes too)
+		void FlushBatch();
+
+		// chunk meshes stay on the GPU until replaced or removed, RenderChunks draws the visible ones
+		void UploadChunkMesh(const ChunkCoord& coord, const ChunkMesh& mesh);
+		void RemoveChunkMesh(const ChunkCoord& coord);
+		void RenderChunks();
+
 		void RenderUI();
+
+		// every block type is a layer of one array texture, so everything draws with one descriptor set.
+		// Replaced layers are uploaded together at the end of the scene
+		static constexpr uint32_t BlockTextureSize = 16;
+		static constexpr uint32_t BlockTextureLayers = 16; // block IDs past this use the last layer
+		void SetBlockTexture(BlockID block, Walnut::Buffer pixels);
+
+		struct CullingSettings
+		{
+			bool Enabled = true;
+			float CubeLodDistance = 96.0f; // cubes further than this from the camera are drawn without their rotation
+		};
+		CullingSettings& GetCullingSettings() { return m_CullingSettings; }
+
+		struct Statistics
+		{
+			uint32_t CubesSubmitted = 0;
+			uint32_t CubesCulled = 0;
+			uint32_t CubesDrawn = 0;
+			uint32_t CubesLowDetail = 0;   // drawn, past CubeLodDistance
+			uint32_t ChunksSubmitted = 0;  // every chunk with a mesh
+			uint32_t ChunksCulled = 0;
+			uint32_t Chunks = 0;           // drawn
+			uint32_t ChunksLowDetail = 0;  // drawn with a lower detail mesh
+			uint64_t ChunkTriangles = 0;
+			uint32_t DrawCalls = 0;
+			uint64_t DynamicUsed = 0;      // bytes of this frame's dynamic arena
+			uint64_t DynamicCapacity = 0;
+			float CullTime = 0.0f;         // CPU ms spent culling and picking detail
+			float SceneTime = 0.0f;        // CPU ms between BeginScene and EndScene
+
+			// CPU/GPU overlap, the GPU numbers are from the last frame that used this one's context
+			uint32_t FramesInFlight = 0;   // earlier frames the GPU was still busy with when this one started
+			float FrameWaitTime = 0.0f;    // CPU ms waiting for this frame's context to be free
+			float GPUTime = 0.0f;          // ms between the renderer's first and last command on the GPU
+			float OverlapRatio = 0.0f;     // share of frames over the last second that started with the GPU busy
+		};
+		const Statistics& GetStatistics() const { return m_Statistics; }
+
+		struct InitStatistics
+		{
+			float InitTime = 0.0f;       // ms in Init
+			float ShaderLoadTime = 0.0f; // ms of that reading SPIR-V and creating shader modules
+			PipelineCache::Statistics PipelineCache;
+		};
+		InitStatistics GetInitStatistics() const;
 	public:
 		static uint32_t GetVulkanMemoryType(VkMemoryPropertyFlags properties, uint32_t type_bits);
 	private:
 		void InitPipeline();
 		void InitBuffers();
-		void CreateOrResizeBuffer(Buffer& buffer, uint64_t newSize);
+		void InitBlockTextures();
+		// device local buffers are filled through m_Staging, so their usage needs TRANSFER_DST
+		void CreateOrResizeBuffer(Buffer& buffer, uint64_t newSize, VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		static void DestroyBuffer(Buffer& buffer);
+		// frees the buffer once the frames that might still use it are done
+		static void DestroyBufferDeferred(const Buffer& buffer);
+
+		void BindPipeline(VkCommandBuffer commandBuffer);
+
+		// memory for this frame's per draw data, like instances, until the GPU is done with the frame
+		struct DynamicAllocation
+		{
+			VkBuffer Buffer = VK_NULL_HANDLE;
+			VkDeviceSize Offset = 0;
+			void* Mapped = nullptr;
+		};
+		DynamicAllocation AllocateDynamic(VkDeviceSize size, VkDeviceSize alignment = 16);
+
+		struct FrameContext;
+		void InitFrameContexts();
+		// waits until the GPU is done with the context's last frame and picks up its timings
+		void AcquireFrameContext(FrameContext& frame);
+		// replaces the arena with one that holds at least minCapacity
+		void GrowArena(FrameContext& frame, VkDeviceSize minCapacity);
 
-		VkShaderModule LoadShader(const std::filesystem::path& path); // stage indicates what shader, and path is shader file
+		static VkShaderModule LoadShader(const std::filesystem::path& path); // stage indicates what shader, and path is shader file
 
 	private:
 		// graphics pipeline
 		VkPipeline m_GraphicsPipeline = nullptr;
 		VkPipelineLayout m_PipelineLayout = nullptr;
+		PipelineCache m_PipelineCache;
+		RendererSettings m_Settings;
+		float m_InitTime = 0.0f, m_ShaderLoadTime = 0.0f;
 
-		// texture sample info
+		// texture sample info and frame uniforms, a set per frame context
 		VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;
 		VkDescriptorSetLayout m_DescriptorSetLayout = nullptr;
-		VkDescriptorSet m_DescriptorSet = nullptr;
 
 		// buffers read through pipeline
 		Buffer m_VertexBuffer, m_IndexBuffer;
 
-		// push constant variables passed to vert shader
-		struct PushConstants
+		// uploads into device local buffers and images, submitted once per frame from EndScene
+		StagingRing m_Staging;
+
+		// uniform buffer contents, one per frame context
+		struct FrameUniforms
 		{
 			glm::mat4 ViewProjection;
-			glm::mat4 Transform;
-		} m_PushConstants;
+		};
 
-		std::shared_ptr<Texture> m_Texture; // dont want to copy it or accidentally delete it too early
+		// everything the CPU writes for a frame, so it can record the next frame while the GPU is
+		// still drawing this one. Contexts are used round robin and each one's fence is waited on
+		// before it is reused, so nothing in it is overwritten while the GPU reads it
+		struct FrameContext
+		{
+			// linear allocator over one mapped buffer, reset every frame
+			Buffer Arena;
+			uint8_t* ArenaMapped = nullptr;
+			VkDeviceSize ArenaUsed = 0;
+
+			Buffer Uniforms;
+			VkDescriptorSet DescriptorSet = VK_NULL_HANDLE;
+
+			// signaled once every frame submitted up to and including this one's is done
+			VkFence Fence = VK_NULL_HANDLE;
+			bool FenceSubmitted = false;
+
+			// GPU time stamps at BeginScene and EndScene, VK_NULL_HANDLE if the queue can't do them
+			VkQueryPool Timestamps = VK_NULL_HANDLE;
+			bool TimestampsWritten = false;
+		};
+		std::vector<FrameContext> m_Frames;
+		uint64_t m_FrameNumber = 0;
+		FrameContext* m_Frame = nullptr; // being recorded
+		float m_TimestampPeriod = 0.0f;  // ns per tick
+		uint64_t m_TimestampMask = 0;
+
+		// for OverlapRatio
+		std::chrono::steady_clock::time_point m_OverlapWindowStart;
+		uint32_t m_OverlapWindowFrames = 0, m_OverlappedFrames = 0;
+		float m_OverlapRatio = 0.0f;
+
+		CubeBatch m_CubeBatch; // cubes submitted since the last flush
+		std::vector<uint8_t> m_Visibility;
+
+		struct ChunkMeshBuffers
+		{
+			Buffer VertexBuffer, IndexBuffer;
+			uint32_t IndexCount = 0;
+			uint32_t Lod = 0;
+		};
+		std::unordered_map<ChunkCoord, ChunkMeshBuffers, ChunkCoordHash> m_ChunkMeshes;
+		std::vector<std::pair<ChunkCoord, const ChunkMeshBuffers*>> m_ChunkDrawList;
+		BoxBatch m_ChunkBounds;
+
+		CullingSettings m_CullingSettings;
+		Frustum m_Frustum;
+		glm::vec3 m_CameraPosition{ 0.0f };
+
+		Statistics m_Statistics, m_FrameStatistics;
+		std::chrono::steady_clock::time_point m_SceneStartTime;
+
+		std::shared_ptr<Texture> m_BlockTextures; // dont want to copy it or accidentally delete it too early
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,277 @@
+#include "StagingRing.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Cubed {
+
+	static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	void StagingRing::Init(VkDeviceSize capacity)
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+
+		VkCommandPoolCreateInfo poolInfo {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+			.queueFamilyIndex = GetVulkanInfo()->QueueFamily
+		};
+		VK_CHECK(vkCreateCommandPool(device, &poolInfo, nullptr, &m_CommandPool));
+
+		m_Ring = CreateBuffer(capacity);
+		m_Capacity = capacity;
+		m_Statistics.Capacity = capacity;
+	}
+
+	void StagingRing::Shutdown()
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+
+		// whatever is still in flight has to land before its staging memory goes away
+		while (!m_InFlight.empty())
+			Retire(true);
+
+		for (Batch& batch : m_Batches)
+		{
+			for (TemporaryBuffer& temporary : batch.Temporaries)
+				DestroyBuffer(temporary);
+			vkDestroyFence(device, batch.Fence, nullptr);
+		}
+
+		// frees the command buffers along with it
+		vkDestroyCommandPool(device, m_CommandPool, nullptr);
+		DestroyBuffer(m_Ring);
+
+		m_Batches.clear();
+		m_FreeBatches.clear();
+		m_Recording = UINT32_MAX;
+		m_CommandPool = VK_NULL_HANDLE;
+	}
+
+	StagingRing::TemporaryBuffer StagingRing::CreateBuffer(VkDeviceSize size)
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+
+		TemporaryBuffer buffer;
+		VkBufferCreateInfo bufferInfo {
+			.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+			.size = size,
+			.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			.sharingMode = VK_SHARING_MODE_EXCLUSIVE
+		};
+		VK_CHECK(vkCreateBuffer(device, &bufferInfo, nullptr, &buffer.Handle));
+
+		// coherent, so nothing written here ever needs a flush
+		VkMemoryRequirements req;
+		vkGetBufferMemoryRequirements(device, buffer.Handle, &req);
+		buffer.Allocation = GetGPUAllocator().Allocate(req, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, GPUResourceKind::Buffer);
+		VK_CHECK(vkBindBufferMemory(device, buffer.Handle, buffer.Allocation.Memory, buffer.Allocation.Offset));
+
+		return buffer;
+	}
+
+	void StagingRing::DestroyBuffer(TemporaryBuffer& buffer)
+	{
+		vkDestroyBuffer(GetVulkanInfo()->Device, buffer.Handle, nullptr);
+		GetGPUAllocator().Free(buffer.Allocation);
+		buffer = {};
+	}
+
+	StagingRing::Batch& StagingRing::GetRecordingBatch()
+	{
+		if (m_Recording != UINT32_MAX)
+			return m_Batches[m_Recording];
+
+		VkDevice device = GetVulkanInfo()->Device;
+
+		if (!m_FreeBatches.empty())
+		{
+			m_Recording = m_FreeBatches.back();
+			m_FreeBatches.pop_back();
+		}
+		else
+		{
+			m_Recording = (uint32_t)m_Batches.size();
+			Batch& batch = m_Batches.emplace_back();
+
+			VkCommandBufferAllocateInfo allocInfo {
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+				.commandPool = m_CommandPool,
+				.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+				.commandBufferCount = 1
+			};
+			VK_CHECK(vkAllocateCommandBuffers(device, &allocInfo, &batch.CommandBuffer));
+
+			VkFenceCreateInfo fenceInfo { .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+			VK_CHECK(vkCreateFence(device, &fenceInfo, nullptr, &batch.Fence));
+		}
+
+		Batch& batch = m_Batches[m_Recording];
+		VkCommandBufferBeginInfo beginInfo {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+		};
+		VK_CHECK(vkBeginCommandBuffer(batch.CommandBuffer, &beginInfo));
+		return batch;
+	}
+
+	VkCommandBuffer StagingRing::GetCommandBuffer()
+	{
+		return GetRecordingBatch().CommandBuffer;
+	}
+
+	StagingAllocation StagingRing::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+	{
+		m_Statistics.BytesUploaded += size;
+		m_WindowBytes += size;
+
+		// anything bigger than half the ring would keep the ring drained, it gets its own buffer
+		// which goes away along with the batch
+		if (size > m_Capacity / 2)
+		{
+			TemporaryBuffer temporary = CreateBuffer(size);
+			GetRecordingBatch().Temporaries.push_back(temporary);
+			m_Statistics.OversizedUploads++;
+			return { temporary.Handle, 0, temporary.Allocation.Mapped };
+		}
+
+		for (;;)
+		{
+			// the range can't wrap around, if it doesn't fit before the end it starts over at the front
+			VkDeviceSize offset = AlignUp(m_Head, alignment);
+			if (offset % m_Capacity + size > m_Capacity)
+				offset = AlignUp(offset, m_Capacity);
+
+			if (offset + size - m_Tail <= m_Capacity)
+			{
+				m_Head = offset + size;
+				VkDeviceSize ringOffset = offset % m_Capacity;
+				return { m_Ring.Handle, ringOffset, (uint8_t*)m_Ring.Allocation.Mapped + ringOffset };
+			}
+
+			if (!m_InFlight.empty())
+			{
+				Retire(true);
+			}
+			else if (m_Recording != UINT32_MAX)
+			{
+				// the batch being recorded holds the rest of the ring
+				Submit();
+			}
+			else
+			{
+				// nothing is using the ring at all
+				m_Tail = m_Head = offset;
+			}
+		}
+	}
+
+	void StagingRing::UploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+	{
+		if (size == 0)
+			return;
+
+		StagingAllocation staging = Allocate(size);
+		memcpy(staging.Mapped, data, size);
+
+		VkBufferCopy region {
+			.srcOffset = staging.Offset,
+			.dstOffset = dstOffset,
+			.size = size
+		};
+		vkCmdCopyBuffer(GetCommandBuffer(), staging.Buffer, dst, 1, &region);
+	}
+
+	void StagingRing::Submit()
+	{
+		if (m_Recording == UINT32_MAX)
+			return;
+
+		Batch& batch = m_Batches[m_Recording];
+
+		// everything submitted after this reads the copies, whatever it is
+		VkMemoryBarrier barrier {
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT
+		};
+		vkCmdPipelineBarrier(batch.CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		VK_CHECK(vkEndCommandBuffer(batch.CommandBuffer));
+
+		VkSubmitInfo submitInfo {
+			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+			.commandBufferCount = 1,
+			.pCommandBuffers = &batch.CommandBuffer
+		};
+		VK_CHECK(vkQueueSubmit(GetVulkanInfo()->Queue, 1, &submitInfo, batch.Fence));
+
+		batch.RingEnd = m_Head;
+		m_InFlight.push_back(m_Recording);
+		m_Recording = UINT32_MAX;
+		m_Statistics.Submissions++;
+	}
+
+	void StagingRing::Retire(bool wait)
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+
+		while (!m_InFlight.empty())
+		{
+			uint32_t index = m_InFlight.front();
+			Batch& batch = m_Batches[index];
+
+			if (vkGetFenceStatus(device, batch.Fence) != VK_SUCCESS)
+			{
+				if (!wait)
+					break;
+
+				// the ring is full of uploads the GPU hasn't gotten to, this is the stall
+				Clock::time_point start = Clock::now();
+				VK_CHECK(vkWaitForFences(device, 1, &batch.Fence, VK_TRUE, UINT64_MAX));
+				m_WindowStallTime += std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+				m_WindowStalls++;
+				wait = false;
+			}
+
+			VK_CHECK(vkResetFences(device, 1, &batch.Fence));
+			VK_CHECK(vkResetCommandBuffer(batch.CommandBuffer, 0));
+
+			for (TemporaryBuffer& temporary : batch.Temporaries)
+				DestroyBuffer(temporary);
+			batch.Temporaries.clear();
+
+			m_Tail = batch.RingEnd;
+			m_InFlight.pop_front();
+			m_FreeBatches.push_back(index);
+		}
+	}
+
+	void StagingRing::Update()
+	{
+		Retire(false);
+
+		m_Statistics.InUse = m_Head - m_Tail;
+		m_Statistics.BatchesInFlight = (uint32_t)m_InFlight.size();
+
+		Clock::time_point now = Clock::now();
+		float elapsed = std::chrono::duration<float>(now - m_WindowStart).count();
+		if (elapsed >= 1.0f)
+		{
+			m_Statistics.Throughput = m_WindowBytes / (1024.0f * 1024.0f) / elapsed;
+			m_Statistics.StallTime = m_WindowStallTime;
+			m_Statistics.Stalls = m_WindowStalls;
+
+			m_WindowStart = now;
+			m_WindowBytes = 0;
+			m_WindowStallTime = 0.0f;
+			m_WindowStalls = 0;
+		}
+	}
+
+}
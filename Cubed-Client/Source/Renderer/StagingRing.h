@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Vulkan.h"
+#include "GPUAllocator.h"
+
+#include <chrono>
+#include <deque>
+#include <vector>
+
+namespace Cubed {
+
+	struct StagingAllocation
+	{
+		VkBuffer Buffer = VK_NULL_HANDLE;
+		VkDeviceSize Offset = 0;
+		void* Mapped = nullptr;
+	};
+
+	//
+	// StagingRing - streams data into device local resources without stalling the frame
+	//
+	// One persistently mapped host buffer is handed out front to back as a ring. Copies out of
+	// it are recorded into a batch command buffer, and the batch is submitted with a fence
+	// (normally once per frame from EndScene) on the same queue the frame is submitted to. The
+	// batch ends in a barrier against vertex input and shader reads, so anything drawn in later
+	// submissions sees the data without the frame having to wait on it. Ring space comes back
+	// once a batch's fence has signaled, which is only ever waited on when the ring is full.
+	//
+	// Walnut only creates the one graphics queue, so there is no dedicated transfer queue here.
+	//
+	class StagingRing
+	{
+	public:
+		struct Statistics
+		{
+			VkDeviceSize Capacity = 0;
+			VkDeviceSize InUse = 0;       // written but not yet known to be copied
+			uint32_t BatchesInFlight = 0;
+			uint64_t BytesUploaded = 0;
+			uint64_t Submissions = 0;
+			uint64_t OversizedUploads = 0; // too big for the ring, got a staging buffer of their own
+
+			// over the last second
+			float Throughput = 0.0f; // MB/s
+			float StallTime = 0.0f;  // ms spent waiting for ring space
+			uint32_t Stalls = 0;
+		};
+	public:
+		void Init(VkDeviceSize capacity = 16ull * 1024 * 1024);
+		void Shutdown();
+
+		// staging memory for size bytes, valid until the next Submit. Call before GetCommandBuffer,
+		// making room can submit the batch that is being recorded
+		StagingAllocation Allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+		// the batch being recorded, copies out of staging memory go in here
+		VkCommandBuffer GetCommandBuffer();
+
+		// copies data into dst at dstOffset, done by the time anything submitted afterwards runs
+		void UploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+
+		// submits the batch being recorded, if there is one
+		void Submit();
+		// reclaims the space of finished batches, once per frame
+		void Update();
+
+		const Statistics& GetStatistics() const { return m_Statistics; }
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		struct TemporaryBuffer
+		{
+			VkBuffer Handle = VK_NULL_HANDLE;
+			GPUAllocation Allocation;
+		};
+
+		struct Batch
+		{
+			VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+			VkFence Fence = VK_NULL_HANDLE;
+			VkDeviceSize RingEnd = 0; // ring head when submitted, the tail moves here once done
+			std::vector<TemporaryBuffer> Temporaries;
+		};
+	private:
+		Batch& GetRecordingBatch();
+		TemporaryBuffer CreateBuffer(VkDeviceSize size);
+		void DestroyBuffer(TemporaryBuffer& buffer);
+
+		// retires finished batches from the front, waiting on the oldest one if wait is set
+		void Retire(bool wait);
+	private:
+		VkCommandPool m_CommandPool = VK_NULL_HANDLE;
+
+		TemporaryBuffer m_Ring;
+		VkDeviceSize m_Capacity = 0;
+		// total bytes ever handed out and reclaimed, the ring offset is these modulo capacity
+		VkDeviceSize m_Head = 0, m_Tail = 0;
+
+		std::vector<Batch> m_Batches;
+		std::vector<uint32_t> m_FreeBatches;
+		std::deque<uint32_t> m_InFlight; // oldest first
+		uint32_t m_Recording = UINT32_MAX;
+
+		Statistics m_Statistics;
+		Clock::time_point m_WindowStart = Clock::now();
+		uint64_t m_WindowBytes = 0;
+		float m_WindowStallTime = 0.0f;
+		uint32_t m_WindowStalls = 0;
+	};
+
+}
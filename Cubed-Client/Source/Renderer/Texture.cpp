@@ -1,14 +1,28 @@
 #include "Texture.h"
 
 #include "Renderer.h"
-#include "Walnut/Application.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
 
 namespace Cubed {
 
-	Texture::Texture(uint32_t width, uint32_t height, Walnut::Buffer data)
-        : m_Width(width), m_Height(height)
+    // what layers that were never set look like
+    static constexpr uint32_t s_MissingColor = 0xffff00ff;
+
+    Texture::Texture(const TextureSpecification& specification)
+        : m_Specification(specification)
+    {
+        Init();
+    }
+
+	Texture::Texture(uint32_t width, uint32_t height, Walnut::Buffer data, StagingRing& staging)
+        : m_Specification({ .Width = width, .Height = height })
     {
-        Init(data);
+        Init();
+        SetLayer(0, data);
+        Flush(staging);
 	}
 
 	Texture::~Texture()
@@ -18,19 +32,23 @@ namespace Cubed {
         vkDestroySampler(device, m_Sampler, nullptr);
         vkDestroyImageView(device, m_ImageView, nullptr);
         vkDestroyImage(device, m_Image, nullptr);
-        vkFreeMemory(device, m_Memory, nullptr);
+        GetGPUAllocator().Free(m_Allocation);
 	}
 
     // heavily recycled from IMGUI's implementation of Vulkan
-    void Texture::Init(Walnut::Buffer data)
+    void Texture::Init()
 	{
         VkDevice device = GetVulkanInfo()->Device;
-        size_t size = m_Width * m_Height * 4; // 4 bytes per pixel - based on format
-        if (size != data.Size) // they need to be the same size...
-        {
-            __debugbreak();
-            return;
-        }
+        const TextureSpecification& spec = m_Specification;
+
+        if (spec.GenerateMips)
+            m_MipLevels = std::bit_width(std::max(spec.Width, spec.Height));
+
+        VkImageSubresourceRange allLevels {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .levelCount = m_MipLevels,
+            .layerCount = spec.Layers
+        };
 
         // Create the Image:
         {
@@ -38,12 +56,13 @@ namespace Cubed {
                 .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
                 .imageType = VK_IMAGE_TYPE_2D,
                 .format = VK_FORMAT_R8G8B8A8_UNORM,
-                .extent = {.width = m_Width, .height = m_Height, .depth = 1 },
-                .mipLevels = 1,
-                .arrayLayers = 1,
+                .extent = {.width = spec.Width, .height = spec.Height, .depth = 1 },
+                .mipLevels = m_MipLevels,
+                .arrayLayers = spec.Layers,
                 .samples = VK_SAMPLE_COUNT_1_BIT,
                 .tiling = VK_IMAGE_TILING_OPTIMAL,
-                .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, // image is transferred with gpu transfer queue here
+                // image is transferred with gpu transfer queue here, and mips are blitted from the level above
+                .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
                 .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
                 .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
             };
@@ -53,14 +72,8 @@ namespace Cubed {
             // allocate memory for image and bind memory to image
             VkMemoryRequirements req;
             vkGetImageMemoryRequirements(device, m_Image, &req);
-            VkMemoryAllocateInfo alloc_info {
-                .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-                .allocationSize = req.size,
-                .memoryTypeIndex = Renderer::GetVulkanMemoryType(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, req.memoryTypeBits)
-            };
-
-            VK_CHECK(vkAllocateMemory(device, &alloc_info, nullptr, &m_Memory));
-            VK_CHECK(vkBindImageMemory(device, m_Image, m_Memory, 0));
+            m_Allocation = GetGPUAllocator().Allocate(req, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, GPUResourceKind::Image);
+            VK_CHECK(vkBindImageMemory(device, m_Image, m_Allocation.Memory, m_Allocation.Offset));
         }
 
         // Create the Image View:
@@ -68,57 +81,106 @@ namespace Cubed {
             VkImageViewCreateInfo info {
                 .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
                 .image = m_Image,
-                .viewType = VK_IMAGE_VIEW_TYPE_2D,
+                .viewType = spec.Layers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D,
                 .format = VK_FORMAT_R8G8B8A8_UNORM,
-                .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .levelCount = 1, .layerCount = 1 }
+                .subresourceRange = allLevels
             };
             VK_CHECK(vkCreateImageView(device, &info, nullptr, &m_ImageView));
         }
 
-        // Create the Upload Buffer:
-        VkBuffer stagingBuffer = nullptr;
-        VkDeviceMemory stagingBufferMemory = nullptr;
+        // create sampler
+        VkSamplerCreateInfo info{
+            .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+            .magFilter = spec.MagFilter,
+            .minFilter = VK_FILTER_LINEAR,
+            .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+            .addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+            .addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+            .addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+            .maxAnisotropy = 1.0f,
+            .minLod = -1000,
+            .maxLod = 1000
+        };
+
+        VK_CHECK(vkCreateSampler(device, &info, nullptr, &m_Sampler));
+
+        m_ImageInfo = {
+            .sampler = m_Sampler,
+            .imageView = m_ImageView,
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        };
+
+        // every layer has to be in a readable layout before anything samples it, so they all
+        // start out pending, overwritten by whatever is set before the first flush
+        std::vector<uint8_t> missing(GetLayerSize());
+        for (size_t i = 0; i < missing.size(); i += 4)
+            memcpy(&missing[i], &s_MissingColor, 4);
+        m_PendingLayers.assign(spec.Layers, missing);
+	}
+
+    void Texture::SetLayer(uint32_t layer, Walnut::Buffer data)
+    {
+        if (layer >= m_Specification.Layers || data.Size != GetLayerSize()) // they need to be the same size...
+        {
+            __debugbreak();
+            return;
+        }
+
+        m_PendingLayers[layer].assign((const uint8_t*)data.Data, (const uint8_t*)data.Data + data.Size);
+    }
+
+    void Texture::Flush(StagingRing& staging)
+    {
+        std::vector<uint32_t> layers;
+        for (uint32_t layer = 0; layer < m_Specification.Layers; layer++)
         {
-            VkBufferCreateInfo buffer_info {
-                .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-                .size = size,
-                .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT, // image is transferred with gpu transfer queue from here
-                .sharingMode = VK_SHARING_MODE_EXCLUSIVE
-            };
-            VK_CHECK(vkCreateBuffer(device, &buffer_info, nullptr, &stagingBuffer));
+            if (!m_PendingLayers[layer].empty())
+                layers.push_back(layer);
+        }
 
-            VkMemoryRequirements req;
-            vkGetBufferMemoryRequirements(device, stagingBuffer, &req);
-            VkMemoryAllocateInfo alloc_info {
-                .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-                .allocationSize = req.size,
-                .memoryTypeIndex = Renderer::GetVulkanMemoryType(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, req.memoryTypeBits)
-            };
-            
-            VK_CHECK(vkAllocateMemory(device, &alloc_info, nullptr, &stagingBufferMemory));
-            VK_CHECK(vkBindBufferMemory(device, stagingBuffer, stagingBufferMemory, 0));
-            
+        if (layers.empty())
+            return;
+
+        // one allocation for all of them, a second one could submit the batch and give this one's space away
+        // (and before getting the command buffer, making room can submit it)
+        uint64_t layerSize = GetLayerSize();
+        StagingAllocation staging_memory = staging.Allocate(layerSize * layers.size());
+        for (size_t i = 0; i < layers.size(); i++)
+        {
+            memcpy((uint8_t*)staging_memory.Mapped + i * layerSize, m_PendingLayers[layers[i]].data(), layerSize);
+            m_PendingLayers[layers[i]] = std::vector<uint8_t>();
         }
 
-        // Upload to Buffer:
+        // recorded into the ring's batch rather than a command buffer that is waited on right away
+        VkCommandBuffer commandBuffer = staging.GetCommandBuffer();
+
+        // neighbouring layers go up together
+        for (size_t start = 0; start < layers.size();)
         {
-            uint8_t* map = NULL;
-            VK_CHECK(vkMapMemory(device, stagingBufferMemory, 0, size, 0, (void**)(&map)));
-            memcpy(map, data.Data, size);
-            VkMappedMemoryRange range{
-                .sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
-                .memory = stagingBufferMemory,
-                .size = size
-            };
-            VK_CHECK(vkFlushMappedMemoryRanges(device, 1, &range));
-            vkUnmapMemory(device, stagingBufferMemory);
+            size_t end = start + 1;
+            while (end < layers.size() && layers[end] == layers[end - 1] + 1)
+                end++;
+
+            RecordUpload(commandBuffer, staging_memory.Buffer, staging_memory.Offset + start * layerSize, layers[start], (uint32_t)(end - start));
+            start = end;
         }
 
-        // use a command buffer from Walnut's pool of command buffers
-        VkCommandBuffer commandBuffer = Walnut::Application::GetCommandBuffer(true);
+        m_LayersUploaded += layers.size();
+    }
+
+    void Texture::RecordUpload(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize bufferOffset, uint32_t first, uint32_t count)
+    {
+        VkImageSubresourceRange range {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .levelCount = m_MipLevels,
+            .baseArrayLayer = first,
+            .layerCount = count
+        };
 
         // Copy to Image:
         {
+            // whatever the layers held before is thrown away, frames that were still sampling them
+            // were submitted earlier, so the barrier waits for them
             VkImageMemoryBarrier copy_barrier[1] = {};
             copy_barrier[0] = {
                 .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
@@ -128,60 +190,84 @@ namespace Cubed {
                 .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
                 .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
                 .image = m_Image,
-                .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .levelCount = 1, .layerCount = 1 }
+                .subresourceRange = range
             };
-            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, copy_barrier);
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, copy_barrier);
 
-            VkBufferImageCopy region {
-                .imageSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .layerCount = 1 },
-                .imageExtent = { .width = m_Width, .height = m_Height, .depth = 1 }
-            };
+            std::vector<VkBufferImageCopy> regions(count);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                regions[i] = {
+                    .bufferOffset = bufferOffset + i * GetLayerSize(),
+                    .imageSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseArrayLayer = first + i, .layerCount = 1 },
+                    .imageExtent = { .width = m_Specification.Width, .height = m_Specification.Height, .depth = 1 }
+                };
+            }
 
-            vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+            vkCmdCopyBufferToImage(commandBuffer, buffer, m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)regions.size(), regions.data());
+        }
 
-            VkImageMemoryBarrier use_barrier[1] = {};
-            use_barrier[0] =
-            {
+        // Generate mips, each level is blitted down from the one above it once that is done:
+        int32_t width = (int32_t)m_Specification.Width, height = (int32_t)m_Specification.Height;
+        for (uint32_t level = 1; level < m_MipLevels; level++)
+        {
+            VkImageMemoryBarrier read_barrier[1] = {};
+            read_barrier[0] = {
                 .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
                 .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-                .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+                .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
                 .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
                 .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
                 .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
                 .image = m_Image,
-                .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .levelCount = 1, .layerCount = 1 }
+                .subresourceRange = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = level - 1, .levelCount = 1, .baseArrayLayer = first, .layerCount = count }
             };
-            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, use_barrier);
-        }
-
-        Walnut::Application::FlushCommandBuffer(commandBuffer);
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, read_barrier);
 
-        // destroy data created within this function
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
-
-        // create sampler
-        VkSamplerCreateInfo info{
-            .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
-            .magFilter = VK_FILTER_LINEAR,
-            .minFilter = VK_FILTER_LINEAR,
-            .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
-            .addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
-            .addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
-            .addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
-            .maxAnisotropy = 1.0f,
-            .minLod = -1000,
-            .maxLod = 1000
-        };
+            int32_t nextWidth = std::max(width / 2, 1), nextHeight = std::max(height / 2, 1);
+            VkImageBlit blit {
+                .srcSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = level - 1, .baseArrayLayer = first, .layerCount = count },
+                .srcOffsets = { { 0, 0, 0 }, { width, height, 1 } },
+                .dstSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = level, .baseArrayLayer = first, .layerCount = count },
+                .dstOffsets = { { 0, 0, 0 }, { nextWidth, nextHeight, 1 } }
+            };
+            // linear blits of R8G8B8A8_UNORM are supported everywhere
+            vkCmdBlitImage(commandBuffer, m_Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
 
-        VK_CHECK(vkCreateSampler(device, &info, nullptr, &m_Sampler));
+            width = nextWidth;
+            height = nextHeight;
+        }
 
-        m_ImageInfo = {
-            .sampler = m_Sampler,
-            .imageView = m_ImageView,
-            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        // every level above the last one was blitted from, the last one was only written
+        VkImageMemoryBarrier use_barrier[2] = {};
+        uint32_t barrierCount = 0;
+        if (m_MipLevels > 1)
+        {
+            use_barrier[barrierCount++] = {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+                .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+                .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = m_Image,
+                .subresourceRange = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .levelCount = m_MipLevels - 1, .baseArrayLayer = first, .layerCount = count }
+            };
+        }
+        use_barrier[barrierCount++] = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = m_Image,
+            .subresourceRange = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = m_MipLevels - 1, .levelCount = 1, .baseArrayLayer = first, .layerCount = count }
         };
-	}
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, barrierCount, use_barrier);
+    }
 
-}
\ No newline at end of file
+}
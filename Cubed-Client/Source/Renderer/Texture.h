@@ -3,28 +3,68 @@
 #include "Walnut/Core/Buffer.h"
 
 #include "Vulkan.h"
+#include "GPUAllocator.h"
+#include "StagingRing.h"
+
+#include <vector>
 
 namespace Cubed {
 
-	class Texture 
+	struct TextureSpecification
+	{
+		uint32_t Width = 1;
+		uint32_t Height = 1;
+		uint32_t Layers = 1;       // more than one makes a 2D array texture, sampled as sampler2DArray
+		bool GenerateMips = false; // full chain down to 1x1, blitted on the GPU from what was uploaded
+		VkFilter MagFilter = VK_FILTER_LINEAR;
+	};
+
+	//
+	// Texture - RGBA8 image, optionally an array of layers with mipmaps
+	//
+	// Layers are set on the CPU side first and only recorded into the staging ring's batch on
+	// Flush, so any number of them go up together: one staging allocation, one copy, and one
+	// set of blits for the mip chain per run of neighbouring layers. Layers that were never set
+	// show up magenta.
+	//
+	class Texture
 	{
 	public:
-		Texture(uint32_t width, uint32_t height, Walnut::Buffer data);
+		Texture(const TextureSpecification& specification);
+		// the pixels are copied in with the staging ring's next submit
+		Texture(uint32_t width, uint32_t height, Walnut::Buffer data, StagingRing& staging);
 		~Texture();
 
+		// width * height * 4 bytes, copied, nothing reaches the GPU until Flush
+		void SetLayer(uint32_t layer, Walnut::Buffer data);
+		// records every layer set since the last flush into staging's batch
+		void Flush(StagingRing& staging);
+
 		const VkDescriptorImageInfo& GetImageInfo() const { return m_ImageInfo; }
+		const TextureSpecification& GetSpecification() const { return m_Specification; }
+		uint32_t GetMipLevels() const { return m_MipLevels; }
+		uint64_t GetLayersUploaded() const { return m_LayersUploaded; }
 	private:
-		void Init(Walnut::Buffer data);
+		void Init();
+		uint64_t GetLayerSize() const { return (uint64_t)m_Specification.Width * m_Specification.Height * 4; }
+
+		// copies, mips and layout changes for layers [first, first + count), whose pixels are in
+		// staging at bufferOffset one after the other
+		void RecordUpload(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize bufferOffset, uint32_t first, uint32_t count);
 	private:
-		uint32_t m_Width = 0;
-		uint32_t m_Height = 0;
+		TextureSpecification m_Specification;
+		uint32_t m_MipLevels = 1;
 
 		VkImage m_Image = nullptr;
 		VkImageView m_ImageView = nullptr;
 		VkSampler m_Sampler = nullptr;
-		VkDeviceMemory m_Memory = nullptr;
+		GPUAllocation m_Allocation;
 
 		VkDescriptorImageInfo m_ImageInfo;
+
+		// pixels waiting for Flush, empty for layers that have nothing new
+		std::vector<std::vector<uint8_t>> m_PendingLayers;
+		uint64_t m_LayersUploaded = 0;
 	};
 
-}
\ No newline at end of file
+}
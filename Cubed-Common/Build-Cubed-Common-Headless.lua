@@ -32,6 +32,13 @@ project "Cubed-Common-Headless"
       systemversion "latest"
       defines { "WL_PLATFORM_WINDOWS" }
 
+   -- client and server have to simulate movement bit for bit the same, see PlayerMovement.h
+   filter { "files:Source/PlayerMovement.cpp", "system:not windows" }
+      buildoptions { "-ffp-contract=off" }
+
+   filter { "files:Source/PlayerMovement.cpp", "system:windows" }
+      buildoptions { "/fp:precise" }
+
    filter "configurations:Debug"
       defines { "WL_DEBUG" }
       runtime "Debug"
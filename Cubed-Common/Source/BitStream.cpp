@@ -0,0 +1,176 @@
+#include "BitStream.h"
+
+#include <bit>
+#include <cmath>
+
+namespace Cubed
+{
+	// widths a signed delta can be packed into, the last one is replaced by the full width
+	static constexpr uint32_t s_DeltaWidths[4] = { 4, 8, 16, 0 };
+
+	static uint32_t GetMask(uint32_t bitCount)
+	{
+		return bitCount >= 32 ? UINT32_MAX : (1u << bitCount) - 1;
+	}
+
+	// Quantization
+
+	uint32_t Quantization::GetBitCount() const
+	{
+		uint32_t steps = (uint32_t)std::ceil(2.0f * Range / Precision);
+		return (uint32_t)std::bit_width(steps);
+	}
+
+	uint32_t Quantization::Quantize(float value) const
+	{
+		float clamped = std::fmin(std::fmax(value, -Range), Range);
+		return (uint32_t)std::lround((clamped + Range) / Precision);
+	}
+
+	float Quantization::Dequantize(uint32_t value) const
+	{
+		return (float)value * Precision - Range;
+	}
+
+	// BitWriter
+
+	void BitWriter::WriteBits(uint32_t value, uint32_t bitCount)
+	{
+		m_Scratch |= (uint64_t)(value & GetMask(bitCount)) << m_ScratchBits;
+		m_ScratchBits += bitCount;
+		m_BitsWritten += bitCount;
+
+		if (m_ScratchBits >= 32)
+		{
+			uint8_t bytes[4] = { (uint8_t)m_Scratch, (uint8_t)(m_Scratch >> 8), (uint8_t)(m_Scratch >> 16), (uint8_t)(m_Scratch >> 24) };
+			m_Good &= m_Stream.WriteData((const char*)bytes, sizeof(bytes));
+			m_Scratch >>= 32;
+			m_ScratchBits -= 32;
+		}
+	}
+
+	void BitWriter::WriteVarUInt(uint32_t value)
+	{
+		do
+		{
+			uint32_t group = value & 0x7f;
+			value >>= 7;
+			WriteBits(group | (value ? 0x80 : 0), 8);
+		} while (value);
+	}
+
+	void BitWriter::WriteSignedDelta(int32_t value, uint32_t maxBits)
+	{
+		uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+		uint32_t needed = (uint32_t)std::bit_width(zigzag);
+
+		uint32_t widthClass = 0;
+		while (widthClass < 3 && needed > s_DeltaWidths[widthClass])
+			widthClass++;
+
+		WriteBits(widthClass, 2);
+		WriteBits(zigzag, widthClass == 3 ? maxBits + 1 : s_DeltaWidths[widthClass]);
+	}
+
+	void BitWriter::Flush()
+	{
+		while (m_ScratchBits > 0)
+		{
+			uint8_t byte = (uint8_t)m_Scratch;
+			m_Good &= m_Stream.WriteData((const char*)&byte, 1);
+			m_Scratch >>= 8;
+			m_ScratchBits = m_ScratchBits > 8 ? m_ScratchBits - 8 : 0;
+		}
+		m_Scratch = 0;
+	}
+
+	uint32_t BitWriter::QuantizeAngle(float degrees, uint32_t bitCount)
+	{
+		float wrapped = degrees - 360.0f * std::floor(degrees / 360.0f);
+		uint32_t steps = 1u << bitCount;
+		return (uint32_t)std::lround(wrapped / 360.0f * (float)steps) & (steps - 1);
+	}
+
+	float BitWriter::DequantizeAngle(uint32_t value, uint32_t bitCount)
+	{
+		return (float)value * 360.0f / (float)(1u << bitCount);
+	}
+
+	// BitReader
+
+	bool BitReader::ReadBits(uint32_t& value, uint32_t bitCount)
+	{
+		while (m_ScratchBits < bitCount)
+		{
+			uint8_t byte;
+			if (!m_Stream.ReadData((char*)&byte, 1))
+				return false;
+
+			m_Scratch |= (uint64_t)byte << m_ScratchBits;
+			m_ScratchBits += 8;
+		}
+
+		value = (uint32_t)m_Scratch & GetMask(bitCount);
+		m_Scratch >>= bitCount;
+		m_ScratchBits -= bitCount;
+		return true;
+	}
+
+	bool BitReader::ReadBool(bool& value)
+	{
+		uint32_t bit;
+		if (!ReadBits(bit, 1))
+			return false;
+
+		value = bit != 0;
+		return true;
+	}
+
+	bool BitReader::ReadVarUInt(uint32_t& value)
+	{
+		value = 0;
+		for (uint32_t shift = 0; shift < 35; shift += 7)
+		{
+			uint32_t group;
+			if (!ReadBits(group, 8))
+				return false;
+
+			value |= (group & 0x7f) << shift;
+			if (!(group & 0x80))
+				return true;
+		}
+
+		// more than 5 groups can't be a uint32_t
+		return false;
+	}
+
+	bool BitReader::ReadSignedDelta(int32_t& value, uint32_t maxBits)
+	{
+		uint32_t widthClass, zigzag;
+		if (!ReadBits(widthClass, 2) || !ReadBits(zigzag, widthClass == 3 ? maxBits + 1 : s_DeltaWidths[widthClass]))
+			return false;
+
+		value = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+		return true;
+	}
+
+	bool BitReader::ReadQuantized(float& value, const Quantization& quantization)
+	{
+		uint32_t quantized;
+		if (!ReadBits(quantized, quantization.GetBitCount()))
+			return false;
+
+		value = quantization.Dequantize(quantized);
+		return true;
+	}
+
+	bool BitReader::ReadAngle(float& degrees, uint32_t bitCount)
+	{
+		uint32_t quantized;
+		if (!ReadBits(quantized, bitCount))
+			return false;
+
+		degrees = BitWriter::DequantizeAngle(quantized, bitCount);
+		return true;
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Walnut/Serialization/StreamReader.h"
+#include "Walnut/Serialization/StreamWriter.h"
+
+namespace Cubed
+{
+	// fixed point quantization of a float in [-Range, Range] with steps of Precision
+	struct Quantization
+	{
+		float Range = 1.0f;
+		float Precision = 1.0f / 256.0f;
+
+		uint32_t GetBitCount() const;
+		uint32_t Quantize(float value) const;
+		float Dequantize(uint32_t value) const;
+	};
+
+	//
+	// BitWriter - packs values into the fewest bits possible on top of a Walnut stream
+	//
+	// Bits are accumulated LSB first and written out in whole bytes, call Flush once done
+	// to write out the last partial byte. Nothing else should be written to the underlying
+	// stream until then.
+	//
+	class BitWriter
+	{
+	public:
+		BitWriter(Walnut::StreamWriter& stream) : m_Stream(stream) {}
+		~BitWriter() { Flush(); }
+
+		void WriteBits(uint32_t value, uint32_t bitCount);
+		void WriteBool(bool value) { WriteBits(value ? 1 : 0, 1); }
+
+		// 7 bits per byte-ish group, small numbers (IDs, counts) stay small
+		void WriteVarUInt(uint32_t value);
+
+		// zigzag encoded with a 2 bit width class, for small deltas of values up to maxBits wide
+		void WriteSignedDelta(int32_t value, uint32_t maxBits);
+
+		void WriteQuantized(float value, const Quantization& quantization) { WriteBits(quantization.Quantize(value), quantization.GetBitCount()); }
+		void WriteAngle(float degrees, uint32_t bitCount) { WriteBits(QuantizeAngle(degrees, bitCount), bitCount); }
+
+		void Flush();
+		bool IsGood() const { return m_Good; }
+		uint64_t GetBitsWritten() const { return m_BitsWritten; }
+	public:
+		static uint32_t QuantizeAngle(float degrees, uint32_t bitCount);
+		static float DequantizeAngle(uint32_t value, uint32_t bitCount);
+	private:
+		Walnut::StreamWriter& m_Stream;
+		uint64_t m_Scratch = 0;
+		uint32_t m_ScratchBits = 0;
+		uint64_t m_BitsWritten = 0;
+		bool m_Good = true;
+	};
+
+	//
+	// BitReader - reads back what BitWriter wrote, pulling bytes from the stream as needed
+	//
+	class BitReader
+	{
+	public:
+		BitReader(Walnut::StreamReader& stream) : m_Stream(stream) {}
+
+		bool ReadBits(uint32_t& value, uint32_t bitCount);
+		bool ReadBool(bool& value);
+		bool ReadVarUInt(uint32_t& value);
+		bool ReadSignedDelta(int32_t& value, uint32_t maxBits);
+		bool ReadQuantized(float& value, const Quantization& quantization);
+		bool ReadAngle(float& degrees, uint32_t bitCount);
+	private:
+		Walnut::StreamReader& m_Stream;
+		uint64_t m_Scratch = 0;
+		uint32_t m_ScratchBits = 0;
+	};
+}
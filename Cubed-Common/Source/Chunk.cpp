@@ -0,0 +1,242 @@
+#include "Chunk.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace Cubed
+{
+	// smallest power of two width that can index a palette of this size
+	static uint32_t GetBitsPerBlock(size_t paletteSize)
+	{
+		if (paletteSize <= 1)
+			return 0;
+
+		return std::bit_ceil((uint32_t)std::bit_width(paletteSize - 1));
+	}
+
+	size_t ChunkCoordHash::operator()(const ChunkCoord& coord) const
+	{
+		// large primes, spreads neighbouring chunks over the whole table
+		return (size_t)((uint64_t)(uint32_t)coord.X * 73856093ull ^ (uint64_t)(uint32_t)coord.Y * 19349663ull ^ (uint64_t)(uint32_t)coord.Z * 83492791ull);
+	}
+
+	static int32_t FloorDivide(int32_t value, int32_t divisor)
+	{
+		return value / divisor - (value % divisor < 0 ? 1 : 0);
+	}
+
+	ChunkCoord ChunkCoord::FromBlock(const glm::ivec3& position)
+	{
+		return { FloorDivide(position.x, ChunkSize), FloorDivide(position.y, ChunkSize), FloorDivide(position.z, ChunkSize) };
+	}
+
+	uint32_t ChunkCoord::GetBlockIndex(const glm::ivec3& position)
+	{
+		ChunkCoord coord = FromBlock(position);
+		glm::ivec3 local = position - glm::ivec3(coord.X, coord.Y, coord.Z) * (int32_t)ChunkSize;
+		return Chunk::GetIndex((uint32_t)local.x, (uint32_t)local.y, (uint32_t)local.z);
+	}
+
+	Chunk::Chunk(BlockID fill)
+	{
+		Fill(fill);
+	}
+
+	uint32_t Chunk::GetPaletteIndex(uint32_t index) const
+	{
+		if (m_BitsPerBlock == 0)
+			return 0;
+
+		uint32_t bit = index * m_BitsPerBlock;
+		return (uint32_t)(m_Data[bit >> 6] >> (bit & 63)) & ((1u << m_BitsPerBlock) - 1);
+	}
+
+	void Chunk::SetPaletteIndex(uint32_t index, uint32_t paletteIndex)
+	{
+		uint32_t bit = index * m_BitsPerBlock;
+		uint64_t mask = ((1ull << m_BitsPerBlock) - 1) << (bit & 63);
+		uint64_t& word = m_Data[bit >> 6];
+		word = (word & ~mask) | ((uint64_t)paletteIndex << (bit & 63));
+	}
+
+	BlockID Chunk::Get(uint32_t x, uint32_t y, uint32_t z) const
+	{
+		return m_Palette[GetPaletteIndex(GetIndex(x, y, z))];
+	}
+
+	void Chunk::Set(uint32_t x, uint32_t y, uint32_t z, BlockID block)
+	{
+		auto it = std::find(m_Palette.begin(), m_Palette.end(), block);
+		uint32_t paletteIndex = (uint32_t)(it - m_Palette.begin());
+		if (it == m_Palette.end())
+		{
+			m_Palette.push_back(block);
+
+			uint32_t bitsPerBlock = Cubed::GetBitsPerBlock(m_Palette.size());
+			if (bitsPerBlock != m_BitsPerBlock)
+				Resize(bitsPerBlock);
+		}
+
+		if (m_BitsPerBlock != 0)
+			SetPaletteIndex(GetIndex(x, y, z), paletteIndex);
+	}
+
+	void Chunk::Fill(BlockID block)
+	{
+		m_Palette.assign(1, block);
+		m_Data.clear();
+		m_Data.shrink_to_fit();
+		m_BitsPerBlock = 0;
+	}
+
+	void Chunk::Resize(uint32_t bitsPerBlock)
+	{
+		std::vector<uint64_t> data(ChunkVolume * bitsPerBlock / 64, 0);
+		for (uint32_t i = 0; i < ChunkVolume; i++)
+		{
+			uint32_t bit = i * bitsPerBlock;
+			data[bit >> 6] |= (uint64_t)GetPaletteIndex(i) << (bit & 63);
+		}
+
+		m_Data = std::move(data);
+		m_BitsPerBlock = bitsPerBlock;
+	}
+
+	void Chunk::Unpack(BlockID* outBlocks) const
+	{
+		if (m_BitsPerBlock == 0)
+		{
+			std::fill(outBlocks, outBlocks + ChunkVolume, m_Palette[0]);
+			return;
+		}
+
+		// a whole word at a time, every word holds the same number of blocks
+		uint32_t blocksPerWord = 64 / m_BitsPerBlock;
+		uint64_t mask = (1ull << m_BitsPerBlock) - 1;
+		for (uint64_t word : m_Data)
+		{
+			for (uint32_t i = 0; i < blocksPerWord; i++)
+			{
+				*outBlocks++ = m_Palette[word & mask];
+				word >>= m_BitsPerBlock;
+			}
+		}
+	}
+
+	void Chunk::Pack(const BlockID* blocks)
+	{
+		// palette indices are written once the final width is known, so stash them first
+		thread_local std::vector<uint16_t> s_PaletteIndices(ChunkVolume);
+
+		m_Palette.clear();
+		uint32_t lastIndex = 0;
+		for (uint32_t i = 0; i < ChunkVolume; i++)
+		{
+			// runs of the same block are the common case
+			if (m_Palette.empty() || m_Palette[lastIndex] != blocks[i])
+			{
+				auto it = std::find(m_Palette.begin(), m_Palette.end(), blocks[i]);
+				lastIndex = (uint32_t)(it - m_Palette.begin());
+				if (it == m_Palette.end())
+					m_Palette.push_back(blocks[i]);
+			}
+			s_PaletteIndices[i] = (uint16_t)lastIndex;
+		}
+
+		m_BitsPerBlock = Cubed::GetBitsPerBlock(m_Palette.size());
+		m_Data.assign(ChunkVolume * m_BitsPerBlock / 64, 0);
+		if (m_BitsPerBlock == 0)
+			return;
+
+		for (uint32_t i = 0; i < ChunkVolume; i++)
+		{
+			uint32_t bit = i * m_BitsPerBlock;
+			m_Data[bit >> 6] |= (uint64_t)s_PaletteIndices[i] << (bit & 63);
+		}
+	}
+
+	void Chunk::UnpackIndices(uint16_t* outIndices) const
+	{
+		if (m_BitsPerBlock == 0)
+		{
+			std::fill(outIndices, outIndices + ChunkVolume, (uint16_t)0);
+			return;
+		}
+
+		uint32_t blocksPerWord = 64 / m_BitsPerBlock;
+		uint64_t mask = (1ull << m_BitsPerBlock) - 1;
+		for (uint64_t word : m_Data)
+		{
+			for (uint32_t i = 0; i < blocksPerWord; i++)
+			{
+				*outIndices++ = (uint16_t)(word & mask);
+				word >>= m_BitsPerBlock;
+			}
+		}
+	}
+
+	void Chunk::PackIndices(std::vector<BlockID> palette, const uint16_t* indices)
+	{
+		m_Palette = std::move(palette);
+		m_BitsPerBlock = Cubed::GetBitsPerBlock(m_Palette.size());
+		m_Data.assign(ChunkVolume * m_BitsPerBlock / 64, 0);
+		if (m_BitsPerBlock == 0)
+			return;
+
+		uint32_t blocksPerWord = 64 / m_BitsPerBlock;
+		for (uint64_t& word : m_Data)
+		{
+			for (uint32_t i = 0; i < blocksPerWord; i++)
+				word |= (uint64_t)*indices++ << (i * m_BitsPerBlock);
+		}
+	}
+
+	void Chunk::Serialize(Walnut::StreamWriter& writer) const
+	{
+		writer.WriteRaw<uint32_t>((uint32_t)m_Palette.size());
+		writer.WriteData((const char*)m_Palette.data(), m_Palette.size() * sizeof(BlockID));
+		if (!m_Data.empty())
+			writer.WriteData((const char*)m_Data.data(), m_Data.size() * sizeof(uint64_t));
+	}
+
+	bool Chunk::Deserialize(Walnut::StreamReader& reader)
+	{
+		uint32_t paletteSize;
+		if (!reader.ReadRaw<uint32_t>(paletteSize) || paletteSize == 0 || paletteSize > (1u << 16))
+			return false;
+
+		std::vector<BlockID> palette(paletteSize);
+		if (!reader.ReadData((char*)palette.data(), paletteSize * sizeof(BlockID)))
+			return false;
+
+		uint32_t bitsPerBlock = Cubed::GetBitsPerBlock(paletteSize);
+		std::vector<uint64_t> data(ChunkVolume * bitsPerBlock / 64);
+		if (!data.empty() && !reader.ReadData((char*)data.data(), data.size() * sizeof(uint64_t)))
+			return false;
+
+		// only a palette that doesn't fill its width leaves room for indices past its end
+		if (bitsPerBlock != 0 && paletteSize != (1u << bitsPerBlock))
+		{
+			uint32_t blocksPerWord = 64 / bitsPerBlock;
+			uint64_t mask = (1ull << bitsPerBlock) - 1;
+			for (uint64_t word : data)
+			{
+				for (uint32_t i = 0; i < blocksPerWord; i++, word >>= bitsPerBlock)
+				{
+					if ((word & mask) >= paletteSize)
+						return false;
+				}
+			}
+		}
+
+		m_Palette = std::move(palette);
+		m_Data = std::move(data);
+		m_BitsPerBlock = bitsPerBlock;
+		return true;
+	}
+
+	uint64_t Chunk::GetSerializedSize() const
+	{
+		return sizeof(uint32_t) + m_Palette.size() * sizeof(BlockID) + m_Data.size() * sizeof(uint64_t);
+	}
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "Walnut/Serialization/StreamReader.h"
+#include "Walnut/Serialization/StreamWriter.h"
+
+namespace Cubed
+{
+	using BlockID = uint16_t;
+	constexpr BlockID AirBlock = 0;
+
+	constexpr uint32_t ChunkSize = 32;
+	constexpr uint32_t ChunkVolume = ChunkSize * ChunkSize * ChunkSize;
+
+	// chunk position in the world, in chunks (block position / ChunkSize)
+	struct ChunkCoord
+	{
+		int32_t X = 0;
+		int32_t Y = 0;
+		int32_t Z = 0;
+
+		bool operator==(const ChunkCoord& other) const = default;
+
+		glm::vec3 GetWorldPosition() const { return glm::vec3((float)X, (float)Y, (float)Z) * (float)ChunkSize; }
+
+		// chunk a block is in, rounding towards negative infinity
+		static ChunkCoord FromBlock(const glm::ivec3& position);
+		// index of a block within its chunk, see Chunk::GetIndex
+		static uint32_t GetBlockIndex(const glm::ivec3& position);
+	};
+
+	struct ChunkCoordHash
+	{
+		size_t operator()(const ChunkCoord& coord) const;
+	};
+
+	//
+	// Chunk - ChunkSize^3 blocks stored as indices into a per-chunk palette
+	//
+	// Each block only takes as many bits as the palette needs (0, 1, 2, 4, 8 or 16), so a chunk
+	// that is all air or all stone is just its palette, and the usual handful of block types fit
+	// in a few bits each. Widths are powers of two so an index never straddles two words.
+	// Set only ever adds to the palette, Pack rebuilds it from scratch to drop unused entries.
+	//
+	// Blocks are laid out x first, then y, then z.
+	//
+	class Chunk
+	{
+	public:
+		explicit Chunk(BlockID fill = AirBlock);
+
+		BlockID Get(uint32_t x, uint32_t y, uint32_t z) const;
+		void Set(uint32_t x, uint32_t y, uint32_t z, BlockID block);
+		void Fill(BlockID block);
+
+		// whole chunk to/from a flat array of ChunkVolume blocks, much faster than Get/Set per block
+		void Unpack(BlockID* outBlocks) const;
+		void Pack(const BlockID* blocks);
+
+		// same, but palette indices rather than blocks, for codecs that work on the palette form.
+		// PackIndices takes the palette as is, every index has to be within it
+		void UnpackIndices(uint16_t* outIndices) const;
+		void PackIndices(std::vector<BlockID> palette, const uint16_t* indices);
+
+		// see the chunk format below, Deserialize leaves the chunk untouched if the data is bad
+		void Serialize(Walnut::StreamWriter& writer) const;
+		bool Deserialize(Walnut::StreamReader& reader);
+		uint64_t GetSerializedSize() const;
+
+		bool IsUniform() const { return m_BitsPerBlock == 0; }
+		bool IsEmpty() const { return IsUniform() && m_Palette[0] == AirBlock; }
+
+		const std::vector<BlockID>& GetPalette() const { return m_Palette; }
+		uint32_t GetBitsPerBlock() const { return m_BitsPerBlock; }
+		size_t GetMemoryUsage() const { return m_Palette.size() * sizeof(BlockID) + m_Data.size() * sizeof(uint64_t); }
+
+		static uint32_t GetIndex(uint32_t x, uint32_t y, uint32_t z) { return x + ChunkSize * (y + ChunkSize * z); }
+	private:
+		uint32_t GetPaletteIndex(uint32_t index) const;
+		void SetPaletteIndex(uint32_t index, uint32_t paletteIndex);
+
+		// repacks every block with a new width, palette indices stay the same
+		void Resize(uint32_t bitsPerBlock);
+	private:
+		std::vector<BlockID> m_Palette;
+		std::vector<uint64_t> m_Data;
+		uint32_t m_BitsPerBlock = 0;
+	};
+
+	// one block change within a chunk, as it goes out to clients
+	struct BlockEdit
+	{
+		uint32_t Index = 0; // see Chunk::GetIndex
+		BlockID Block = AirBlock;
+	};
+
+	//
+	// Chunk format, just the palette form above as it is in memory. The network and disk use
+	// the compressed format from ChunkCompression.h instead
+	// 1. Palette size (uint32_t)
+	// 2. Palette (BlockID each)
+	// 3. Packed palette indices, ChunkVolume * bits per block / 64 uint64_t words, where bits
+	//    per block follows from the palette size. Nothing at all for a uniform chunk
+	//
+
+	// loaded chunks are shared read-only, so worker threads can keep using the version they
+	// were handed while the world moves on, change a chunk by swapping in a modified copy
+	using ChunkMap = std::unordered_map<ChunkCoord, std::shared_ptr<const Chunk>, ChunkCoordHash>;
+}
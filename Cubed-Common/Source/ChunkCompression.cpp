@@ -0,0 +1,256 @@
+#include "ChunkCompression.h"
+
+#include <array>
+#include <cstring>
+#include <vector>
+
+#include "Walnut/Serialization/BufferStream.h"
+
+#include "Compression.h"
+
+using namespace Walnut;
+
+namespace Cubed
+{
+	enum class Encoding : uint8_t { Runs = 0, Plain = 1 };
+
+	static constexpr uint8_t s_LZFlag = 0x80;
+	static constexpr uint32_t s_AxisCount = 3;
+	// a body is never bigger than the plain format, that's when the runs are given up on
+	static constexpr uint64_t s_MaxBodySize = MaxCompressedChunkSize - 1;
+
+	using RunOrder = std::array<uint16_t, ChunkVolume>;
+
+	// block indices in snake order for each run axis, see the format in the header
+	static const std::array<RunOrder, s_AxisCount>& GetRunOrders()
+	{
+		static const std::array<RunOrder, s_AxisCount> s_Orders = []()
+		{
+			std::array<RunOrder, s_AxisCount> orders;
+			for (uint32_t axis = 0; axis < s_AxisCount; axis++)
+			{
+				uint32_t position = 0;
+				for (uint32_t outer = 0; outer < ChunkSize; outer++)
+				{
+					for (uint32_t m = 0; m < ChunkSize; m++)
+					{
+						// every other plane goes back the way it came, and so does every other line
+						uint32_t middle = outer % 2 ? ChunkSize - 1 - m : m;
+						uint32_t line = outer * ChunkSize + m;
+						for (uint32_t i = 0; i < ChunkSize; i++)
+						{
+							uint32_t inner = line % 2 ? ChunkSize - 1 - i : i;
+							uint32_t index = 0;
+							switch (axis)
+							{
+							case 0: index = Chunk::GetIndex(inner, outer, middle); break;
+							case 1: index = Chunk::GetIndex(middle, inner, outer); break;
+							case 2: index = Chunk::GetIndex(middle, outer, inner); break;
+							}
+							orders[axis][position++] = (uint16_t)index;
+						}
+					}
+				}
+			}
+			return orders;
+		}();
+		return s_Orders;
+	}
+
+	static uint8_t* WriteVarUInt(uint8_t* out, uint32_t value)
+	{
+		while (value >= 0x80)
+		{
+			*out++ = (uint8_t)(value | 0x80);
+			value >>= 7;
+		}
+		*out++ = (uint8_t)value;
+		return out;
+	}
+
+	static bool ReadVarUInt(const uint8_t*& in, const uint8_t* end, uint32_t& value)
+	{
+		value = 0;
+		for (uint32_t shift = 0; shift < 35; shift += 7)
+		{
+			if (in == end)
+				return false;
+
+			uint8_t byte = *in++;
+			value |= (uint32_t)(byte & 0x7f) << shift;
+			if (!(byte & 0x80))
+				return true;
+		}
+		return false;
+	}
+
+	// the runs body, or 0 if it would come out bigger than the plain format
+	static uint64_t WriteRuns(const Chunk& chunk, const uint16_t* indices, const RunOrder& order, uint8_t* outData)
+	{
+		const std::vector<BlockID>& palette = chunk.GetPalette();
+		uint64_t limit = chunk.GetSerializedSize();
+
+		uint8_t* out = WriteVarUInt(outData, (uint32_t)palette.size());
+		for (BlockID block : palette)
+			out = WriteVarUInt(out, block);
+
+		uint32_t paletteSize = (uint32_t)palette.size();
+		uint32_t position = 0;
+		while (position < ChunkVolume)
+		{
+			uint16_t index = indices[order[position]];
+			uint32_t length = 1;
+			while (position + length < ChunkVolume && indices[order[position + length]] == index)
+				length++;
+
+			out = WriteVarUInt(out, (length - 1) * paletteSize + index);
+			position += length;
+			if ((uint64_t)(out - outData) > limit)
+				return 0;
+		}
+
+		return (uint64_t)(out - outData);
+	}
+
+	uint64_t CompressChunk(const Chunk& chunk, ChunkCodec codec, uint8_t* outData)
+	{
+		thread_local std::vector<uint16_t> s_Indices(ChunkVolume);
+		// room for the run that goes past the limit
+		thread_local std::vector<uint8_t> s_Body(s_MaxBodySize + 5);
+		thread_local std::vector<uint8_t> s_LZBody(GetLZMaxCompressedSize(s_MaxBodySize));
+
+		const std::array<RunOrder, s_AxisCount>& orders = GetRunOrders();
+		chunk.UnpackIndices(s_Indices.data());
+
+		// fewest runs wins. Runs mostly break where neighbours along the axis differ, and those
+		// can be counted in straight passes over the blocks, the turns of the snake barely matter
+		uint32_t bestAxis = 0;
+		if (!chunk.IsUniform())
+		{
+			const uint16_t* indices = s_Indices.data();
+			const uint32_t strides[s_AxisCount] = { 1, ChunkSize, ChunkSize * ChunkSize };
+			uint32_t bestChanges = UINT32_MAX;
+			for (uint32_t axis = 0; axis < s_AxisCount; axis++)
+			{
+				// along x this also counts from the end of one row to the start of the next,
+				// that's only one in ChunkSize and doesn't change which axis wins
+				uint32_t stride = strides[axis], changes = 0;
+				for (uint32_t i = stride; i < ChunkVolume; i++)
+					changes += indices[i] != indices[i - stride];
+
+				if (changes < bestChanges)
+				{
+					bestChanges = changes;
+					bestAxis = axis;
+				}
+			}
+		}
+
+		Encoding encoding = Encoding::Runs;
+		uint64_t bodySize = WriteRuns(chunk, s_Indices.data(), orders[bestAxis], s_Body.data());
+		if (bodySize == 0)
+		{
+			encoding = Encoding::Plain;
+			bodySize = chunk.GetSerializedSize();
+			BufferStreamWriter stream(Buffer(s_Body.data(), s_Body.size()));
+			chunk.Serialize(stream);
+		}
+
+		uint8_t header = (uint8_t)encoding | (uint8_t)(bestAxis << 2);
+		if (codec == ChunkCodec::RunsLZ)
+		{
+			uint64_t compressedSize = LZCompress(s_Body.data(), bodySize, s_LZBody.data(), s_LZBody.size());
+			uint8_t sizeBytes[5];
+			uint64_t sizeSize = (uint64_t)(WriteVarUInt(sizeBytes, (uint32_t)bodySize) - sizeBytes);
+			if (compressedSize != 0 && compressedSize + sizeSize < bodySize)
+			{
+				outData[0] = header | s_LZFlag;
+				memcpy(outData + 1, sizeBytes, sizeSize);
+				memcpy(outData + 1 + sizeSize, s_LZBody.data(), compressedSize);
+				return 1 + sizeSize + compressedSize;
+			}
+		}
+
+		outData[0] = header;
+		memcpy(outData + 1, s_Body.data(), bodySize);
+		return 1 + bodySize;
+	}
+
+	bool DecompressChunk(const uint8_t* data, uint64_t size, Chunk& outChunk)
+	{
+		thread_local std::vector<uint16_t> s_Indices(ChunkVolume);
+		thread_local std::vector<uint8_t> s_Body(s_MaxBodySize);
+
+		if (size == 0)
+			return false;
+
+		uint8_t header = data[0];
+		Encoding encoding = (Encoding)(header & 3);
+		uint32_t axis = (header >> 2) & 3;
+		if ((header & ~(s_LZFlag | 15)) != 0 || encoding > Encoding::Plain || axis >= s_AxisCount)
+			return false;
+
+		const uint8_t* in = data + 1;
+		const uint8_t* end = data + size;
+		if (header & s_LZFlag)
+		{
+			uint32_t bodySize;
+			if (!ReadVarUInt(in, end, bodySize) || bodySize > s_MaxBodySize)
+				return false;
+			if (!LZDecompress(in, (uint64_t)(end - in), s_Body.data(), bodySize))
+				return false;
+
+			in = s_Body.data();
+			end = in + bodySize;
+		}
+
+		if (encoding == Encoding::Plain)
+		{
+			Chunk chunk;
+			BufferStreamReader stream(Buffer((void*)in, (uint64_t)(end - in)));
+			if (!chunk.Deserialize(stream) || stream.GetStreamPosition() != (uint64_t)(end - in))
+				return false;
+
+			outChunk = std::move(chunk);
+			return true;
+		}
+
+		uint32_t paletteSize;
+		if (!ReadVarUInt(in, end, paletteSize) || paletteSize == 0 || paletteSize > (1u << 16))
+			return false;
+
+		std::vector<BlockID> palette(paletteSize);
+		for (BlockID& block : palette)
+		{
+			uint32_t value;
+			if (!ReadVarUInt(in, end, value) || value > UINT16_MAX)
+				return false;
+			block = (BlockID)value;
+		}
+
+		const RunOrder& order = GetRunOrders()[axis];
+		uint16_t* indices = s_Indices.data();
+		uint32_t position = 0;
+		while (position < ChunkVolume)
+		{
+			uint32_t run;
+			if (!ReadVarUInt(in, end, run))
+				return false;
+
+			uint32_t length = run / paletteSize + 1;
+			uint16_t index = (uint16_t)(run % paletteSize);
+			if (length > ChunkVolume - position)
+				return false;
+
+			for (uint32_t i = 0; i < length; i++)
+				indices[order[position + i]] = index;
+			position += length;
+		}
+
+		if (in != end)
+			return false;
+
+		outChunk.PackIndices(std::move(palette), indices);
+		return true;
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Chunk.h"
+
+namespace Cubed
+{
+	enum class ChunkCodec : uint8_t
+	{
+		Runs = 0, // palette and runs only, the cheapest to encode and decode
+		RunsLZ    // runs followed by an LZ pass (see Compression.h), kept only if it comes out smaller
+	};
+
+	//
+	// Chunk compression - what chunks look like on the network and on disk
+	//
+	// Blocks are stored as indices into the chunk's palette, which is already as small as it can
+	// be, and then run length encoded. Runs follow a snake through the chunk along whichever
+	// axis gives the fewest of them: the direction flips at the end of every line and every
+	// plane, so a run of air at the top of one column carries on into the top of the next.
+	// Terrain mostly runs along y, layered structures along x or z. A chunk that doesn't
+	// compress at all (noise) is stored in the plain chunk format instead, so compressing
+	// never makes a chunk much bigger than it already is in memory.
+	//
+	// Decoding is a single pass writing each run out, cheap enough for the network thread.
+	// Both use thread local scratch space, so any thread can compress or decompress at once.
+	//
+
+	// most CompressChunk can write: the header and a chunk in the plain format with a full 16 bit palette
+	constexpr uint64_t MaxCompressedChunkSize = 1 + sizeof(uint32_t) + (1 << 16) * sizeof(BlockID) + ChunkVolume * sizeof(BlockID);
+
+	// returns the compressed size, outData has to hold MaxCompressedChunkSize bytes
+	uint64_t CompressChunk(const Chunk& chunk, ChunkCodec codec, uint8_t* outData);
+	// leaves the chunk untouched if the data is bad
+	bool DecompressChunk(const uint8_t* data, uint64_t size, Chunk& outChunk);
+
+	//
+	// Compressed chunk format
+	// 1. Header byte: encoding in the low 2 bits (0 = runs, 1 = plain), run axis in the next
+	//    2 (0 = x, 1 = y, 2 = z), LZ flag in the top bit
+	// 2. If the LZ flag is set: var-uint size of the body, then the LZ compressed body
+	// 3. Body, runs:
+	//    a. Var-uint palette size, then var-uint block IDs
+	//    b. Var-uint runs until there are ChunkVolume blocks, each (length - 1) * palette size
+	//       + palette index. Blocks are in snake order along the run axis (x runs go along x,
+	//       then z, then y, y runs along y, then x, then z, z runs along z, then x, then y)
+	//    Body, plain: the chunk format from Chunk.h
+	// All var-uints are LEB128, 7 bits per byte
+	//
+}
@@ -0,0 +1,230 @@
+#include "ChunkMesher.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Cubed
+{
+	// chunk plus a one block border on every side, at full detail
+	static constexpr int32_t s_PaddedSize = ChunkSize + 2;
+
+	// one block standing in for a step^3 group: solid if at least half of the group is, and
+	// then the topmost solid block so a grass surface stays grass
+	template<typename Get>
+	static BlockID Downsample(Get get, uint32_t x, uint32_t y, uint32_t z, uint32_t step)
+	{
+		uint32_t solid = 0;
+		BlockID top = AirBlock;
+		for (uint32_t dy = step; dy-- > 0;)
+		{
+			for (uint32_t dz = 0; dz < step; dz++)
+			{
+				for (uint32_t dx = 0; dx < step; dx++)
+				{
+					BlockID block = get(x + dx, y + dy, z + dz);
+					if (block == AirBlock)
+						continue;
+
+					solid++;
+					if (top == AirBlock)
+						top = block;
+				}
+			}
+		}
+
+		return solid * 2 >= step * step * step ? top : AirBlock;
+	}
+
+	ChunkMesher::ChunkMesher()
+		: m_Blocks(ChunkVolume), m_Padded(s_PaddedSize * s_PaddedSize * s_PaddedSize), m_Mask(ChunkSize * ChunkSize)
+	{
+	}
+
+	void ChunkMesher::FillPadded(const Chunk& chunk, const ChunkNeighbours& neighbours)
+	{
+		uint32_t step = 1u << m_Lod;
+		std::fill_n(m_Padded.begin(), m_PaddedSize * m_PaddedSize * m_PaddedSize, AirBlock);
+
+		chunk.Unpack(m_Blocks.data());
+		if (m_Lod == 0)
+		{
+			for (uint32_t z = 0; z < ChunkSize; z++)
+			{
+				for (uint32_t y = 0; y < ChunkSize; y++)
+					memcpy(&m_Padded[GetPaddedIndex(0, y, z)], &m_Blocks[Chunk::GetIndex(0, y, z)], ChunkSize * sizeof(BlockID));
+			}
+		}
+		else
+		{
+			auto get = [this](uint32_t x, uint32_t y, uint32_t z) { return m_Blocks[Chunk::GetIndex(x, y, z)]; };
+			for (int32_t z = 0; z < m_Size; z++)
+			{
+				for (int32_t y = 0; y < m_Size; y++)
+				{
+					for (int32_t x = 0; x < m_Size; x++)
+						m_Padded[GetPaddedIndex(x, y, z)] = Downsample(get, x * step, y * step, z * step, step);
+				}
+			}
+		}
+
+		// only the layer of each neighbour that touches us matters
+		for (uint32_t face = 0; face < 6; face++)
+		{
+			const Chunk* neighbour = neighbours[face];
+			if (!neighbour || neighbour->IsEmpty())
+				continue;
+
+			uint32_t axis = face / 2;
+			bool positive = face % 2 == 0;
+			uint32_t u = (axis + 1) % 3;
+			uint32_t v = (axis + 2) % 3;
+
+			auto get = [neighbour](uint32_t x, uint32_t y, uint32_t z) { return neighbour->Get(x, y, z); };
+			for (int32_t j = 0; j < m_Size; j++)
+			{
+				for (int32_t i = 0; i < m_Size; i++)
+				{
+					uint32_t from[3];
+					from[axis] = positive ? 0 : ChunkSize - step;
+					from[u] = i * step;
+					from[v] = j * step;
+
+					int32_t padded[3];
+					padded[axis] = positive ? m_Size : -1;
+					padded[u] = i;
+					padded[v] = j;
+
+					m_Padded[GetPaddedIndex(padded[0], padded[1], padded[2])] = m_Lod == 0
+						? neighbour->Get(from[0], from[1], from[2])
+						: Downsample(get, from[0], from[1], from[2], step);
+				}
+			}
+		}
+	}
+
+	uint32_t ChunkMesher::Build(const Chunk& chunk, const ChunkNeighbours& neighbours, ChunkMesh& outMesh, uint32_t lod)
+	{
+		outMesh.Clear();
+		outMesh.Lod = std::min(lod, MaxLod);
+		if (chunk.IsEmpty())
+			return 0;
+
+		m_Lod = outMesh.Lod;
+		m_Size = (int32_t)(ChunkSize >> m_Lod);
+		m_PaddedSize = m_Size + 2;
+		m_PaddedStrides[0] = 1;
+		m_PaddedStrides[1] = m_PaddedSize;
+		m_PaddedStrides[2] = m_PaddedSize * m_PaddedSize;
+
+		FillPadded(chunk, neighbours);
+
+		// vertices are in blocks whatever the detail
+		float scale = (float)(1u << m_Lod);
+		uint32_t size = (uint32_t)m_Size;
+
+		uint32_t quadCount = 0;
+		for (uint32_t face = 0; face < 6; face++)
+		{
+			uint32_t axis = face / 2;
+			bool positive = face % 2 == 0;
+
+			// u x v points along the face normal, keeps the winding consistent on every face
+			uint32_t u = (axis + 1) % 3;
+			uint32_t v = (axis + 2) % 3;
+
+			int32_t neighbourOffset = positive ? m_PaddedStrides[axis] : -m_PaddedStrides[axis];
+
+			// walk each slice along whichever of u and v is closer together in memory
+			bool uInner = m_PaddedStrides[u] < m_PaddedStrides[v];
+			int32_t innerStride = m_PaddedStrides[uInner ? u : v];
+			int32_t outerStride = m_PaddedStrides[uInner ? v : u];
+			uint32_t maskInnerStride = uInner ? 1 : size;
+			uint32_t maskOuterStride = uInner ? size : 1;
+
+			glm::vec3 normal(0.0f);
+			normal[axis] = positive ? 1.0f : -1.0f;
+
+			for (uint32_t slice = 0; slice < size; slice++)
+			{
+				// visible faces of this slice, by block type
+				int32_t sliceStart = GetPaddedIndex(0, 0, 0) + (int32_t)slice * m_PaddedStrides[axis];
+				BlockID anyVisible = AirBlock;
+				for (uint32_t outer = 0; outer < size; outer++)
+				{
+					int32_t index = sliceStart + (int32_t)outer * outerStride;
+					BlockID* mask = &m_Mask[outer * maskOuterStride];
+					for (uint32_t inner = 0; inner < size; inner++, index += innerStride)
+					{
+						BlockID block = m_Padded[index];
+						BlockID visible = m_Padded[index + neighbourOffset] == AirBlock ? block : AirBlock;
+						mask[inner * maskInnerStride] = visible;
+						anyVisible |= visible;
+					}
+				}
+
+				// buried or empty slices are the common case
+				if (anyVisible == AirBlock)
+					continue;
+
+				// grow each face into the biggest rectangle of the same block and emit it as one quad
+				for (uint32_t j = 0; j < size; j++)
+				{
+					for (uint32_t i = 0; i < size;)
+					{
+						BlockID block = m_Mask[i + j * size];
+						if (block == AirBlock)
+						{
+							i++;
+							continue;
+						}
+
+						uint32_t width = 1;
+						while (i + width < size && m_Mask[i + width + j * size] == block)
+							width++;
+
+						uint32_t height = 1;
+						for (; j + height < size; height++)
+						{
+							const BlockID* row = &m_Mask[i + (j + height) * size];
+							if (std::any_of(row, row + width, [block](BlockID other) { return other != block; }))
+								break;
+						}
+
+						for (uint32_t h = 0; h < height; h++)
+							std::fill_n(&m_Mask[i + (j + h) * size], width, AirBlock);
+
+						glm::vec3 origin(0.0f), du(0.0f), dv(0.0f);
+						origin[axis] = (float)(slice + (positive ? 1 : 0)) * scale;
+						origin[u] = (float)i * scale;
+						origin[v] = (float)j * scale;
+						du[u] = (float)width * scale;
+						dv[v] = (float)height * scale;
+
+						uint32_t first = (uint32_t)outMesh.Vertices.size();
+						outMesh.Vertices.resize(first + 4);
+						ChunkVertex* vertices = &outMesh.Vertices[first];
+						vertices[0] = { origin, normal, block };
+						vertices[1] = { origin + (positive ? dv : du), normal, block };
+						vertices[2] = { origin + du + dv, normal, block };
+						vertices[3] = { origin + (positive ? du : dv), normal, block };
+
+						size_t indexStart = outMesh.Indices.size();
+						outMesh.Indices.resize(indexStart + 6);
+						uint32_t* indices = &outMesh.Indices[indexStart];
+						indices[0] = first + 0;
+						indices[1] = first + 1;
+						indices[2] = first + 2;
+						indices[3] = first + 2;
+						indices[4] = first + 3;
+						indices[5] = first + 0;
+
+						quadCount++;
+						i += width;
+					}
+				}
+			}
+		}
+
+		return quadCount;
+	}
+}
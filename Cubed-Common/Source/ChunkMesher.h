@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <stdint.h>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "Chunk.h"
+
+namespace Cubed
+{
+	// same layout as the client renderer's Vertex, so meshes can be uploaded as is
+	struct ChunkVertex
+	{
+		glm::vec3 Position; // relative to the chunk's corner
+		glm::vec3 Normal;
+		uint32_t Material = 0; // block ID of the face, the renderer picks its texture with it
+	};
+
+	struct ChunkMesh
+	{
+		std::vector<ChunkVertex> Vertices;
+		std::vector<uint32_t> Indices; // 6 per quad, same winding as the renderer's cube
+		uint32_t Lod = 0;              // built from blocks grouped 2^Lod to a side
+
+		void Clear() { Vertices.clear(); Indices.clear(); Lod = 0; }
+		bool Empty() const { return Indices.empty(); }
+	};
+
+	enum class ChunkFace : uint8_t
+	{
+		PositiveX = 0, NegativeX, PositiveY, NegativeY, PositiveZ, NegativeZ
+	};
+
+	// chunks touching each face, indexed by ChunkFace, nullptr if not loaded (treated as air)
+	using ChunkNeighbours = std::array<const Chunk*, 6>;
+
+	//
+	// ChunkMesher - turns a chunk into a triangle mesh of its visible faces
+	//
+	// Faces between two solid blocks are never visible, so only faces next to air are kept,
+	// including faces against the neighbouring chunks. What's left is merged greedily: every
+	// slice of the chunk is swept row by row and each visible face grows into the biggest
+	// rectangle of matching faces it can, which turns a flat floor into a single quad.
+	//
+	// Far away chunks can be meshed at a lower level of detail: every 2^lod blocks to a side
+	// become one block (solid if at least half of them are), which leaves far fewer faces.
+	// Faces against neighbours use the neighbours at the same detail, so there can be small
+	// gaps where chunks of different detail meet.
+	//
+	// Holds on to its scratch buffers, keep one per thread and reuse it.
+	//
+	class ChunkMesher
+	{
+	public:
+		ChunkMesher();
+
+		static constexpr uint32_t MaxLod = 3;
+
+		// returns the number of quads generated
+		uint32_t Build(const Chunk& chunk, const ChunkNeighbours& neighbours, ChunkMesh& outMesh, uint32_t lod = 0);
+	private:
+		// chunk plus a one block border copied from the neighbours, at the current detail
+		void FillPadded(const Chunk& chunk, const ChunkNeighbours& neighbours);
+
+		int32_t GetPaddedIndex(int32_t x, int32_t y, int32_t z) const { return (x + 1) + m_PaddedSize * ((y + 1) + m_PaddedSize * (z + 1)); }
+	private:
+		// blocks per side at the current detail, and the padded volume's size and strides
+		uint32_t m_Lod = 0;
+		int32_t m_Size = ChunkSize;
+		int32_t m_PaddedSize = ChunkSize + 2;
+		int32_t m_PaddedStrides[3] = {};
+
+		std::vector<BlockID> m_Blocks;
+		std::vector<BlockID> m_Padded;
+		std::vector<BlockID> m_Mask;
+	};
+}
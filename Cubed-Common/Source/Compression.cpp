@@ -0,0 +1,174 @@
+#include "Compression.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Cubed
+{
+	static constexpr uint32_t s_MinMatch = 4;
+	static constexpr uint32_t s_MaxOffset = 65535;
+	static constexpr uint32_t s_HashBits = 12;
+
+	static uint32_t Read32(const uint8_t* data)
+	{
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	static uint32_t Hash(uint32_t sequence)
+	{
+		// Knuth's multiplicative hash, the top bits are the well mixed ones
+		return (sequence * 2654435761u) >> (32 - s_HashBits);
+	}
+
+	// a length that didn't fit in its nibble, the nibble itself already holds 15 of it
+	static uint8_t* WriteLength(uint8_t* out, uint64_t length)
+	{
+		length -= 15;
+		for (; length >= 255; length -= 255)
+			*out++ = 255;
+		*out++ = (uint8_t)length;
+		return out;
+	}
+
+	static bool ReadLength(const uint8_t*& in, const uint8_t* end, uint64_t& length)
+	{
+		uint8_t byte;
+		do
+		{
+			if (in == end)
+				return false;
+
+			byte = *in++;
+			length += byte;
+		} while (byte == 255);
+		return true;
+	}
+
+	static uint8_t* WriteLiterals(uint8_t* out, const uint8_t* literals, uint64_t count, uint32_t matchNibble)
+	{
+		*out++ = (uint8_t)(std::min<uint64_t>(count, 15) << 4 | matchNibble);
+		if (count >= 15)
+			out = WriteLength(out, count);
+
+		memcpy(out, literals, count);
+		return out + count;
+	}
+
+	uint64_t GetLZMaxCompressedSize(uint64_t size)
+	{
+		// everything as literals: a token, the length bytes and the literals themselves
+		return size + size / 255 + 16;
+	}
+
+	uint64_t LZCompress(const uint8_t* data, uint64_t size, uint8_t* outData, uint64_t capacity)
+	{
+		// checking once up front keeps the loop free of bounds checks
+		if (capacity < GetLZMaxCompressedSize(size))
+			return 0;
+
+		// positions of the last 4 byte sequence with each hash, candidates are checked before use
+		uint32_t table[1 << s_HashBits] = {};
+
+		const uint8_t* in = data;
+		const uint8_t* end = data + size;
+		const uint8_t* anchor = data; // start of the literals not written yet
+		uint8_t* out = outData;
+
+		while (size >= s_MinMatch && in <= end - s_MinMatch)
+		{
+			uint32_t sequence = Read32(in);
+			uint32_t& entry = table[Hash(sequence)];
+			const uint8_t* candidate = data + entry;
+			entry = (uint32_t)(in - data);
+
+			if (candidate >= in || in - candidate > s_MaxOffset || Read32(candidate) != sequence)
+			{
+				in++;
+				continue;
+			}
+
+			// matches may run into the bytes they produce, that's how repeats come out as one match
+			const uint8_t* matchEnd = in + s_MinMatch;
+			const uint8_t* reference = candidate + s_MinMatch;
+			while (matchEnd < end && *matchEnd == *reference)
+			{
+				matchEnd++;
+				reference++;
+			}
+
+			uint64_t matchLength = (uint64_t)(matchEnd - in) - s_MinMatch;
+			out = WriteLiterals(out, anchor, (uint64_t)(in - anchor), (uint32_t)std::min<uint64_t>(matchLength, 15));
+
+			uint32_t offset = (uint32_t)(in - candidate);
+			*out++ = (uint8_t)offset;
+			*out++ = (uint8_t)(offset >> 8);
+			if (matchLength >= 15)
+				out = WriteLength(out, matchLength);
+
+			in = matchEnd;
+			anchor = in;
+		}
+
+		// always ends in a sequence of literals only, even an empty one
+		out = WriteLiterals(out, anchor, (uint64_t)(end - anchor), 0);
+		return (uint64_t)(out - outData);
+	}
+
+	bool LZDecompress(const uint8_t* data, uint64_t dataSize, uint8_t* outData, uint64_t size)
+	{
+		const uint8_t* in = data;
+		const uint8_t* inEnd = data + dataSize;
+		uint8_t* out = outData;
+		uint8_t* outEnd = outData + size;
+
+		while (in < inEnd)
+		{
+			uint8_t token = *in++;
+
+			uint64_t literalCount = token >> 4;
+			if (literalCount == 15 && !ReadLength(in, inEnd, literalCount))
+				return false;
+			if (literalCount > (uint64_t)(inEnd - in) || literalCount > (uint64_t)(outEnd - out))
+				return false;
+
+			memcpy(out, in, literalCount);
+			in += literalCount;
+			out += literalCount;
+
+			// the last sequence has no match
+			if (in == inEnd)
+				break;
+
+			if (inEnd - in < 2)
+				return false;
+
+			uint32_t offset = (uint32_t)in[0] | (uint32_t)in[1] << 8;
+			in += 2;
+
+			uint64_t matchLength = token & 15;
+			if (matchLength == 15 && !ReadLength(in, inEnd, matchLength))
+				return false;
+			matchLength += s_MinMatch;
+
+			if (offset == 0 || offset > (uint64_t)(out - outData) || matchLength > (uint64_t)(outEnd - out))
+				return false;
+
+			const uint8_t* match = out - offset;
+			if (offset >= matchLength)
+			{
+				memcpy(out, match, matchLength);
+				out += matchLength;
+			}
+			else
+			{
+				// overlapping, each byte copied may be one this match just wrote
+				for (uint64_t i = 0; i < matchLength; i++)
+					*out++ = *match++;
+			}
+		}
+
+		return out == outEnd;
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace Cubed
+{
+	//
+	// LZ compression - general purpose byte compression, LZ4 style
+	//
+	// Greedy matching against a small hash table of recently seen 4 byte sequences, so it is
+	// fast enough to encode every chunk edit and decode on the network thread, at the cost of
+	// a worse ratio than an entropy coder would get. Best on data that repeats whole byte
+	// sequences, like the runs of neighbouring terrain columns.
+	//
+	// Format, a series of sequences until the input runs out
+	// 1. Token byte: literal count in the high 4 bits, match length - 4 in the low 4 bits. A
+	//    nibble of 15 means more length follows as bytes after it, each added on until one
+	//    that isn't 255 (literal count right after the token, match length after the offset)
+	// 2. Literals, copied as is
+	// 3. Match offset back from the current output position (uint16_t), absent in the last
+	//    sequence, which is only literals
+	//
+
+	// most LZCompress can write for size bytes of input
+	uint64_t GetLZMaxCompressedSize(uint64_t size);
+
+	// returns the compressed size, 0 if capacity is less than GetLZMaxCompressedSize(size)
+	uint64_t LZCompress(const uint8_t* data, uint64_t size, uint8_t* outData, uint64_t capacity);
+	// false unless the data decompresses to exactly size bytes
+	bool LZDecompress(const uint8_t* data, uint64_t dataSize, uint8_t* outData, uint64_t size);
+}
@@ -0,0 +1,56 @@
+#include "CubeBatch.h"
+
+#include <algorithm>
+
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtx/euler_angles.hpp"
+
+namespace Cubed
+{
+	// bounding sphere of a unit cube, whatever its rotation
+	static constexpr float s_CubeRadius = 0.8660254f;
+
+	void CubeBatch::Add(const glm::vec3& position, const glm::vec3& rotation, uint32_t material)
+	{
+		m_Cubes.push_back({ position, rotation, material });
+		m_Bounds.Add(position, s_CubeRadius);
+	}
+
+	void CubeBatch::Clear()
+	{
+		m_Cubes.clear();
+		m_Bounds.Clear();
+	}
+
+	uint32_t CubeBatch::Cull(const Frustum* frustum)
+	{
+		m_Visibility.resize(m_Cubes.size());
+		if (frustum)
+			return frustum->CullSpheres(m_Bounds, m_Visibility.data());
+
+		std::fill(m_Visibility.begin(), m_Visibility.end(), (uint8_t)1);
+		return (uint32_t)m_Cubes.size();
+	}
+
+	uint32_t CubeBatch::WriteInstances(CubeInstance* outInstances, const glm::vec3& cameraPosition, float lodDistance) const
+	{
+		float lodDistance2 = lodDistance * lodDistance;
+		uint32_t lowDetail = 0;
+		for (size_t i = 0; i < m_Cubes.size(); i++)
+		{
+			if (!m_Visibility[i])
+				continue;
+
+			const PendingCube& cube = m_Cubes[i];
+			glm::vec3 offset = cube.Position - cameraPosition;
+			outInstances->Transform = glm::translate(glm::mat4(1.0f), cube.Position);
+			if (glm::dot(offset, offset) < lodDistance2)
+				outInstances->Transform *= glm::eulerAngleXYZ(glm::radians(cube.Rotation.x), glm::radians(cube.Rotation.y), glm::radians(cube.Rotation.z));
+			else
+				lowDetail++;
+			outInstances->Material = cube.Material;
+			outInstances++;
+		}
+		return lowDetail;
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "Frustum.h"
+
+namespace Cubed
+{
+	// per instance vertex data, one per cube in a batch
+	struct CubeInstance
+	{
+		glm::mat4 Transform;
+		uint32_t Material = 0; // chunk vertices carry their own and leave this at 0
+	};
+
+	//
+	// CubeBatch - cubes queued for one instanced draw, and the CPU side of turning them into instances
+	//
+	// Bounds are kept apart from the cubes so the whole batch is culled in one go. Every cube
+	// that survives gets its instance written straight to wherever the draw reads it from,
+	// which is mapped GPU memory in the renderer, so nothing is ever read back. Far away cubes
+	// are drawn without their rotation, it isn't worth working out.
+	//
+	class CubeBatch
+	{
+	public:
+		void Add(const glm::vec3& position, const glm::vec3& rotation, uint32_t material);
+		void Clear();
+		uint32_t Size() const { return (uint32_t)m_Cubes.size(); }
+
+		// marks the cubes the frustum can see (all of them without one), returns how many
+		uint32_t Cull(const Frustum* frustum);
+		// writes an instance for every cube the last Cull kept, outInstances needs room for as many
+		// as it returned. Returns how many of them were written without their rotation
+		uint32_t WriteInstances(CubeInstance* outInstances, const glm::vec3& cameraPosition, float lodDistance) const;
+	private:
+		struct PendingCube
+		{
+			glm::vec3 Position;
+			glm::vec3 Rotation;
+			uint32_t Material;
+		};
+		std::vector<PendingCube> m_Cubes;
+		SphereBatch m_Bounds;
+		std::vector<uint8_t> m_Visibility;
+	};
+}
@@ -0,0 +1,200 @@
+#include "EntityStore.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace Cubed
+{
+	EntityHandle EntityStore::Insert(uint32_t id, const PlayerData& data)
+	{
+		uint32_t existing = FindSlot(id);
+		if (existing != UINT32_MAX)
+		{
+			const Slot& slot = m_Slots[existing];
+			Set(slot.DenseIndex, data);
+			return { existing, slot.Generation };
+		}
+
+		uint32_t slotIndex = AllocateSlot();
+		Slot& slot = m_Slots[slotIndex];
+		slot.DenseIndex = (uint32_t)m_IDs.size();
+
+		m_IDs.push_back(id);
+		m_DenseToSlot.push_back(slotIndex);
+		m_Positions.push_back(data.Position);
+		m_Velocities.push_back(data.Velocity);
+		m_Rotations.push_back(data.Rotation);
+		InsertID(id, slotIndex);
+
+		return { slotIndex, slot.Generation };
+	}
+
+	uint32_t EntityStore::AllocateSlot()
+	{
+		if (!m_FreeSlots.empty())
+		{
+			uint32_t slotIndex = m_FreeSlots.back();
+			m_FreeSlots.pop_back();
+			return slotIndex;
+		}
+
+		m_Slots.emplace_back();
+		return (uint32_t)m_Slots.size() - 1;
+	}
+
+	bool EntityStore::Remove(uint32_t id)
+	{
+		uint32_t slotIndex = FindSlot(id);
+		if (slotIndex == UINT32_MAX)
+			return false;
+
+		EraseID(id);
+
+		// swap the last entity into the hole to keep the arrays packed
+		Slot& slot = m_Slots[slotIndex];
+		uint32_t index = slot.DenseIndex;
+		uint32_t last = (uint32_t)m_IDs.size() - 1;
+		if (index != last)
+		{
+			m_IDs[index] = m_IDs[last];
+			m_DenseToSlot[index] = m_DenseToSlot[last];
+			m_Positions[index] = m_Positions[last];
+			m_Velocities[index] = m_Velocities[last];
+			m_Rotations[index] = m_Rotations[last];
+			m_Slots[m_DenseToSlot[index]].DenseIndex = index;
+		}
+
+		m_IDs.pop_back();
+		m_DenseToSlot.pop_back();
+		m_Positions.pop_back();
+		m_Velocities.pop_back();
+		m_Rotations.pop_back();
+
+		// bump generation so outstanding handles to this slot go stale
+		slot.DenseIndex = UINT32_MAX;
+		slot.Generation++;
+		m_FreeSlots.push_back(slotIndex);
+		return true;
+	}
+
+	void EntityStore::Clear()
+	{
+		// walk the live entities rather than resetting slots, so old handles stay stale
+		for (uint32_t slotIndex : m_DenseToSlot)
+		{
+			m_Slots[slotIndex].DenseIndex = UINT32_MAX;
+			m_Slots[slotIndex].Generation++;
+			m_FreeSlots.push_back(slotIndex);
+		}
+
+		// emptied in place, keeping its capacity
+		if (!m_IDs.empty())
+			std::fill(m_IDTable.begin(), m_IDTable.end(), IDEntry());
+
+		m_IDs.clear();
+		m_DenseToSlot.clear();
+		m_Positions.clear();
+		m_Velocities.clear();
+		m_Rotations.clear();
+	}
+
+	void EntityStore::Reserve(size_t capacity)
+	{
+		m_Slots.reserve(capacity);
+		GrowIDTable(capacity);
+		m_IDs.reserve(capacity);
+		m_DenseToSlot.reserve(capacity);
+		m_Positions.reserve(capacity);
+		m_Velocities.reserve(capacity);
+		m_Rotations.reserve(capacity);
+	}
+
+	EntityHandle EntityStore::Find(uint32_t id) const
+	{
+		uint32_t slotIndex = FindSlot(id);
+		if (slotIndex == UINT32_MAX)
+			return {};
+
+		return { slotIndex, m_Slots[slotIndex].Generation };
+	}
+
+	bool EntityStore::IsValid(EntityHandle handle) const
+	{
+		return handle.Slot < m_Slots.size()
+			&& m_Slots[handle.Slot].Generation == handle.Generation
+			&& m_Slots[handle.Slot].DenseIndex != UINT32_MAX;
+	}
+
+	size_t EntityStore::GetIndex(uint32_t id) const
+	{
+		uint32_t slotIndex = FindSlot(id);
+		if (slotIndex == UINT32_MAX)
+			return SIZE_MAX;
+
+		return m_Slots[slotIndex].DenseIndex;
+	}
+
+	size_t EntityStore::GetIndex(EntityHandle handle) const
+	{
+		if (!IsValid(handle))
+			return SIZE_MAX;
+
+		return m_Slots[handle.Slot].DenseIndex;
+	}
+
+	void EntityStore::InsertID(uint32_t id, uint32_t slot)
+	{
+		// m_IDs already holds the new entity
+		GrowIDTable(m_IDs.size());
+
+		size_t mask = m_IDTable.size() - 1;
+		size_t i = GetIDHash(id) & mask;
+		while (m_IDTable[i].Slot != UINT32_MAX)
+			i = (i + 1) & mask;
+
+		m_IDTable[i] = { id, slot };
+	}
+
+	void EntityStore::EraseID(uint32_t id)
+	{
+		size_t mask = m_IDTable.size() - 1;
+		size_t hole = GetIDHash(id) & mask;
+		while (m_IDTable[hole].ID != id || m_IDTable[hole].Slot == UINT32_MAX)
+			hole = (hole + 1) & mask;
+
+		// shift later entries of the probe run back into the hole instead of leaving a
+		// tombstone, so lookups never have to skip over dead entries
+		for (size_t i = (hole + 1) & mask; m_IDTable[i].Slot != UINT32_MAX; i = (i + 1) & mask)
+		{
+			size_t home = GetIDHash(m_IDTable[i].ID) & mask;
+			if (((i - home) & mask) >= ((i - hole) & mask))
+			{
+				m_IDTable[hole] = m_IDTable[i];
+				hole = i;
+			}
+		}
+
+		m_IDTable[hole] = {};
+	}
+
+	void EntityStore::GrowIDTable(size_t capacity)
+	{
+		if (capacity * 2 <= m_IDTable.size())
+			return;
+
+		std::vector<IDEntry> old = std::move(m_IDTable);
+		m_IDTable.assign(std::bit_ceil(std::max<size_t>(capacity * 2, 16)), IDEntry());
+
+		size_t mask = m_IDTable.size() - 1;
+		for (const IDEntry& entry : old)
+		{
+			if (entry.Slot == UINT32_MAX)
+				continue;
+
+			size_t i = GetIDHash(entry.ID) & mask;
+			while (m_IDTable[i].Slot != UINT32_MAX)
+				i = (i + 1) & mask;
+			m_IDTable[i] = entry;
+		}
+	}
+}
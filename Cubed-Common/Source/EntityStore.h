@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+namespace Cubed
+{
+	// player state shared between server and client
+	struct PlayerData
+	{
+		glm::vec2 Position;
+		glm::vec2 Velocity;
+		glm::vec3 Rotation{ 0.0f }; // in degrees
+	};
+
+	// stable reference to an entity, stays valid (and detectably stale once removed) while
+	// other entities come and go and the dense arrays get shuffled around
+	struct EntityHandle
+	{
+		uint32_t Slot = UINT32_MAX;
+		uint32_t Generation = 0;
+	};
+
+	//
+	// EntityStore - slot map of players keyed by network ID
+	//
+	// Components live in tightly packed struct-of-arrays storage so iteration is a linear walk
+	// and serialization is a bulk copy. Removal swaps the last entity into the hole, so dense
+	// indices are not stable across removals, use EntityHandle for that.
+	//
+	// Nothing is freed by Clear() or Remove(), so a store that gets refilled every tick (interest
+	// sets, snapshot views) stops allocating once it has seen its largest size.
+	//
+	class EntityStore
+	{
+	public:
+		// inserts a new entity or overwrites the existing one with this ID
+		EntityHandle Insert(uint32_t id, const PlayerData& data);
+		bool Remove(uint32_t id);
+		void Clear();
+		void Reserve(size_t capacity);
+
+		bool Contains(uint32_t id) const { return FindSlot(id) != UINT32_MAX; }
+		EntityHandle Find(uint32_t id) const;
+		bool IsValid(EntityHandle handle) const;
+
+		// dense index lookups, return SIZE_MAX if missing/stale
+		size_t GetIndex(uint32_t id) const;
+		size_t GetIndex(EntityHandle handle) const;
+
+		PlayerData Get(size_t index) const { return { m_Positions[index], m_Velocities[index], m_Rotations[index] }; }
+		void Set(size_t index, const PlayerData& data) { m_Positions[index] = data.Position; m_Velocities[index] = data.Velocity; m_Rotations[index] = data.Rotation; }
+
+		size_t Size() const { return m_IDs.size(); }
+		bool Empty() const { return m_IDs.empty(); }
+
+		// dense component arrays, all the same length and in the same order
+		const std::vector<uint32_t>& GetIDs() const { return m_IDs; }
+		const std::vector<glm::vec2>& GetPositions() const { return m_Positions; }
+		const std::vector<glm::vec2>& GetVelocities() const { return m_Velocities; }
+		const std::vector<glm::vec3>& GetRotations() const { return m_Rotations; }
+		std::vector<glm::vec2>& GetPositions() { return m_Positions; }
+		std::vector<glm::vec2>& GetVelocities() { return m_Velocities; }
+		std::vector<glm::vec3>& GetRotations() { return m_Rotations; }
+	private:
+		uint32_t AllocateSlot();
+
+		// ID to slot lookup, open addressing with linear probing in a power of two sized table,
+		// returns UINT32_MAX if missing
+		uint32_t FindSlot(uint32_t id) const
+		{
+			if (m_IDTable.empty())
+				return UINT32_MAX;
+
+			size_t mask = m_IDTable.size() - 1;
+			for (size_t i = GetIDHash(id) & mask;; i = (i + 1) & mask)
+			{
+				const IDEntry& entry = m_IDTable[i];
+				if (entry.Slot == UINT32_MAX || entry.ID == id)
+					return entry.Slot;
+			}
+		}
+		void InsertID(uint32_t id, uint32_t slot);
+		void EraseID(uint32_t id);
+		void GrowIDTable(size_t capacity);
+
+		static size_t GetIDHash(uint32_t id) { return (size_t)((id * 0x9E3779B97F4A7C15ull) >> 32); }
+	private:
+		struct Slot
+		{
+			uint32_t DenseIndex = UINT32_MAX;
+			uint32_t Generation = 0;
+		};
+
+		struct IDEntry
+		{
+			uint32_t ID = 0;
+			uint32_t Slot = UINT32_MAX; // UINT32_MAX marks an empty entry
+		};
+
+		std::vector<Slot> m_Slots;
+		std::vector<uint32_t> m_FreeSlots;
+		std::vector<IDEntry> m_IDTable; // never more than half full, one entry per live entity
+
+		// dense storage
+		std::vector<uint32_t> m_IDs;
+		std::vector<uint32_t> m_DenseToSlot;
+		std::vector<glm::vec2> m_Positions;
+		std::vector<glm::vec2> m_Velocities;
+		std::vector<glm::vec3> m_Rotations;
+	};
+}
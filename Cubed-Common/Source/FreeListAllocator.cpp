@@ -0,0 +1,101 @@
+#include "FreeListAllocator.h"
+
+#include <iterator>
+
+namespace Cubed
+{
+	FreeListAllocator::FreeListAllocator(uint64_t size)
+		: m_Size(size)
+	{
+		if (size > 0)
+			AddFreeRange(0, size);
+	}
+
+	void FreeListAllocator::AddFreeRange(uint64_t offset, uint64_t size)
+	{
+		m_FreeByOffset.emplace(offset, size);
+		m_FreeBySize.emplace(size, offset);
+	}
+
+	void FreeListAllocator::RemoveFreeRange(std::map<uint64_t, uint64_t>::iterator it)
+	{
+		m_FreeBySize.erase({ it->second, it->first });
+		m_FreeByOffset.erase(it);
+	}
+
+	uint64_t FreeListAllocator::Allocate(uint64_t size, uint64_t alignment)
+	{
+		if (size == 0)
+			return InvalidOffset;
+
+		// smallest range first, a range that is big enough can still be too small once its
+		// start is aligned, so keep looking until one fits
+		for (auto it = m_FreeBySize.lower_bound({ size, 0 }); it != m_FreeBySize.end(); ++it)
+		{
+			auto [rangeSize, rangeOffset] = *it;
+			uint64_t offset = (rangeOffset + alignment - 1) & ~(alignment - 1);
+			uint64_t padding = offset - rangeOffset;
+			if (padding + size > rangeSize)
+				continue;
+
+			RemoveFreeRange(m_FreeByOffset.find(rangeOffset));
+
+			// whatever is left on either side stays free
+			if (padding > 0)
+				AddFreeRange(rangeOffset, padding);
+			if (padding + size < rangeSize)
+				AddFreeRange(offset + size, rangeSize - padding - size);
+
+			m_Allocations.emplace(offset, size);
+			m_Used += size;
+			return offset;
+		}
+
+		return InvalidOffset;
+	}
+
+	void FreeListAllocator::Free(uint64_t offset)
+	{
+		auto allocation = m_Allocations.find(offset);
+		if (allocation == m_Allocations.end())
+			return;
+
+		uint64_t size = allocation->second;
+		m_Allocations.erase(allocation);
+		m_Used -= size;
+
+		// merge with the free ranges right after and right before
+		auto next = m_FreeByOffset.lower_bound(offset);
+		if (next != m_FreeByOffset.end() && next->first == offset + size)
+		{
+			size += next->second;
+			auto after = std::next(next);
+			RemoveFreeRange(next);
+			next = after;
+		}
+
+		if (next != m_FreeByOffset.begin())
+		{
+			auto previous = std::prev(next);
+			if (previous->first + previous->second == offset)
+			{
+				offset = previous->first;
+				size += previous->second;
+				RemoveFreeRange(previous);
+			}
+		}
+
+		AddFreeRange(offset, size);
+	}
+
+	FreeListAllocator::Statistics FreeListAllocator::GetStatistics() const
+	{
+		Statistics stats;
+		stats.Size = m_Size;
+		stats.Used = m_Used;
+		stats.Allocations = (uint32_t)m_Allocations.size();
+		stats.FreeRanges = (uint32_t)m_FreeByOffset.size();
+		stats.LargestFreeRange = m_FreeBySize.empty() ? 0 : m_FreeBySize.rbegin()->first;
+		return stats;
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+namespace Cubed
+{
+	//
+	// FreeListAllocator - hands out aligned ranges of a fixed size address space
+	//
+	// Only does the bookkeeping, it never touches the memory itself, so it knows nothing about
+	// Vulkan and can be exercised on its own. Free ranges are kept both by offset, so a freed
+	// range merges with the free ranges on either side of it, and by size, so allocation picks
+	// the smallest range that fits (best fit keeps the big ranges big).
+	//
+	class FreeListAllocator
+	{
+	public:
+		static constexpr uint64_t InvalidOffset = UINT64_MAX;
+
+		struct Statistics
+		{
+			uint64_t Size = 0;
+			uint64_t Used = 0;
+			uint64_t LargestFreeRange = 0;
+			uint32_t Allocations = 0;
+			uint32_t FreeRanges = 0;
+
+			uint64_t GetFree() const { return Size - Used; }
+
+			// 0 when all free space is one range, towards 1 the more it is split up
+			float GetFragmentation() const { return GetFree() ? 1.0f - (float)LargestFreeRange / (float)GetFree() : 0.0f; }
+		};
+	public:
+		explicit FreeListAllocator(uint64_t size);
+
+		// alignment has to be a power of two, returns InvalidOffset if nothing fits
+		uint64_t Allocate(uint64_t size, uint64_t alignment = 1);
+		void Free(uint64_t offset);
+
+		uint64_t GetSize() const { return m_Size; }
+		bool IsEmpty() const { return m_Allocations.empty(); }
+		Statistics GetStatistics() const;
+	private:
+		void AddFreeRange(uint64_t offset, uint64_t size);
+		void RemoveFreeRange(std::map<uint64_t, uint64_t>::iterator it);
+	private:
+		uint64_t m_Size = 0;
+		uint64_t m_Used = 0;
+
+		std::map<uint64_t, uint64_t> m_FreeByOffset;         // offset -> size
+		std::set<std::pair<uint64_t, uint64_t>> m_FreeBySize; // (size, offset)
+		std::unordered_map<uint64_t, uint64_t> m_Allocations; // offset -> size
+	};
+}
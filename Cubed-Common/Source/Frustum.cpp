@@ -0,0 +1,139 @@
+#include "Frustum.h"
+
+#include <cmath>
+
+namespace Cubed
+{
+	void BoxBatch::Add(const glm::vec3& min, const glm::vec3& max)
+	{
+		glm::vec3 center = (min + max) * 0.5f;
+		glm::vec3 extent = (max - min) * 0.5f;
+		CenterX.push_back(center.x);
+		CenterY.push_back(center.y);
+		CenterZ.push_back(center.z);
+		ExtentX.push_back(extent.x);
+		ExtentY.push_back(extent.y);
+		ExtentZ.push_back(extent.z);
+	}
+
+	void BoxBatch::Clear()
+	{
+		CenterX.clear();
+		CenterY.clear();
+		CenterZ.clear();
+		ExtentX.clear();
+		ExtentY.clear();
+		ExtentZ.clear();
+	}
+
+	Frustum Frustum::FromViewProjection(const glm::mat4& viewProjection)
+	{
+		// Gribb/Hartmann, each plane is the last row of the matrix plus or minus one of the others.
+		// The near plane assumes -w <= z, which is also right (just looser) for 0..1 depth
+		auto row = [&viewProjection](int i) { return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]); };
+
+		Frustum frustum;
+		frustum.Planes[0] = row(3) + row(0);
+		frustum.Planes[1] = row(3) - row(0);
+		frustum.Planes[2] = row(3) + row(1);
+		frustum.Planes[3] = row(3) - row(1);
+		frustum.Planes[4] = row(3) + row(2);
+		frustum.Planes[5] = row(3) - row(2);
+
+		for (glm::vec4& plane : frustum.Planes)
+			plane /= glm::length(glm::vec3(plane));
+
+		return frustum;
+	}
+
+	bool Frustum::IsSphereVisible(const glm::vec3& center, float radius) const
+	{
+		for (const glm::vec4& plane : Planes)
+		{
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+				return false;
+		}
+		return true;
+	}
+
+	bool Frustum::IsBoxVisible(const glm::vec3& min, const glm::vec3& max) const
+	{
+		glm::vec3 center = (min + max) * 0.5f;
+		glm::vec3 extent = (max - min) * 0.5f;
+		for (const glm::vec4& plane : Planes)
+		{
+			// how far the box reaches towards the plane's normal
+			float reach = glm::dot(extent, glm::abs(glm::vec3(plane)));
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -reach)
+				return false;
+		}
+		return true;
+	}
+
+	// The batch versions keep every plane in locals and go through the batch once, without
+	// branching on the result, so the compiler can vectorize the loop across entries.
+
+	uint32_t Frustum::CullSpheres(const SphereBatch& spheres, uint8_t* outVisible) const
+	{
+		const float* x = spheres.X.data();
+		const float* y = spheres.Y.data();
+		const float* z = spheres.Z.data();
+		const float* radius = spheres.Radius.data();
+
+		const glm::vec4 p0 = Planes[0], p1 = Planes[1], p2 = Planes[2], p3 = Planes[3], p4 = Planes[4], p5 = Planes[5];
+
+		uint32_t count = spheres.Size();
+		uint32_t visibleCount = 0;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			float r = -radius[i];
+			bool visible = (p0.x * x[i] + p0.y * y[i] + p0.z * z[i] + p0.w >= r)
+				& (p1.x * x[i] + p1.y * y[i] + p1.z * z[i] + p1.w >= r)
+				& (p2.x * x[i] + p2.y * y[i] + p2.z * z[i] + p2.w >= r)
+				& (p3.x * x[i] + p3.y * y[i] + p3.z * z[i] + p3.w >= r)
+				& (p4.x * x[i] + p4.y * y[i] + p4.z * z[i] + p4.w >= r)
+				& (p5.x * x[i] + p5.y * y[i] + p5.z * z[i] + p5.w >= r);
+
+			outVisible[i] = (uint8_t)visible;
+			visibleCount += (uint32_t)visible;
+		}
+
+		return visibleCount;
+	}
+
+	uint32_t Frustum::CullBoxes(const BoxBatch& boxes, uint8_t* outVisible) const
+	{
+		const float* cx = boxes.CenterX.data();
+		const float* cy = boxes.CenterY.data();
+		const float* cz = boxes.CenterZ.data();
+		const float* ex = boxes.ExtentX.data();
+		const float* ey = boxes.ExtentY.data();
+		const float* ez = boxes.ExtentZ.data();
+
+		// the extents only ever get dotted with the absolute normals
+		std::array<glm::vec4, 6> planes = Planes;
+		std::array<glm::vec3, 6> normals;
+		for (size_t i = 0; i < planes.size(); i++)
+			normals[i] = glm::abs(glm::vec3(planes[i]));
+
+		const glm::vec4 p0 = planes[0], p1 = planes[1], p2 = planes[2], p3 = planes[3], p4 = planes[4], p5 = planes[5];
+		const glm::vec3 n0 = normals[0], n1 = normals[1], n2 = normals[2], n3 = normals[3], n4 = normals[4], n5 = normals[5];
+
+		uint32_t count = boxes.Size();
+		uint32_t visibleCount = 0;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			bool visible = (p0.x * cx[i] + p0.y * cy[i] + p0.z * cz[i] + p0.w >= -(n0.x * ex[i] + n0.y * ey[i] + n0.z * ez[i]))
+				& (p1.x * cx[i] + p1.y * cy[i] + p1.z * cz[i] + p1.w >= -(n1.x * ex[i] + n1.y * ey[i] + n1.z * ez[i]))
+				& (p2.x * cx[i] + p2.y * cy[i] + p2.z * cz[i] + p2.w >= -(n2.x * ex[i] + n2.y * ey[i] + n2.z * ez[i]))
+				& (p3.x * cx[i] + p3.y * cy[i] + p3.z * cz[i] + p3.w >= -(n3.x * ex[i] + n3.y * ey[i] + n3.z * ez[i]))
+				& (p4.x * cx[i] + p4.y * cy[i] + p4.z * cz[i] + p4.w >= -(n4.x * ex[i] + n4.y * ey[i] + n4.z * ez[i]))
+				& (p5.x * cx[i] + p5.y * cy[i] + p5.z * cz[i] + p5.w >= -(n5.x * ex[i] + n5.y * ey[i] + n5.z * ez[i]));
+
+			outVisible[i] = (uint8_t)visible;
+			visibleCount += (uint32_t)visible;
+		}
+
+		return visibleCount;
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+namespace Cubed
+{
+	// bounding volumes kept as separate arrays per component, so a whole batch can be tested
+	// with straight loops the compiler turns into SIMD
+	struct SphereBatch
+	{
+		std::vector<float> X, Y, Z, Radius;
+
+		void Add(const glm::vec3& center, float radius) { X.push_back(center.x); Y.push_back(center.y); Z.push_back(center.z); Radius.push_back(radius); }
+		void Clear() { X.clear(); Y.clear(); Z.clear(); Radius.clear(); }
+		uint32_t Size() const { return (uint32_t)X.size(); }
+	};
+
+	struct BoxBatch
+	{
+		std::vector<float> CenterX, CenterY, CenterZ;
+		std::vector<float> ExtentX, ExtentY, ExtentZ; // half the size on each axis
+
+		void Add(const glm::vec3& min, const glm::vec3& max);
+		void Clear();
+		uint32_t Size() const { return (uint32_t)CenterX.size(); }
+	};
+
+	//
+	// Frustum - the six planes of a camera's view volume, for throwing away what it can't see
+	//
+	// Planes point inwards and are normalized. Tests are conservative: something reported
+	// visible might still be just outside a corner of the frustum, but nothing visible is
+	// ever reported as outside.
+	//
+	struct Frustum
+	{
+		std::array<glm::vec4, 6> Planes; // left, right, bottom, top, near, far
+
+		static Frustum FromViewProjection(const glm::mat4& viewProjection);
+
+		bool IsSphereVisible(const glm::vec3& center, float radius) const;
+		bool IsBoxVisible(const glm::vec3& min, const glm::vec3& max) const;
+
+		// writes 1 for every visible entry and 0 for every culled one, returns the visible count
+		uint32_t CullSpheres(const SphereBatch& spheres, uint8_t* outVisible) const;
+		uint32_t CullBoxes(const BoxBatch& boxes, uint8_t* outVisible) const;
+	};
+}
@@ -0,0 +1,129 @@
+#include "Interpolation.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Cubed
+{
+	// anything further off than this is a server restart or a stall, not jitter
+	static constexpr double s_ClockResyncThreshold = 0.5;
+	static constexpr double s_ClockSmoothing = 0.05;
+
+	static glm::vec2 Hermite(const glm::vec2& p0, const glm::vec2& v0, const glm::vec2& p1, const glm::vec2& v1, float dt, float t)
+	{
+		float t2 = t * t;
+		float t3 = t2 * t;
+		return (2.0f * t3 - 3.0f * t2 + 1.0f) * p0
+			+ (t3 - 2.0f * t2 + t) * dt * v0
+			+ (-2.0f * t3 + 3.0f * t2) * p1
+			+ (t3 - t2) * dt * v1;
+	}
+
+	// shortest way round, so 350 -> 10 goes through 0 instead of spinning backwards
+	static float LerpAngle(float from, float to, float t)
+	{
+		float delta = std::fmod(to - from, 360.0f);
+		if (delta > 180.0f)
+			delta -= 360.0f;
+		else if (delta < -180.0f)
+			delta += 360.0f;
+		return from + delta * t;
+	}
+
+	void InterpolationBuffer::Track::Push(const Keyframe& keyframe)
+	{
+		// snapshots arrive in order, but never let time go backwards within a track
+		if (Count && keyframe.Time <= Get(Count - 1).Time)
+			return;
+
+		if (Count == s_MaxKeyframes)
+		{
+			Start = (Start + 1) % s_MaxKeyframes;
+			Count--;
+		}
+
+		Keyframes[(Start + Count) % s_MaxKeyframes] = keyframe;
+		Count++;
+	}
+
+	void InterpolationBuffer::PushSnapshot(double serverTime, double localTime, const EntityStore& players)
+	{
+		double offset = serverTime - localTime;
+		if (!m_HasServerTime || std::abs(offset - m_ServerTimeOffset) > s_ClockResyncThreshold)
+		{
+			m_ServerTimeOffset = offset;
+			m_HasServerTime = true;
+		}
+		else
+		{
+			m_ServerTimeOffset += (offset - m_ServerTimeOffset) * s_ClockSmoothing;
+		}
+
+		m_SnapshotCount++;
+		for (size_t i = 0; i < players.Size(); i++)
+		{
+			Track& track = m_Tracks[players.GetIDs()[i]];
+			track.Push({ serverTime, players.Get(i) });
+			track.LastSnapshot = m_SnapshotCount;
+		}
+
+		// players that left our view or disconnected
+		std::erase_if(m_Tracks, [this](const auto& entry) { return entry.second.LastSnapshot != m_SnapshotCount; });
+	}
+
+	void InterpolationBuffer::Clear()
+	{
+		m_Tracks.clear();
+		m_HasServerTime = false;
+	}
+
+	InterpolationBuffer::Statistics InterpolationBuffer::Sample(double localTime, EntityStore& outPlayers) const
+	{
+		Statistics stats;
+		outPlayers.Clear();
+
+		double renderTime = localTime + m_ServerTimeOffset - m_Settings.Delay;
+		for (const auto& [id, track] : m_Tracks)
+		{
+			if (track.Count == 0)
+				continue;
+
+			// newest keyframe at or before the render time
+			uint32_t before = 0;
+			while (before + 1 < track.Count && track.Get(before + 1).Time <= renderTime)
+				before++;
+
+			const Keyframe& from = track.Get(before);
+			PlayerData result = from.Data;
+
+			if (before + 1 < track.Count && from.Time <= renderTime)
+			{
+				const Keyframe& to = track.Get(before + 1);
+				float dt = (float)(to.Time - from.Time);
+				float t = (float)((renderTime - from.Time) / (to.Time - from.Time));
+
+				result.Position = Hermite(from.Data.Position, from.Data.Velocity, to.Data.Position, to.Data.Velocity, dt, t);
+				result.Velocity = glm::mix(from.Data.Velocity, to.Data.Velocity, t);
+				result.Rotation.x = LerpAngle(from.Data.Rotation.x, to.Data.Rotation.x, t);
+				result.Rotation.y = LerpAngle(from.Data.Rotation.y, to.Data.Rotation.y, t);
+				result.Rotation.z = LerpAngle(from.Data.Rotation.z, to.Data.Rotation.z, t);
+				stats.Interpolated++;
+			}
+			else if (renderTime > from.Time)
+			{
+				// ran out of keyframes, keep going for a bit in case the next one is just late
+				double ahead = renderTime - from.Time;
+				if (ahead > m_Settings.MaxExtrapolation)
+					stats.Clamped++;
+				else
+					stats.Extrapolated++;
+
+				result.Position += from.Data.Velocity * (float)std::min<double>(ahead, m_Settings.MaxExtrapolation);
+			}
+
+			outPlayers.Insert(id, result);
+		}
+
+		return stats;
+	}
+}
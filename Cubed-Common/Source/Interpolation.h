@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <unordered_map>
+
+#include "EntityStore.h"
+
+namespace Cubed
+{
+	struct InterpolationSettings
+	{
+		// how far behind the server we render, should cover a couple of send intervals plus jitter
+		float Delay = 0.1f;
+		// how long we keep moving a player along its last velocity once its samples run out
+		float MaxExtrapolation = 0.25f;
+	};
+
+	//
+	// InterpolationBuffer - smooths remote players between the snapshots we receive
+	//
+	// Every player gets a small ring of server timestamped samples. Rendering happens a fixed
+	// delay behind our estimate of the server's clock, so there is usually a sample on either
+	// side of the render time, and positions are Hermite interpolated between them using the
+	// velocities the server sent. When packets are late, players keep going along their last
+	// velocity for a bounded time and then stop, rather than jumping around.
+	//
+	class InterpolationBuffer
+	{
+	public:
+		struct Statistics
+		{
+			uint32_t Interpolated = 0;
+			uint32_t Extrapolated = 0;
+			uint32_t Clamped = 0; // out of samples and past MaxExtrapolation
+		};
+	public:
+		// adds every player in the snapshot, and forgets any player that is no longer in it
+		void PushSnapshot(double serverTime, double localTime, const EntityStore& players);
+		void Clear();
+
+		// samples every player at localTime (converted to server time, minus the delay)
+		Statistics Sample(double localTime, EntityStore& outPlayers) const;
+
+		InterpolationSettings& GetSettings() { return m_Settings; }
+		double GetServerTimeOffset() const { return m_ServerTimeOffset; }
+	private:
+		static constexpr uint32_t s_MaxKeyframes = 16;
+
+		struct Keyframe
+		{
+			double Time = 0.0;
+			PlayerData Data;
+		};
+
+		struct Track
+		{
+			std::array<Keyframe, s_MaxKeyframes> Keyframes;
+			uint32_t Start = 0;
+			uint32_t Count = 0;
+			uint32_t LastSnapshot = 0;
+
+			const Keyframe& Get(uint32_t index) const { return Keyframes[(Start + index) % s_MaxKeyframes]; }
+			void Push(const Keyframe& keyframe);
+		};
+	private:
+		InterpolationSettings m_Settings;
+		std::unordered_map<uint32_t, Track> m_Tracks;
+		uint32_t m_SnapshotCount = 0;
+
+		// server time - local time, smoothed so network jitter doesn't shake the render clock
+		double m_ServerTimeOffset = 0.0;
+		bool m_HasServerTime = false;
+	};
+}
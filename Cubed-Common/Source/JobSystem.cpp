@@ -0,0 +1,143 @@
+#include "JobSystem.h"
+
+#include <string>
+
+#include "Profiler.h"
+
+namespace Cubed
+{
+	JobSystem::JobSystem(uint32_t workerCount)
+	{
+		m_Queues.reserve(workerCount + 1);
+		for (uint32_t i = 0; i < workerCount + 1; i++)
+			m_Queues.push_back(std::make_unique<JobQueue>());
+
+		m_Workers.reserve(workerCount);
+		for (uint32_t i = 0; i < workerCount; i++)
+			m_Workers.emplace_back([this, i]() { WorkerMain(i + 1); });
+	}
+
+	JobSystem::~JobSystem()
+	{
+		m_Running = false;
+		m_WorkEpoch.fetch_add(1);
+		m_WorkEpoch.notify_all();
+
+		for (std::thread& worker : m_Workers)
+			worker.join();
+	}
+
+	uint32_t JobSystem::GetDefaultWorkerCount()
+	{
+		uint32_t threads = std::thread::hardware_concurrency();
+		return threads > 1 ? threads - 1 : 0;
+	}
+
+	JobSystem::Statistics JobSystem::GetStatistics() const
+	{
+		return { GetWorkerCount(), m_JobsExecuted.load(), m_JobsStolen.load() };
+	}
+
+	void JobSystem::Dispatch(uint32_t count, JobFunction function, void* context)
+	{
+		if (count == 0)
+			return;
+
+		m_Remaining.store(count, std::memory_order_relaxed);
+
+		// deal the jobs out round robin, stealing sorts out whatever imbalance is left
+		uint32_t queueCount = (uint32_t)m_Queues.size();
+		for (uint32_t q = 0; q < queueCount && q < count; q++)
+		{
+			JobQueue& queue = *m_Queues[q];
+			std::scoped_lock<std::mutex> lock(queue.Mutex);
+			for (uint32_t i = q; i < count; i += queueCount)
+				queue.Jobs.push_back({ function, context, i });
+		}
+
+		m_WorkEpoch.fetch_add(1, std::memory_order_release);
+		m_WorkEpoch.notify_all();
+
+		// help out until everything queued here has been picked up, then wait for stragglers
+		Job job;
+		while (PopJob(0, job) || StealJob(0, job))
+			RunJob(job);
+
+		for (uint32_t left = m_Remaining.load(std::memory_order_acquire); left != 0; left = m_Remaining.load(std::memory_order_acquire))
+			m_Remaining.wait(left, std::memory_order_acquire);
+	}
+
+	void JobSystem::WorkerMain(uint32_t queueIndex)
+	{
+		CUBED_PROFILE_THREAD("Job Worker " + std::to_string(queueIndex));
+
+		while (m_Running.load(std::memory_order_relaxed))
+		{
+			// read the epoch before looking for work, anything queued after this wakes us up
+			uint32_t epoch = m_WorkEpoch.load(std::memory_order_acquire);
+
+			Job job;
+			if (PopJob(queueIndex, job) || StealJob(queueIndex, job))
+			{
+				RunJob(job);
+				continue;
+			}
+
+			m_WorkEpoch.wait(epoch, std::memory_order_acquire);
+		}
+	}
+
+	bool JobSystem::PopJob(uint32_t queueIndex, Job& job)
+	{
+		JobQueue& queue = *m_Queues[queueIndex];
+		std::scoped_lock<std::mutex> lock(queue.Mutex);
+		if (queue.Empty())
+			return false;
+
+		job = queue.Jobs.back();
+		queue.Jobs.pop_back();
+		if (queue.Empty())
+		{
+			queue.Jobs.clear();
+			queue.Front = 0;
+		}
+		return true;
+	}
+
+	bool JobSystem::StealJob(uint32_t thiefIndex, Job& job)
+	{
+		uint32_t queueCount = (uint32_t)m_Queues.size();
+		for (uint32_t offset = 1; offset < queueCount; offset++)
+		{
+			JobQueue& victim = *m_Queues[(thiefIndex + offset) % queueCount];
+
+			// don't queue up behind the owner for a lock on a queue that's probably empty anyway
+			std::unique_lock<std::mutex> lock(victim.Mutex, std::try_to_lock);
+			if (!lock.owns_lock() || victim.Empty())
+				continue;
+
+			job = victim.Jobs[victim.Front++];
+			if (victim.Empty())
+			{
+				victim.Jobs.clear();
+				victim.Front = 0;
+			}
+			m_JobsStolen.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		return false;
+	}
+
+	void JobSystem::RunJob(const Job& job)
+	{
+		{
+			CUBED_PROFILE_ZONE("JobSystem::RunJob");
+			job.Function(job.Context, job.Index);
+		}
+		m_JobsExecuted.fetch_add(1, std::memory_order_relaxed);
+
+		if (m_Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			m_Remaining.notify_all();
+	}
+}
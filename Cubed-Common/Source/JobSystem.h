@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Cubed
+{
+	//
+	// JobSystem - work-stealing thread pool
+	//
+	// Every worker has its own job deque. Workers take jobs from the back of their own deque
+	// and, once that runs dry, steal from the front of everyone else's, so uneven jobs even
+	// out across threads without a shared queue everyone contends on. The thread that calls
+	// ParallelFor gets a deque too and works through jobs alongside the workers instead of
+	// just waiting, so a JobSystem with 0 workers simply runs everything inline.
+	//
+	class JobSystem
+	{
+	public:
+		struct Statistics
+		{
+			uint32_t WorkerCount = 0;
+			uint64_t JobsExecuted = 0;
+			uint64_t JobsStolen = 0; // jobs run by a thread other than the one they were queued on
+		};
+	public:
+		// defaults to one worker per hardware thread, minus the calling thread
+		explicit JobSystem(uint32_t workerCount = GetDefaultWorkerCount());
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		// calls func(i) for every i in [0, count) across all threads and returns once they are
+		// all done, must only be called from one thread at a time and never from inside a job
+		template<typename Func>
+		void ParallelFor(uint32_t count, Func&& func)
+		{
+			auto invoke = [](void* context, uint32_t index) { (*(std::remove_reference_t<Func>*)context)(index); };
+			Dispatch(count, invoke, (void*)&func);
+		}
+
+		uint32_t GetWorkerCount() const { return (uint32_t)m_Workers.size(); }
+		Statistics GetStatistics() const;
+
+		static uint32_t GetDefaultWorkerCount();
+	private:
+		using JobFunction = void(*)(void* context, uint32_t index);
+
+		struct Job
+		{
+			JobFunction Function = nullptr;
+			void* Context = nullptr;
+			uint32_t Index = 0;
+		};
+
+		// used as a deque, the owner pushes and pops at the back and thieves take from Front,
+		// it's only emptied out once Front catches up so its storage stays for the next ParallelFor
+		struct alignas(64) JobQueue
+		{
+			std::mutex Mutex;
+			std::vector<Job> Jobs;
+			size_t Front = 0;
+
+			bool Empty() const { return Front == Jobs.size(); }
+		};
+	private:
+		void Dispatch(uint32_t count, JobFunction function, void* context);
+		void WorkerMain(uint32_t queueIndex);
+
+		bool PopJob(uint32_t queueIndex, Job& job);
+		bool StealJob(uint32_t thiefIndex, Job& job);
+		void RunJob(const Job& job);
+	private:
+		// queue 0 belongs to the calling thread, queue i + 1 to worker i
+		std::vector<std::unique_ptr<JobQueue>> m_Queues;
+		std::vector<std::thread> m_Workers;
+
+		// bumped whenever jobs are queued, idle workers sleep on it
+		std::atomic<uint32_t> m_WorkEpoch = 0;
+		std::atomic<bool> m_Running = true;
+
+		// jobs of the current ParallelFor still to finish, a member rather than a local so
+		// the last job can still notify it after the caller has already seen it hit zero
+		std::atomic<uint32_t> m_Remaining = 0;
+
+		std::atomic<uint64_t> m_JobsExecuted = 0;
+		std::atomic<uint64_t> m_JobsStolen = 0;
+	};
+}
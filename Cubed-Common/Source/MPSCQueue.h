@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <utility>
+
+namespace Cubed
+{
+	//
+	// MPSCQueue - bounded lock-free multi-producer single-consumer queue
+	//
+	// Based on Dmitry Vyukov's bounded MPMC queue, with the consumer side simplified since
+	// only one thread ever pops. Every slot carries a sequence number, so producers never
+	// touch the consumer's index and neither side ever blocks the other. Capacity is rounded
+	// up to a power of two and storage is allocated once up front.
+	//
+	template<typename T>
+	class MPSCQueue
+	{
+	public:
+		explicit MPSCQueue(size_t capacity = 4096)
+		{
+			size_t size = std::bit_ceil(capacity < 2 ? 2 : capacity);
+			m_Mask = size - 1;
+			m_Slots = std::make_unique<Slot[]>(size);
+			for (size_t i = 0; i < size; i++)
+				m_Slots[i].Sequence.store(i, std::memory_order_relaxed);
+		}
+
+		MPSCQueue(const MPSCQueue&) = delete;
+		MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+		// safe from any thread, returns false if the queue is full
+		bool Push(const T& value) { return Emplace(value); }
+		bool Push(T&& value) { return Emplace(std::move(value)); }
+
+		// consumer thread only, returns false if the queue is empty
+		bool Pop(T& value)
+		{
+			Slot& slot = m_Slots[m_Tail & m_Mask];
+			size_t sequence = slot.Sequence.load(std::memory_order_acquire);
+			if ((intptr_t)sequence - (intptr_t)(m_Tail + 1) < 0)
+				return false;
+
+			value = std::move(slot.Value);
+			slot.Sequence.store(m_Tail + m_Mask + 1, std::memory_order_release);
+			m_Tail++;
+			return true;
+		}
+
+		size_t GetCapacity() const { return m_Mask + 1; }
+	private:
+		template<typename U>
+		bool Emplace(U&& value)
+		{
+			size_t position = m_Head.load(std::memory_order_relaxed);
+			Slot* slot;
+			for (;;)
+			{
+				slot = &m_Slots[position & m_Mask];
+				size_t sequence = slot->Sequence.load(std::memory_order_acquire);
+				intptr_t diff = (intptr_t)sequence - (intptr_t)position;
+				if (diff == 0)
+				{
+					// slot is free, try to claim it
+					if (m_Head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (diff < 0)
+				{
+					// consumer hasn't freed this slot yet, we're full
+					return false;
+				}
+				else
+				{
+					// another producer claimed it first
+					position = m_Head.load(std::memory_order_relaxed);
+				}
+			}
+
+			slot->Value = std::forward<U>(value);
+			slot->Sequence.store(position + 1, std::memory_order_release);
+			return true;
+		}
+	private:
+		struct Slot
+		{
+			std::atomic<size_t> Sequence;
+			T Value;
+		};
+
+		std::unique_ptr<Slot[]> m_Slots;
+		size_t m_Mask = 0;
+
+		// keep producers and the consumer off each other's cache lines
+		alignas(64) std::atomic<size_t> m_Head = 0;
+		alignas(64) size_t m_Tail = 0;
+	};
+}
@@ -0,0 +1,237 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#ifdef WL_PLATFORM_WINDOWS
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace Cubed
+{
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Close();
+			m_Data = std::exchange(other.m_Data, nullptr);
+			m_Size = std::exchange(other.m_Size, 0);
+			m_Open = std::exchange(other.m_Open, false);
+			m_Access = std::exchange(other.m_Access, Access::Read);
+#ifdef WL_PLATFORM_WINDOWS
+			m_File = std::exchange(other.m_File, nullptr);
+			m_Mapping = std::exchange(other.m_Mapping, nullptr);
+#else
+			m_File = std::exchange(other.m_File, -1);
+#endif
+		}
+		return *this;
+	}
+
+	bool MappedFile::Resize(uint64_t size)
+	{
+		if (!m_Open || m_Access != Access::ReadWrite)
+			return false;
+
+		Unmap();
+#ifdef WL_PLATFORM_WINDOWS
+		LARGE_INTEGER end;
+		end.QuadPart = (LONGLONG)size;
+		bool resized = SetFilePointerEx(m_File, end, nullptr, FILE_BEGIN) && SetEndOfFile(m_File);
+#else
+		bool resized = ftruncate(m_File, (off_t)size) == 0;
+#endif
+		if (resized)
+			m_Size = size;
+
+		// the old mapping is gone either way, map whatever size the file ended up at
+		if (!Map())
+		{
+			Close();
+			return false;
+		}
+		return resized;
+	}
+
+#ifdef WL_PLATFORM_WINDOWS
+
+	bool MappedFile::Open(const std::filesystem::path& path, Access access)
+	{
+		Close();
+
+		HANDLE file;
+		if (access == Access::ReadWrite)
+		{
+			file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+				FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+		}
+		else
+		{
+			file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+				FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		}
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size))
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		m_File = file;
+		m_Size = (uint64_t)size.QuadPart;
+		m_Access = access;
+		m_Open = true;
+
+		if (!Map())
+		{
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		Unmap();
+		if (m_File)
+			CloseHandle(m_File);
+
+		m_File = nullptr;
+		m_Size = 0;
+		m_Access = Access::Read;
+		m_Open = false;
+	}
+
+	bool MappedFile::Flush()
+	{
+		if (!m_Open || m_Access != Access::ReadWrite)
+			return false;
+
+		if (m_Data && !FlushViewOfFile(m_Data, 0))
+			return false;
+		return FlushFileBuffers(m_File);
+	}
+
+	bool MappedFile::Map()
+	{
+		// a zero sized mapping is an error, an empty file just has no data
+		if (m_Size == 0)
+			return true;
+
+		bool write = m_Access == Access::ReadWrite;
+		m_Mapping = CreateFileMappingW(m_File, nullptr, write ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+		if (m_Mapping)
+			m_Data = (uint8_t*)MapViewOfFile(m_Mapping, write ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+		return m_Data != nullptr;
+	}
+
+	void MappedFile::Unmap()
+	{
+		if (m_Data)
+			UnmapViewOfFile(m_Data);
+		if (m_Mapping)
+			CloseHandle(m_Mapping);
+
+		m_Data = nullptr;
+		m_Mapping = nullptr;
+	}
+
+#else
+
+	bool MappedFile::Open(const std::filesystem::path& path, Access access)
+	{
+		Close();
+
+		int file = access == Access::ReadWrite
+			? open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)
+			: open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (file < 0)
+			return false;
+
+		struct stat info;
+		if (fstat(file, &info) != 0)
+		{
+			close(file);
+			return false;
+		}
+
+		m_File = file;
+		m_Size = (uint64_t)info.st_size;
+		m_Access = access;
+		m_Open = true;
+
+		if (!Map())
+		{
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		Unmap();
+		if (m_File >= 0)
+			close(m_File);
+
+		m_File = -1;
+		m_Size = 0;
+		m_Access = Access::Read;
+		m_Open = false;
+	}
+
+	bool MappedFile::Flush()
+	{
+		if (!m_Open || m_Access != Access::ReadWrite)
+			return false;
+
+		if (m_Data && msync(m_Data, m_Size, MS_SYNC) != 0)
+			return false;
+		return fsync(m_File) == 0;
+	}
+
+	bool MappedFile::Map()
+	{
+		// a zero sized mapping is an error, an empty file just has no data
+		if (m_Size == 0)
+			return true;
+
+		// writes go through to the file, reads are front to back so the kernel can read ahead
+		bool write = m_Access == Access::ReadWrite;
+		void* data = mmap(nullptr, m_Size, write ? PROT_READ | PROT_WRITE : PROT_READ, write ? MAP_SHARED : MAP_PRIVATE, m_File, 0);
+		if (data == MAP_FAILED)
+			return false;
+
+		madvise(data, m_Size, write ? MADV_RANDOM : MADV_SEQUENTIAL);
+		m_Data = (uint8_t*)data;
+		return true;
+	}
+
+	void MappedFile::Unmap()
+	{
+		if (m_Data)
+			munmap(m_Data, m_Size);
+		m_Data = nullptr;
+	}
+
+#endif
+}
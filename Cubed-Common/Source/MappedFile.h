@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+#include <filesystem>
+
+namespace Cubed
+{
+	//
+	// MappedFile - view of a whole file mapped into memory
+	//
+	// Pages are only read in as they are touched and come straight out of the OS file cache,
+	// so there is no copy into a buffer of our own like with a stream. The data is page
+	// aligned, which is enough for anything read as 32 bit words, like SPIR-V.
+	//
+	// Opened for writing, the mapping is shared with the file: writes land in the OS file
+	// cache and reach the disk whenever the OS gets to them, or on Flush. The file only
+	// grows through Resize, which maps it again, so any pointer into the old data is gone.
+	//
+	class MappedFile
+	{
+	public:
+		enum class Access : uint8_t { Read = 0, ReadWrite };
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		// false if the file doesn't exist or can't be mapped, an empty file opens with no data
+		// ReadWrite creates the file if it doesn't exist
+		bool Open(const std::filesystem::path& path, Access access = Access::Read);
+		void Close();
+
+		// ReadWrite only, new space reads as zero
+		bool Resize(uint64_t size);
+		// ReadWrite only, blocks until everything written so far is on disk
+		bool Flush();
+
+		bool IsOpen() const { return m_Open; }
+		const uint8_t* GetData() const { return m_Data; }
+		uint8_t* GetWritableData() const { return m_Access == Access::ReadWrite ? m_Data : nullptr; }
+		uint64_t GetSize() const { return m_Size; }
+	private:
+		bool Map();
+		void Unmap();
+	private:
+		uint8_t* m_Data = nullptr;
+		uint64_t m_Size = 0;
+		bool m_Open = false;
+		Access m_Access = Access::Read;
+
+#ifdef WL_PLATFORM_WINDOWS
+		void* m_File = nullptr;
+		void* m_Mapping = nullptr;
+#else
+		int m_File = -1;
+#endif
+	};
+}
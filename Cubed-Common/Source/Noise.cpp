@@ -0,0 +1,372 @@
+#include "Noise.h"
+
+#include <bit>
+
+#if defined(__x86_64__) || defined(_M_X64)
+	#define CUBED_NOISE_AVX2 1
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+		// MSVC takes AVX2 intrinsics anywhere
+		#define CUBED_TARGET_AVX2
+	#else
+		// AVX2 only, not FMA, so the compiler can't fuse anything the scalar path doesn't
+		#define CUBED_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
+namespace Cubed
+{
+	static constexpr float s_F2 = 0.366025403784f; // (sqrt(3) - 1) / 2, skews a point onto the simplex grid
+	static constexpr float s_G2 = 0.211324865405f; // (3 - sqrt(3)) / 6, and back
+	static constexpr float s_F3 = 1.0f / 3.0f;
+	static constexpr float s_G3 = 1.0f / 6.0f;
+
+	// scales the sum of the corners to roughly [-1, 1]
+	static constexpr float s_Scale2D = 40.0f;
+	static constexpr float s_Scale3D = 32.0f;
+
+	static constexpr uint32_t s_PrimeX = 0x9e3779b1u;
+	static constexpr uint32_t s_PrimeY = 0x85ebca77u;
+	static constexpr uint32_t s_PrimeZ = 0xc2b2ae3du;
+	static constexpr uint32_t s_Mix = 0x7feb352du;
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// Scalar
+	//////////////////////////////////////////////////////////////////////////////////
+
+	// std::floor is a library call without SSE4.1, this is exact as long as x fits an int
+	static float FastFloor(float x)
+	{
+		int32_t i = (int32_t)x;
+		return (float)(i - (int32_t)(x < (float)i));
+	}
+
+	// the gradient picks are random by design, so as branches they would mispredict half the
+	// time. These do it with masks, the way the AVX2 path has to anyway
+	static float Select(bool condition, float a, float b)
+	{
+		uint32_t mask = 0u - (uint32_t)condition;
+		return std::bit_cast<float>((std::bit_cast<uint32_t>(a) & mask) | (std::bit_cast<uint32_t>(b) & ~mask));
+	}
+
+	static float FlipSign(float value, uint32_t flip)
+	{
+		return std::bit_cast<float>(std::bit_cast<uint32_t>(value) ^ (flip << 31));
+	}
+
+	static uint32_t Hash(uint32_t seed, int32_t i, int32_t j, int32_t k = 0)
+	{
+		uint32_t h = seed ^ ((uint32_t)i * s_PrimeX) ^ ((uint32_t)j * s_PrimeY) ^ ((uint32_t)k * s_PrimeZ);
+		h ^= h >> 16;
+		h *= s_Mix;
+		return h ^ (h >> 15);
+	}
+
+	// one of 8 gradients, the low bits pick the axis and the signs
+	static float Gradient2D(uint32_t hash, float x, float y)
+	{
+		uint32_t h = hash & 7;
+		float u = Select(h < 4, x, y);
+		float v = Select(h < 4, y, x);
+		return FlipSign(u, h & 1) + FlipSign(2.0f * v, (h >> 1) & 1);
+	}
+
+	// one of the 12 cube edge gradients, with 4 of them twice to make 16
+	static float Gradient3D(uint32_t hash, float x, float y, float z)
+	{
+		uint32_t h = hash & 15;
+		float u = Select(h < 8, x, y);
+		float v = Select(h < 4, y, Select(h == 12 || h == 14, x, z));
+		return FlipSign(u, h & 1) + FlipSign(v, (h >> 1) & 1);
+	}
+
+	static float Corner2D(uint32_t hash, float x, float y)
+	{
+		float t = 0.5f - x * x - y * y;
+		t *= (float)(t > 0.0f); // clamped without a branch, whether a corner is in range is a coin toss
+		t *= t;
+		return t * t * Gradient2D(hash, x, y);
+	}
+
+	static float Corner3D(uint32_t hash, float x, float y, float z)
+	{
+		float t = 0.6f - x * x - y * y - z * z;
+		t *= (float)(t > 0.0f); // clamped without a branch, whether a corner is in range is a coin toss
+		t *= t;
+		return t * t * Gradient3D(hash, x, y, z);
+	}
+
+	static float Simplex2D(uint32_t seed, float x, float y)
+	{
+		float s = (x + y) * s_F2;
+		float fi = FastFloor(x + s), fj = FastFloor(y + s);
+		float t = (fi + fj) * s_G2;
+		float x0 = x - (fi - t), y0 = y - (fj - t);
+
+		// lower or upper triangle of the cell
+		bool lower = x0 > y0;
+		float i1 = (float)lower, j1 = (float)!lower;
+
+		float x1 = x0 - i1 + s_G2, y1 = y0 - j1 + s_G2;
+		float x2 = x0 - 1.0f + 2.0f * s_G2, y2 = y0 - 1.0f + 2.0f * s_G2;
+
+		int32_t i = (int32_t)fi, j = (int32_t)fj;
+		float n = Corner2D(Hash(seed, i, j), x0, y0);
+		n += Corner2D(Hash(seed, i + (int32_t)i1, j + (int32_t)j1), x1, y1);
+		n += Corner2D(Hash(seed, i + 1, j + 1), x2, y2);
+		return s_Scale2D * n;
+	}
+
+	static float Simplex3D(uint32_t seed, float x, float y, float z)
+	{
+		float s = (x + y + z) * s_F3;
+		float fi = FastFloor(x + s), fj = FastFloor(y + s), fk = FastFloor(z + s);
+		float t = (fi + fj + fk) * s_G3;
+		float x0 = x - (fi - t), y0 = y - (fj - t), z0 = z - (fk - t);
+
+		// which of the 6 tetrahedra of the cell, from the order of x0, y0 and z0. Written as
+		// masks so the AVX2 path can do exactly the same thing, ties included
+		bool a = x0 >= y0, b = y0 >= z0, c = x0 >= z0;
+		float i1 = (float)(a & c), j1 = (float)(!a & b), k1 = (float)(!b & !c);
+		float i2 = (float)(a | c), j2 = (float)(!a | b), k2 = (float)(!b | !c);
+
+		float x1 = x0 - i1 + s_G3, y1 = y0 - j1 + s_G3, z1 = z0 - k1 + s_G3;
+		float x2 = x0 - i2 + 2.0f * s_G3, y2 = y0 - j2 + 2.0f * s_G3, z2 = z0 - k2 + 2.0f * s_G3;
+		float x3 = x0 - 1.0f + 3.0f * s_G3, y3 = y0 - 1.0f + 3.0f * s_G3, z3 = z0 - 1.0f + 3.0f * s_G3;
+
+		int32_t i = (int32_t)fi, j = (int32_t)fj, k = (int32_t)fk;
+		float n = Corner3D(Hash(seed, i, j, k), x0, y0, z0);
+		n += Corner3D(Hash(seed, i + (int32_t)i1, j + (int32_t)j1, k + (int32_t)k1), x1, y1, z1);
+		n += Corner3D(Hash(seed, i + (int32_t)i2, j + (int32_t)j2, k + (int32_t)k2), x2, y2, z2);
+		n += Corner3D(Hash(seed, i + 1, j + 1, k + 1), x3, y3, z3);
+		return s_Scale3D * n;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// AVX2, the same steps as above 8 points at a time
+	//////////////////////////////////////////////////////////////////////////////////
+
+#ifdef CUBED_NOISE_AVX2
+	CUBED_TARGET_AVX2 static inline __m256i HashAVX2(__m256i seed, __m256i i, __m256i j, __m256i k)
+	{
+		__m256i h = _mm256_xor_si256(seed, _mm256_mullo_epi32(i, _mm256_set1_epi32((int32_t)s_PrimeX)));
+		h = _mm256_xor_si256(h, _mm256_mullo_epi32(j, _mm256_set1_epi32((int32_t)s_PrimeY)));
+		h = _mm256_xor_si256(h, _mm256_mullo_epi32(k, _mm256_set1_epi32((int32_t)s_PrimeZ)));
+		h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+		h = _mm256_mullo_epi32(h, _mm256_set1_epi32((int32_t)s_Mix));
+		return _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+	}
+
+	// negating is flipping the sign bit, so the gradient's sign bits of the hash are shifted
+	// up into it. Bit 0 for u, bit 1 for v
+	CUBED_TARGET_AVX2 static inline __m256 FlipSignUAVX2(__m256 value, __m256i hash)
+	{
+		return _mm256_xor_ps(value, _mm256_castsi256_ps(_mm256_slli_epi32(hash, 31)));
+	}
+
+	CUBED_TARGET_AVX2 static inline __m256 FlipSignVAVX2(__m256 value, __m256i hash)
+	{
+		__m256i sign = _mm256_and_si256(_mm256_slli_epi32(hash, 30), _mm256_set1_epi32(INT32_MIN));
+		return _mm256_xor_ps(value, _mm256_castsi256_ps(sign));
+	}
+
+	CUBED_TARGET_AVX2 static inline __m256 Corner2DAVX2(__m256i hash, __m256 x, __m256 y)
+	{
+		__m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(7));
+		__m256 below4 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+		__m256 u = _mm256_blendv_ps(y, x, below4);
+		__m256 v = _mm256_blendv_ps(x, y, below4);
+		__m256 gradient = _mm256_add_ps(FlipSignUAVX2(u, h), FlipSignVAVX2(_mm256_mul_ps(_mm256_set1_ps(2.0f), v), h));
+
+		__m256 t = _mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(0.5f), _mm256_mul_ps(x, x)), _mm256_mul_ps(y, y));
+		t = _mm256_max_ps(t, _mm256_setzero_ps());
+		t = _mm256_mul_ps(t, t);
+		return _mm256_mul_ps(_mm256_mul_ps(t, t), gradient);
+	}
+
+	CUBED_TARGET_AVX2 static inline __m256 Corner3DAVX2(__m256i hash, __m256 x, __m256 y, __m256 z)
+	{
+		__m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+		__m256 below8 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h));
+		__m256 below4 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+		__m256 is12or14 = _mm256_castsi256_ps(_mm256_or_si256(_mm256_cmpeq_epi32(h, _mm256_set1_epi32(12)), _mm256_cmpeq_epi32(h, _mm256_set1_epi32(14))));
+		__m256 u = _mm256_blendv_ps(y, x, below8);
+		__m256 v = _mm256_blendv_ps(_mm256_blendv_ps(z, x, is12or14), y, below4);
+		__m256 gradient = _mm256_add_ps(FlipSignUAVX2(u, h), FlipSignVAVX2(v, h));
+
+		__m256 t = _mm256_sub_ps(_mm256_set1_ps(0.6f), _mm256_mul_ps(x, x));
+		t = _mm256_sub_ps(_mm256_sub_ps(t, _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+		t = _mm256_max_ps(t, _mm256_setzero_ps());
+		t = _mm256_mul_ps(t, t);
+		return _mm256_mul_ps(_mm256_mul_ps(t, t), gradient);
+	}
+
+	// offsets to the middle corners, mask is all ones where the corner is one further along
+	CUBED_TARGET_AVX2 static inline __m256 MaskToFloatAVX2(__m256 mask) { return _mm256_and_ps(mask, _mm256_set1_ps(1.0f)); }
+	CUBED_TARGET_AVX2 static inline __m256i MaskToIntAVX2(__m256 mask) { return _mm256_and_si256(_mm256_castps_si256(mask), _mm256_set1_epi32(1)); }
+
+	CUBED_TARGET_AVX2 static void SimplexNoise2DAVX2(uint32_t seed, const float* x, const float* y, float* out, uint32_t count)
+	{
+		const __m256i seeds = _mm256_set1_epi32((int32_t)seed);
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i one = _mm256_set1_epi32(1);
+		const __m256 g2 = _mm256_set1_ps(s_G2);
+		const __m256 g2Far = _mm256_set1_ps(2.0f * s_G2);
+		const __m256 oneFloat = _mm256_set1_ps(1.0f);
+
+		uint32_t n = 0;
+		for (; n + 8 <= count; n += 8)
+		{
+			__m256 px = _mm256_loadu_ps(x + n), py = _mm256_loadu_ps(y + n);
+
+			__m256 s = _mm256_mul_ps(_mm256_add_ps(px, py), _mm256_set1_ps(s_F2));
+			__m256 fi = _mm256_floor_ps(_mm256_add_ps(px, s)), fj = _mm256_floor_ps(_mm256_add_ps(py, s));
+			__m256 t = _mm256_mul_ps(_mm256_add_ps(fi, fj), g2);
+			__m256 x0 = _mm256_sub_ps(px, _mm256_sub_ps(fi, t)), y0 = _mm256_sub_ps(py, _mm256_sub_ps(fj, t));
+
+			__m256 lower = _mm256_cmp_ps(x0, y0, _CMP_GT_OQ);
+			__m256 upper = _mm256_andnot_ps(lower, _mm256_castsi256_ps(_mm256_set1_epi32(-1)));
+
+			__m256 x1 = _mm256_add_ps(_mm256_sub_ps(x0, MaskToFloatAVX2(lower)), g2);
+			__m256 y1 = _mm256_add_ps(_mm256_sub_ps(y0, MaskToFloatAVX2(upper)), g2);
+			__m256 x2 = _mm256_add_ps(_mm256_sub_ps(x0, oneFloat), g2Far);
+			__m256 y2 = _mm256_add_ps(_mm256_sub_ps(y0, oneFloat), g2Far);
+
+			__m256i i = _mm256_cvttps_epi32(fi), j = _mm256_cvttps_epi32(fj);
+			__m256 result = Corner2DAVX2(HashAVX2(seeds, i, j, zero), x0, y0);
+			result = _mm256_add_ps(result, Corner2DAVX2(HashAVX2(seeds, _mm256_add_epi32(i, MaskToIntAVX2(lower)), _mm256_add_epi32(j, MaskToIntAVX2(upper)), zero), x1, y1));
+			result = _mm256_add_ps(result, Corner2DAVX2(HashAVX2(seeds, _mm256_add_epi32(i, one), _mm256_add_epi32(j, one), zero), x2, y2));
+			_mm256_storeu_ps(out + n, _mm256_mul_ps(_mm256_set1_ps(s_Scale2D), result));
+		}
+
+		for (; n < count; n++)
+			out[n] = Simplex2D(seed, x[n], y[n]);
+	}
+
+	CUBED_TARGET_AVX2 static void SimplexNoise3DAVX2(uint32_t seed, const float* x, const float* y, const float* z, float* out, uint32_t count)
+	{
+		const __m256i seeds = _mm256_set1_epi32((int32_t)seed);
+		const __m256i one = _mm256_set1_epi32(1);
+		const __m256 allOnes = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		const __m256 g3 = _mm256_set1_ps(s_G3);
+		const __m256 g3Middle = _mm256_set1_ps(2.0f * s_G3);
+		const __m256 g3Far = _mm256_set1_ps(3.0f * s_G3);
+		const __m256 oneFloat = _mm256_set1_ps(1.0f);
+
+		uint32_t n = 0;
+		for (; n + 8 <= count; n += 8)
+		{
+			__m256 px = _mm256_loadu_ps(x + n), py = _mm256_loadu_ps(y + n), pz = _mm256_loadu_ps(z + n);
+
+			__m256 s = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(px, py), pz), _mm256_set1_ps(s_F3));
+			__m256 fi = _mm256_floor_ps(_mm256_add_ps(px, s));
+			__m256 fj = _mm256_floor_ps(_mm256_add_ps(py, s));
+			__m256 fk = _mm256_floor_ps(_mm256_add_ps(pz, s));
+			__m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(fi, fj), fk), g3);
+			__m256 x0 = _mm256_sub_ps(px, _mm256_sub_ps(fi, t));
+			__m256 y0 = _mm256_sub_ps(py, _mm256_sub_ps(fj, t));
+			__m256 z0 = _mm256_sub_ps(pz, _mm256_sub_ps(fk, t));
+
+			__m256 a = _mm256_cmp_ps(x0, y0, _CMP_GE_OQ);
+			__m256 b = _mm256_cmp_ps(y0, z0, _CMP_GE_OQ);
+			__m256 c = _mm256_cmp_ps(x0, z0, _CMP_GE_OQ);
+			__m256 i1 = _mm256_and_ps(a, c);
+			__m256 j1 = _mm256_andnot_ps(a, b);
+			__m256 k1 = _mm256_andnot_ps(_mm256_or_ps(b, c), allOnes);
+			__m256 i2 = _mm256_or_ps(a, c);
+			__m256 j2 = _mm256_andnot_ps(_mm256_andnot_ps(b, a), allOnes);
+			__m256 k2 = _mm256_andnot_ps(_mm256_and_ps(b, c), allOnes);
+
+			__m256 x1 = _mm256_add_ps(_mm256_sub_ps(x0, MaskToFloatAVX2(i1)), g3);
+			__m256 y1 = _mm256_add_ps(_mm256_sub_ps(y0, MaskToFloatAVX2(j1)), g3);
+			__m256 z1 = _mm256_add_ps(_mm256_sub_ps(z0, MaskToFloatAVX2(k1)), g3);
+			__m256 x2 = _mm256_add_ps(_mm256_sub_ps(x0, MaskToFloatAVX2(i2)), g3Middle);
+			__m256 y2 = _mm256_add_ps(_mm256_sub_ps(y0, MaskToFloatAVX2(j2)), g3Middle);
+			__m256 z2 = _mm256_add_ps(_mm256_sub_ps(z0, MaskToFloatAVX2(k2)), g3Middle);
+			__m256 x3 = _mm256_add_ps(_mm256_sub_ps(x0, oneFloat), g3Far);
+			__m256 y3 = _mm256_add_ps(_mm256_sub_ps(y0, oneFloat), g3Far);
+			__m256 z3 = _mm256_add_ps(_mm256_sub_ps(z0, oneFloat), g3Far);
+
+			__m256i i = _mm256_cvttps_epi32(fi), j = _mm256_cvttps_epi32(fj), k = _mm256_cvttps_epi32(fk);
+			__m256 result = Corner3DAVX2(HashAVX2(seeds, i, j, k), x0, y0, z0);
+			result = _mm256_add_ps(result, Corner3DAVX2(HashAVX2(seeds,
+				_mm256_add_epi32(i, MaskToIntAVX2(i1)), _mm256_add_epi32(j, MaskToIntAVX2(j1)), _mm256_add_epi32(k, MaskToIntAVX2(k1))), x1, y1, z1));
+			result = _mm256_add_ps(result, Corner3DAVX2(HashAVX2(seeds,
+				_mm256_add_epi32(i, MaskToIntAVX2(i2)), _mm256_add_epi32(j, MaskToIntAVX2(j2)), _mm256_add_epi32(k, MaskToIntAVX2(k2))), x2, y2, z2));
+			result = _mm256_add_ps(result, Corner3DAVX2(HashAVX2(seeds,
+				_mm256_add_epi32(i, one), _mm256_add_epi32(j, one), _mm256_add_epi32(k, one)), x3, y3, z3));
+			_mm256_storeu_ps(out + n, _mm256_mul_ps(_mm256_set1_ps(s_Scale3D), result));
+		}
+
+		for (; n < count; n++)
+			out[n] = Simplex3D(seed, x[n], y[n], z[n]);
+	}
+#endif
+
+	//////////////////////////////////////////////////////////////////////////////////
+
+	SimdLevel GetSupportedSimdLevel()
+	{
+		static const SimdLevel s_Level = []()
+		{
+#if defined(CUBED_NOISE_AVX2) && defined(_MSC_VER)
+			// AVX2 on the CPU, and the OS saving the upper halves of the registers (XCR0 bits 1 and 2)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return SimdLevel::Scalar;
+
+			__cpuid(info, 1);
+			bool osSupport = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+			__cpuidex(info, 7, 0);
+			return osSupport && (info[1] & (1 << 5)) ? SimdLevel::AVX2 : SimdLevel::Scalar;
+#elif defined(CUBED_NOISE_AVX2)
+			// checks OS support as well
+			return __builtin_cpu_supports("avx2") ? SimdLevel::AVX2 : SimdLevel::Scalar;
+#else
+			return SimdLevel::Scalar;
+#endif
+		}();
+		return s_Level;
+	}
+
+	std::string_view SimdLevelToString(SimdLevel level)
+	{
+		switch (level)
+		{
+			case SimdLevel::Scalar: return "SimdLevel::Scalar";
+			case SimdLevel::AVX2:   return "SimdLevel::AVX2";
+
+			default: return "SimdLevel::<Invalid>";
+		}
+
+		return "SimdLevel::<Invalid>";
+	}
+
+	void SimplexNoise2D(uint32_t seed, const float* x, const float* y, float* out, uint32_t count, SimdLevel level)
+	{
+#ifdef CUBED_NOISE_AVX2
+		if (level == SimdLevel::AVX2 && GetSupportedSimdLevel() == SimdLevel::AVX2)
+		{
+			SimplexNoise2DAVX2(seed, x, y, out, count);
+			return;
+		}
+#endif
+		for (uint32_t i = 0; i < count; i++)
+			out[i] = Simplex2D(seed, x[i], y[i]);
+	}
+
+	void SimplexNoise3D(uint32_t seed, const float* x, const float* y, const float* z, float* out, uint32_t count, SimdLevel level)
+	{
+#ifdef CUBED_NOISE_AVX2
+		if (level == SimdLevel::AVX2 && GetSupportedSimdLevel() == SimdLevel::AVX2)
+		{
+			SimplexNoise3DAVX2(seed, x, y, z, out, count);
+			return;
+		}
+#endif
+		for (uint32_t i = 0; i < count; i++)
+			out[i] = Simplex3D(seed, x[i], y[i], z[i]);
+	}
+}
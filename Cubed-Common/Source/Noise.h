@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+#include <string_view>
+
+namespace Cubed
+{
+	enum class SimdLevel : uint8_t
+	{
+		Scalar = 0,
+		AVX2
+	};
+
+	//
+	// Noise - batched simplex noise, scalar or AVX2
+	//
+	// Gradient noise on a simplex grid, 2D and 3D, in roughly [-1, 1]. Points go in as arrays
+	// and come out as an array, so the AVX2 path can run 8 at a time. Which path runs is picked
+	// at runtime from what the CPU supports, asking for AVX2 on a CPU without it runs the
+	// scalar path instead.
+	//
+	// Both paths give exactly the same result, bit for bit: gradients come from an integer
+	// hash of the lattice point and the seed rather than from a table, every float operation
+	// happens in the same order on both, and nothing is fused into an FMA. A world generated
+	// from the same seed comes out the same on every machine.
+	//
+
+	// best level this CPU supports, checked once
+	SimdLevel GetSupportedSimdLevel();
+	std::string_view SimdLevelToString(SimdLevel level);
+
+	// out[i] = noise at (x[i], y[i]), out may be one of the inputs
+	void SimplexNoise2D(uint32_t seed, const float* x, const float* y, float* out, uint32_t count, SimdLevel level = GetSupportedSimdLevel());
+	// out[i] = noise at (x[i], y[i], z[i]), out may be one of the inputs
+	void SimplexNoise3D(uint32_t seed, const float* x, const float* y, const float* z, float* out, uint32_t count, SimdLevel level = GetSupportedSimdLevel());
+}
@@ -0,0 +1,231 @@
+#include "PacketBuffer.h"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace Cubed
+{
+	// 256B up to 16MB, anything bigger goes straight to the heap
+	static constexpr uint32_t s_MinSizeClassBits = 8;
+	static constexpr uint32_t s_MaxSizeClassBits = 24;
+	static constexpr uint32_t s_SizeClassCount = s_MaxSizeClassBits - s_MinSizeClassBits + 1;
+	static constexpr uint32_t s_OversizeClass = UINT32_MAX;
+
+	struct Arena;
+
+	struct PacketBuffer::Block
+	{
+		std::atomic<uint32_t> RefCount;
+		uint32_t SizeClass;
+		uint64_t Capacity;
+		Arena* Owner;
+		Block* Next;
+
+		// data follows the header
+		uint8_t* GetData() { return (uint8_t*)(this + 1); }
+	};
+	static_assert(sizeof(PacketBuffer::Block) % 16 == 0, "packet data should stay 16 byte aligned");
+
+	struct Arena
+	{
+		// only touched by the owning thread
+		std::array<PacketBuffer::Block*, s_SizeClassCount> FreeLists{};
+
+		// blocks released by other threads, pushed lock-free and drained by the owner
+		std::atomic<PacketBuffer::Block*> ReturnedBlocks = nullptr;
+	};
+
+	static std::atomic<uint64_t> s_HeapAllocations = 0;
+	static std::atomic<uint64_t> s_PoolAllocations = 0;
+	static std::atomic<uint64_t> s_CrossThreadFrees = 0;
+
+	// arenas outlive their threads since blocks can still be in flight when a thread exits,
+	// a new thread adopts an abandoned arena instead of creating another one
+	static std::mutex s_ArenaRegistryMutex;
+	static std::vector<Arena*> s_AbandonedArenas;
+
+	struct ThreadArena
+	{
+		Arena* Instance;
+
+		ThreadArena()
+		{
+			std::scoped_lock<std::mutex> lock(s_ArenaRegistryMutex);
+			if (!s_AbandonedArenas.empty())
+			{
+				Instance = s_AbandonedArenas.back();
+				s_AbandonedArenas.pop_back();
+			}
+			else
+			{
+				Instance = new Arena();
+			}
+		}
+
+		~ThreadArena()
+		{
+			std::scoped_lock<std::mutex> lock(s_ArenaRegistryMutex);
+			s_AbandonedArenas.push_back(Instance);
+		}
+	};
+
+	static Arena* GetThreadArena()
+	{
+		thread_local ThreadArena s_ThreadArena;
+		return s_ThreadArena.Instance;
+	}
+
+	static uint32_t GetSizeClass(uint64_t size)
+	{
+		uint32_t bits = (uint32_t)std::bit_width(size > 1 ? size - 1 : 1);
+		if (bits < s_MinSizeClassBits)
+			bits = s_MinSizeClassBits;
+		return bits > s_MaxSizeClassBits ? s_OversizeClass : bits - s_MinSizeClassBits;
+	}
+
+	static PacketBuffer::Block* AllocateBlock(uint64_t capacity, uint32_t sizeClass, Arena* owner)
+	{
+		void* memory = ::operator new(sizeof(PacketBuffer::Block) + capacity);
+		PacketBuffer::Block* block = new (memory) PacketBuffer::Block;
+		block->SizeClass = sizeClass;
+		block->Capacity = capacity;
+		block->Owner = owner;
+		block->Next = nullptr;
+
+		s_HeapAllocations++;
+		return block;
+	}
+
+	PacketBuffer PacketBuffer::Allocate(uint64_t size)
+	{
+		uint32_t sizeClass = GetSizeClass(size);
+		if (sizeClass == s_OversizeClass)
+		{
+			Block* block = AllocateBlock(size, s_OversizeClass, nullptr);
+			block->RefCount.store(1, std::memory_order_relaxed);
+			return PacketBuffer(block);
+		}
+
+		Arena* arena = GetThreadArena();
+		Block*& freeList = arena->FreeLists[sizeClass];
+
+		// pick up anything other threads handed back
+		if (!freeList)
+		{
+			Block* returned = arena->ReturnedBlocks.exchange(nullptr, std::memory_order_acquire);
+			while (returned)
+			{
+				Block* next = returned->Next;
+				returned->Next = arena->FreeLists[returned->SizeClass];
+				arena->FreeLists[returned->SizeClass] = returned;
+				returned = next;
+			}
+		}
+
+		Block* block = freeList;
+		if (block)
+		{
+			freeList = block->Next;
+			s_PoolAllocations++;
+		}
+		else
+		{
+			block = AllocateBlock(1ull << (sizeClass + s_MinSizeClassBits), sizeClass, arena);
+		}
+
+		block->Next = nullptr;
+		block->RefCount.store(1, std::memory_order_relaxed);
+		return PacketBuffer(block);
+	}
+
+	PacketBuffer::PacketBuffer(const PacketBuffer& other)
+		: m_Block(other.m_Block)
+	{
+		if (m_Block)
+			m_Block->RefCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	PacketBuffer::PacketBuffer(PacketBuffer&& other) noexcept
+		: m_Block(other.m_Block)
+	{
+		other.m_Block = nullptr;
+	}
+
+	PacketBuffer::~PacketBuffer()
+	{
+		Release();
+	}
+
+	PacketBuffer& PacketBuffer::operator=(const PacketBuffer& other)
+	{
+		if (this != &other)
+		{
+			Release();
+			m_Block = other.m_Block;
+			if (m_Block)
+				m_Block->RefCount.fetch_add(1, std::memory_order_relaxed);
+		}
+		return *this;
+	}
+
+	PacketBuffer& PacketBuffer::operator=(PacketBuffer&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Release();
+			m_Block = other.m_Block;
+			other.m_Block = nullptr;
+		}
+		return *this;
+	}
+
+	uint8_t* PacketBuffer::GetData() const
+	{
+		return m_Block ? m_Block->GetData() : nullptr;
+	}
+
+	uint64_t PacketBuffer::GetCapacity() const
+	{
+		return m_Block ? m_Block->Capacity : 0;
+	}
+
+	void PacketBuffer::Release()
+	{
+		Block* block = m_Block;
+		m_Block = nullptr;
+		if (!block || block->RefCount.fetch_sub(1, std::memory_order_acq_rel) != 1)
+			return;
+
+		if (block->SizeClass == s_OversizeClass)
+		{
+			block->~Block();
+			::operator delete(block);
+			return;
+		}
+
+		Arena* owner = block->Owner;
+		if (owner == GetThreadArena())
+		{
+			block->Next = owner->FreeLists[block->SizeClass];
+			owner->FreeLists[block->SizeClass] = block;
+			return;
+		}
+
+		// owner only ever takes the whole list at once, so a plain push is ABA safe
+		s_CrossThreadFrees++;
+		Block* head = owner->ReturnedBlocks.load(std::memory_order_relaxed);
+		do
+		{
+			block->Next = head;
+		} while (!owner->ReturnedBlocks.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	PacketBuffer::Statistics PacketBuffer::GetStatistics()
+	{
+		return { s_HeapAllocations.load(), s_PoolAllocations.load(), s_CrossThreadFrees.load() };
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Walnut/Core/Buffer.h"
+
+namespace Cubed
+{
+	//
+	// PacketBuffer - pooled, ref-counted buffer for building outgoing packets
+	//
+	// Buffers come from power-of-two size classes kept in per-thread arenas, so any thread can
+	// build packets without sharing a scratch buffer and without locking. Copies of a
+	// PacketBuffer share the same memory, which lets one encoded packet be sent to many clients.
+	// Once the last reference goes away the memory returns to the arena of the thread that
+	// allocated it (lock-free if that happens on another thread), ready to be reused, so steady
+	// state traffic does no heap allocation at all.
+	//
+	class PacketBuffer
+	{
+	public:
+		struct Statistics
+		{
+			uint64_t HeapAllocations = 0;  // blocks that had to come from the heap
+			uint64_t PoolAllocations = 0;  // blocks reused from an arena
+			uint64_t CrossThreadFrees = 0; // blocks released on a thread other than their owner's
+		};
+	public:
+		PacketBuffer() = default;
+		PacketBuffer(const PacketBuffer& other);
+		PacketBuffer(PacketBuffer&& other) noexcept;
+		~PacketBuffer();
+
+		PacketBuffer& operator=(const PacketBuffer& other);
+		PacketBuffer& operator=(PacketBuffer&& other) noexcept;
+
+		// capacity is rounded up to the size class, contents are not cleared
+		static PacketBuffer Allocate(uint64_t size);
+
+		uint8_t* GetData() const;
+		uint64_t GetCapacity() const;
+
+		// whole capacity as a Walnut buffer, for BufferStreamWriter
+		Walnut::Buffer GetBuffer() const { return Walnut::Buffer(GetData(), GetCapacity()); }
+
+		explicit operator bool() const { return m_Block != nullptr; }
+
+		static Statistics GetStatistics();
+	public:
+		struct Block;
+	private:
+		explicit PacketBuffer(Block* block) : m_Block(block) {}
+		void Release();
+	private:
+		Block* m_Block = nullptr;
+	};
+}
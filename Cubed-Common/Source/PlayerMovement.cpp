@@ -0,0 +1,88 @@
+#include "PlayerMovement.h"
+
+#include <cmath>
+
+namespace Cubed
+{
+	PlayerData GetSpawnPlayerData()
+	{
+		PlayerData player;
+		player.Position = { 0.0f, 0.0f };
+		player.Velocity = { 0.0f, 0.0f };
+		player.Rotation = { 30.0f, 45.0f, 0.0f };
+		return player;
+	}
+
+	void ApplyPlayerInput(PlayerData& player, const PlayerInput& input, const MovementSettings& settings)
+	{
+		glm::vec2 direction{ (float)input.MoveX, (float)input.MoveY };
+		if (direction.x != 0.0f || direction.y != 0.0f)
+		{
+			// avoid longer diagonals
+			player.Velocity = glm::normalize(direction) * settings.Speed;
+		}
+
+		player.Position += player.Velocity * PlayerInputInterval;
+		player.Velocity = glm::mix(player.Velocity, glm::vec2(0.0f), settings.Friction * PlayerInputInterval);
+
+		// wrapped so precision doesn't fall apart after spinning for hours
+		player.Rotation.y = std::fmod(player.Rotation.y + PlayerInputInterval * 20.0f, 360.0f);
+	}
+
+	void PendingInputs::Push(const PlayerInput& input)
+	{
+		if (m_Inputs.size() == MaxPendingInputs)
+			m_Inputs.pop_front();
+		m_Inputs.push_back(input);
+	}
+
+	PlayerData PendingInputs::Reconcile(const PlayerData& serverPlayer, uint32_t lastProcessedInput, const MovementSettings& settings)
+	{
+		// the server has already applied these, or skipped them because they never arrived
+		while (!m_Inputs.empty() && m_Inputs.front().Sequence <= lastProcessedInput)
+			m_Inputs.pop_front();
+
+		PlayerData replayed = serverPlayer;
+		for (const PlayerInput& input : m_Inputs)
+			ApplyPlayerInput(replayed, input, settings);
+		return replayed;
+	}
+
+	void WritePlayerInputs(BitWriter& writer, const PlayerInput* inputs, uint32_t count)
+	{
+		writer.WriteVarUInt(count);
+		if (count == 0)
+			return;
+
+		writer.WriteVarUInt(inputs[0].Sequence);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			writer.WriteBits((uint32_t)(inputs[i].MoveX + 1), 2);
+			writer.WriteBits((uint32_t)(inputs[i].MoveY + 1), 2);
+		}
+	}
+
+	bool ReadPlayerInputs(BitReader& reader, PlayerInput* inputs, uint32_t& count)
+	{
+		uint32_t firstSequence;
+		if (!reader.ReadVarUInt(count) || count > MaxInputsPerPacket)
+			return false;
+		if (count == 0)
+			return true;
+		if (!reader.ReadVarUInt(firstSequence))
+			return false;
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint32_t moveX, moveY;
+			if (!reader.ReadBits(moveX, 2) || !reader.ReadBits(moveY, 2) || moveX > 2 || moveY > 2)
+				return false;
+
+			inputs[i].Sequence = firstSequence + i;
+			inputs[i].MoveX = (int8_t)moveX - 1;
+			inputs[i].MoveY = (int8_t)moveY - 1;
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+
+#include "BitStream.h"
+#include "EntityStore.h"
+
+namespace Cubed
+{
+	// inputs are sampled and simulated at a fixed rate so every step is the same size
+	// on the client and the server
+	constexpr uint32_t PlayerInputRate = 60;
+	constexpr float PlayerInputInterval = 1.0f / PlayerInputRate;
+
+	// one fixed step worth of input
+	struct PlayerInput
+	{
+		uint32_t Sequence = 0; // 0 = no input
+		int8_t MoveX = 0;      // -1, 0 or 1
+		int8_t MoveY = 0;      // -1, 0 or 1
+	};
+
+	// a frame hitch longer than this many input steps just loses the extra time
+	constexpr uint32_t MaxInputsPerPacket = 16;
+
+	struct MovementSettings
+	{
+		float Speed = 150.0f;
+		float Friction = 10.0f; // velocity lerps towards 0 at this rate
+	};
+
+	// where (and how) every player starts out, on both ends
+	PlayerData GetSpawnPlayerData();
+
+	//
+	// Advances a player by one input step. The client runs this to predict its own player
+	// and the server runs it to simulate that same player authoritatively, so it has to
+	// produce bit-identical results on both: fixed step size and no state other than the
+	// arguments. The client links Cubed-Common and the server Cubed-Common-Headless, so this
+	// is compiled twice, and it only agrees as long as every operation is IEEE exact (no fast
+	// math or approximate intrinsics), the compiler doesn't contract anything into FMAs and
+	// both ends run with the same denormal mode. Both projects pin the first two for this file.
+	//
+	void ApplyPlayerInput(PlayerData& player, const PlayerInput& input, const MovementSettings& settings);
+
+	//
+	// PendingInputs - inputs a client has sent that the server hasn't applied yet
+	//
+	// Every snapshot tells the client the last input the server applied to its player. The
+	// client forgets everything up to there and replays the rest on top of the server's state,
+	// which lands exactly where it predicted unless the two disagreed. The server carries on
+	// past inputs that never reached it, so after lost packets these clear out again at the
+	// next snapshot. If the server stops answering altogether only the newest
+	// MaxPendingInputs are kept, and the next correction lands short of the prediction.
+	//
+	class PendingInputs
+	{
+	public:
+		static constexpr uint32_t MaxPendingInputs = PlayerInputRate * 2;
+	public:
+		void Push(const PlayerInput& input);
+		void Clear() { m_Inputs.clear(); }
+
+		// serverPlayer with every input after lastProcessedInput replayed on top
+		PlayerData Reconcile(const PlayerData& serverPlayer, uint32_t lastProcessedInput, const MovementSettings& settings);
+
+		size_t Size() const { return m_Inputs.size(); }
+	private:
+		std::deque<PlayerInput> m_Inputs;
+	};
+
+	// consecutive inputs, bit-packed
+	// 1. Input count (var-uint, at most MaxInputsPerPacket)
+	// 2. Sequence of the first input (var-uint), the rest follow on from it
+	// 3. MoveX + 1 and MoveY + 1 for every input (2 bits each)
+	void WritePlayerInputs(BitWriter& writer, const PlayerInput* inputs, uint32_t count);
+	bool ReadPlayerInputs(BitReader& reader, PlayerInput* inputs, uint32_t& count);
+}
@@ -0,0 +1,225 @@
+#include "Profiler.h"
+
+#if CUBED_PROFILING
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Cubed
+{
+	struct ProfileRecord
+	{
+		std::atomic<const char*> Name;
+		std::atomic<uint64_t> Start;
+		std::atomic<uint64_t> End;
+	};
+
+	struct ProfileRing
+	{
+		std::array<ProfileRecord, Profiler::RingCapacity> Zones;
+		// zones ever written, only the owning thread stores to it
+		std::atomic<uint64_t> Head = 0;
+
+		// everything below is guarded by s_RingRegistryMutex
+		uint64_t First = 0; // zones before this were written by a thread that has since exited
+		uint32_t ThreadID = 0;
+		std::string ThreadName;
+	};
+
+	struct ProfileCalibration
+	{
+		uint64_t Ticks;
+		std::chrono::steady_clock::time_point Time;
+	};
+
+	static const ProfileCalibration s_Start = { Profiler::ReadTicks(), std::chrono::steady_clock::now() };
+
+	// rings are never freed so they can be exported after their thread is gone, a new thread
+	// adopts an abandoned ring instead of creating another one
+	static std::mutex s_RingRegistryMutex;
+	static std::vector<std::unique_ptr<ProfileRing>> s_Rings;
+	static std::vector<ProfileRing*> s_AbandonedRings;
+	static uint32_t s_NextThreadID = 1;
+
+	// a plain pointer for the hot path, a thread_local with a destructor costs a guard check
+	// on every access
+	static thread_local ProfileRing* s_ThreadRing = nullptr;
+
+	struct ThreadRingOwner
+	{
+		~ThreadRingOwner()
+		{
+			std::scoped_lock<std::mutex> lock(s_RingRegistryMutex);
+			s_AbandonedRings.push_back(s_ThreadRing);
+			s_ThreadRing = nullptr;
+		}
+	};
+
+	static ProfileRing& GetThreadRing()
+	{
+		if (s_ThreadRing)
+			return *s_ThreadRing;
+
+		// only constructed on a thread's first zone, it gives the ring back when the thread exits
+		thread_local ThreadRingOwner s_ThreadRingOwner;
+
+		std::scoped_lock<std::mutex> lock(s_RingRegistryMutex);
+		ProfileRing* ring;
+		if (!s_AbandonedRings.empty())
+		{
+			ring = s_AbandonedRings.back();
+			s_AbandonedRings.pop_back();
+		}
+		else
+		{
+			ring = s_Rings.emplace_back(std::make_unique<ProfileRing>()).get();
+		}
+
+		ring->First = ring->Head.load(std::memory_order_relaxed);
+		ring->ThreadID = s_NextThreadID++;
+		ring->ThreadName = "Thread " + std::to_string(ring->ThreadID);
+		s_ThreadRing = ring;
+		return *ring;
+	}
+
+	void Profiler::Record(const char* name, uint64_t startTicks, uint64_t endTicks)
+	{
+		ProfileRing& ring = GetThreadRing();
+
+		// a seqlock with one writer: the head is bumped after the zone is written, and the
+		// fence keeps the next zone's stores behind that bump, so a reader that sees a zone
+		// being overwritten also sees the head that tells it so
+		uint64_t head = ring.Head.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		ProfileRecord& zone = ring.Zones[head & (RingCapacity - 1)];
+		zone.Name.store(name, std::memory_order_relaxed);
+		zone.Start.store(startTicks, std::memory_order_relaxed);
+		zone.End.store(endTicks, std::memory_order_relaxed);
+		ring.Head.store(head + 1, std::memory_order_release);
+	}
+
+	void Profiler::SetThreadName(std::string_view name)
+	{
+		ProfileRing& ring = GetThreadRing();
+
+		std::scoped_lock<std::mutex> lock(s_RingRegistryMutex);
+		ring.ThreadName = name;
+	}
+
+	static void WriteEscaped(std::string& out, std::string_view text)
+	{
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+				out += '\\';
+			if ((unsigned char)c >= 0x20)
+				out += c;
+		}
+	}
+
+	bool Profiler::WriteChromeTrace(const std::filesystem::path& path)
+	{
+		struct Zone
+		{
+			const char* Name;
+			uint64_t Start;
+			uint64_t End;
+			uint32_t ThreadID;
+		};
+
+		struct Thread
+		{
+			uint32_t ID;
+			std::string Name;
+		};
+
+		std::vector<Zone> zones;
+		std::vector<Thread> threads;
+		{
+			// only keeps rings from being handed to other threads, their owners keep recording
+			std::scoped_lock<std::mutex> lock(s_RingRegistryMutex);
+			for (const std::unique_ptr<ProfileRing>& ring : s_Rings)
+			{
+				uint64_t head = ring->Head.load(std::memory_order_acquire);
+				uint64_t first = std::max(ring->First, head > RingCapacity ? head - RingCapacity : 0);
+
+				size_t copied = zones.size();
+				for (uint64_t i = first; i < head; i++)
+				{
+					const ProfileRecord& zone = ring->Zones[i & (RingCapacity - 1)];
+					zones.push_back({
+						zone.Name.load(std::memory_order_relaxed),
+						zone.Start.load(std::memory_order_relaxed),
+						zone.End.load(std::memory_order_relaxed),
+						ring->ThreadID
+					});
+				}
+
+				// the owner wrote on while we copied, anything it may have lapped is torn
+				std::atomic_thread_fence(std::memory_order_acquire);
+				uint64_t newHead = ring->Head.load(std::memory_order_relaxed);
+				uint64_t lapped = newHead + 1 > first + RingCapacity ? newHead + 1 - RingCapacity - first : 0;
+				lapped = std::min<uint64_t>(lapped, zones.size() - copied);
+				zones.erase(zones.begin() + copied, zones.begin() + copied + lapped);
+
+				threads.push_back({ ring->ThreadID, ring->ThreadName });
+			}
+		}
+
+		// ticks to microseconds, measured against steady_clock over everything since startup
+		ProfileCalibration now = { ReadTicks(), std::chrono::steady_clock::now() };
+		double elapsed = std::chrono::duration<double, std::micro>(now.Time - s_Start.Time).count();
+		double microsecondsPerTick = now.Ticks > s_Start.Ticks ? elapsed / (double)(now.Ticks - s_Start.Ticks) : 0.0;
+
+		std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+		if (!stream)
+			return false;
+
+		std::string out;
+		out.reserve(1024 * 1024);
+		out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+		bool firstEvent = true;
+		for (const Thread& thread : threads)
+		{
+			out += firstEvent ? "" : ",\n";
+			out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" + std::to_string(thread.ID) + ",\"args\":{\"name\":\"";
+			WriteEscaped(out, thread.Name);
+			out += "\"}}";
+			firstEvent = false;
+		}
+
+		char numbers[96];
+		for (const Zone& zone : zones)
+		{
+			double start = (double)(int64_t)(zone.Start - s_Start.Ticks) * microsecondsPerTick;
+			double duration = (double)(zone.End - zone.Start) * microsecondsPerTick;
+
+			out += firstEvent ? "{\"name\":\"" : ",\n{\"name\":\"";
+			WriteEscaped(out, zone.Name);
+			snprintf(numbers, sizeof(numbers), "\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", zone.ThreadID, start, duration);
+			out += numbers;
+			firstEvent = false;
+
+			if (out.size() > 512 * 1024)
+			{
+				stream.write(out.data(), out.size());
+				out.clear();
+			}
+		}
+
+		out += "\n]}\n";
+		stream.write(out.data(), out.size());
+		return (bool)stream;
+	}
+}
+
+#endif
@@ -0,0 +1,98 @@
+#pragma once
+
+// everything below, the macros included, is compiled out of Dist builds
+#ifndef WL_DIST
+	#define CUBED_PROFILING 1
+#else
+	#define CUBED_PROFILING 0
+#endif
+
+#if CUBED_PROFILING
+
+#include <stdint.h>
+#include <chrono>
+#include <filesystem>
+#include <string_view>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+	#include <intrin.h>
+	#define CUBED_PROFILER_RDTSC 1
+#elif defined(__x86_64__)
+	#include <x86intrin.h>
+	#define CUBED_PROFILER_RDTSC 1
+#else
+	#define CUBED_PROFILER_RDTSC 0
+#endif
+
+namespace Cubed
+{
+	//
+	// Profiler - scoped timing zones, exported as a Chrome trace
+	//
+	// Every thread that opens a zone gets a ring buffer of its own and is the only one that
+	// ever writes to it, so recording a zone is two timestamps and a few stores, no locks and
+	// nothing shared with other threads. Rings hold the last RingCapacity zones of their
+	// thread and are always recording, WriteChromeTrace copies out whatever they hold right
+	// now without stopping anyone (zones overwritten while it copies are dropped).
+	//
+	// Timestamps are raw rdtsc ticks on x86-64, steady_clock everywhere else, and only turned
+	// into time on export, against steady_clock. Load the trace in chrome://tracing or
+	// ui.perfetto.dev.
+	//
+	// Zone names must outlive the trace, string literals are what they're meant for. Use the
+	// macros rather than the class directly, they disappear from Dist builds entirely.
+	//
+	class Profiler
+	{
+	public:
+		static constexpr uint32_t RingCapacity = 1 << 16; // zones per thread, a power of two
+
+		static uint64_t ReadTicks()
+		{
+		#if CUBED_PROFILER_RDTSC
+			return __rdtsc();
+		#else
+			return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+		#endif
+		}
+
+		static void Record(const char* name, uint64_t startTicks, uint64_t endTicks);
+
+		// what the calling thread shows up as in the trace, "Thread <n>" if never set
+		static void SetThreadName(std::string_view name);
+
+		// safe to call from any thread at any time, false if the file couldn't be written
+		static bool WriteChromeTrace(const std::filesystem::path& path);
+	};
+
+	class ProfileZone
+	{
+	public:
+		explicit ProfileZone(const char* name)
+			: m_Name(name), m_Start(Profiler::ReadTicks())
+		{
+		}
+
+		~ProfileZone() { Profiler::Record(m_Name, m_Start, Profiler::ReadTicks()); }
+
+		ProfileZone(const ProfileZone&) = delete;
+		ProfileZone& operator=(const ProfileZone&) = delete;
+	private:
+		const char* m_Name;
+		uint64_t m_Start;
+	};
+}
+
+#define CUBED_PROFILE_CONCAT_INNER(a, b) a##b
+#define CUBED_PROFILE_CONCAT(a, b) CUBED_PROFILE_CONCAT_INNER(a, b)
+
+// times the rest of the enclosing scope
+#define CUBED_PROFILE_ZONE(name) ::Cubed::ProfileZone CUBED_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define CUBED_PROFILE_THREAD(name) ::Cubed::Profiler::SetThreadName(name)
+
+#else
+
+#define CUBED_PROFILE_ZONE(name)
+#define CUBED_PROFILE_THREAD(name)
+
+#endif
@@ -0,0 +1,246 @@
+#include "RegionFile.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Cubed
+{
+	static int32_t FloorDivide(int32_t value, int32_t divisor)
+	{
+		return value / divisor - (value % divisor < 0 ? 1 : 0);
+	}
+
+	static int32_t FloorModulo(int32_t value, int32_t divisor)
+	{
+		return value - FloorDivide(value, divisor) * divisor;
+	}
+
+	RegionCoord RegionCoord::FromChunk(const ChunkCoord& coord)
+	{
+		return { FloorDivide(coord.X, RegionSize), FloorDivide(coord.Y, RegionHeight), FloorDivide(coord.Z, RegionSize) };
+	}
+
+	uint32_t RegionCoord::GetSlot(const ChunkCoord& coord)
+	{
+		uint32_t x = (uint32_t)FloorModulo(coord.X, RegionSize);
+		uint32_t y = (uint32_t)FloorModulo(coord.Y, RegionHeight);
+		uint32_t z = (uint32_t)FloorModulo(coord.Z, RegionSize);
+		return x + RegionSize * (z + RegionSize * y);
+	}
+
+	ChunkCoord RegionCoord::GetChunk(uint32_t slot) const
+	{
+		int32_t x = (int32_t)(slot % RegionSize);
+		int32_t z = (int32_t)(slot / RegionSize % RegionSize);
+		int32_t y = (int32_t)(slot / (RegionSize * RegionSize));
+		return { X * RegionSize + x, Y * RegionHeight + y, Z * RegionSize + z };
+	}
+
+	size_t RegionCoordHash::operator()(const RegionCoord& coord) const
+	{
+		return (size_t)((uint64_t)(uint32_t)coord.X * 73856093ull ^ (uint64_t)(uint32_t)coord.Y * 19349663ull ^ (uint64_t)(uint32_t)coord.Z * 83492791ull);
+	}
+
+	bool RegionFile::Open(const std::filesystem::path& path)
+	{
+		std::scoped_lock lock(m_Mutex);
+
+		m_File.Close();
+		m_UsedSectors.clear();
+		m_PendingFrees.clear();
+		m_Statistics = {};
+		m_Version = 0;
+
+		if (!m_File.Open(path, MappedFile::Access::ReadWrite))
+			return false;
+
+		if (m_File.GetSize() == 0)
+		{
+			// new file, the table starts out all zeroes which is every slot empty
+			if (!m_File.Resize((uint64_t)s_HeaderSectors * s_SectorSize))
+				return false;
+
+			FileHeader header = {
+				.Magic = s_Magic,
+				.Version = CurrentVersion,
+				.Size = RegionSize,
+				.Height = RegionHeight
+			};
+			memcpy(m_File.GetWritableData(), &header, sizeof(header));
+		}
+
+		if (m_File.GetSize() < (uint64_t)s_HeaderSectors * s_SectorSize)
+		{
+			m_File.Close();
+			return false;
+		}
+
+		FileHeader header;
+		memcpy(&header, m_File.GetData(), sizeof(header));
+		if (header.Magic != s_Magic || header.Version == 0 || header.Version > CurrentVersion || header.Size != RegionSize || header.Height != RegionHeight)
+		{
+			m_File.Close();
+			return false;
+		}
+		m_Version = header.Version;
+
+		// which sectors are taken only lives in the table, rebuild it. A partial sector at the
+		// end of the file can't hold anything
+		uint32_t sectorCount = (uint32_t)(m_File.GetSize() / s_SectorSize);
+		m_UsedSectors.assign(sectorCount, false);
+		MarkSectors(0, s_HeaderSectors, true);
+
+		SlotEntry* table = GetTable();
+		for (uint32_t slot = 0; slot < RegionChunkCount; slot++)
+		{
+			SlotEntry& entry = table[slot];
+			if (entry.Sector == 0)
+				continue;
+
+			// pointing outside the data, there's nothing to be saved from it
+			uint32_t count = GetSectorCount(entry.Size);
+			if (entry.Sector < s_HeaderSectors || entry.Size == 0 || (uint64_t)entry.Sector + count > sectorCount)
+			{
+				entry = {};
+				continue;
+			}
+
+			MarkSectors(entry.Sector, count, true);
+		}
+
+		return true;
+	}
+
+	void RegionFile::Close()
+	{
+		std::scoped_lock lock(m_Mutex);
+
+		m_File.Close();
+		m_UsedSectors.clear();
+		m_PendingFrees.clear();
+		m_Version = 0;
+	}
+
+	bool RegionFile::Read(const ChunkCoord& coord, std::vector<uint8_t>& outData)
+	{
+		std::scoped_lock lock(m_Mutex);
+		if (!m_File.IsOpen())
+			return false;
+
+		SlotEntry entry = GetTable()[RegionCoord::GetSlot(coord)];
+		if (entry.Sector == 0)
+			return false;
+
+		const uint8_t* data = m_File.GetData() + (uint64_t)entry.Sector * s_SectorSize;
+		if (Checksum(data, entry.Size) != entry.Checksum)
+		{
+			m_Statistics.DamagedChunks++;
+			return false;
+		}
+
+		outData.assign(data, data + entry.Size);
+		m_Statistics.ChunksRead++;
+		return true;
+	}
+
+	bool RegionFile::Write(const ChunkCoord& coord, const uint8_t* data, uint64_t size)
+	{
+		std::scoped_lock lock(m_Mutex);
+		if (!m_File.IsOpen() || size == 0 || size > UINT32_MAX)
+			return false;
+
+		uint32_t count = GetSectorCount(size);
+		uint32_t sector = Allocate(count);
+		if (sector == 0)
+			return false;
+
+		// the data has to be in place before the table points at it
+		uint8_t* destination = m_File.GetWritableData() + (uint64_t)sector * s_SectorSize;
+		memcpy(destination, data, size);
+		memset(destination + size, 0, (uint64_t)count * s_SectorSize - size);
+
+		SlotEntry& entry = GetTable()[RegionCoord::GetSlot(coord)];
+		if (entry.Sector != 0)
+			m_PendingFrees.push_back(entry);
+
+		entry = {
+			.Sector = sector,
+			.Size = (uint32_t)size,
+			.Checksum = Checksum(data, size)
+		};
+
+		m_Statistics.ChunksWritten++;
+		m_Statistics.BytesWritten += size;
+		return true;
+	}
+
+	bool RegionFile::Flush()
+	{
+		std::scoped_lock lock(m_Mutex);
+		if (!m_File.IsOpen())
+			return false;
+
+		if (!m_File.Flush())
+			return false;
+
+		// nothing on disk points at these anymore
+		for (const SlotEntry& entry : m_PendingFrees)
+			MarkSectors(entry.Sector, GetSectorCount(entry.Size), false);
+		m_PendingFrees.clear();
+		return true;
+	}
+
+	RegionFile::Statistics RegionFile::GetStatistics() const
+	{
+		std::scoped_lock lock(m_Mutex);
+
+		Statistics stats = m_Statistics;
+		stats.UsedSectors = (uint32_t)std::count(m_UsedSectors.begin(), m_UsedSectors.end(), true);
+		stats.FileSectors = (uint32_t)m_UsedSectors.size();
+		return stats;
+	}
+
+	uint32_t RegionFile::Allocate(uint32_t count)
+	{
+		uint32_t sectorCount = (uint32_t)m_UsedSectors.size();
+		uint32_t runStart = s_HeaderSectors, runLength = 0;
+		for (uint32_t sector = s_HeaderSectors; sector < sectorCount; sector++)
+		{
+			if (m_UsedSectors[sector])
+			{
+				runStart = sector + 1;
+				runLength = 0;
+				continue;
+			}
+
+			if (++runLength == count)
+			{
+				MarkSectors(runStart, count, true);
+				return runStart;
+			}
+		}
+
+		// no gap big enough, the run at the end of the file (if any) gets extended instead
+		uint64_t newSectorCount = std::max<uint64_t>((uint64_t)runStart + count, (uint64_t)sectorCount + s_GrowSectors);
+		if (newSectorCount > UINT32_MAX || !m_File.Resize(newSectorCount * s_SectorSize))
+			return 0;
+
+		m_UsedSectors.resize((size_t)newSectorCount, false);
+		MarkSectors(runStart, count, true);
+		return runStart;
+	}
+
+	void RegionFile::MarkSectors(uint32_t sector, uint32_t count, bool used)
+	{
+		std::fill_n(m_UsedSectors.begin() + sector, count, used);
+	}
+
+	uint32_t RegionFile::Checksum(const uint8_t* data, uint64_t size)
+	{
+		// FNV-1a, only has to catch sectors that never made it to disk
+		uint32_t hash = 2166136261u;
+		for (uint64_t i = 0; i < size; i++)
+			hash = (hash ^ data[i]) * 16777619u;
+		return hash;
+	}
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <stdint.h>
+#include <filesystem>
+#include <mutex>
+#include <vector>
+
+#include "Chunk.h"
+#include "MappedFile.h"
+
+namespace Cubed
+{
+	// chunks in one region file, along each axis
+	constexpr int32_t RegionSize = 32;   // x and z
+	constexpr int32_t RegionHeight = 8;  // y
+	constexpr uint32_t RegionChunkCount = RegionSize * RegionHeight * RegionSize;
+
+	// region position in the world, in regions (chunk position / region size)
+	struct RegionCoord
+	{
+		int32_t X = 0;
+		int32_t Y = 0;
+		int32_t Z = 0;
+
+		bool operator==(const RegionCoord& other) const = default;
+
+		// region a chunk is in, rounding towards negative infinity
+		static RegionCoord FromChunk(const ChunkCoord& coord);
+		// index of a chunk within its region, x first, then z, then y
+		static uint32_t GetSlot(const ChunkCoord& coord);
+		// chunk in a slot of this region, the other way around
+		ChunkCoord GetChunk(uint32_t slot) const;
+	};
+
+	struct RegionCoordHash
+	{
+		size_t operator()(const RegionCoord& coord) const;
+	};
+
+	//
+	// RegionFile - one file holding every saved chunk of a region
+	//
+	// The file is mapped into memory and split into 4KB sectors. The first few hold a header
+	// and a table with an entry per chunk slot (see the region format below), the rest hold
+	// chunk data, each chunk in a run of whole sectors. Reading a chunk is a copy straight out
+	// of the mapping, writing one is a copy into it; the OS writes the pages back on its own
+	// time, or right away on Flush.
+	//
+	// Chunks are never rewritten in place: a new version goes into free sectors and only then
+	// does the table point at it, and the sectors it replaced aren't reused until the next
+	// Flush has made the table on disk point away from them. Entries carry a checksum, so a
+	// chunk whose sectors didn't make it to disk before a crash reads as missing, not garbage.
+	//
+	// The version in the header also says what the chunks hold, see the region format below.
+	// Older versions still open, for the caller to upgrade, new files get the current one.
+	//
+	// Read and Write may be called from any thread, Write can grow and remap the file so the
+	// two are serialized.
+	//
+	class RegionFile
+	{
+	public:
+		struct Statistics
+		{
+			uint64_t ChunksRead = 0;
+			uint64_t ChunksWritten = 0;
+			uint64_t BytesWritten = 0;
+			uint64_t DamagedChunks = 0; // entries whose data didn't match the checksum
+			uint32_t UsedSectors = 0;   // header included
+			uint32_t FileSectors = 0;
+		};
+	public:
+		static constexpr uint32_t CurrentVersion = 2;
+	public:
+		// creates the file if it doesn't exist, false if it can't be or isn't a region file
+		bool Open(const std::filesystem::path& path);
+		void Close();
+
+		// coord has to be within this region. false if the chunk was never written or is damaged
+		bool Read(const ChunkCoord& coord, std::vector<uint8_t>& outData);
+		bool Write(const ChunkCoord& coord, const uint8_t* data, uint64_t size);
+
+		// blocks until everything written so far is on disk
+		bool Flush();
+
+		bool IsOpen() const { return m_File.IsOpen(); }
+		// version the file was written with, CurrentVersion for a new one
+		uint32_t GetVersion() const { return m_Version; }
+		Statistics GetStatistics() const;
+	private:
+		struct FileHeader
+		{
+			uint32_t Magic = 0;
+			uint32_t Version = 0;
+			uint32_t Size = 0;   // RegionSize the file was written with
+			uint32_t Height = 0; // RegionHeight the file was written with
+		};
+
+		struct SlotEntry
+		{
+			uint32_t Sector = 0; // first sector of the data, 0 if the chunk was never written
+			uint32_t Size = 0;   // in bytes
+			uint32_t Checksum = 0;
+		};
+
+		static constexpr uint32_t s_Magic = 0x4e475243; // "CRGN"
+		static constexpr uint32_t s_SectorSize = 4096;
+		static constexpr uint32_t s_HeaderSectors = (sizeof(FileHeader) + sizeof(SlotEntry) * RegionChunkCount + s_SectorSize - 1) / s_SectorSize;
+		// the file grows by at least this much at a time, so appending isn't a remap per chunk
+		static constexpr uint32_t s_GrowSectors = 64;
+	private:
+		SlotEntry* GetTable() const { return (SlotEntry*)(m_File.GetWritableData() + sizeof(FileHeader)); }
+
+		// first free run of count sectors, growing the file if there isn't one, 0 on failure
+		uint32_t Allocate(uint32_t count);
+		void MarkSectors(uint32_t sector, uint32_t count, bool used);
+
+		static uint32_t GetSectorCount(uint64_t size) { return (uint32_t)((size + s_SectorSize - 1) / s_SectorSize); }
+		static uint32_t Checksum(const uint8_t* data, uint64_t size);
+	private:
+		mutable std::mutex m_Mutex;
+		MappedFile m_File;
+		uint32_t m_Version = 0;
+
+		std::vector<bool> m_UsedSectors;
+		// sectors replaced since the last Flush, see above
+		std::vector<SlotEntry> m_PendingFrees;
+
+		Statistics m_Statistics;
+	};
+
+	//
+	// Region format, all little endian
+	// 1. Header: magic "CRGN", version, RegionSize, RegionHeight (uint32_t each)
+	// 2. Slot table, RegionChunkCount entries of sector, size and FNV-1a checksum (uint32_t
+	//    each), slots in RegionCoord::GetSlot order
+	// 3. Padding up to the first whole sector, then chunk data, each chunk starting on a sector
+	//    boundary. What a chunk's data holds depends on the version: 1 is the plain chunk format
+	//    from Chunk.h, 2 the compressed format from ChunkCompression.h
+	//
+}
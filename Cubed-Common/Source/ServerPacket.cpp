@@ -16,6 +16,12 @@ std::string_view PacketTypeToString(PacketType type)
 		case PacketType::MessageHistory:           return "PacketType::MessageHistory";
 		case PacketType::ServerShutdown:           return "PacketType::ServerShutdown";
 		case PacketType::ClientKick:               return "PacketType::ClientKick";
+		case PacketType::ClientInput:              return "PacketType::ClientInput";
+		case PacketType::ChunkData:                return "PacketType::ChunkData";
+		case PacketType::ChunkUnload:              return "PacketType::ChunkUnload";
+		case PacketType::ChunkEdits:               return "PacketType::ChunkEdits";
+		case PacketType::ChunkStreamIdle:          return "PacketType::ChunkStreamIdle";
+		case PacketType::SetBlock:                 return "PacketType::SetBlock";
 
 		default: return "PacketType::<Invalid>";
 	}
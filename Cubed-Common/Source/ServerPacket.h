@@ -62,12 +62,16 @@ enum class PacketType : uint16_t
 	// -- ClientUpdate --
 	// 
 	// [Server->Client]
-	// 1. Existing username (Hazel serialized UTF-8 string)
-	// 2. New color for user (32-bit int, RGB)
-	// 3. New username (Hazel serialized UTF-8 string)
+	// Player snapshot, delta compressed against a snapshot the client has acknowledged
+	// 1. Snapshot ID (uint32_t)
+	// 2. Baseline snapshot ID (uint32_t), 0 if this is a full snapshot
+	// 3. Server simulation time in milliseconds (uint32_t), for client interpolation
+	// 4. Sequence of the last ClientInput the server applied for this client (uint32_t), 0 if none
+	// 5. This client's own player after that input (PlayerData), unquantized so the client
+	//    can reconcile its prediction bit for bit
+	// 6. Delta snapshot body (see Snapshot.h)
 	// [Client->Server]
-	// 1. Requested new color (32-bit int, RGB)
-	// 2. Requested new username (Hazel serialized UTF-8 string)
+	// Not sent anymore, clients send ClientInput instead
 	ClientUpdate = 6,
 
 	// 
@@ -112,6 +116,62 @@ enum class PacketType : uint16_t
 	// User has been kicked from server
 	// 1. String reason, could be empty string
 	ClientKick = 11,
+
+	// 
+	// -- ClientInput --
+	// 
+	// [Client->Server]
+	// Bit-packed (see BitStream.h)
+	// 1. ID of the last snapshot received (var-uint), acknowledges it as a baseline
+	// 2. Player inputs since the last ClientInput (see WritePlayerInputs in PlayerMovement.h)
+	ClientInput = 12,
+
+	// 
+	// -- ChunkData --
+	// 
+	// [Server->Client]
+	// A whole chunk, sent nearest first as the client comes into range of it
+	// 1. Chunk coordinate (3x int32_t)
+	// 2. Chunk version (uint32_t), later ChunkEdits build on it
+	// 3. Compressed chunk, the rest of the packet (see ChunkCompression.h)
+	ChunkData = 13,
+
+	// 
+	// -- ChunkUnload --
+	// 
+	// [Server->Client]
+	// Chunk has gone out of range, it won't get any more edits until it is sent again
+	// 1. Chunk coordinate (3x int32_t)
+	ChunkUnload = 14,
+
+	// 
+	// -- ChunkEdits --
+	// 
+	// [Server->Client]
+	// Blocks that changed in a chunk the client already has, in the order they were set
+	// 1. Chunk coordinate (3x int32_t)
+	// 2. Version the edits apply to (uint32_t)
+	// 3. Version after the edits (uint32_t)
+	// 4. Bit-packed (see BitStream.h): var-uint edit count, then for each edit a var-uint
+	//    block index (see Chunk::GetIndex) and a var-uint BlockID
+	ChunkEdits = 15,
+
+	// 
+	// -- ChunkStreamIdle --
+	// 
+	// [Server->Client]
+	// Every chunk in range has been sent, sent each time the client's queue runs dry
+	// 1. Number of chunks the client should have now (uint32_t)
+	ChunkStreamIdle = 16,
+
+	// 
+	// -- SetBlock --
+	// 
+	// [Client->Server]
+	// Request to change a block, only honoured in chunks the server has sent to the client
+	// 1. Block position (3x int32_t)
+	// 2. BlockID (uint16_t), 0 to remove the block
+	SetBlock = 17,
 };
 
 std::string_view PacketTypeToString(PacketType type);
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include "Snapshot.h"
+
+#include <vector>
+
+namespace Cubed
+{
+	static bool ExceedsThreshold(const glm::vec2& a, const glm::vec2& b, float threshold)
+	{
+		glm::vec2 diff = a - b;
+		return glm::dot(diff, diff) > threshold * threshold;
+	}
+
+	static bool ExceedsThreshold(const glm::vec3& a, const glm::vec3& b, float threshold)
+	{
+		glm::vec3 diff = a - b;
+		return glm::dot(diff, diff) > threshold * threshold;
+	}
+
+	static void WriteMotion(BitWriter& writer, const PlayerData& data, const PlayerQuantization& quantization)
+	{
+		// most players are standing still most of the time
+		uint32_t zero = quantization.Velocity.Quantize(0.0f);
+		bool moving = quantization.Velocity.Quantize(data.Velocity.x) != zero || quantization.Velocity.Quantize(data.Velocity.y) != zero;
+		writer.WriteBool(moving);
+		if (moving)
+		{
+			writer.WriteQuantized(data.Velocity.x, quantization.Velocity);
+			writer.WriteQuantized(data.Velocity.y, quantization.Velocity);
+		}
+
+		writer.WriteAngle(data.Rotation.x, quantization.AngleBits);
+		writer.WriteAngle(data.Rotation.y, quantization.AngleBits);
+		writer.WriteAngle(data.Rotation.z, quantization.AngleBits);
+	}
+
+	static bool ReadMotion(BitReader& reader, PlayerData& data, const PlayerQuantization& quantization)
+	{
+		bool moving;
+		if (!reader.ReadBool(moving))
+			return false;
+
+		data.Velocity = glm::vec2(quantization.Velocity.Dequantize(quantization.Velocity.Quantize(0.0f)));
+		if (moving && (!reader.ReadQuantized(data.Velocity.x, quantization.Velocity) || !reader.ReadQuantized(data.Velocity.y, quantization.Velocity)))
+			return false;
+
+		return reader.ReadAngle(data.Rotation.x, quantization.AngleBits)
+			&& reader.ReadAngle(data.Rotation.y, quantization.AngleBits)
+			&& reader.ReadAngle(data.Rotation.z, quantization.AngleBits);
+	}
+
+	void WritePlayerData(BitWriter& writer, const PlayerData& data, const PlayerQuantization& quantization)
+	{
+		writer.WriteQuantized(data.Position.x, quantization.Position);
+		writer.WriteQuantized(data.Position.y, quantization.Position);
+		WriteMotion(writer, data, quantization);
+	}
+
+	bool ReadPlayerData(BitReader& reader, PlayerData& data, const PlayerQuantization& quantization)
+	{
+		return reader.ReadQuantized(data.Position.x, quantization.Position)
+			&& reader.ReadQuantized(data.Position.y, quantization.Position)
+			&& ReadMotion(reader, data, quantization);
+	}
+
+	PlayerData QuantizePlayerData(const PlayerData& data, const PlayerQuantization& quantization)
+	{
+		auto round = [](float value, const Quantization& q) { return q.Dequantize(q.Quantize(value)); };
+		auto roundAngle = [&quantization](float degrees)
+		{
+			return BitWriter::DequantizeAngle(BitWriter::QuantizeAngle(degrees, quantization.AngleBits), quantization.AngleBits);
+		};
+
+		PlayerData result;
+		result.Position = { round(data.Position.x, quantization.Position), round(data.Position.y, quantization.Position) };
+		result.Velocity = { round(data.Velocity.x, quantization.Velocity), round(data.Velocity.y, quantization.Velocity) };
+		result.Rotation = { roundAngle(data.Rotation.x), roundAngle(data.Rotation.y), roundAngle(data.Rotation.z) };
+		return result;
+	}
+
+	uint32_t WriteSnapshotDelta(Walnut::StreamWriter& writer, const EntityStore& baseline, const EntityStore& current,
+		const SnapshotDeltaSettings& settings, EntityStore& outView)
+	{
+		const PlayerQuantization& quantization = settings.Quantization;
+
+		// reused between calls so steady state snapshots don't allocate
+		thread_local std::vector<uint32_t> s_Changed;
+		thread_local std::vector<uint32_t> s_Removed;
+		s_Changed.clear();
+		s_Removed.clear();
+		outView.Clear();
+
+		const std::vector<uint32_t>& ids = current.GetIDs();
+		for (size_t i = 0; i < ids.size(); i++)
+		{
+			// compare what the client would actually end up with
+			PlayerData data = QuantizePlayerData(current.Get(i), quantization);
+
+			size_t baselineIndex = baseline.GetIndex(ids[i]);
+			if (baselineIndex != SIZE_MAX
+				&& !ExceedsThreshold(data.Position, baseline.GetPositions()[baselineIndex], settings.PositionThreshold)
+				&& !ExceedsThreshold(data.Velocity, baseline.GetVelocities()[baselineIndex], settings.VelocityThreshold)
+				&& !ExceedsThreshold(data.Rotation, baseline.GetRotations()[baselineIndex], settings.RotationThreshold))
+			{
+				// client already has a close enough value, keep it in the view
+				outView.Insert(ids[i], baseline.Get(baselineIndex));
+				continue;
+			}
+
+			s_Changed.push_back((uint32_t)i);
+			outView.Insert(ids[i], data);
+		}
+
+		for (uint32_t id : baseline.GetIDs())
+		{
+			if (!current.Contains(id))
+				s_Removed.push_back(id);
+		}
+
+		BitWriter bits(writer);
+		uint32_t positionBits = quantization.Position.GetBitCount();
+
+		bits.WriteVarUInt((uint32_t)s_Changed.size());
+		for (uint32_t index : s_Changed)
+		{
+			uint32_t id = ids[index];
+			PlayerData data = current.Get(index);
+			bits.WriteVarUInt(id);
+
+			size_t baselineIndex = baseline.GetIndex(id);
+			if (baselineIndex != SIZE_MAX)
+			{
+				// client has this player already, position usually only moved a little
+				const glm::vec2& from = baseline.GetPositions()[baselineIndex];
+				bits.WriteSignedDelta((int32_t)quantization.Position.Quantize(data.Position.x) - (int32_t)quantization.Position.Quantize(from.x), positionBits);
+				bits.WriteSignedDelta((int32_t)quantization.Position.Quantize(data.Position.y) - (int32_t)quantization.Position.Quantize(from.y), positionBits);
+				WriteMotion(bits, data, quantization);
+			}
+			else
+			{
+				WritePlayerData(bits, data, quantization);
+			}
+		}
+
+		bits.WriteVarUInt((uint32_t)s_Removed.size());
+		for (uint32_t id : s_Removed)
+			bits.WriteVarUInt(id);
+
+		bits.Flush();
+		return (uint32_t)s_Changed.size();
+	}
+
+	bool ReadSnapshotDelta(Walnut::StreamReader& reader, const EntityStore& baseline, const PlayerQuantization& quantization,
+		EntityStore& outView)
+	{
+		outView = baseline;
+
+		BitReader bits(reader);
+		uint32_t positionBits = quantization.Position.GetBitCount();
+
+		uint32_t changedCount;
+		if (!bits.ReadVarUInt(changedCount))
+			return false;
+
+		for (uint32_t i = 0; i < changedCount; i++)
+		{
+			uint32_t id;
+			if (!bits.ReadVarUInt(id))
+				return false;
+
+			PlayerData data;
+			size_t baselineIndex = baseline.GetIndex(id);
+			if (baselineIndex != SIZE_MAX)
+			{
+				const glm::vec2& from = baseline.GetPositions()[baselineIndex];
+				int32_t deltaX, deltaY;
+				if (!bits.ReadSignedDelta(deltaX, positionBits) || !bits.ReadSignedDelta(deltaY, positionBits))
+					return false;
+
+				data.Position.x = quantization.Position.Dequantize((uint32_t)((int32_t)quantization.Position.Quantize(from.x) + deltaX));
+				data.Position.y = quantization.Position.Dequantize((uint32_t)((int32_t)quantization.Position.Quantize(from.y) + deltaY));
+				if (!ReadMotion(bits, data, quantization))
+					return false;
+			}
+			else if (!ReadPlayerData(bits, data, quantization))
+			{
+				return false;
+			}
+
+			outView.Insert(id, data);
+		}
+
+		uint32_t removedCount;
+		if (!bits.ReadVarUInt(removedCount))
+			return false;
+
+		for (uint32_t i = 0; i < removedCount; i++)
+		{
+			uint32_t id;
+			if (!bits.ReadVarUInt(id))
+				return false;
+
+			outView.Remove(id);
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "BitStream.h"
+#include "EntityStore.h"
+
+#include "Walnut/Serialization/StreamReader.h"
+#include "Walnut/Serialization/StreamWriter.h"
+
+namespace Cubed
+{
+	// a client's view of the world after it has received a given snapshot
+	struct Snapshot
+	{
+		uint32_t ID = 0;
+		EntityStore Players;
+	};
+
+	// snapshot ID 0 is never sent, so a baseline ID of 0 means "full snapshot"
+	constexpr uint32_t NoSnapshotBaseline = 0;
+
+	// how player state is quantized on the wire, both ends have to agree on this
+	struct PlayerQuantization
+	{
+		Quantization Position{ 4096.0f, 1.0f / 32.0f };
+		Quantization Velocity{ 256.0f, 1.0f / 16.0f };
+		uint32_t AngleBits = 9;
+	};
+
+	struct SnapshotDeltaSettings
+	{
+		// players that moved less than this since the baseline are not resent
+		float PositionThreshold = 0.01f;
+		float VelocityThreshold = 0.01f;
+		float RotationThreshold = 1.0f; // in degrees
+
+		PlayerQuantization Quantization;
+	};
+
+	// absolute, bit-packed player state
+	// 1. Position (2x quantized)
+	// 2. Moving flag (1 bit), followed by velocity (2x quantized) if set
+	// 3. Rotation (3x quantized angle)
+	void WritePlayerData(BitWriter& writer, const PlayerData& data, const PlayerQuantization& quantization);
+	bool ReadPlayerData(BitReader& reader, PlayerData& data, const PlayerQuantization& quantization);
+
+	// what the other end will see after data goes through the wire
+	PlayerData QuantizePlayerData(const PlayerData& data, const PlayerQuantization& quantization);
+
+	//
+	// Delta snapshot format (body of a [Server->Client] ClientUpdate, bit-packed)
+	// 1. Var-uint count of changed players, for each:
+	//    a. Var-uint ID
+	//    b. If the ID is in the baseline: position as a signed delta of the quantized values,
+	//       otherwise absolute quantized position
+	//    c. Moving flag + velocity, rotation (as per WritePlayerData)
+	// 2. Var-uint count of removed players, followed by var-uint IDs
+	//
+	// writes everything in current that differs from baseline beyond the thresholds, and fills
+	// outView with what the client will see once it applies the delta (baseline + changes)
+	// returns number of changed players written
+	uint32_t WriteSnapshotDelta(Walnut::StreamWriter& writer, const EntityStore& baseline, const EntityStore& current,
+		const SnapshotDeltaSettings& settings, EntityStore& outView);
+
+	// applies a delta written by WriteSnapshotDelta on top of baseline into outView
+	bool ReadSnapshotDelta(Walnut::StreamReader& reader, const EntityStore& baseline, const PlayerQuantization& quantization,
+		EntityStore& outView);
+}
@@ -0,0 +1,287 @@
+#include "TerrainGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "Profiler.h"
+
+namespace Cubed
+{
+	static constexpr uint32_t s_ColumnCount = ChunkSize * ChunkSize;
+
+	// above sea level, heights where the tops of columns turn to bare stone and then snow
+	static constexpr int32_t s_RockLine = 30;
+	static constexpr int32_t s_SnowLine = 44;
+	// the ground under the sea isn't carved this close to the sea floor, nothing would hold the water up
+	static constexpr int32_t s_SeaFloorDepth = 6;
+	// caves are where the cave noise is above the threshold, which goes up towards the
+	// surface so only a few break through it
+	static constexpr float s_CaveThreshold = 0.55f;
+	static constexpr float s_CaveSurfaceThreshold = 0.06f; // added per block shallower than s_CaveSurfaceDepth
+	static constexpr int32_t s_CaveSurfaceDepth = 8;
+
+	// every noise gets seeds of its own, one per octave
+	enum class NoiseLayer : uint32_t { Temperature = 0, Humidity, Height, Caves, CaveDetail };
+
+	static uint32_t GetNoiseSeed(uint32_t worldSeed, NoiseLayer layer, uint32_t octave)
+	{
+		return worldSeed * 0x9e3779b1u + ((uint32_t)layer << 8 | octave) * 0x85ebca77u;
+	}
+
+	struct BiomeSpecification
+	{
+		// where the biome sits in climate space, the noises are mostly within [-0.5, 0.5]
+		float Temperature;
+		float Humidity;
+
+		// height in blocks is BaseHeight + HeightScale * noise, or ridged noise, which peaks
+		// along lines instead of in blobs
+		float BaseHeight;
+		float HeightScale;
+		bool Ridged;
+
+		BlockID Surface;
+		BlockID Filler; // the few blocks under the surface
+	};
+
+	static constexpr BiomeSpecification s_Biomes[(size_t)Biome::Count] = {
+		{ 0.05f,  0.4f,  -22.0f, 14.0f, false, SandBlock,  SandBlock }, // Ocean
+		{ 0.0f,   0.0f,    4.0f,  7.0f, false, GrassBlock, DirtBlock }, // Plains
+		{ 0.4f,  -0.3f,    3.0f,  6.0f, false, SandBlock,  SandBlock }, // Desert
+		{ -0.3f,  0.15f,  12.0f, 20.0f, false, GrassBlock, DirtBlock }, // Hills
+		{ -0.3f, -0.35f,  18.0f, 42.0f, true,  StoneBlock, StoneBlock } // Mountains
+	};
+
+	// how sharply biomes give way to one another, lower is sharper
+	static constexpr float s_BiomeBlend = 0.02f;
+
+	std::string_view BiomeToString(Biome biome)
+	{
+		switch (biome)
+		{
+			case Biome::Ocean:     return "Biome::Ocean";
+			case Biome::Plains:    return "Biome::Plains";
+			case Biome::Desert:    return "Biome::Desert";
+			case Biome::Hills:     return "Biome::Hills";
+			case Biome::Mountains: return "Biome::Mountains";
+
+			default: return "Biome::<Invalid>";
+		}
+
+		return "Biome::<Invalid>";
+	}
+
+	struct TerrainGenerator::Scratch
+	{
+		// per column, x fastest
+		std::vector<float> X, Z, OctaveX, OctaveZ, Octave;
+		std::vector<float> Temperature, Humidity, Height;
+		std::vector<int32_t> ColumnHeight;
+		std::vector<BlockID> ColumnSurface, ColumnFiller;
+
+		// the chunks of a column share it, so the last one is kept for the next chunk up or down
+		bool HasColumns = false;
+		uint32_t ColumnSeed = 0;
+		SimdLevel ColumnSimd = SimdLevel::Scalar;
+		int32_t ColumnX = 0, ColumnZ = 0;
+
+		// per block that might be carved out
+		std::vector<float> BlockX, BlockY, BlockZ, NoiseX, NoiseY, NoiseZ, Caves, CaveDetail, Thresholds;
+		std::vector<uint16_t> BlockIndices;
+		uint32_t BlockCount = 0;
+
+		std::vector<BlockID> Blocks;
+
+		Scratch()
+			: X(s_ColumnCount), Z(s_ColumnCount), OctaveX(s_ColumnCount), OctaveZ(s_ColumnCount), Octave(s_ColumnCount),
+			Temperature(s_ColumnCount), Humidity(s_ColumnCount), Height(s_ColumnCount),
+			ColumnHeight(s_ColumnCount), ColumnSurface(s_ColumnCount), ColumnFiller(s_ColumnCount),
+			BlockX(ChunkVolume), BlockY(ChunkVolume), BlockZ(ChunkVolume),
+			NoiseX(ChunkVolume), NoiseY(ChunkVolume), NoiseZ(ChunkVolume), Caves(ChunkVolume), CaveDetail(ChunkVolume), Thresholds(ChunkVolume),
+			BlockIndices(ChunkVolume), Blocks(ChunkVolume)
+		{
+		}
+	};
+
+	TerrainGenerator::TerrainGenerator(const TerrainSettings& settings, SimdLevel simd)
+		: m_Settings(settings), m_Simd(simd)
+	{
+	}
+
+	void TerrainGenerator::Generate(const ChunkCoord& coord, Chunk& outChunk) const
+	{
+		CUBED_PROFILE_ZONE("TerrainGenerator::Generate");
+
+		thread_local Scratch s_Scratch;
+		Scratch& scratch = s_Scratch;
+
+		GenerateColumns(coord, scratch);
+
+		int32_t bottom = coord.Y * (int32_t)ChunkSize;
+		int32_t highest = *std::max_element(scratch.ColumnHeight.begin(), scratch.ColumnHeight.end());
+		if (bottom > highest && bottom >= m_Settings.SeaLevel)
+		{
+			outChunk.Fill(AirBlock);
+			return;
+		}
+
+		// layers of blocks down from the surface, and the blocks caves might take
+		scratch.BlockCount = 0;
+		for (uint32_t z = 0; z < ChunkSize; z++)
+		{
+			for (uint32_t y = 0; y < ChunkSize; y++)
+			{
+				int32_t worldY = bottom + (int32_t)y;
+				for (uint32_t x = 0; x < ChunkSize; x++)
+				{
+					uint32_t column = x + z * ChunkSize;
+					uint32_t index = Chunk::GetIndex(x, y, z);
+					int32_t height = scratch.ColumnHeight[column];
+					if (worldY > height)
+					{
+						scratch.Blocks[index] = worldY < m_Settings.SeaLevel ? WaterBlock : AirBlock;
+						continue;
+					}
+
+					int32_t depth = height - worldY;
+					if (depth == 0)
+						scratch.Blocks[index] = scratch.ColumnSurface[column];
+					else if (depth < 4)
+						scratch.Blocks[index] = scratch.ColumnFiller[column];
+					else
+						scratch.Blocks[index] = StoneBlock;
+
+					if (height < m_Settings.SeaLevel && depth < s_SeaFloorDepth)
+						continue;
+
+					uint32_t block = scratch.BlockCount++;
+					scratch.BlockX[block] = scratch.X[column];
+					scratch.BlockY[block] = (float)worldY;
+					scratch.BlockZ[block] = scratch.Z[column];
+					scratch.Thresholds[block] = s_CaveThreshold + s_CaveSurfaceThreshold * (float)std::max(s_CaveSurfaceDepth - depth, 0);
+					scratch.BlockIndices[block] = (uint16_t)index;
+				}
+			}
+		}
+
+		// two octaves of 3D noise, squashed vertically so caves run more sideways than down
+		uint32_t count = scratch.BlockCount;
+		auto caveNoise = [&](NoiseLayer layer, float horizontal, float vertical, float* out)
+		{
+			for (uint32_t i = 0; i < count; i++)
+			{
+				scratch.NoiseX[i] = scratch.BlockX[i] * horizontal;
+				scratch.NoiseY[i] = scratch.BlockY[i] * vertical;
+				scratch.NoiseZ[i] = scratch.BlockZ[i] * horizontal;
+			}
+			SimplexNoise3D(GetNoiseSeed(m_Settings.Seed, layer, 0), scratch.NoiseX.data(), scratch.NoiseY.data(), scratch.NoiseZ.data(), out, count, m_Simd);
+		};
+		caveNoise(NoiseLayer::Caves, 1.0f / 48.0f, 1.0f / 24.0f, scratch.Caves.data());
+		caveNoise(NoiseLayer::CaveDetail, 1.0f / 16.0f, 1.0f / 12.0f, scratch.CaveDetail.data());
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (scratch.Caves[i] + 0.35f * scratch.CaveDetail[i] > scratch.Thresholds[i])
+				scratch.Blocks[scratch.BlockIndices[i]] = AirBlock;
+		}
+
+		outChunk.Pack(scratch.Blocks.data());
+	}
+
+	void TerrainGenerator::GenerateColumns(const ChunkCoord& coord, Scratch& scratch) const
+	{
+		if (scratch.HasColumns && scratch.ColumnSeed == m_Settings.Seed && scratch.ColumnSimd == m_Simd
+			&& scratch.ColumnX == coord.X && scratch.ColumnZ == coord.Z)
+			return;
+
+		for (uint32_t z = 0; z < ChunkSize; z++)
+		{
+			for (uint32_t x = 0; x < ChunkSize; x++)
+			{
+				scratch.X[x + z * ChunkSize] = (float)(coord.X * (int32_t)ChunkSize + (int32_t)x);
+				scratch.Z[x + z * ChunkSize] = (float)(coord.Z * (int32_t)ChunkSize + (int32_t)z);
+			}
+		}
+
+		FractalNoise2D((uint32_t)NoiseLayer::Temperature, 2, 1.0f / 600.0f, scratch, scratch.Temperature.data());
+		FractalNoise2D((uint32_t)NoiseLayer::Humidity, 2, 1.0f / 600.0f, scratch, scratch.Humidity.data());
+		FractalNoise2D((uint32_t)NoiseLayer::Height, 5, 1.0f / 200.0f, scratch, scratch.Height.data());
+
+		int32_t seaLevel = m_Settings.SeaLevel;
+		for (uint32_t column = 0; column < s_ColumnCount; column++)
+		{
+			// every biome's height, weighted by the inverse square of its squared distance in
+			// climate space. Never quite zero, so heights are smooth everywhere
+			float noise = scratch.Height[column];
+			float ridged = 1.0f - 2.0f * std::abs(noise);
+			float totalWeight = 0.0f, height = 0.0f, closest = INFINITY;
+			Biome biome = Biome::Plains;
+			for (uint32_t b = 0; b < (uint32_t)Biome::Count; b++)
+			{
+				const BiomeSpecification& spec = s_Biomes[b];
+				float dt = scratch.Temperature[column] - spec.Temperature;
+				float dh = scratch.Humidity[column] - spec.Humidity;
+				float distance = dt * dt + dh * dh;
+				float weight = 1.0f / ((distance + s_BiomeBlend) * (distance + s_BiomeBlend));
+
+				height += weight * (spec.BaseHeight + spec.HeightScale * (spec.Ridged ? ridged : noise));
+				totalWeight += weight;
+				if (distance < closest)
+				{
+					closest = distance;
+					biome = (Biome)b;
+				}
+			}
+
+			int32_t columnHeight = (int32_t)std::floor(height / totalWeight);
+			scratch.ColumnHeight[column] = columnHeight;
+
+			// whatever the biome, shores and sea floors are sand and high peaks bare
+			const BiomeSpecification& spec = s_Biomes[(size_t)biome];
+			BlockID surface = spec.Surface, filler = spec.Filler;
+			if (columnHeight <= seaLevel + 1)
+				surface = filler = SandBlock;
+			else if (columnHeight >= seaLevel + s_SnowLine)
+				surface = SnowBlock, filler = StoneBlock;
+			else if (columnHeight >= seaLevel + s_RockLine)
+				surface = filler = StoneBlock;
+
+			scratch.ColumnSurface[column] = surface;
+			scratch.ColumnFiller[column] = filler;
+		}
+
+		scratch.HasColumns = true;
+		scratch.ColumnSeed = m_Settings.Seed;
+		scratch.ColumnSimd = m_Simd;
+		scratch.ColumnX = coord.X;
+		scratch.ColumnZ = coord.Z;
+	}
+
+	void TerrainGenerator::FractalNoise2D(uint32_t layer, uint32_t octaves, float frequency, Scratch& scratch, float* out) const
+	{
+		std::fill(out, out + s_ColumnCount, 0.0f);
+
+		float amplitude = 1.0f, totalAmplitude = 0.0f;
+		for (uint32_t octave = 0; octave < octaves; octave++)
+		{
+			for (uint32_t i = 0; i < s_ColumnCount; i++)
+			{
+				scratch.OctaveX[i] = scratch.X[i] * frequency;
+				scratch.OctaveZ[i] = scratch.Z[i] * frequency;
+			}
+
+			uint32_t seed = GetNoiseSeed(m_Settings.Seed, (NoiseLayer)layer, octave);
+			SimplexNoise2D(seed, scratch.OctaveX.data(), scratch.OctaveZ.data(), scratch.Octave.data(), s_ColumnCount, m_Simd);
+			for (uint32_t i = 0; i < s_ColumnCount; i++)
+				out[i] += amplitude * scratch.Octave[i];
+
+			totalAmplitude += amplitude;
+			amplitude *= 0.5f;
+			frequency *= 2.0f;
+		}
+
+		for (uint32_t i = 0; i < s_ColumnCount; i++)
+			out[i] /= totalAmplitude;
+	}
+}
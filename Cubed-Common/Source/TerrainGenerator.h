@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+#include <string_view>
+
+#include "Chunk.h"
+#include "Noise.h"
+
+namespace Cubed
+{
+	// blocks the generator places, the client has placeholder textures for each
+	constexpr BlockID StoneBlock = 1;
+	constexpr BlockID GrassBlock = 2;
+	constexpr BlockID DirtBlock = 3;
+	constexpr BlockID SandBlock = 4;
+	constexpr BlockID SnowBlock = 5;
+	constexpr BlockID WaterBlock = 6;
+	constexpr BlockID BlockTypeCount = 7; // every valid block ID is below this
+
+	enum class Biome : uint8_t
+	{
+		Ocean = 0,
+		Plains,
+		Desert,
+		Hills,
+		Mountains,
+		Count
+	};
+
+	std::string_view BiomeToString(Biome biome);
+
+	struct TerrainSettings
+	{
+		uint32_t Seed = 0;
+		int32_t SeaLevel = 0; // empty blocks below it are water
+	};
+
+	//
+	// TerrainGenerator - builds chunks of terrain from noise
+	//
+	// Every column gets a temperature and humidity from two slow 2D noises, and each biome has
+	// a spot in that climate space. A column's height is a blend of every biome's height for
+	// it, weighted by how close its climate is to theirs, so biomes fade into one another
+	// instead of meeting at cliffs. The closest biome decides the blocks on top. Caves are
+	// carved out of the ground by 3D noise, which is the bulk of the work, every block below
+	// the surface needs it.
+	//
+	// Noise runs on the SIMD level given at construction, which only changes the speed: the
+	// same seed and coordinate give the same chunk on any level, on any machine (see Noise.h).
+	// Generate is const and keeps its scratch space per thread, so chunks can be generated on
+	// as many threads at once as there are.
+	//
+	class TerrainGenerator
+	{
+	public:
+		explicit TerrainGenerator(const TerrainSettings& settings = {}, SimdLevel simd = GetSupportedSimdLevel());
+
+		void Generate(const ChunkCoord& coord, Chunk& outChunk) const;
+
+		const TerrainSettings& GetSettings() const { return m_Settings; }
+		SimdLevel GetSimdLevel() const { return m_Simd; }
+	private:
+		struct Scratch;
+
+		// height and biome of every column of the chunk
+		void GenerateColumns(const ChunkCoord& coord, Scratch& scratch) const;
+		// sums octaves of 2D noise, each at twice the frequency and half the amplitude of the
+		// one before, scaled back to about [-1, 1]
+		void FractalNoise2D(uint32_t layer, uint32_t octaves, float frequency, Scratch& scratch, float* out) const;
+	private:
+		TerrainSettings m_Settings;
+		SimdLevel m_Simd;
+	};
+}
@@ -0,0 +1,193 @@
+#include "AllocationTest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "Walnut/Core/Log.h"
+
+#include "BenchmarkLayer.h"
+#include "JobSystem.h"
+#include "PacketBuffer.h"
+#include "ServerShard.h"
+
+// every allocation this executable makes goes through these, counting is one relaxed add,
+// cheap enough to leave in for the load test bots too
+static std::atomic<uint64_t> s_HeapAllocations = 0;
+
+void* operator new(std::size_t size)
+{
+	s_HeapAllocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* memory = std::malloc(size ? size : 1))
+		return memory;
+	throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	s_HeapAllocations.fetch_add(1, std::memory_order_relaxed);
+	size_t align = (size_t)alignment;
+#ifdef _MSC_VER
+	void* memory = _aligned_malloc(size ? size : 1, align);
+#else
+	void* memory = std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) & ~(align - 1));
+#endif
+	if (memory)
+		return memory;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+
+#ifdef _MSC_VER
+void operator delete(void* memory, std::align_val_t) noexcept { _aligned_free(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { _aligned_free(memory); }
+#else
+void operator delete(void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+#endif
+
+namespace Cubed
+{
+	static constexpr uint32_t s_PaceTicks = 120;   // players turn around this often
+	static constexpr uint32_t s_WarmupTicks = 1200; // a few rounds of pacing, every view has been as big as it gets
+	static constexpr uint32_t s_TickCount = 600;
+	static constexpr float s_ArenaSize = 1024.0f;
+
+	static uint64_t GetHeapAllocations()
+	{
+		return s_HeapAllocations.load(std::memory_order_relaxed);
+	}
+
+	AllocationTest::AllocationTest(uint32_t playerCount)
+		: m_PlayerCount(playerCount)
+	{
+	}
+
+	bool AllocationTest::Run()
+	{
+		struct Player
+		{
+			uint32_t Shard = 0;
+			uint32_t NextInputSequence = 1;
+			uint32_t TurnPhase = 0;
+			int8_t MoveX = 0;
+			int8_t MoveY = 0;
+		};
+
+		JobSystem jobs;
+		ShardLayout layout;
+		std::vector<ServerShard> shards;
+		shards.reserve(layout.ShardCount);
+		for (uint32_t i = 0; i < layout.ShardCount; i++)
+			shards.emplace_back(i, layout);
+
+		// client IDs are indices + 1
+		std::mt19937 random(BenchmarkSeed);
+		std::uniform_real_distribution<float> position(-s_ArenaSize * 0.5f, s_ArenaSize * 0.5f);
+		std::vector<Player> players(m_PlayerCount);
+		for (uint32_t i = 0; i < m_PlayerCount; i++)
+		{
+			ServerShard::Handoff handoff;
+			handoff.ClientID = i + 1;
+			handoff.Data = GetSpawnPlayerData();
+			handoff.Data.Position = { position(random), position(random) };
+			handoff.TargetShard = layout.GetShard(handoff.Data.Position);
+
+			Player& player = players[i];
+			player.Shard = handoff.TargetShard;
+			player.TurnPhase = random() % s_PaceTicks;
+			player.MoveX = (int8_t)(random() % 3) - 1;
+			player.MoveY = (int8_t)(random() % 3) - 1;
+			shards[handoff.TargetShard].AcceptHandoff(handoff);
+		}
+
+		ServerShard::SendContext context;
+		context.Shards = &shards;
+
+		uint64_t simulateAllocations = 0, gridAllocations = 0, sendAllocations = 0;
+		uint64_t packetAllocations = 0, handoffs = 0;
+		uint32_t allocatingTicks = 0;
+		uint64_t maxTickAllocations = 0;
+
+		for (uint32_t tick = 0; tick < s_WarmupTicks + s_TickCount; tick++)
+		{
+			// one input per player per tick, acknowledging the snapshot from the tick before
+			for (uint32_t i = 0; i < m_PlayerCount; i++)
+			{
+				// back and forth over the same ground, so the crowd keeps repeating itself
+				Player& player = players[i];
+				if ((tick + player.TurnPhase) % s_PaceTicks == 0)
+				{
+					player.MoveX = -player.MoveX;
+					player.MoveY = -player.MoveY;
+				}
+
+				InboundEvent event;
+				event.EventType = InboundEvent::Type::Input;
+				event.ClientID = i + 1;
+				event.AckedSnapshotID = context.SnapshotID;
+				event.InputCount = 1;
+				event.Inputs[0] = { player.NextInputSequence++, player.MoveX, player.MoveY };
+				shards[player.Shard].PushEvent(event);
+			}
+
+			context.SnapshotID++;
+			context.ServerTime = (uint32_t)((uint64_t)tick * 1000 / PlayerInputRate);
+
+			uint64_t start = GetHeapAllocations();
+			uint64_t packetStart = PacketBuffer::GetStatistics().HeapAllocations;
+
+			jobs.ParallelFor((uint32_t)shards.size(), [&shards](uint32_t i) { shards[i].Simulate(PlayerInputInterval); });
+			uint64_t tickHandoffs = 0;
+			for (ServerShard& shard : shards)
+			{
+				for (ServerShard::Handoff& handoff : shard.GetOutgoingHandoffs())
+				{
+					players[handoff.ClientID - 1].Shard = handoff.TargetShard;
+					shards[handoff.TargetShard].AcceptHandoff(handoff);
+				}
+				tickHandoffs += shard.GetOutgoingHandoffs().size();
+				shard.GetOutgoingHandoffs().clear();
+			}
+			uint64_t afterSimulate = GetHeapAllocations();
+
+			jobs.ParallelFor((uint32_t)shards.size(), [&shards](uint32_t i) { shards[i].BuildGrid(); });
+			uint64_t afterGrid = GetHeapAllocations();
+
+			jobs.ParallelFor((uint32_t)shards.size(), [&shards, &context](uint32_t i) { shards[i].SendSnapshots(context); });
+			uint64_t afterSend = GetHeapAllocations();
+
+			for (ServerShard& shard : shards)
+				shard.GetStatistics() = {};
+
+			if (tick < s_WarmupTicks)
+				continue;
+
+			simulateAllocations += afterSimulate - start;
+			gridAllocations += afterGrid - afterSimulate;
+			sendAllocations += afterSend - afterGrid;
+			packetAllocations += PacketBuffer::GetStatistics().HeapAllocations - packetStart;
+			maxTickAllocations = std::max(maxTickAllocations, afterSend - start);
+
+			handoffs += tickHandoffs;
+			if (afterSend != start)
+				allocatingTicks++;
+		}
+
+		WL_INFO_TAG("AllocationTest", "{} players over {} ticks: {} allocations simulating, {} building grids, {} building snapshots ({} of them packet buffers), at most {} in a tick",
+			m_PlayerCount, s_TickCount, simulateAllocations, gridAllocations, sendAllocations, packetAllocations, maxTickAllocations);
+		WL_INFO_TAG("AllocationTest", "{} players handed over to another shard, {} of {} ticks allocated",
+			handoffs, allocatingTicks, s_TickCount);
+
+		if (allocatingTicks > 0)
+			WL_ERROR_TAG("AllocationTest", "{} steady state ticks allocated!", allocatingTicks);
+
+		return allocatingTicks == 0;
+	}
+
+}
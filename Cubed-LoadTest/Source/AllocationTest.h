@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace Cubed
+{
+	//
+	// AllocationTest - counts heap allocations made by steady state server ticks
+	//
+	// Runs the server's shards in process, like Cubed-Server --tick-bench, and counts every
+	// operator new made while they simulate, rebuild their grids and build snapshots. The count
+	// comes from this executable replacing the global operator new, so it covers the
+	// containers and anything else that allocates, not just packet buffers. Players pace back
+	// and forth, crossing between shards as they go, and acknowledge every snapshot. Once a
+	// few rounds of that have let every view, ring slot and grid grow as big as it gets, no
+	// tick should allocate at all. Reports per phase, and fails if any tick did.
+	//
+	class AllocationTest
+	{
+	public:
+		AllocationTest(uint32_t playerCount);
+
+		bool Run();
+	private:
+		uint32_t m_PlayerCount;
+	};
+}
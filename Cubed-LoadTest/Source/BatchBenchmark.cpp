@@ -0,0 +1,127 @@
+#include "BatchBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "Walnut/Core/Log.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "BenchmarkLayer.h"
+#include "CubeBatch.h"
+
+namespace Cubed
+{
+	static constexpr uint32_t s_Views = 64;
+	static constexpr float s_LodDistance = 96.0f; // Renderer::CullingSettings default
+	static constexpr float s_CubeRadius = 0.8660254f;
+
+	BatchBenchmark::BatchBenchmark(uint32_t cubeCount)
+		: m_CubeCount(cubeCount)
+	{
+	}
+
+	bool BatchBenchmark::Run()
+	{
+		struct Cube
+		{
+			glm::vec3 Position;
+			glm::vec3 Rotation;
+			uint32_t Material;
+		};
+
+		// spread out like players around the camera
+		std::mt19937 random(BenchmarkSeed);
+		std::uniform_real_distribution<float> position(-256.0f, 256.0f);
+		std::uniform_real_distribution<float> height(0.0f, 32.0f);
+		std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+		std::vector<Cube> cubes(m_CubeCount);
+		for (Cube& cube : cubes)
+		{
+			cube.Position = { position(random), height(random), position(random) };
+			cube.Rotation = { angle(random), angle(random), angle(random) };
+			cube.Material = random() % 16;
+		}
+
+		// same projection as the client renderer
+		glm::mat4 projection = glm::perspectiveFov(glm::radians(45.0f), 1600.0f, 900.0f, 0.1f, 1000.0f);
+		glm::vec3 cameraPosition(0.0f, 10.0f, 0.0f);
+
+		CubeBatch batch;
+		std::vector<CubeInstance> instances(m_CubeCount); // stands in for the mapped arena
+		float submitTime = 0.0f, cullTime = 0.0f, writeTime = 0.0f, unculledTime = 0.0f;
+		uint64_t visibleCubes = 0, lowDetailCubes = 0;
+		uint32_t mismatches = 0;
+
+		using Clock = std::chrono::steady_clock;
+		auto elapsed = [](Clock::time_point start) { return std::chrono::duration<float, std::milli>(Clock::now() - start).count(); };
+
+		for (uint32_t view = 0; view < s_Views; view++)
+		{
+			glm::mat4 cameraTransform = glm::translate(glm::mat4(1.0f), cameraPosition)
+				* glm::rotate(glm::mat4(1.0f), glm::radians(360.0f * view / s_Views), glm::vec3(0.0f, 1.0f, 0.0f));
+			Frustum frustum = Frustum::FromViewProjection(projection * glm::inverse(cameraTransform));
+
+			Clock::time_point start = Clock::now();
+			batch.Clear();
+			for (const Cube& cube : cubes)
+				batch.Add(cube.Position, cube.Rotation, cube.Material);
+			submitTime += elapsed(start);
+
+			start = Clock::now();
+			uint32_t visibleCount = batch.Cull(&frustum);
+			cullTime += elapsed(start);
+
+			start = Clock::now();
+			uint32_t lowDetailCount = batch.WriteInstances(instances.data(), cameraPosition, s_LodDistance);
+			writeTime += elapsed(start);
+
+			visibleCubes += visibleCount;
+			lowDetailCubes += lowDetailCount;
+
+			// one cube at a time, the instances have to come out in submission order with the right detail
+			uint32_t written = 0, lowDetail = 0;
+			for (const Cube& cube : cubes)
+			{
+				if (!frustum.IsSphereVisible(cube.Position, s_CubeRadius))
+					continue;
+
+				glm::vec3 offset = cube.Position - cameraPosition;
+				lowDetail += glm::dot(offset, offset) >= s_LodDistance * s_LodDistance;
+				if (written < visibleCount)
+				{
+					const CubeInstance& instance = instances[written];
+					mismatches += glm::vec3(instance.Transform[3]) != cube.Position || instance.Material != cube.Material;
+				}
+				written++;
+			}
+			mismatches += written != visibleCount || lowDetail != lowDetailCount;
+
+			// what the same frame costs with culling turned off
+			start = Clock::now();
+			batch.Cull(nullptr);
+			batch.WriteInstances(instances.data(), cameraPosition, s_LodDistance);
+			unculledTime += elapsed(start);
+		}
+
+		float perCube = 1e6f / ((float)s_Views * std::max(m_CubeCount, 1u)); // ms per view -> ns per cube
+		float perVisible = 1e6f / (float)std::max<uint64_t>(visibleCubes, 1);
+		float instanceBytes = (float)visibleCubes * sizeof(CubeInstance);
+		float culledTime = cullTime + writeTime;
+		WL_INFO_TAG("BatchBenchmark", "{} cubes, {} views, {:.1f}% visible, {:.1f}% of those past the detail distance",
+			m_CubeCount, s_Views, 100.0f * visibleCubes / ((float)s_Views * m_CubeCount), 100.0f * lowDetailCubes / std::max<uint64_t>(visibleCubes, 1));
+		WL_INFO_TAG("BatchBenchmark", "submit {:.3f}ms per view ({:.2f}ns per cube), cull {:.3f}ms ({:.2f}ns per cube), write instances {:.3f}ms ({:.2f}ns per visible cube, {:.0f}MB/s)",
+			submitTime / s_Views, submitTime * perCube, cullTime / s_Views, cullTime * perCube,
+			writeTime / s_Views, writeTime * perVisible, instanceBytes / (writeTime * 1000.0f));
+		WL_INFO_TAG("BatchBenchmark", "cull and write {:.3f}ms per view, without culling {:.3f}ms, culling saves {:.0f}%",
+			culledTime / s_Views, unculledTime / s_Views, 100.0f * (1.0f - culledTime / std::max(unculledTime, 1e-6f)));
+
+		if (mismatches > 0)
+			WL_ERROR_TAG("BatchBenchmark", "instances disagree with culling one cube at a time in {} places!", mismatches);
+
+		return mismatches == 0;
+	}
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace Cubed
+{
+	//
+	// BatchBenchmark - times the CPU side of drawing a batch of cubes
+	//
+	// Runs CubeBatch, which is everything Renderer::FlushBatch does before it records the draw:
+	// submitting the cubes, culling them, and writing an instance for each one that's left.
+	// Cubes are scattered around a camera that turns a full circle over the run, same as the
+	// cull benchmark, and the instances go to plain memory standing in for the mapped arena.
+	// The whole thing is timed again with culling off, to see what culling saves. Every view's
+	// instances are checked against culling and detail picked one cube at a time.
+	//
+	class BatchBenchmark
+	{
+	public:
+		BatchBenchmark(uint32_t cubeCount);
+
+		bool Run();
+	private:
+		uint32_t m_CubeCount;
+	};
+}
@@ -0,0 +1,222 @@
+#include "CompressionBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#include "Walnut/Core/Log.h"
+#include "Walnut/Serialization/BufferStream.h"
+
+#include "BenchmarkLayer.h"
+#include "ChunkCompression.h"
+
+using namespace Walnut;
+
+namespace Cubed
+{
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr BlockID s_StoneBlock = 1;
+	static constexpr BlockID s_DirtBlock = 2;
+	static constexpr BlockID s_GrassBlock = 3;
+	static constexpr BlockID s_OreBlock = 4;
+
+	// cheap lattice value noise in [0, 1], good enough for hills and cave-ish blobs
+	static float HashLattice(int32_t x, int32_t y, int32_t z)
+	{
+		uint32_t h = (uint32_t)x * 374761393u + (uint32_t)y * 668265263u + (uint32_t)z * 2147483647u;
+		h = (h ^ (h >> 13)) * 1274126177u;
+		return (float)((h ^ (h >> 16)) & 0xffffff) / (float)0xffffff;
+	}
+
+	static float ValueNoise(float x, float y, float z)
+	{
+		int32_t ix = (int32_t)std::floor(x), iy = (int32_t)std::floor(y), iz = (int32_t)std::floor(z);
+		auto smooth = [](float t) { return t * t * (3.0f - 2.0f * t); };
+		float fx = smooth(x - ix), fy = smooth(y - iy), fz = smooth(z - iz);
+
+		auto lerp = [](float a, float b, float t) { return a + (b - a) * t; };
+		float x00 = lerp(HashLattice(ix, iy, iz), HashLattice(ix + 1, iy, iz), fx);
+		float x10 = lerp(HashLattice(ix, iy + 1, iz), HashLattice(ix + 1, iy + 1, iz), fx);
+		float x01 = lerp(HashLattice(ix, iy, iz + 1), HashLattice(ix + 1, iy, iz + 1), fx);
+		float x11 = lerp(HashLattice(ix, iy + 1, iz + 1), HashLattice(ix + 1, iy + 1, iz + 1), fx);
+		return lerp(lerp(x00, x10, fy), lerp(x01, x11, fy), fz);
+	}
+
+	static float MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+	}
+
+	CompressionBenchmark::CompressionBenchmark(uint32_t chunkCount)
+		: m_ChunkCount(chunkCount)
+	{
+	}
+
+	bool CompressionBenchmark::Run()
+	{
+		WL_INFO_TAG("CompressionBenchmark", "Compressing {} chunks of {}^3 blocks per world", m_ChunkCount, ChunkSize);
+
+		GenerateWorld(WorldType::Flat);
+		CompressWorld("flat");
+
+		GenerateWorld(WorldType::Hills);
+		CompressWorld("hills");
+
+		GenerateWorld(WorldType::Caves);
+		CompressWorld("caves");
+
+		GenerateWorld(WorldType::Random);
+		CompressWorld("random");
+
+		return true;
+	}
+
+	void CompressionBenchmark::GenerateWorld(WorldType type)
+	{
+		m_Chunks.assign(m_ChunkCount, Chunk());
+
+		std::mt19937 random(BenchmarkSeed);
+		std::vector<BlockID> blocks(ChunkVolume);
+
+		// columns of 4 chunks around the surface at y = 0, laid out along a square
+		constexpr int32_t columnHeight = 4;
+		int32_t columns = (int32_t)((m_ChunkCount + columnHeight - 1) / columnHeight);
+		int32_t side = std::max((int32_t)std::ceil(std::sqrt((float)columns)), 1);
+
+		for (uint32_t c = 0; c < m_ChunkCount; c++)
+		{
+			int32_t column = (int32_t)c / columnHeight;
+			int32_t cx = column % side, cz = column / side, cy = (int32_t)c % columnHeight - columnHeight / 2;
+
+			for (uint32_t z = 0; z < ChunkSize; z++)
+			{
+				for (uint32_t x = 0; x < ChunkSize; x++)
+				{
+					int32_t worldX = cx * (int32_t)ChunkSize + (int32_t)x;
+					int32_t worldZ = cz * (int32_t)ChunkSize + (int32_t)z;
+					int32_t surface = 0;
+					if (type == WorldType::Hills)
+						surface = (int32_t)((ValueNoise(worldX / 48.0f, 0.0f, worldZ / 48.0f) - 0.5f) * 48.0f);
+
+					for (uint32_t y = 0; y < ChunkSize; y++)
+					{
+						int32_t worldY = cy * (int32_t)ChunkSize + (int32_t)y;
+
+						BlockID block = AirBlock;
+						switch (type)
+						{
+						case WorldType::Flat:
+						case WorldType::Hills:
+							if (worldY < surface - 4)
+								block = random() % 64 == 0 ? s_OreBlock : s_StoneBlock;
+							else if (worldY < surface - 1)
+								block = s_DirtBlock;
+							else if (worldY < surface)
+								block = s_GrassBlock;
+							break;
+						case WorldType::Caves:
+							if (worldY < 0 && ValueNoise(worldX / 16.0f, worldY / 12.0f, worldZ / 16.0f) * 0.7f
+								+ ValueNoise(worldX / 5.0f, worldY / 5.0f, worldZ / 5.0f) * 0.3f < 0.55f)
+								block = worldY < -3 ? s_StoneBlock : s_DirtBlock;
+							break;
+						case WorldType::Random:
+							// worst case, nothing runs and every block is its own palette entry
+							block = (BlockID)(random() % 4096);
+							break;
+						}
+						blocks[Chunk::GetIndex(x, y, z)] = block;
+					}
+				}
+			}
+
+			m_Chunks[c].Pack(blocks.data());
+		}
+	}
+
+	void CompressionBenchmark::CompressWorld(const char* name)
+	{
+		struct Codec
+		{
+			const char* Name;
+			bool Plain; // the chunk format from Chunk.h, as a baseline
+			ChunkCodec Type;
+		};
+		const Codec codecs[] = {
+			{ "plain", true, ChunkCodec::Runs },
+			{ "runs", false, ChunkCodec::Runs },
+			{ "runs+lz", false, ChunkCodec::RunsLZ }
+		};
+
+		// allocated up front, so the first codec isn't paying for page faults
+		std::vector<std::vector<uint8_t>> compressed(m_Chunks.size(), std::vector<uint8_t>(MaxCompressedChunkSize));
+		std::vector<uint64_t> compressedSizes(m_Chunks.size());
+		std::vector<float> decodeTimes(m_Chunks.size());
+
+		float rawMegabytes = (float)m_Chunks.size() * ChunkVolume * sizeof(BlockID) / (1024.0f * 1024.0f);
+		uint64_t plainBytes = 0;
+
+		for (const Codec& codec : codecs)
+		{
+			// encode everything first, so decoding isn't sharing the cache with the encoder
+			Clock::time_point start = Clock::now();
+			for (size_t i = 0; i < m_Chunks.size(); i++)
+			{
+				const Chunk& chunk = m_Chunks[i];
+				if (codec.Plain)
+				{
+					BufferStreamWriter stream(Buffer(compressed[i].data(), compressed[i].size()));
+					chunk.Serialize(stream);
+					compressedSizes[i] = chunk.GetSerializedSize();
+				}
+				else
+				{
+					compressedSizes[i] = CompressChunk(chunk, codec.Type, compressed[i].data());
+				}
+			}
+			float encodeTime = MillisecondsSince(start);
+
+			Chunk decoded;
+			std::vector<BlockID> original(ChunkVolume), result(ChunkVolume);
+			uint32_t mismatches = 0;
+			float decodeTime = 0.0f;
+			uint64_t totalBytes = 0;
+			for (size_t i = 0; i < m_Chunks.size(); i++)
+			{
+				Clock::time_point decodeStart = Clock::now();
+				bool valid;
+				if (codec.Plain)
+				{
+					BufferStreamReader stream(Buffer(compressed[i].data(), compressedSizes[i]));
+					valid = decoded.Deserialize(stream);
+				}
+				else
+				{
+					valid = DecompressChunk(compressed[i].data(), compressedSizes[i], decoded);
+				}
+				decodeTimes[i] = MillisecondsSince(decodeStart);
+				decodeTime += decodeTimes[i];
+				totalBytes += compressedSizes[i];
+
+				m_Chunks[i].Unpack(original.data());
+				decoded.Unpack(result.data());
+				if (!valid || original != result)
+					mismatches++;
+			}
+
+			if (codec.Plain)
+				plainBytes = totalBytes;
+
+			std::sort(decodeTimes.begin(), decodeTimes.end());
+			float p99 = decodeTimes.empty() ? 0.0f : decodeTimes[(size_t)(0.99f * (decodeTimes.size() - 1))];
+
+			float megabytes = totalBytes / (1024.0f * 1024.0f);
+			WL_INFO_TAG("CompressionBenchmark", "{} {}: {:.2f}MB, {:.1f}:1 against raw blocks, {:.1f}:1 against plain, {:.0f} bytes per chunk",
+				name, codec.Name, megabytes, rawMegabytes / std::max(megabytes, 1e-6f), (float)plainBytes / std::max<uint64_t>(totalBytes, 1),
+				(float)totalBytes / std::max<size_t>(m_Chunks.size(), 1));
+			WL_INFO_TAG("CompressionBenchmark", "{} {}: encode {:.0f}MB/s, decode {:.0f}MB/s, decode p99 {:.1f}us per chunk, {} mismatched",
+				name, codec.Name, rawMegabytes / (encodeTime / 1000.0f), rawMegabytes / (decodeTime / 1000.0f), p99 * 1000.0f, mismatches);
+		}
+	}
+}
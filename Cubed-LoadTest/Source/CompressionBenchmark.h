@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "Chunk.h"
+
+namespace Cubed
+{
+	//
+	// CompressionBenchmark - times chunk compression on a few generated worlds
+	//
+	// Every chunk of each world is compressed with each codec and decompressed again, and the
+	// result checked against the original. Reports the compression ratio against raw 16 bit
+	// blocks and against the plain chunk format, and encode and decode speeds in MB/s of raw
+	// blocks, which is what the network thread has to keep up with.
+	//
+	class CompressionBenchmark
+	{
+	public:
+		CompressionBenchmark(uint32_t chunkCount);
+
+		bool Run();
+	private:
+		enum class WorldType { Flat = 0, Hills, Caves, Random };
+
+		void GenerateWorld(WorldType type);
+		void CompressWorld(const char* name);
+	private:
+		uint32_t m_ChunkCount;
+		std::vector<Chunk> m_Chunks;
+	};
+}
@@ -0,0 +1,91 @@
+#include "CullBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#include "Walnut/Core/Log.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "BenchmarkLayer.h"
+
+namespace Cubed
+{
+	static constexpr uint32_t s_Views = 64;
+
+	CullBenchmark::CullBenchmark(uint32_t objectCount)
+		: m_ObjectCount(objectCount)
+	{
+	}
+
+	bool CullBenchmark::Run()
+	{
+		std::mt19937 random(BenchmarkSeed);
+		std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+		std::uniform_real_distribution<float> height(-50.0f, 50.0f);
+		std::uniform_real_distribution<float> size(0.5f, 32.0f);
+
+		for (uint32_t i = 0; i < m_ObjectCount; i++)
+		{
+			glm::vec3 center(position(random), height(random), position(random));
+			glm::vec3 extent = glm::vec3(size(random), size(random), size(random)) * 0.5f;
+
+			m_Boxes.Add(center - extent, center + extent);
+			m_BoxMin.push_back(center - extent);
+			m_BoxMax.push_back(center + extent);
+			m_Spheres.Add(center, glm::length(extent));
+		}
+
+		// same projection as the client renderer
+		glm::mat4 projection = glm::perspectiveFov(glm::radians(45.0f), 1600.0f, 900.0f, 0.1f, 1000.0f);
+
+		std::vector<uint8_t> visibility(m_ObjectCount);
+		float boxTime = 0.0f, sphereTime = 0.0f, scalarTime = 0.0f;
+		uint64_t visibleBoxes = 0, visibleSpheres = 0;
+		uint32_t mismatches = 0;
+
+		using Clock = std::chrono::steady_clock;
+		auto elapsed = [](Clock::time_point start) { return std::chrono::duration<float, std::milli>(Clock::now() - start).count(); };
+
+		for (uint32_t view = 0; view < s_Views; view++)
+		{
+			glm::mat4 cameraTransform = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 10.0f, 0.0f))
+				* glm::rotate(glm::mat4(1.0f), glm::radians(360.0f * view / s_Views), glm::vec3(0.0f, 1.0f, 0.0f));
+			Frustum frustum = Frustum::FromViewProjection(projection * glm::inverse(cameraTransform));
+
+			Clock::time_point start = Clock::now();
+			visibleSpheres += frustum.CullSpheres(m_Spheres, visibility.data());
+			sphereTime += elapsed(start);
+
+			start = Clock::now();
+			visibleBoxes += frustum.CullBoxes(m_Boxes, visibility.data());
+			boxTime += elapsed(start);
+
+			// one at a time, this is what the batch has to beat (and agree with)
+			start = Clock::now();
+			uint32_t scalarVisible = 0;
+			for (uint32_t i = 0; i < m_ObjectCount; i++)
+			{
+				bool visible = frustum.IsBoxVisible(m_BoxMin[i], m_BoxMax[i]);
+				scalarVisible += visible;
+				mismatches += visible != (bool)visibility[i];
+			}
+			scalarTime += elapsed(start);
+		}
+
+		float perObject = 1e6f / ((float)s_Views * std::max(m_ObjectCount, 1u)); // ms per view -> ns per object
+		WL_INFO_TAG("CullBenchmark", "{} objects, {} views, {:.1f}% of boxes and {:.1f}% of spheres visible",
+			m_ObjectCount, s_Views, 100.0f * visibleBoxes / ((float)s_Views * m_ObjectCount),
+			100.0f * visibleSpheres / ((float)s_Views * m_ObjectCount));
+		WL_INFO_TAG("CullBenchmark", "boxes: {:.3f}ms per view ({:.2f}ns per object), one at a time {:.3f}ms ({:.2f}ns per object)",
+			boxTime / s_Views, boxTime * perObject, scalarTime / s_Views, scalarTime * perObject);
+		WL_INFO_TAG("CullBenchmark", "spheres: {:.3f}ms per view ({:.2f}ns per object)", sphereTime / s_Views, sphereTime * perObject);
+
+		if (mismatches > 0)
+			WL_ERROR_TAG("CullBenchmark", "batch and one at a time culling disagree on {} objects!", mismatches);
+
+		return mismatches == 0;
+	}
+
+}
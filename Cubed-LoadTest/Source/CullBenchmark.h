@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "Frustum.h"
+
+namespace Cubed
+{
+	//
+	// CullBenchmark - times frustum culling of a lot of boxes and spheres
+	//
+	// Objects are scattered around a camera that turns a full circle over the run, so about
+	// as many end up visible as in game. The batch culling is timed against testing each
+	// object on its own, and both have to agree on every object.
+	//
+	class CullBenchmark
+	{
+	public:
+		CullBenchmark(uint32_t objectCount);
+
+		bool Run();
+	private:
+		uint32_t m_ObjectCount;
+
+		BoxBatch m_Boxes;
+		SphereBatch m_Spheres;
+		std::vector<glm::vec3> m_BoxMin, m_BoxMax;
+
+	};
+}
@@ -0,0 +1,166 @@
+#include "EntityBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "Walnut/Core/Log.h"
+#include "Walnut/Serialization/BufferStream.h"
+
+#include "BenchmarkLayer.h"
+#include "EntityStore.h"
+
+using namespace Walnut;
+
+namespace Cubed
+{
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr uint32_t s_Passes = 200;
+	static constexpr float s_TimeStep = 1.0f / 60.0f;
+
+	static float NanosecondsPerEntity(Clock::time_point start, uint64_t entities)
+	{
+		return std::chrono::duration<float, std::nano>(Clock::now() - start).count() / std::max<uint64_t>(entities, 1);
+	}
+
+	EntityBenchmark::EntityBenchmark(uint32_t entityCount)
+		: m_EntityCount(entityCount)
+	{
+	}
+
+	bool EntityBenchmark::Run()
+	{
+		WL_INFO_TAG("EntityBenchmark", "{} players, {} passes each", m_EntityCount, s_Passes);
+
+		// IDs are sparse like client IDs
+		std::mt19937 random(BenchmarkSeed);
+		std::uniform_real_distribution<float> distribution(-512.0f, 512.0f);
+		auto makePlayer = [&]() { return PlayerData{ { distribution(random), distribution(random) }, { distribution(random), distribution(random) } }; };
+
+		// the first half of the IDs start out in game, the second half join later
+		std::vector<uint32_t> ids((size_t)m_EntityCount * 2);
+		std::iota(ids.begin(), ids.end(), 1);
+		std::shuffle(ids.begin(), ids.end(), random);
+		std::vector<uint32_t> joining(ids.begin() + m_EntityCount, ids.end());
+		ids.resize(m_EntityCount);
+
+		std::map<uint32_t, PlayerData> map;
+		EntityStore store;
+		for (uint32_t id : ids)
+		{
+			PlayerData data = makePlayer();
+			map[id] = data;
+			store.Insert(id, data);
+		}
+
+		// half the players leave and others join, every node allocated in between the ones left
+		for (uint32_t i = 0; i < m_EntityCount; i += 2)
+		{
+			map.erase(ids[i]);
+			store.Remove(ids[i]);
+
+			ids[i] = joining[i];
+			PlayerData data = makePlayer();
+			map[ids[i]] = data;
+			store.Insert(ids[i], data);
+		}
+
+		uint64_t entities = (uint64_t)s_Passes * map.size();
+
+		// movement, one pass over every player
+		Clock::time_point start = Clock::now();
+		for (uint32_t pass = 0; pass < s_Passes; pass++)
+		{
+			for (auto& [id, data] : map)
+				data.Position += data.Velocity * s_TimeStep;
+		}
+		float mapIterate = NanosecondsPerEntity(start, entities);
+
+		start = Clock::now();
+		for (uint32_t pass = 0; pass < s_Passes; pass++)
+		{
+			std::vector<glm::vec2>& positions = store.GetPositions();
+			const std::vector<glm::vec2>& velocities = store.GetVelocities();
+			for (size_t i = 0; i < positions.size(); i++)
+				positions[i] += velocities[i] * s_TimeStep;
+		}
+		float storeIterate = NanosecondsPerEntity(start, entities);
+
+		// lookups by ID, in an order unrelated to either container's
+		std::vector<uint32_t> lookups(ids);
+		std::shuffle(lookups.begin(), lookups.end(), random);
+		uint64_t lookupCount = (uint64_t)s_Passes * lookups.size();
+
+		float mapSum = 0.0f;
+		start = Clock::now();
+		for (uint32_t pass = 0; pass < s_Passes; pass++)
+		{
+			for (uint32_t id : lookups)
+				mapSum += map.find(id)->second.Position.x;
+		}
+		float mapLookup = NanosecondsPerEntity(start, lookupCount);
+
+		float storeSum = 0.0f;
+		start = Clock::now();
+		for (uint32_t pass = 0; pass < s_Passes; pass++)
+		{
+			for (uint32_t id : lookups)
+				storeSum += store.GetPositions()[store.GetIndex(id)].x;
+		}
+		float storeLookup = NanosecondsPerEntity(start, lookupCount);
+
+		// serialization of everyone, both land in the same sized buffer
+		size_t count = store.Size();
+		std::vector<uint8_t> mapBytes(sizeof(uint32_t) + count * (sizeof(uint32_t) + sizeof(PlayerData)));
+		std::vector<uint8_t> storeBytes(mapBytes.size());
+		uint64_t mapSize = 0, storeSize = 0;
+
+		start = Clock::now();
+		for (uint32_t pass = 0; pass < s_Passes; pass++)
+		{
+			BufferStreamWriter stream(Buffer(mapBytes.data(), mapBytes.size()));
+			stream.WriteMap(map);
+			mapSize = stream.GetStreamPosition();
+		}
+		float mapSerialize = NanosecondsPerEntity(start, entities);
+
+		start = Clock::now();
+		for (uint32_t pass = 0; pass < s_Passes; pass++)
+		{
+			BufferStreamWriter stream(Buffer(storeBytes.data(), storeBytes.size()));
+			stream.WriteRaw<uint32_t>((uint32_t)count);
+			stream.WriteData((const char*)store.GetIDs().data(), count * sizeof(uint32_t));
+			stream.WriteData((const char*)store.GetPositions().data(), count * sizeof(glm::vec2));
+			stream.WriteData((const char*)store.GetVelocities().data(), count * sizeof(glm::vec2));
+			stream.WriteData((const char*)store.GetRotations().data(), count * sizeof(glm::vec3));
+			storeSize = stream.GetStreamPosition();
+		}
+		float storeSerialize = NanosecondsPerEntity(start, entities);
+
+		// both moved the same players the same way, so they have to agree
+		uint32_t mismatches = 0;
+		for (const auto& [id, data] : map)
+		{
+			size_t index = store.GetIndex(id);
+			if (index == SIZE_MAX || store.GetPositions()[index] != data.Position)
+				mismatches++;
+		}
+
+		WL_INFO_TAG("EntityBenchmark", "iterate: map {:.2f}ns per player, store {:.2f}ns per player, {:.1f}x",
+			mapIterate, storeIterate, mapIterate / std::max(storeIterate, 1e-6f));
+		WL_INFO_TAG("EntityBenchmark", "lookup: map {:.2f}ns, store {:.2f}ns, {:.1f}x",
+			mapLookup, storeLookup, mapLookup / std::max(storeLookup, 1e-6f));
+		WL_INFO_TAG("EntityBenchmark", "serialize: map {:.2f}ns per player ({} bytes), store {:.2f}ns per player ({} bytes), {:.1f}x",
+			mapSerialize, mapSize, storeSerialize, storeSize, mapSerialize / std::max(storeSerialize, 1e-6f));
+
+		if (mismatches > 0 || mapSum != storeSum)
+			WL_ERROR_TAG("EntityBenchmark", "map and store disagree on {} players!", mismatches);
+
+		return mismatches == 0 && mapSum == storeSum;
+	}
+
+}
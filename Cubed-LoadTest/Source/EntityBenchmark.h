@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace Cubed
+{
+	//
+	// EntityBenchmark - times EntityStore against the std::map it replaced
+	//
+	// Both hold the same players, inserted in random order and then churned through a round of
+	// removes and inserts so the map's nodes end up scattered like they do on a live server.
+	// Times a movement pass over every player, looking players up by ID, and serializing
+	// everyone: the map the way it used to be sent, entry by entry with WriteMap, and the store
+	// as one bulk copy per dense array.
+	//
+	class EntityBenchmark
+	{
+	public:
+		EntityBenchmark(uint32_t entityCount);
+
+		bool Run();
+	private:
+		uint32_t m_EntityCount;
+	};
+}
@@ -0,0 +1,122 @@
+#include "Walnut/Application.h"
+#include "Walnut/EntryPoint.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <string_view>
+
+#include "LoadTestLayer.h"
+#include "BenchmarkLayer.h"
+#include "MeshBenchmark.h"
+#include "CullBenchmark.h"
+#include "CompressionBenchmark.h"
+#include "TerrainBenchmark.h"
+#include "QueueBenchmark.h"
+#include "EntityBenchmark.h"
+#include "AllocationTest.h"
+#include "ScalingBenchmark.h"
+#include "BatchBenchmark.h"
+#include "ProfilerBenchmark.h"
+
+// options that run one benchmark or test instead of the load test
+static constexpr Cubed::BenchmarkMode s_BenchmarkModes[] = {
+	{ "--mesh-bench", Cubed::CreateBenchmark<Cubed::MeshBenchmark> },
+	{ "--cull-bench", Cubed::CreateBenchmark<Cubed::CullBenchmark> },
+	{ "--compress-bench", Cubed::CreateBenchmark<Cubed::CompressionBenchmark> },
+	{ "--terrain-bench", Cubed::CreateBenchmark<Cubed::TerrainBenchmark> },
+	{ "--queue-bench", Cubed::CreateBenchmark<Cubed::QueueBenchmark> },
+	{ "--entity-bench", Cubed::CreateBenchmark<Cubed::EntityBenchmark> },
+	{ "--alloc-test", Cubed::CreateBenchmark<Cubed::AllocationTest> },
+	{ "--scaling-bench", Cubed::CreateBenchmark<Cubed::ScalingBenchmark> },
+	{ "--batch-bench", Cubed::CreateBenchmark<Cubed::BatchBenchmark> },
+	{ "--profiler-bench", Cubed::CreateBenchmark<Cubed::ProfilerBenchmark> },
+};
+
+// Cubed-LoadTest [--server <ip:port>] [--bots <n>] [--rate <hz>] [--connect-rate <n/s>]
+//                [--duration <s>] [--report <s>] [--arena <size>]
+// Cubed-LoadTest --mesh-bench <world size in chunks>
+// Cubed-LoadTest --cull-bench <object count>
+// Cubed-LoadTest --compress-bench <chunks per world>
+// Cubed-LoadTest --terrain-bench <chunk count>
+// Cubed-LoadTest --queue-bench <updates per producer>
+// Cubed-LoadTest --entity-bench <player count>
+// Cubed-LoadTest --alloc-test <player count>
+// Cubed-LoadTest --scaling-bench <players per thread>
+// Cubed-LoadTest --batch-bench <cube count>
+// Cubed-LoadTest --profiler-bench <zone count>
+static bool ParseArguments(int argc, char** argv, Cubed::LoadTestSettings& settings, const Cubed::BenchmarkMode*& outBenchmark, uint32_t& outBenchmarkValue)
+{
+	auto parse = [](std::string_view value, auto& out)
+	{
+		auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), out);
+		return error == std::errc() && end == value.data() + value.size();
+	};
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string_view option = argv[i];
+		if (i + 1 >= argc)
+		{
+			std::cerr << "Missing value for " << option << std::endl;
+			return false;
+		}
+
+		std::string_view value = argv[++i];
+		auto benchmark = std::find_if(std::begin(s_BenchmarkModes), std::end(s_BenchmarkModes),
+			[option](const Cubed::BenchmarkMode& mode) { return mode.Option == option; });
+
+		bool valid = true;
+		if (benchmark != std::end(s_BenchmarkModes))
+		{
+			outBenchmark = benchmark;
+			valid = parse(value, outBenchmarkValue) && outBenchmarkValue > 0;
+		}
+		else if (option == "--server")
+			settings.ServerAddress = value;
+		else if (option == "--bots")
+			valid = parse(value, settings.BotCount);
+		else if (option == "--rate")
+			valid = parse(value, settings.UpdateRate) && settings.UpdateRate > 0;
+		else if (option == "--connect-rate")
+			valid = parse(value, settings.ConnectRate) && settings.ConnectRate > 0;
+		else if (option == "--duration")
+			valid = parse(value, settings.Duration);
+		else if (option == "--report")
+			valid = parse(value, settings.ReportInterval);
+		else if (option == "--arena")
+			valid = parse(value, settings.ArenaSize);
+		else
+			valid = false;
+
+		if (!valid)
+		{
+			std::cerr << "Invalid option " << option << ' ' << value << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+Walnut::Application* Walnut::CreateApplication(int argc, char** argv)
+{
+	Cubed::LoadTestSettings settings;
+	const Cubed::BenchmarkMode* benchmark = nullptr;
+	uint32_t benchmarkValue = 0;
+	if (!ParseArguments(argc, argv, settings, benchmark, benchmarkValue))
+		std::exit(1);
+
+	Walnut::ApplicationSpecification spec;
+	spec.Name = "Cubed Load Test";
+
+	Walnut::Application* app = new Walnut::Application(spec);
+	if (benchmark)
+		app->PushLayer(std::make_shared<Cubed::BenchmarkLayer>(benchmark->Create(benchmarkValue)));
+	else
+		app->PushLayer(std::make_shared<Cubed::LoadTestLayer>(settings));
+
+	return app;
+}
@@ -0,0 +1,425 @@
+#include "LoadTestLayer.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "Walnut/Application.h"
+#include "Walnut/Core/Log.h"
+#include "Walnut/Serialization/BufferStream.h"
+
+#include "PacketBuffer.h"
+#include "ServerPacket.h"
+
+using namespace Walnut;
+
+namespace Cubed
+{
+	static LoadTestLayer* s_Instance = nullptr;
+
+	LoadTestLayer::LoadTestLayer(const LoadTestSettings& settings)
+		: m_Settings(settings)
+	{
+	}
+
+	void LoadTestLayer::OnAttach()
+	{
+		s_Instance = this;
+
+		SteamNetworkingErrMsg errorMessage;
+		if (!GameNetworkingSockets_Init(nullptr, errorMessage))
+		{
+			WL_ERROR_TAG("LoadTest", "Could not initialize GameNetworkingSockets: {}", errorMessage);
+			return;
+		}
+
+		m_ServerAddress.Clear();
+		if (!m_ServerAddress.ParseString(m_Settings.ServerAddress.c_str()))
+		{
+			WL_ERROR_TAG("LoadTest", "Invalid server address '{}'", m_Settings.ServerAddress);
+			GameNetworkingSockets_Kill();
+			return;
+		}
+
+		m_Interface = SteamNetworkingSockets();
+		m_PollGroup = m_Interface->CreatePollGroup();
+		SteamNetworkingUtils()->SetGlobalCallback_SteamNetConnectionStatusChanged(ConnectionStatusChangedCallback);
+
+		m_Bots.resize(m_Settings.BotCount);
+		for (Bot& bot : m_Bots)
+		{
+			// a quarter of the bots stand still, like idle players do
+			bot.Idle = m_Random() % 4 == 0;
+		}
+
+		m_StartTime = Clock::now();
+		m_LastReport = m_StartTime;
+
+		WL_INFO_TAG("LoadTest", "Connecting {} bots to {}, {} updates/s each", m_Settings.BotCount, m_Settings.ServerAddress, m_Settings.UpdateRate);
+	}
+
+	void LoadTestLayer::OnDetach()
+	{
+		if (!m_Interface)
+			return;
+
+		Report(true);
+
+		for (Bot& bot : m_Bots)
+		{
+			if (bot.Connection != k_HSteamNetConnection_Invalid)
+				m_Interface->CloseConnection(bot.Connection, 0, "Load test finished", false);
+		}
+
+		m_Interface->DestroyPollGroup(m_PollGroup);
+		m_Interface = nullptr;
+
+		GameNetworkingSockets_Kill();
+		s_Instance = nullptr;
+	}
+
+	void LoadTestLayer::OnUpdate(float ts)
+	{
+		// failed to start up, already logged why
+		if (!m_Interface)
+		{
+			Application::Get().Close();
+			return;
+		}
+
+		Clock::time_point now = Clock::now();
+
+		m_Interface->RunCallbacks();
+		ReceiveMessages();
+		ConnectBots(now);
+		UpdateBots(now);
+
+		if (std::chrono::duration<float>(now - m_LastReport).count() >= m_Settings.ReportInterval)
+			Report(false);
+
+		if (m_Settings.Duration > 0.0f && std::chrono::duration<float>(now - m_StartTime).count() >= m_Settings.Duration)
+		{
+			Application::Get().Close();
+			return;
+		}
+
+		// nothing else runs on this thread, no need to spin a whole core between updates
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	void LoadTestLayer::ConnectBots(Clock::time_point now)
+	{
+		// ramp up at ConnectRate rather than opening every connection on the first frame
+		float elapsed = std::chrono::duration<float>(now - m_StartTime).count();
+		uint32_t target = std::min<uint32_t>(m_Settings.BotCount, (uint32_t)(elapsed * m_Settings.ConnectRate) + 1);
+
+		Clock::duration updateInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(1.0f / m_Settings.UpdateRate));
+		for (; m_BotsStarted < target; m_BotsStarted++)
+		{
+			Bot& bot = m_Bots[m_BotsStarted];
+			bot.Connection = m_Interface->ConnectByIPAddress(m_ServerAddress, 0, nullptr);
+			if (bot.Connection == k_HSteamNetConnection_Invalid)
+			{
+				bot.ConnectionState = Bot::State::Disconnected;
+				m_ConnectFailures++;
+				continue;
+			}
+
+			bot.ConnectionState = Bot::State::Connecting;
+			m_Interface->SetConnectionUserData(bot.Connection, m_BotsStarted);
+			m_Interface->SetConnectionPollGroup(bot.Connection, m_PollGroup);
+
+			// spread updates over the interval instead of every bot sending on the same frame
+			bot.NextUpdate = now + updateInterval * m_BotsStarted / std::max<uint32_t>(m_Settings.BotCount, 1);
+		}
+	}
+
+	void LoadTestLayer::ReceiveMessages()
+	{
+		constexpr int maxMessages = 256;
+		ISteamNetworkingMessage* messages[maxMessages];
+
+		for (;;)
+		{
+			int count = m_Interface->ReceiveMessagesOnPollGroup(m_PollGroup, messages, maxMessages);
+			for (int i = 0; i < count; i++)
+			{
+				ISteamNetworkingMessage* message = messages[i];
+				int64_t botIndex = message->m_nConnUserData;
+				if (botIndex >= 0 && botIndex < (int64_t)m_Bots.size())
+					OnBotDataReceived(m_Bots[botIndex], Buffer(message->m_pData, message->m_cbSize));
+
+				message->Release();
+			}
+
+			if (count < maxMessages)
+				break;
+		}
+	}
+
+	void LoadTestLayer::UpdateBots(Clock::time_point now)
+	{
+		float interval = 1.0f / m_Settings.UpdateRate;
+		Clock::duration updateInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(interval));
+
+		for (Bot& bot : m_Bots)
+		{
+			if (bot.ConnectionState != Bot::State::Connected || now < bot.NextUpdate)
+				continue;
+
+			bot.NextUpdate += updateInterval;
+			if (bot.NextUpdate < now)
+			{
+				// fell more than an interval behind, don't burst to catch up
+				bot.NextUpdate = now + updateInterval;
+				m_LateUpdates++;
+			}
+
+			// wander, turning back towards the middle whenever we end up outside the arena
+			bot.WanderTimer -= interval;
+			if (!bot.Idle && bot.WanderTimer <= 0.0f)
+			{
+				float halfSize = m_Settings.ArenaSize * 0.5f;
+				auto pickDirection = [this, halfSize](float position) -> int8_t
+				{
+					if (position > halfSize)
+						return -1;
+					if (position < -halfSize)
+						return 1;
+					return (int8_t)(m_Random() % 3) - 1;
+				};
+
+				bot.MoveX = pickDirection(bot.Position.x);
+				bot.MoveY = pickDirection(bot.Position.y);
+				bot.WanderTimer = std::uniform_real_distribution<float>(0.5f, 3.0f)(m_Random);
+			}
+
+			// same fixed input steps as the real client
+			std::array<PlayerInput, MaxInputsPerPacket> inputs;
+			uint32_t inputCount = 0;
+
+			bot.InputAccumulator = std::min(bot.InputAccumulator + interval, PlayerInputInterval * MaxInputsPerPacket);
+			while (bot.InputAccumulator >= PlayerInputInterval)
+			{
+				bot.InputAccumulator -= PlayerInputInterval;
+				inputs[inputCount++] = { bot.NextInputSequence++, bot.MoveX, bot.MoveY };
+			}
+
+			PacketBuffer packet = PacketBuffer::Allocate(sizeof(PacketType) + sizeof(uint32_t) * 3 + MaxInputsPerPacket);
+			BufferStreamWriter stream(packet.GetBuffer());
+			stream.WriteRaw(PacketType::ClientInput);
+
+			BitWriter bits(stream);
+			bits.WriteVarUInt(bot.LastSnapshotID);
+			WritePlayerInputs(bits, inputs.data(), inputCount);
+			bits.Flush();
+
+			Buffer buffer = stream.GetBuffer();
+			m_Interface->SendMessageToConnection(bot.Connection, buffer.Data, (uint32_t)buffer.Size, k_nSteamNetworkingSend_Reliable, nullptr);
+			bot.UpdatesSent++;
+			bot.BytesSent += buffer.Size;
+		}
+	}
+
+	void LoadTestLayer::Report(bool final)
+	{
+		Clock::time_point now = Clock::now();
+		float elapsed = std::max(std::chrono::duration<float>(now - m_LastReport).count(), 0.001f);
+
+		uint32_t connected = 0, connecting = 0, disconnected = 0;
+		uint64_t bytesReceived = 0, bytesSent = 0, snapshots = 0, snapshotBytes = 0, missed = 0, dropped = 0;
+		uint64_t chunks = 0, chunkBytes = 0, chunksInView = 0;
+		uint32_t chunksLoading = 0;
+		float lossSum = 0.0f;
+
+		// only bots that have everything in view so far, the rest are still waiting
+		std::vector<float> chunkLoadTimes;
+		chunkLoadTimes.reserve(m_Bots.size());
+
+		// ping and loss come from the transport, the server doesn't echo anything back
+		std::vector<int> pings;
+		pings.reserve(m_Bots.size());
+
+		for (const Bot& bot : m_Bots)
+		{
+			bytesReceived += bot.BytesReceived;
+			bytesSent += bot.BytesSent;
+			snapshots += bot.SnapshotsReceived;
+			snapshotBytes += bot.SnapshotBytesReceived;
+			missed += bot.SnapshotsMissed;
+			dropped += bot.SnapshotsDropped;
+			chunks += bot.ChunksReceived;
+			chunkBytes += bot.ChunkBytesReceived;
+			if (bot.ChunkLoadTime >= 0.0f)
+			{
+				chunkLoadTimes.push_back(bot.ChunkLoadTime);
+				chunksInView += bot.ChunksInView;
+			}
+
+			switch (bot.ConnectionState)
+			{
+			case Bot::State::Connecting: connecting++; break;
+			case Bot::State::Disconnected: disconnected++; break;
+			case Bot::State::Connected:
+			{
+				connected++;
+				if (bot.ChunkLoadTime < 0.0f)
+					chunksLoading++;
+
+				SteamNetConnectionRealTimeStatus_t status;
+				if (m_Interface->GetConnectionRealTimeStatus(bot.Connection, &status, 0, nullptr) == k_EResultOK)
+				{
+					pings.push_back(status.m_nPing);
+					lossSum += 1.0f - std::clamp(status.m_flConnectionQualityLocal, 0.0f, 1.0f);
+				}
+				break;
+			}
+			default: break;
+			}
+		}
+
+		auto percentile = [&pings](float p) { return pings.empty() ? 0 : pings[(size_t)(p * (pings.size() - 1))]; };
+		std::sort(pings.begin(), pings.end());
+
+		auto loadPercentile = [&chunkLoadTimes](float p) { return chunkLoadTimes.empty() ? 0.0f : chunkLoadTimes[(size_t)(p * (chunkLoadTimes.size() - 1))]; };
+		std::sort(chunkLoadTimes.begin(), chunkLoadTimes.end());
+
+		float perBot = 1.0f / std::max<uint32_t>(connected, 1);
+		WL_INFO_TAG("LoadTest", "{}{} connected, {} connecting, {} disconnected ({} failed to connect)",
+			final ? "Final: " : "", connected, connecting, disconnected, m_ConnectFailures);
+		WL_INFO_TAG("LoadTest", "  per bot: {:.1f} snapshots/s, {:.0f} B/s down, {:.0f} B/s up",
+			(snapshots - m_SnapshotsAtLastReport) / elapsed * perBot,
+			(bytesReceived - m_BytesReceivedAtLastReport) / elapsed * perBot,
+			(bytesSent - m_BytesSentAtLastReport) / elapsed * perBot);
+		// every bot gets one snapshot per send tick, so this is also what the server sends per tick
+		uint64_t newSnapshots = snapshots - m_SnapshotsAtLastReport;
+		float bytesPerSnapshot = newSnapshots ? (float)(snapshotBytes - m_SnapshotBytesAtLastReport) / newSnapshots : 0.0f;
+		WL_INFO_TAG("LoadTest", "  snapshots: {:.0f} B per snapshot, ~{:.1f} KB per send tick over {} bots",
+			bytesPerSnapshot, bytesPerSnapshot * connected / 1024.0f, connected);
+		WL_INFO_TAG("LoadTest", "  ping p50 {}ms, p99 {}ms, max {}ms, loss {:.2f}%",
+			percentile(0.5f), percentile(0.99f), pings.empty() ? 0 : pings.back(), lossSum * perBot * 100.0f);
+		WL_INFO_TAG("LoadTest", "  {} snapshots total, {} missed, {} dropped, {} late updates",
+			snapshots, missed, dropped, m_LateUpdates);
+		WL_INFO_TAG("LoadTest", "  chunks: {} received ({} KB), {:.0f} B/s down per bot, {} bots still loading",
+			chunks, chunkBytes / 1024, (chunkBytes - m_ChunkBytesAtLastReport) / elapsed * perBot, chunksLoading);
+		WL_INFO_TAG("LoadTest", "  initial chunk load ({} bots, ~{} chunks each): p50 {:.2f}s, p99 {:.2f}s, max {:.2f}s",
+			chunkLoadTimes.size(), chunkLoadTimes.empty() ? 0 : chunksInView / chunkLoadTimes.size(),
+			loadPercentile(0.5f), loadPercentile(0.99f), chunkLoadTimes.empty() ? 0.0f : chunkLoadTimes.back());
+
+		m_LastReport = now;
+		m_BytesReceivedAtLastReport = bytesReceived;
+		m_BytesSentAtLastReport = bytesSent;
+		m_SnapshotsAtLastReport = snapshots;
+		m_SnapshotBytesAtLastReport = snapshotBytes;
+		m_ChunkBytesAtLastReport = chunkBytes;
+	}
+
+	void LoadTestLayer::OnBotDataReceived(Bot& bot, const Buffer buffer)
+	{
+		bot.BytesReceived += buffer.Size;
+
+		BufferStreamReader stream(buffer);
+
+		PacketType type;
+		if (!stream.ReadRaw(type))
+			return;
+
+		switch (type)
+		{
+		case PacketType::ClientConnect:
+			stream.ReadRaw<uint32_t>(bot.PlayerID);
+			break;
+		case PacketType::ClientUpdate:
+		{
+			// same as ClientLayer, decode against whichever baseline the server picked
+			uint32_t snapshotID, baselineID, serverTime, lastProcessedInput;
+			PlayerData self;
+			if (!stream.ReadRaw<uint32_t>(snapshotID) || !stream.ReadRaw<uint32_t>(baselineID) || !stream.ReadRaw<uint32_t>(serverTime)
+				|| !stream.ReadRaw<uint32_t>(lastProcessedInput) || !stream.ReadRaw<PlayerData>(self))
+				break;
+			bot.Position = self.Position;
+
+			bot.SnapshotsReceived++;
+			bot.SnapshotBytesReceived += buffer.Size;
+			if (bot.LastSnapshotID != NoSnapshotBaseline && snapshotID > bot.LastSnapshotID + 1)
+				bot.SnapshotsMissed += snapshotID - bot.LastSnapshotID - 1;
+
+			static const EntityStore s_EmptyBaseline;
+			const EntityStore* baseline = &s_EmptyBaseline;
+			if (baselineID != NoSnapshotBaseline)
+			{
+				const Snapshot& history = bot.SnapshotHistory[baselineID % bot.SnapshotHistory.size()];
+				if (history.ID != baselineID)
+				{
+					bot.SnapshotsDropped++;
+					break;
+				}
+
+				baseline = &history.Players;
+			}
+
+			Snapshot& snapshot = bot.SnapshotHistory[snapshotID % bot.SnapshotHistory.size()];
+			EntityStore players;
+			snapshot.ID = NoSnapshotBaseline;
+			if (!ReadSnapshotDelta(stream, *baseline, m_PlayerQuantization, players))
+			{
+				bot.SnapshotsDropped++;
+				break;
+			}
+
+			snapshot.ID = snapshotID;
+			snapshot.Players = std::move(players);
+			bot.LastSnapshotID = snapshotID;
+			break;
+		}
+		case PacketType::ChunkData:
+			bot.ChunksReceived++;
+			bot.ChunkBytesReceived += buffer.Size;
+			break;
+		case PacketType::ChunkStreamIdle:
+		{
+			// only the first one counts, later ones come from walking into new chunks
+			stream.ReadRaw<uint32_t>(bot.ChunksInView);
+			if (bot.ChunkLoadTime < 0.0f)
+				bot.ChunkLoadTime = std::chrono::duration<float>(Clock::now() - bot.ConnectedTime).count();
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	void LoadTestLayer::OnConnectionStatusChanged(SteamNetConnectionStatusChangedCallback_t* info)
+	{
+		int64_t botIndex = info->m_info.m_nUserData;
+		if (botIndex < 0 || botIndex >= (int64_t)m_Bots.size())
+			return;
+
+		Bot& bot = m_Bots[botIndex];
+		switch (info->m_info.m_eState)
+		{
+		case k_ESteamNetworkingConnectionState_Connected:
+			bot.ConnectionState = Bot::State::Connected;
+			bot.ConnectedTime = Clock::now();
+			break;
+		case k_ESteamNetworkingConnectionState_ClosedByPeer:
+		case k_ESteamNetworkingConnectionState_ProblemDetectedLocally:
+			if (bot.ConnectionState == Bot::State::Connecting)
+				m_ConnectFailures++;
+			else
+				WL_WARN_TAG("LoadTest", "Bot {} lost connection: {}", botIndex, info->m_info.m_szEndDebug);
+
+			m_Interface->CloseConnection(bot.Connection, 0, nullptr, false);
+			bot.Connection = k_HSteamNetConnection_Invalid;
+			bot.ConnectionState = Bot::State::Disconnected;
+			break;
+		default:
+			break;
+		}
+	}
+
+	void LoadTestLayer::ConnectionStatusChangedCallback(SteamNetConnectionStatusChangedCallback_t* info)
+	{
+		if (s_Instance)
+			s_Instance->OnConnectionStatusChanged(info);
+	}
+}
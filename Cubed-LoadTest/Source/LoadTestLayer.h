@@ -0,0 +1,125 @@
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "Walnut/Layer.h"
+#include "Walnut/Core/Buffer.h"
+
+#include <steam/steamnetworkingsockets.h>
+#include <steam/isteamnetworkingutils.h>
+
+#include "BenchmarkLayer.h"
+#include "PlayerMovement.h"
+#include "Snapshot.h"
+
+namespace Cubed
+{
+	struct LoadTestSettings
+	{
+		std::string ServerAddress = "127.0.0.1:8192";
+		uint32_t BotCount = 1000;
+		uint32_t UpdateRate = 30;    // ClientInput packets per second, per bot
+		uint32_t ConnectRate = 250;  // new connections per second, so the server isn't hit by every bot at once
+		float Duration = 60.0f;      // in seconds, 0 runs until killed
+		float ReportInterval = 5.0f; // in seconds
+		float ArenaSize = 1024.0f;   // bots wander within [-size/2, size/2] on both axes
+	};
+
+	//
+	// LoadTestLayer - lots of headless bot clients in one process
+	//
+	// Talks to GameNetworkingSockets directly rather than through Walnut::Client, since that
+	// spins up a network thread per connection. Every bot lives on one poll group that is
+	// serviced from OnUpdate. Bots wander about, send ClientInputs like the real
+	// client does and decode and acknowledge the snapshots they get back, so the server sees
+	// realistic traffic, delta baselines included. Chunks are counted but not decoded, the
+	// report has how long each bot waited for everything in its view distance to arrive.
+	//
+	class LoadTestLayer : public Walnut::Layer
+	{
+	public:
+		LoadTestLayer(const LoadTestSettings& settings);
+
+		virtual void OnAttach() override;
+		virtual void OnDetach() override;
+
+		virtual void OnUpdate(float ts) override;
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		struct Bot
+		{
+			enum class State : uint8_t { Idle = 0, Connecting, Connected, Disconnected };
+
+			State ConnectionState = State::Idle;
+			HSteamNetConnection Connection = k_HSteamNetConnection_Invalid;
+			uint32_t PlayerID = 0;
+
+			// scripted movement, holds a direction for a while then picks another one
+			bool Idle = false;
+			int8_t MoveX = 0;
+			int8_t MoveY = 0;
+			float WanderTimer = 0.0f;
+			glm::vec2 Position{ 0.0f }; // as last reported by the server
+
+			float InputAccumulator = 0.0f;
+			uint32_t NextInputSequence = 1;
+
+			Clock::time_point NextUpdate;
+
+			std::array<Snapshot, 32> SnapshotHistory;
+			uint32_t LastSnapshotID = NoSnapshotBaseline;
+
+			uint64_t UpdatesSent = 0;
+			uint64_t BytesSent = 0;
+			uint64_t BytesReceived = 0;
+			uint64_t SnapshotsReceived = 0;
+			uint64_t SnapshotBytesReceived = 0;
+			uint64_t SnapshotsMissed = 0;   // gaps in snapshot IDs
+			uint64_t SnapshotsDropped = 0;  // baseline no longer in history, or failed to decode
+
+			// chunk streaming, the time it takes the server to send everything in view to a fresh client
+			Clock::time_point ConnectedTime;
+			float ChunkLoadTime = -1.0f;    // seconds from connecting to the first ChunkStreamIdle, < 0 until then
+			uint32_t ChunksInView = 0;      // as of the last ChunkStreamIdle
+			uint64_t ChunksReceived = 0;
+			uint64_t ChunkBytesReceived = 0;
+		};
+	private:
+		void ConnectBots(Clock::time_point now);
+		void ReceiveMessages();
+		void UpdateBots(Clock::time_point now);
+		void Report(bool final);
+
+		void OnBotDataReceived(Bot& bot, const Walnut::Buffer buffer);
+		void OnConnectionStatusChanged(SteamNetConnectionStatusChangedCallback_t* info);
+		static void ConnectionStatusChangedCallback(SteamNetConnectionStatusChangedCallback_t* info);
+	private:
+		LoadTestSettings m_Settings;
+		PlayerQuantization m_PlayerQuantization;
+
+		ISteamNetworkingSockets* m_Interface = nullptr;
+		HSteamNetPollGroup m_PollGroup = k_HSteamNetPollGroup_Invalid;
+		SteamNetworkingIPAddr m_ServerAddress;
+
+		std::vector<Bot> m_Bots;
+		std::mt19937 m_Random{ BenchmarkSeed };
+		uint32_t m_BotsStarted = 0;
+		uint32_t m_ConnectFailures = 0;
+		uint64_t m_LateUpdates = 0; // updates we were too busy to send on time
+
+		Clock::time_point m_StartTime;
+		Clock::time_point m_LastReport;
+		uint64_t m_BytesReceivedAtLastReport = 0;
+		uint64_t m_BytesSentAtLastReport = 0;
+		uint64_t m_SnapshotsAtLastReport = 0;
+		uint64_t m_SnapshotBytesAtLastReport = 0;
+		uint64_t m_ChunkBytesAtLastReport = 0;
+	};
+}
@@ -0,0 +1,184 @@
+#include "MeshBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#include "Walnut/Core/Log.h"
+
+#include "BenchmarkLayer.h"
+#include "ChunkMesher.h"
+
+namespace Cubed
+{
+	static constexpr BlockID s_StoneBlock = 1;
+	static constexpr BlockID s_DirtBlock = 2;
+	static constexpr BlockID s_GrassBlock = 3;
+
+	// cheap lattice value noise in [0, 1], good enough for cave-ish blobs
+	static float HashLattice(int32_t x, int32_t y, int32_t z)
+	{
+		uint32_t h = (uint32_t)x * 374761393u + (uint32_t)y * 668265263u + (uint32_t)z * 2147483647u;
+		h = (h ^ (h >> 13)) * 1274126177u;
+		return (float)((h ^ (h >> 16)) & 0xffffff) / (float)0xffffff;
+	}
+
+	static float ValueNoise(float x, float y, float z)
+	{
+		int32_t ix = (int32_t)std::floor(x), iy = (int32_t)std::floor(y), iz = (int32_t)std::floor(z);
+		auto smooth = [](float t) { return t * t * (3.0f - 2.0f * t); };
+		float fx = smooth(x - ix), fy = smooth(y - iy), fz = smooth(z - iz);
+
+		auto lerp = [](float a, float b, float t) { return a + (b - a) * t; };
+		float x00 = lerp(HashLattice(ix, iy, iz), HashLattice(ix + 1, iy, iz), fx);
+		float x10 = lerp(HashLattice(ix, iy + 1, iz), HashLattice(ix + 1, iy + 1, iz), fx);
+		float x01 = lerp(HashLattice(ix, iy, iz + 1), HashLattice(ix + 1, iy, iz + 1), fx);
+		float x11 = lerp(HashLattice(ix, iy + 1, iz + 1), HashLattice(ix + 1, iy + 1, iz + 1), fx);
+		return lerp(lerp(x00, x10, fy), lerp(x01, x11, fy), fz);
+	}
+
+	MeshBenchmark::MeshBenchmark(uint32_t worldSize)
+		: m_WorldSize((int32_t)worldSize)
+	{
+	}
+
+	bool MeshBenchmark::Run()
+	{
+		WL_INFO_TAG("MeshBenchmark", "Meshing {0}x{0}x{0} chunks of {1}^3 blocks per world", m_WorldSize, ChunkSize);
+
+		GenerateWorld(WorldType::Random);
+		MeshWorld("random");
+
+		GenerateWorld(WorldType::Flat);
+		MeshWorld("flat");
+
+		GenerateWorld(WorldType::Caves);
+		MeshWorld("caves");
+
+		return true;
+	}
+
+	void MeshBenchmark::GenerateWorld(WorldType type)
+	{
+		m_Chunks.assign((size_t)m_WorldSize * m_WorldSize * m_WorldSize, Chunk());
+
+		std::mt19937 random(BenchmarkSeed);
+		std::vector<BlockID> blocks(ChunkVolume);
+		int32_t surface = m_WorldSize * (int32_t)ChunkSize / 2;
+
+		for (int32_t cz = 0; cz < m_WorldSize; cz++)
+		{
+			for (int32_t cy = 0; cy < m_WorldSize; cy++)
+			{
+				for (int32_t cx = 0; cx < m_WorldSize; cx++)
+				{
+					for (uint32_t z = 0; z < ChunkSize; z++)
+					{
+						for (uint32_t y = 0; y < ChunkSize; y++)
+						{
+							for (uint32_t x = 0; x < ChunkSize; x++)
+							{
+								int32_t worldX = cx * (int32_t)ChunkSize + (int32_t)x;
+								int32_t worldY = cy * (int32_t)ChunkSize + (int32_t)y;
+								int32_t worldZ = cz * (int32_t)ChunkSize + (int32_t)z;
+
+								BlockID block = AirBlock;
+								switch (type)
+								{
+								case WorldType::Random:
+									// worst case, almost nothing can be merged
+									block = random() % 2 ? (BlockID)(random() % 3 + 1) : AirBlock;
+									break;
+								case WorldType::Flat:
+									if (worldY < surface - 4)
+										block = s_StoneBlock;
+									else if (worldY < surface - 1)
+										block = s_DirtBlock;
+									else if (worldY < surface)
+										block = s_GrassBlock;
+									break;
+								case WorldType::Caves:
+									if (worldY < surface && ValueNoise(worldX / 16.0f, worldY / 12.0f, worldZ / 16.0f) * 0.7f
+										+ ValueNoise(worldX / 5.0f, worldY / 5.0f, worldZ / 5.0f) * 0.3f < 0.55f)
+										block = worldY < surface - 3 ? s_StoneBlock : s_DirtBlock;
+									break;
+								}
+								blocks[Chunk::GetIndex(x, y, z)] = block;
+							}
+						}
+					}
+
+					GetChunk(cx, cy, cz).Pack(blocks.data());
+				}
+			}
+		}
+	}
+
+	const Chunk* MeshBenchmark::FindChunk(int32_t x, int32_t y, int32_t z) const
+	{
+		if (x < 0 || y < 0 || z < 0 || x >= m_WorldSize || y >= m_WorldSize || z >= m_WorldSize)
+			return nullptr;
+
+		return &m_Chunks[x + m_WorldSize * (y + m_WorldSize * z)];
+	}
+
+	void MeshBenchmark::MeshWorld(const char* name)
+	{
+		ChunkMesher mesher;
+		ChunkMesh mesh;
+
+		std::vector<float> times;
+		times.reserve(m_Chunks.size());
+
+		uint64_t vertices = 0, indices = 0, quads = 0, storageBytes = 0;
+		uint32_t emptyChunks = 0;
+
+		for (int32_t z = 0; z < m_WorldSize; z++)
+		{
+			for (int32_t y = 0; y < m_WorldSize; y++)
+			{
+				for (int32_t x = 0; x < m_WorldSize; x++)
+				{
+					const Chunk& chunk = GetChunk(x, y, z);
+					storageBytes += chunk.GetMemoryUsage();
+					if (chunk.IsEmpty())
+					{
+						emptyChunks++;
+						continue;
+					}
+
+					ChunkNeighbours neighbours = {
+						FindChunk(x + 1, y, z), FindChunk(x - 1, y, z),
+						FindChunk(x, y + 1, z), FindChunk(x, y - 1, z),
+						FindChunk(x, y, z + 1), FindChunk(x, y, z - 1)
+					};
+
+					auto start = std::chrono::steady_clock::now();
+					quads += mesher.Build(chunk, neighbours, mesh);
+					times.push_back(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+					vertices += mesh.Vertices.size();
+					indices += mesh.Indices.size();
+				}
+			}
+		}
+
+		std::sort(times.begin(), times.end());
+		auto percentile = [&times](float p) { return times.empty() ? 0.0f : times[(size_t)(p * (times.size() - 1))]; };
+
+		float total = 0.0f;
+		for (float time : times)
+			total += time;
+
+		size_t overBudget = times.end() - std::upper_bound(times.begin(), times.end(), 1.0f);
+		uint64_t rawBytes = (uint64_t)m_Chunks.size() * ChunkVolume * sizeof(BlockID);
+
+		WL_INFO_TAG("MeshBenchmark", "{}: {} chunks meshed ({} empty), {} vertices, {} indices, {} quads",
+			name, times.size(), emptyChunks, vertices, indices, quads);
+		WL_INFO_TAG("MeshBenchmark", "{}: per chunk avg {:.3f}ms, p50 {:.3f}ms, p99 {:.3f}ms, max {:.3f}ms, {} over 1ms",
+			name, times.empty() ? 0.0f : total / times.size(), percentile(0.5f), percentile(0.99f), percentile(1.0f), overBudget);
+		WL_INFO_TAG("MeshBenchmark", "{}: block storage {:.1f}KB ({:.1f}KB unpacked)",
+			name, storageBytes / 1024.0f, rawBytes / 1024.0f);
+	}
+}
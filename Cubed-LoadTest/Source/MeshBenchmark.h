@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "Chunk.h"
+
+namespace Cubed
+{
+	//
+	// MeshBenchmark - times the chunk mesher on a few generated worlds
+	//
+	// Every world is size^3 chunks, and every chunk is meshed with its real neighbours so faces
+	// between chunks get culled like they would in game. Reports vertex counts and per chunk
+	// meshing times for each world.
+	//
+	class MeshBenchmark
+	{
+	public:
+		MeshBenchmark(uint32_t worldSize);
+
+		bool Run();
+	private:
+		enum class WorldType { Random = 0, Flat, Caves };
+
+		void GenerateWorld(WorldType type);
+		void MeshWorld(const char* name);
+
+		Chunk& GetChunk(int32_t x, int32_t y, int32_t z) { return m_Chunks[x + m_WorldSize * (y + m_WorldSize * z)]; }
+		const Chunk* FindChunk(int32_t x, int32_t y, int32_t z) const;
+	private:
+		int32_t m_WorldSize;
+		std::vector<Chunk> m_Chunks;
+	};
+}
@@ -0,0 +1,135 @@
+#include "ProfilerBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "Walnut/Core/Log.h"
+
+#include "Profiler.h"
+
+namespace Cubed
+{
+	static constexpr uint32_t s_Passes = 5;
+	static constexpr float s_ZoneBudget = 50.0f; // ns
+	static constexpr const char* s_TracePath = "ProfilerBenchmark.json";
+
+	ProfilerBenchmark::ProfilerBenchmark(uint32_t zoneCount)
+		: m_ZoneCount(zoneCount)
+	{
+	}
+
+#if CUBED_PROFILING
+	// ns per iteration of the fastest pass
+	template<typename Body>
+	static float TimeBest(uint32_t count, Body&& body)
+	{
+		using Clock = std::chrono::steady_clock;
+
+		float best = 0.0f;
+		for (uint32_t pass = 0; pass < s_Passes; pass++)
+		{
+			Clock::time_point start = Clock::now();
+			for (uint32_t i = 0; i < count; i++)
+				body();
+			float time = std::chrono::duration<float, std::nano>(Clock::now() - start).count() / (float)count;
+			best = pass == 0 ? time : std::min(best, time);
+		}
+		return best;
+	}
+
+	static uint64_t CountOccurrences(const std::string& text, const std::string& pattern)
+	{
+		uint64_t count = 0;
+		for (size_t at = text.find(pattern); at != std::string::npos; at = text.find(pattern, at + pattern.size()))
+			count++;
+		return count;
+	}
+#endif
+
+	bool ProfilerBenchmark::Run()
+	{
+#if CUBED_PROFILING
+		float zoneTime = TimeBest(m_ZoneCount, []()
+		{
+			CUBED_PROFILE_ZONE("Zone");
+		});
+
+		float nestedTime = TimeBest(m_ZoneCount, []()
+		{
+			CUBED_PROFILE_ZONE("Outer Zone");
+			CUBED_PROFILE_ZONE("Inner Zone");
+		}) / 2.0f;
+
+		// what a zone reads, and what it would read with steady_clock instead
+		volatile uint64_t sink = 0;
+		float timestampTime = TimeBest(m_ZoneCount, [&sink]()
+		{
+			uint64_t start = Profiler::ReadTicks();
+			sink = Profiler::ReadTicks() - start;
+		});
+
+		float steadyClockTime = TimeBest(m_ZoneCount, [&sink]()
+		{
+			auto start = std::chrono::steady_clock::now();
+			sink = (uint64_t)(std::chrono::steady_clock::now() - start).count();
+		});
+
+		const char* clockName = CUBED_PROFILER_RDTSC ? "rdtsc" : "steady_clock";
+		WL_INFO_TAG("ProfilerBenchmark", "{} zones, best of {} passes: {:.1f}ns per zone, {:.1f}ns nested",
+			m_ZoneCount, s_Passes, zoneTime, nestedTime);
+		WL_INFO_TAG("ProfilerBenchmark", "two {} timestamps {:.1f}ns (steady_clock {:.1f}ns), the profiler itself {:.1f}ns",
+			clockName, timestampTime, steadyClockTime, zoneTime - timestampTime);
+
+		float worstTime = std::max(zoneTime, nestedTime);
+		if (worstTime < s_ZoneBudget)
+			WL_INFO_TAG("ProfilerBenchmark", "within the {:.0f}ns budget", s_ZoneBudget);
+		else
+			WL_WARN_TAG("ProfilerBenchmark", "over the {:.0f}ns budget by {:.1f}ns, {:.1f}ns of a zone is the clock alone",
+				s_ZoneBudget, worstTime - s_ZoneBudget, timestampTime);
+
+		using Clock = std::chrono::steady_clock;
+		Clock::time_point start = Clock::now();
+		bool written = Profiler::WriteChromeTrace(s_TracePath);
+		float exportTime = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+		if (!written)
+		{
+			WL_ERROR_TAG("ProfilerBenchmark", "could not write {}!", s_TracePath);
+			return false;
+		}
+
+		std::ifstream stream(s_TracePath, std::ios::binary);
+		std::stringstream contents;
+		contents << stream.rdbuf();
+		std::string trace = contents.str();
+
+		// nothing else records on this thread, so its ring holds the newest zones, nested ones last.
+		// A full ring gives up its oldest, the owner could be overwriting it during the export
+		uint64_t recorded = (uint64_t)m_ZoneCount * s_Passes;
+		uint64_t kept = recorded * 3 >= Profiler::RingCapacity ? Profiler::RingCapacity - 1 : recorded * 3;
+		uint64_t nestedKept = std::min(recorded * 2, kept);
+		uint64_t flatKept = kept - nestedKept;
+		uint64_t flat = CountOccurrences(trace, "\"name\":\"Zone\"");
+		uint64_t outer = CountOccurrences(trace, "\"name\":\"Outer Zone\"");
+		uint64_t inner = CountOccurrences(trace, "\"name\":\"Inner Zone\"");
+
+		WL_INFO_TAG("ProfilerBenchmark", "exported {} zones to {} in {:.1f}ms ({}KB)",
+			flat + outer + inner, s_TracePath, exportTime, trace.size() / 1024);
+
+		// the oldest nested zone kept is an outer one if there's an odd number of them
+		if (flat != flatKept || outer != (nestedKept + 1) / 2 || inner != nestedKept / 2)
+		{
+			WL_ERROR_TAG("ProfilerBenchmark", "trace holds {} zones, {} outer and {} inner, expected {}, {} and {}!",
+				flat, outer, inner, flatKept, (nestedKept + 1) / 2, nestedKept / 2);
+			return false;
+		}
+#else
+		WL_INFO_TAG("ProfilerBenchmark", "the profiler is compiled out of this build");
+#endif
+		return true;
+	}
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace Cubed
+{
+	//
+	// ProfilerBenchmark - times what a profiler zone costs
+	//
+	// Opens empty zones back to back, once one after another and once nested in pairs, and
+	// runs the same loop with only the two timestamps a zone reads, so what's left over is the
+	// profiler's own bookkeeping. Each loop is the best of a few passes, clocks in a VM are
+	// noisy. A zone is meant to stay under 50ns, most of which is the clock: where rdtsc is
+	// virtualized it costs several times what it does on bare metal, so steady_clock is timed
+	// as well to show whether it would do any better. The zones are then exported as a Chrome
+	// trace, which has to hold exactly the last ring's worth of them.
+	//
+	// Does nothing in Dist builds, the profiler isn't there.
+	//
+	class ProfilerBenchmark
+	{
+	public:
+		ProfilerBenchmark(uint32_t zoneCount);
+
+		bool Run();
+	private:
+		uint32_t m_ZoneCount;
+	};
+}
@@ -0,0 +1,198 @@
+#include "QueueBenchmark.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Walnut/Core/Log.h"
+
+#include "EntityStore.h"
+#include "MPSCQueue.h"
+
+namespace Cubed
+{
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr uint32_t s_ClientCount = 1000;   // updates are spread over this many players
+	static constexpr size_t s_QueueCapacity = 65536;  // same as the server's inbound queue
+	static constexpr auto s_TickInterval = std::chrono::milliseconds(1); // far faster than any real tick, for plenty of samples
+
+	struct PlayerUpdate
+	{
+		uint32_t ClientID = 0;
+		PlayerData Data{};
+	};
+
+	struct QueueBenchmarkResult
+	{
+		float Seconds = 0.0f;
+		uint64_t Dropped = 0;
+		std::vector<float> PushTimes; // in microseconds
+		std::vector<float> TickTimes; // in milliseconds
+	};
+
+	static float Percentile(std::vector<float>& times, float p)
+	{
+		if (times.empty())
+			return 0.0f;
+
+		size_t index = (size_t)(p * (times.size() - 1));
+		std::nth_element(times.begin(), times.begin() + index, times.end());
+		return times[index];
+	}
+
+	// push(update) runs on every producer and returns false if the update was dropped,
+	// tick() runs on the calling thread until the producers are done, and once more after
+	template<typename PushFunc, typename TickFunc>
+	static QueueBenchmarkResult RunProducers(uint32_t producerCount, uint32_t updatesPerProducer, PushFunc&& push, TickFunc&& tick)
+	{
+		QueueBenchmarkResult result;
+		std::vector<std::vector<float>> pushTimes(producerCount);
+		std::atomic<uint32_t> ready = 0, finished = 0;
+		std::atomic<uint64_t> dropped = 0;
+		std::atomic<bool> go = false;
+
+		std::vector<std::thread> producers;
+		producers.reserve(producerCount);
+		for (uint32_t p = 0; p < producerCount; p++)
+		{
+			producers.emplace_back([&, p]()
+			{
+				std::vector<float>& times = pushTimes[p];
+				times.resize(updatesPerProducer);
+				uint64_t droppedHere = 0;
+
+				ready++;
+				while (!go.load(std::memory_order_acquire))
+					std::this_thread::yield();
+
+				PlayerUpdate update;
+				for (uint32_t i = 0; i < updatesPerProducer; i++)
+				{
+					// producers own disjoint players, like connections do
+					update.ClientID = (p + i * producerCount) % s_ClientCount + 1;
+					update.Data.Position = { (float)i, (float)p };
+
+					Clock::time_point start = Clock::now();
+					if (!push(update))
+						droppedHere++;
+					times[i] = std::chrono::duration<float, std::micro>(Clock::now() - start).count();
+				}
+
+				dropped += droppedHere;
+				finished++;
+			});
+		}
+
+		while (ready < producerCount)
+			std::this_thread::yield();
+
+		Clock::time_point start = Clock::now();
+		go.store(true, std::memory_order_release);
+
+		Clock::time_point producersDone;
+		for (;;)
+		{
+			bool done = finished == producerCount;
+			if (done)
+				producersDone = Clock::now();
+
+			Clock::time_point tickStart = Clock::now();
+			tick();
+			result.TickTimes.push_back(std::chrono::duration<float, std::milli>(Clock::now() - tickStart).count());
+
+			if (done)
+				break;
+			std::this_thread::sleep_for(s_TickInterval);
+		}
+
+		for (std::thread& producer : producers)
+			producer.join();
+
+		result.Seconds = std::chrono::duration<float>(producersDone - start).count();
+		result.Dropped = dropped;
+		for (std::vector<float>& times : pushTimes)
+			result.PushTimes.insert(result.PushTimes.end(), times.begin(), times.end());
+		return result;
+	}
+
+	static void Report(const char* name, uint32_t producerCount, uint32_t updatesPerProducer, QueueBenchmarkResult& result)
+	{
+		uint64_t updates = (uint64_t)producerCount * updatesPerProducer;
+		WL_INFO_TAG("QueueBenchmark", "{} producers, {}: {:.2f}M updates/s delivered, push p50 {:.2f}us p99 {:.2f}us max {:.1f}us, tick p50 {:.3f}ms p99 {:.3f}ms, {} dropped",
+			producerCount, name, (updates - result.Dropped) / std::max(result.Seconds, 1e-6f) / 1e6f,
+			Percentile(result.PushTimes, 0.5f), Percentile(result.PushTimes, 0.99f), Percentile(result.PushTimes, 1.0f),
+			Percentile(result.TickTimes, 0.5f), Percentile(result.TickTimes, 0.99f), result.Dropped);
+	}
+
+	QueueBenchmark::QueueBenchmark(uint32_t updatesPerProducer)
+		: m_UpdatesPerProducer(updatesPerProducer)
+	{
+	}
+
+	bool QueueBenchmark::Run()
+	{
+		WL_INFO_TAG("QueueBenchmark", "{} updates per producer over {} players, {} hardware threads",
+			m_UpdatesPerProducer, s_ClientCount, std::thread::hardware_concurrency());
+
+		for (uint32_t producerCount : { 1u, 2u, 4u, 8u, 16u, 32u, 64u })
+		{
+			// the old path, one lock around the table for the callbacks and the tick
+			{
+				std::mutex mutex;
+				std::map<uint32_t, PlayerData> players;
+				std::vector<PlayerUpdate> snapshot;
+				snapshot.reserve(s_ClientCount);
+
+				QueueBenchmarkResult result = RunProducers(producerCount, m_UpdatesPerProducer,
+					[&](const PlayerUpdate& update)
+					{
+						std::scoped_lock<std::mutex> lock(mutex);
+						players[update.ClientID] = update.Data;
+						return true;
+					},
+					[&]()
+					{
+						std::scoped_lock<std::mutex> lock(mutex);
+						snapshot.clear();
+						for (const auto& [id, data] : players)
+							snapshot.push_back({ id, data });
+					});
+				Report("mutex+map", producerCount, m_UpdatesPerProducer, result);
+			}
+
+			// the new path, the tick owns the table and only the queue is shared
+			{
+				MPSCQueue<PlayerUpdate> queue(s_QueueCapacity);
+				std::map<uint32_t, PlayerData> players;
+				std::vector<PlayerUpdate> snapshot;
+				snapshot.reserve(s_ClientCount);
+
+				QueueBenchmarkResult result = RunProducers(producerCount, m_UpdatesPerProducer,
+					[&](const PlayerUpdate& update)
+					{
+						// dropped when full, like the server does with player updates
+						return queue.Push(update);
+					},
+					[&]()
+					{
+						PlayerUpdate update;
+						while (queue.Pop(update))
+							players[update.ClientID] = update.Data;
+
+						snapshot.clear();
+						for (const auto& [id, data] : players)
+							snapshot.push_back({ id, data });
+					});
+				Report("mpsc queue", producerCount, m_UpdatesPerProducer, result);
+			}
+		}
+
+		return true;
+	}
+
+}
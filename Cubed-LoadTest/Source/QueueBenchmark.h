@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace Cubed
+{
+	//
+	// QueueBenchmark - times inbound player updates under contention
+	//
+	// 1 to 64 producer threads, standing in for the network callbacks, push player updates
+	// as fast as they can while a tick thread keeps draining them into a player table and
+	// copying the whole table out, like building snapshots. Run once the old way, with
+	// producers writing into a std::map behind the same mutex the tick holds while it
+	// copies, and once the way the server does it now, through an MPSCQueue that only the
+	// tick thread drains. Both use the same table so the only difference is the hand over.
+	//
+	// Reports update throughput, how long a single push takes (the time a network callback
+	// is stuck) and how long a tick takes, per producer count.
+	//
+	class QueueBenchmark
+	{
+	public:
+		QueueBenchmark(uint32_t updatesPerProducer);
+
+		bool Run();
+	private:
+		uint32_t m_UpdatesPerProducer;
+	};
+}
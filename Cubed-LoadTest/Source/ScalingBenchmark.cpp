@@ -0,0 +1,167 @@
+#include "ScalingBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Walnut/Core/Log.h"
+
+#include "BenchmarkLayer.h"
+#include "JobSystem.h"
+#include "ServerShard.h"
+
+namespace Cubed
+{
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr uint32_t s_WarmupTicks = 60; // lets ring buffers, grids and baselines settle first
+	static constexpr uint32_t s_TickCount = 300;
+	static constexpr float s_AreaPerPlayer = 512.0f; // about 2000 players on 1024x1024, as busy as the load test gets
+
+	static float MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+	}
+
+	ScalingBenchmark::ScalingBenchmark(uint32_t playersPerThread)
+		: m_PlayersPerThread(playersPerThread)
+	{
+	}
+
+	bool ScalingBenchmark::Run()
+	{
+		uint32_t maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		std::vector<uint32_t> threadCounts;
+		for (uint32_t threads = 1; threads < maxThreads; threads *= 2)
+			threadCounts.push_back(threads);
+		threadCounts.push_back(maxThreads);
+
+		WL_INFO_TAG("ScalingBenchmark", "{} ticks per run, {} players per thread, up to {} threads", s_TickCount, m_PlayersPerThread, maxThreads);
+
+		// same work split more ways, ideally it takes 1/threads as long
+		uint32_t fixedPlayers = m_PlayersPerThread * maxThreads;
+		TickTimes single;
+		for (uint32_t threads : threadCounts)
+		{
+			TickTimes times = BenchmarkTicks(threads, fixedPlayers);
+			if (threads == 1)
+				single = times;
+
+			float speedup = single.P50 / std::max(times.P50, 1e-6f);
+			WL_INFO_TAG("ScalingBenchmark", "fixed, {} threads, {} players: tick p50 {:.3f}ms p99 {:.3f}ms, {:.2f}x speedup ({:.0f}% efficiency), {} jobs stolen",
+				threads, fixedPlayers, times.P50, times.P99, speedup, speedup * 100.0f / threads, times.JobsStolen);
+		}
+
+		// more players as threads are added, ideally tick time doesn't move
+		for (uint32_t threads : threadCounts)
+		{
+			uint32_t playerCount = m_PlayersPerThread * threads;
+			TickTimes times = BenchmarkTicks(threads, playerCount);
+			if (threads == 1)
+				single = times;
+
+			WL_INFO_TAG("ScalingBenchmark", "growing, {} threads, {} players: tick p50 {:.3f}ms p99 {:.3f}ms, {:.0f}% of 1 thread's p50, {} jobs stolen",
+				threads, playerCount, times.P50, times.P99, times.P50 * 100.0f / std::max(single.P50, 1e-6f), times.JobsStolen);
+		}
+
+		return true;
+	}
+
+	ScalingBenchmark::TickTimes ScalingBenchmark::BenchmarkTicks(uint32_t threadCount, uint32_t playerCount)
+	{
+		struct Player
+		{
+			uint32_t Shard = 0;
+			uint32_t NextInputSequence = 1;
+			int8_t MoveX = 0;
+			int8_t MoveY = 0;
+		};
+
+		JobSystem jobs(threadCount - 1);
+		ShardLayout layout;
+		std::vector<ServerShard> shards;
+		shards.reserve(layout.ShardCount);
+		for (uint32_t i = 0; i < layout.ShardCount; i++)
+			shards.emplace_back(i, layout);
+
+		// one stripe per shard across, as deep as it takes to keep the density the same
+		float width = layout.StripeWidth * layout.ShardCount;
+		float depth = std::max(playerCount * s_AreaPerPlayer / width, layout.StripeWidth);
+
+		// client IDs are indices + 1
+		std::mt19937 random(BenchmarkSeed);
+		std::uniform_real_distribution<float> positionX(-width * 0.5f, width * 0.5f);
+		std::uniform_real_distribution<float> positionY(-depth * 0.5f, depth * 0.5f);
+		std::vector<Player> players(playerCount);
+		for (uint32_t i = 0; i < playerCount; i++)
+		{
+			ServerShard::Handoff handoff;
+			handoff.ClientID = i + 1;
+			handoff.Data = GetSpawnPlayerData();
+			handoff.Data.Position = { positionX(random), positionY(random) };
+			handoff.TargetShard = layout.GetShard(handoff.Data.Position);
+
+			players[i].Shard = handoff.TargetShard;
+			shards[handoff.TargetShard].AcceptHandoff(handoff);
+		}
+
+		ServerShard::SendContext context;
+		context.Shards = &shards;
+
+		std::vector<float> tickTimes;
+		uint64_t stolenBefore = 0;
+		for (uint32_t tick = 0; tick < s_WarmupTicks + s_TickCount; tick++)
+		{
+			// one input per player per tick, acknowledging the snapshot from the tick before
+			for (uint32_t i = 0; i < playerCount; i++)
+			{
+				Player& player = players[i];
+				if (random() % 60 == 0 || player.NextInputSequence == 1)
+				{
+					player.MoveX = (int8_t)(random() % 3) - 1;
+					player.MoveY = (int8_t)(random() % 3) - 1;
+				}
+
+				InboundEvent event;
+				event.EventType = InboundEvent::Type::Input;
+				event.ClientID = i + 1;
+				event.AckedSnapshotID = context.SnapshotID;
+				event.InputCount = 1;
+				event.Inputs[0] = { player.NextInputSequence++, player.MoveX, player.MoveY };
+				shards[player.Shard].PushEvent(event);
+			}
+
+			context.SnapshotID++;
+			context.ServerTime = (uint32_t)((uint64_t)tick * 1000 / PlayerInputRate);
+			if (tick == s_WarmupTicks)
+				stolenBefore = jobs.GetStatistics().JobsStolen;
+
+			Clock::time_point start = Clock::now();
+			jobs.ParallelFor((uint32_t)shards.size(), [&shards](uint32_t i) { shards[i].Simulate(PlayerInputInterval); });
+			for (ServerShard& shard : shards)
+			{
+				for (ServerShard::Handoff& handoff : shard.GetOutgoingHandoffs())
+				{
+					players[handoff.ClientID - 1].Shard = handoff.TargetShard;
+					shards[handoff.TargetShard].AcceptHandoff(handoff);
+				}
+				shard.GetOutgoingHandoffs().clear();
+			}
+			jobs.ParallelFor((uint32_t)shards.size(), [&shards](uint32_t i) { shards[i].BuildGrid(); });
+			jobs.ParallelFor((uint32_t)shards.size(), [&shards, &context](uint32_t i) { shards[i].SendSnapshots(context); });
+			float tickTime = MillisecondsSince(start);
+
+			for (ServerShard& shard : shards)
+				shard.GetStatistics() = {};
+
+			if (tick >= s_WarmupTicks)
+				tickTimes.push_back(tickTime);
+		}
+
+		std::sort(tickTimes.begin(), tickTimes.end());
+		auto percentile = [&tickTimes](float p) { return tickTimes.empty() ? 0.0f : tickTimes[(size_t)(p * (tickTimes.size() - 1))]; };
+		return { percentile(0.5f), percentile(0.99f), jobs.GetStatistics().JobsStolen - stolenBefore };
+	}
+}
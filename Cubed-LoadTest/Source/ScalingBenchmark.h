@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace Cubed
+{
+	//
+	// ScalingBenchmark - times sharded server ticks from 1 to N threads
+	//
+	// Runs the server's shards in process on a JobSystem with 1, 2, 4... up to one thread per
+	// core. Players are spread over a field as wide as all the shards' stripes together, and
+	// deeper the more of them there are, so the crowd is equally dense at every player count.
+	// Two passes: a fixed crowd of the requested players per thread times the most threads,
+	// reported as speedup over 1 thread, and a crowd that grows with the thread count, where
+	// tick time should stay flat while there are cores to go around.
+	//
+	class ScalingBenchmark
+	{
+	public:
+		ScalingBenchmark(uint32_t playersPerThread);
+
+		bool Run();
+	private:
+		struct TickTimes
+		{
+			float P50 = 0.0f;
+			float P99 = 0.0f;
+			uint64_t JobsStolen = 0;
+		};
+
+		TickTimes BenchmarkTicks(uint32_t threadCount, uint32_t playerCount);
+	private:
+		uint32_t m_PlayersPerThread;
+	};
+}
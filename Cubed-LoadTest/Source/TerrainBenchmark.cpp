@@ -0,0 +1,122 @@
+#include "TerrainBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#include "Walnut/Core/Log.h"
+
+#include "BenchmarkLayer.h"
+#include "JobSystem.h"
+#include "TerrainGenerator.h"
+
+namespace Cubed
+{
+	using Clock = std::chrono::steady_clock;
+
+	// the server's default world height, see WorldSettings
+	static constexpr int32_t s_MinChunkY = -2;
+	static constexpr int32_t s_MaxChunkY = 1;
+
+	static float MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+	}
+
+	TerrainBenchmark::TerrainBenchmark(uint32_t chunkCount)
+		: m_ChunkCount(chunkCount)
+	{
+	}
+
+	bool TerrainBenchmark::Run()
+	{
+		// columns laid out along a square, nearest first like the server would ask for them
+		int32_t height = s_MaxChunkY - s_MinChunkY + 1;
+		int32_t columns = (int32_t)((m_ChunkCount + height - 1) / height);
+		int32_t side = std::max((int32_t)std::ceil(std::sqrt((float)columns)), 1);
+		for (int32_t z = 0; z < side && m_Coords.size() < m_ChunkCount; z++)
+		{
+			for (int32_t x = 0; x < side && m_Coords.size() < m_ChunkCount; x++)
+			{
+				for (int32_t y = s_MinChunkY; y <= s_MaxChunkY && m_Coords.size() < m_ChunkCount; y++)
+					m_Coords.push_back({ x, y, z });
+			}
+		}
+		m_Chunks.resize(m_Coords.size());
+
+		SimdLevel supported = GetSupportedSimdLevel();
+		uint32_t threadCount = JobSystem::GetDefaultWorkerCount() + 1;
+		WL_INFO_TAG("TerrainBenchmark", "Generating {} chunks ({}x{} columns) on up to {} threads, best SIMD level {}",
+			m_Coords.size(), side, side, threadCount, SimdLevelToString(supported));
+
+		for (uint32_t level = 0; level <= (uint32_t)supported; level++)
+		{
+			TimeNoise((SimdLevel)level);
+			GenerateChunks((SimdLevel)level, 1);
+			if (threadCount > 1)
+				GenerateChunks((SimdLevel)level, threadCount);
+		}
+
+		return true;
+	}
+
+	void TerrainBenchmark::TimeNoise(SimdLevel level)
+	{
+		constexpr uint32_t count = 1 << 20;
+		std::mt19937 random(BenchmarkSeed);
+		std::uniform_real_distribution<float> distribution(-10000.0f, 10000.0f);
+		std::vector<float> x(count), y(count), z(count), result(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			x[i] = distribution(random);
+			y[i] = distribution(random);
+			z[i] = distribution(random);
+		}
+
+		auto time = [&](const char* name, auto&& noise)
+		{
+			Clock::time_point start = Clock::now();
+			noise();
+			float time = MillisecondsSince(start);
+
+			WL_INFO_TAG("TerrainBenchmark", "{} {}: {:.1f}ns per point",
+				SimdLevelToString(level), name, time * 1000000.0f / count);
+		};
+
+		time("2D noise", [&]() { SimplexNoise2D(BenchmarkSeed, x.data(), y.data(), result.data(), count, level); });
+		time("3D noise", [&]() { SimplexNoise3D(BenchmarkSeed, x.data(), y.data(), z.data(), result.data(), count, level); });
+	}
+
+	void TerrainBenchmark::GenerateChunks(SimdLevel level, uint32_t threadCount)
+	{
+		TerrainGenerator generator({ .Seed = BenchmarkSeed }, level);
+		JobSystem jobs(threadCount - 1);
+
+		std::vector<float> times(m_Coords.size());
+		Clock::time_point start = Clock::now();
+		jobs.ParallelFor((uint32_t)m_Coords.size(), [&](uint32_t i)
+		{
+			Clock::time_point chunkStart = Clock::now();
+			generator.Generate(m_Coords[i], m_Chunks[i]);
+			times[i] = MillisecondsSince(chunkStart);
+		});
+		float totalTime = MillisecondsSince(start);
+
+		uint32_t emptyChunks = 0;
+		for (const Chunk& chunk : m_Chunks)
+			emptyChunks += chunk.IsEmpty();
+
+		std::sort(times.begin(), times.end());
+		float average = 0.0f;
+		for (float time : times)
+			average += time;
+		average /= std::max<size_t>(times.size(), 1);
+
+		float chunksPerSecond = m_Coords.size() / (totalTime / 1000.0f);
+		WL_INFO_TAG("TerrainBenchmark", "{} on {} threads: {:.0f} chunks/s, {:.0f} chunks/s per core, {} empty",
+			SimdLevelToString(level), threadCount, chunksPerSecond, chunksPerSecond / threadCount, emptyChunks);
+		WL_INFO_TAG("TerrainBenchmark", "{} on {} threads: per chunk avg {:.3f}ms, p50 {:.3f}ms, p99 {:.3f}ms, max {:.3f}ms",
+			SimdLevelToString(level), threadCount, average, times[times.size() / 2], times[(size_t)(0.99f * (times.size() - 1))], times.back());
+	}
+}
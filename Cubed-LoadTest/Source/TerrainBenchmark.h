@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "Chunk.h"
+#include "Noise.h"
+
+namespace Cubed
+{
+	//
+	// TerrainBenchmark - times terrain generation on every SIMD level
+	//
+	// Generates the same square of chunk columns on one thread and then across a job system,
+	// once per SIMD level the CPU has, and reports chunks per second per core and the time per
+	// noise point. NoiseTest in Cubed-Tests checks the levels agree with each other.
+	//
+	class TerrainBenchmark
+	{
+	public:
+		TerrainBenchmark(uint32_t chunkCount);
+
+		bool Run();
+	private:
+		void TimeNoise(SimdLevel level);
+		void GenerateChunks(SimdLevel level, uint32_t threadCount);
+	private:
+		uint32_t m_ChunkCount;
+		std::vector<ChunkCoord> m_Coords;
+		std::vector<Chunk> m_Chunks;
+	};
+}
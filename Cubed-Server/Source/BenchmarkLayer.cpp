@@ -0,0 +1,28 @@
+#include "BenchmarkLayer.h"
+
+#include <cstdlib>
+#include <utility>
+
+#include "Walnut/Application.h"
+
+namespace Cubed
+{
+	BenchmarkLayer::BenchmarkLayer(std::function<bool()> function)
+		: m_Function(std::move(function))
+	{
+	}
+
+	void BenchmarkLayer::OnAttach()
+	{
+		m_Passed = m_Function();
+	}
+
+	void BenchmarkLayer::OnUpdate(float ts)
+	{
+		// Run would ignore a Close from OnAttach
+		if (!m_Passed)
+			std::exit(1);
+
+		Walnut::Application::Get().Close();
+	}
+}
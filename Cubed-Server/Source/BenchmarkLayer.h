@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <string_view>
+
+#include "Walnut/Layer.h"
+
+namespace Cubed
+{
+	// what benchmarks and tests seed their random numbers with, the same every run so results
+	// can be compared between runs
+	constexpr uint32_t BenchmarkSeed = 1234;
+
+	// a command line option that runs something other than the app, the value given with it
+	// goes to Create
+	struct BenchmarkMode
+	{
+		std::string_view Option;
+		std::function<bool()> (*Create)(uint32_t value);
+	};
+
+	// Create for a class taking the value in its constructor and doing the work in Run
+	template<typename T>
+	std::function<bool()> CreateBenchmark(uint32_t value)
+	{
+		return [value]() { return T(value).Run(); };
+	}
+
+	//
+	// BenchmarkLayer - runs one benchmark or test, then quits
+	//
+	// The function does all the work from OnAttach and returns false if anything it checked
+	// came out wrong. Walnut's main returns 0 whatever happened, so the layer exits with 1
+	// itself then, for scripts and CI to see.
+	//
+	class BenchmarkLayer : public Walnut::Layer
+	{
+	public:
+		BenchmarkLayer(std::function<bool()> function);
+
+		virtual void OnAttach() override;
+		virtual void OnUpdate(float ts) override;
+	private:
+		std::function<bool()> m_Function;
+		bool m_Passed = false;
+	};
+}
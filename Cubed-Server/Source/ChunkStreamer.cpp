@@ -0,0 +1,313 @@
+#include "ChunkStreamer.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "Walnut/Serialization/BufferStream.h"
+
+#include "BitStream.h"
+#include "Profiler.h"
+#include "ServerPacket.h"
+
+using namespace Walnut;
+
+namespace Cubed
+{
+	static void WriteChunkCoord(BufferStreamWriter& stream, const ChunkCoord& coord)
+	{
+		stream.WriteRaw<int32_t>(coord.X);
+		stream.WriteRaw<int32_t>(coord.Y);
+		stream.WriteRaw<int32_t>(coord.Z);
+	}
+
+	void ChunkStreamer::AddClient(uint32_t clientID)
+	{
+		ClientStream& client = m_Clients[clientID];
+		client = {};
+		client.ClientID = clientID;
+	}
+
+	void ChunkStreamer::RemoveClient(uint32_t clientID)
+	{
+		auto it = m_Clients.find(clientID);
+		if (it == m_Clients.end())
+			return;
+
+		const Statistics& stats = it->second.Stats;
+		m_RemovedStats.ChunksSent += stats.ChunksSent;
+		m_RemovedStats.ChunkBytesSent += stats.ChunkBytesSent;
+		m_RemovedStats.ChunksUnloaded += stats.ChunksUnloaded;
+		m_RemovedStats.ChunksResent += stats.ChunksResent;
+		m_RemovedStats.EditPacketsSent += stats.EditPacketsSent;
+		m_RemovedStats.EditBytesSent += stats.EditBytesSent;
+		m_Clients.erase(it);
+	}
+
+	void ChunkStreamer::SetPosition(uint32_t clientID, const glm::vec2& position)
+	{
+		auto it = m_Clients.find(clientID);
+		if (it != m_Clients.end())
+			it->second.Position = position;
+	}
+
+	bool ChunkStreamer::HasChunk(uint32_t clientID, const ChunkCoord& coord) const
+	{
+		auto it = m_Clients.find(clientID);
+		return it != m_Clients.end() && it->second.Sent.contains(coord);
+	}
+
+	void ChunkStreamer::SetViewDistance(int32_t distance)
+	{
+		m_Settings.ViewDistance = distance;
+		for (auto& [clientID, client] : m_Clients)
+			client.HasCenter = false;
+	}
+
+	ChunkStreamer::Statistics ChunkStreamer::GetStatistics() const
+	{
+		Statistics total = m_RemovedStats;
+		for (const auto& [clientID, client] : m_Clients)
+		{
+			total.ChunksSent += client.Stats.ChunksSent;
+			total.ChunkBytesSent += client.Stats.ChunkBytesSent;
+			total.ChunksUnloaded += client.Stats.ChunksUnloaded;
+			total.ChunksResent += client.Stats.ChunksResent;
+			total.EditPacketsSent += client.Stats.EditPacketsSent;
+			total.EditBytesSent += client.Stats.EditBytesSent;
+			total.QueuedChunks += client.Stats.QueuedChunks;
+		}
+		return total;
+	}
+
+	void ChunkStreamer::Update(ServerWorld& world, Server& server, JobSystem& jobs, float dt)
+	{
+		// edits go out to everyone who has the chunk, so each packet is only encoded once
+		const std::vector<ChunkEdits>& edits = world.FlushEdits();
+		m_EditPackets.resize(edits.size());
+		m_EditPacketSizes.resize(edits.size());
+		for (size_t i = 0; i < edits.size(); i++)
+		{
+			const ChunkEdits& chunkEdits = edits[i];
+			m_EditPackets[i] = {};
+			m_EditPacketSizes[i] = 0;
+			if (chunkEdits.Edits.size() > m_Settings.MaxEditsPerPacket)
+				continue;
+
+			// var-uint index and block take at most 3 bytes each
+			uint64_t maxPacketSize = sizeof(PacketType) + sizeof(int32_t) * 3 + sizeof(uint32_t) * 2 + 5 + chunkEdits.Edits.size() * 6;
+			PacketBuffer packet = PacketBuffer::Allocate(maxPacketSize);
+			BufferStreamWriter stream(packet.GetBuffer());
+			stream.WriteRaw(PacketType::ChunkEdits);
+			WriteChunkCoord(stream, chunkEdits.Coord);
+			stream.WriteRaw<uint32_t>(chunkEdits.FromVersion);
+			stream.WriteRaw<uint32_t>(chunkEdits.ToVersion);
+
+			BitWriter bits(stream);
+			bits.WriteVarUInt((uint32_t)chunkEdits.Edits.size());
+			for (const BlockEdit& edit : chunkEdits.Edits)
+			{
+				bits.WriteVarUInt(edit.Index);
+				bits.WriteVarUInt(edit.Block);
+			}
+			bits.Flush();
+
+			m_EditPackets[i] = std::move(packet);
+			m_EditPacketSizes[i] = stream.GetBuffer().Size;
+		}
+
+		// everything that loads or generates chunks happens here, so the sends below can all
+		// read the world at once
+		float budget = (float)m_Settings.BytesPerSecond * dt;
+		float maxBudget = std::max((float)m_Settings.BurstBytes, budget);
+
+		m_ClientList.clear();
+		size_t maxQueued = 0;
+		for (auto& [clientID, client] : m_Clients)
+		{
+			Recenter(client, world);
+			client.Budget = std::min(client.Budget + budget, maxBudget);
+			maxQueued = std::max(maxQueued, std::min<size_t>(client.Queue.size(), m_Settings.MaxChunksPerTick));
+			m_ClientList.push_back(&client);
+		}
+
+		// each client's nearest chunk, then each one's second nearest and so on, so whatever
+		// doesn't get generated this tick is spread evenly over the clients
+		m_Loads.clear();
+		for (size_t i = 0; i < maxQueued; i++)
+		{
+			for (ClientStream* client : m_ClientList)
+			{
+				if (i < client->Queue.size() && i < m_Settings.MaxChunksPerTick)
+					m_Loads.push_back(client->Queue[client->Queue.size() - 1 - i]);
+			}
+		}
+		world.Load(m_Loads, jobs, m_Settings.MaxGeneratedPerTick * (jobs.GetWorkerCount() + 1));
+
+		jobs.ParallelFor((uint32_t)m_ClientList.size(), [&](uint32_t i) { Send(*m_ClientList[i], world, server, edits); });
+
+		// the sends are done reading the world, so nothing they hold on to goes away
+		m_EvictTimer += dt;
+		if (m_EvictTimer >= m_Settings.EvictInterval)
+		{
+			m_EvictTimer = 0.0f;
+			Evict(world);
+		}
+	}
+
+	void ChunkStreamer::Evict(ServerWorld& world)
+	{
+		CUBED_PROFILE_ZONE("ChunkStreamer::Evict");
+
+		// every client was just recentered, so everything it has or is about to be sent is at most
+		// a column past the view distance from its center
+		int32_t distance = m_Settings.ViewDistance + 1;
+		m_KeptColumns.clear();
+		for (const ClientStream* client : m_ClientList)
+		{
+			for (int32_t z = client->Center.Z - distance; z <= client->Center.Z + distance; z++)
+			{
+				for (int32_t x = client->Center.X - distance; x <= client->Center.X + distance; x++)
+					m_KeptColumns.insert({ x, 0, z });
+			}
+		}
+
+		world.Evict([this](const ChunkCoord& coord) { return m_KeptColumns.contains({ coord.X, 0, coord.Z }); });
+	}
+
+	void ChunkStreamer::Recenter(ClientStream& client, const ServerWorld& world)
+	{
+		// player positions are on the ground plane, x and z in the world
+		ChunkCoord center = {
+			(int32_t)glm::floor(client.Position.x / ChunkSize), 0,
+			(int32_t)glm::floor(client.Position.y / ChunkSize)
+		};
+		if (client.HasCenter && center == client.Center)
+			return;
+
+		client.Center = center;
+		client.HasCenter = true;
+
+		// chunks are only unloaded once they are a column past the view distance, so walking
+		// back and forth over a chunk border doesn't send the same chunks over and over
+		int32_t distance = m_Settings.ViewDistance;
+		for (auto it = client.Sent.begin(); it != client.Sent.end();)
+		{
+			const ChunkCoord& coord = it->first;
+			if (std::abs(coord.X - center.X) <= distance + 1 && std::abs(coord.Z - center.Z) <= distance + 1)
+			{
+				++it;
+				continue;
+			}
+
+			client.Unloads.push_back(coord);
+			it = client.Sent.erase(it);
+		}
+
+		const WorldSettings& worldSettings = world.GetSettings();
+		client.Queue.clear();
+		for (int32_t z = center.Z - distance; z <= center.Z + distance; z++)
+		{
+			for (int32_t x = center.X - distance; x <= center.X + distance; x++)
+			{
+				for (int32_t y = worldSettings.MinChunkY; y <= worldSettings.MaxChunkY; y++)
+				{
+					ChunkCoord coord = { x, y, z };
+					if (!client.Sent.contains(coord))
+						client.Queue.push_back(coord);
+				}
+			}
+		}
+
+		auto distanceSquared = [&center](const ChunkCoord& coord)
+		{
+			int32_t dx = coord.X - center.X, dy = coord.Y - center.Y, dz = coord.Z - center.Z;
+			return dx * dx + dy * dy + dz * dz;
+		};
+		std::sort(client.Queue.begin(), client.Queue.end(), [&distanceSquared](const ChunkCoord& a, const ChunkCoord& b)
+		{
+			return distanceSquared(a) > distanceSquared(b);
+		});
+
+		if (!client.Queue.empty())
+			client.Idle = false;
+	}
+
+	void ChunkStreamer::Send(ClientStream& client, const ServerWorld& world, Server& server, const std::vector<ChunkEdits>& edits)
+	{
+		Statistics& stats = client.Stats;
+
+		for (const ChunkCoord& coord : client.Unloads)
+		{
+			PacketBuffer packet = PacketBuffer::Allocate(sizeof(PacketType) + sizeof(int32_t) * 3);
+			BufferStreamWriter stream(packet.GetBuffer());
+			stream.WriteRaw(PacketType::ChunkUnload);
+			WriteChunkCoord(stream, coord);
+			server.SendBufferToClient(client.ClientID, stream.GetBuffer());
+		}
+		stats.ChunksUnloaded += client.Unloads.size();
+		client.Unloads.clear();
+
+		// edits first, a chunk sent below is already at the new version
+		for (size_t i = 0; i < edits.size(); i++)
+		{
+			auto it = client.Sent.find(edits[i].Coord);
+			if (it == client.Sent.end())
+				continue;
+
+			if (it->second != edits[i].FromVersion || !m_EditPackets[i])
+			{
+				// too many edits to be worth sending one by one, the chunk jumps the queue instead
+				client.Sent.erase(it);
+				client.Queue.push_back(edits[i].Coord);
+				client.Idle = false;
+				stats.ChunksResent++;
+				continue;
+			}
+
+			server.SendBufferToClient(client.ClientID, Buffer(m_EditPackets[i].GetData(), m_EditPacketSizes[i]));
+			it->second = edits[i].ToVersion;
+			stats.EditPacketsSent++;
+			stats.EditBytesSent += m_EditPacketSizes[i];
+		}
+
+		// a chunk bigger than what's left still goes out, the budget just goes into debt for it
+		uint32_t chunksSent = 0;
+		while (!client.Queue.empty() && chunksSent < m_Settings.MaxChunksPerTick && client.Budget > 0.0f)
+		{
+			const ChunkCoord& coord = client.Queue.back();
+			const ServerWorld::WorldChunk* chunk = world.Find(coord);
+			if (!chunk)
+				break; // not generated yet, or jumped the queue after loading, it goes next tick
+
+			PacketBuffer packet = PacketBuffer::Allocate(sizeof(PacketType) + sizeof(int32_t) * 3 + sizeof(uint32_t) + chunk->PayloadSize);
+			BufferStreamWriter stream(packet.GetBuffer());
+			stream.WriteRaw(PacketType::ChunkData);
+			WriteChunkCoord(stream, coord);
+			stream.WriteRaw<uint32_t>(chunk->Version);
+			stream.WriteData((const char*)chunk->Payload.GetData(), chunk->PayloadSize);
+
+			Buffer buffer = stream.GetBuffer();
+			server.SendBufferToClient(client.ClientID, buffer);
+
+			client.Sent[coord] = chunk->Version;
+			client.Budget -= (float)buffer.Size;
+			client.Queue.pop_back();
+			chunksSent++;
+
+			stats.ChunksSent++;
+			stats.ChunkBytesSent += buffer.Size;
+		}
+
+		if (client.Queue.empty() && !client.Idle)
+		{
+			PacketBuffer packet = PacketBuffer::Allocate(sizeof(PacketType) + sizeof(uint32_t));
+			BufferStreamWriter stream(packet.GetBuffer());
+			stream.WriteRaw(PacketType::ChunkStreamIdle);
+			stream.WriteRaw<uint32_t>((uint32_t)client.Sent.size());
+			server.SendBufferToClient(client.ClientID, stream.GetBuffer());
+			client.Idle = true;
+		}
+
+		stats.QueuedChunks = client.Queue.size();
+	}
+}
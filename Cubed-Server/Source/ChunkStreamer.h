@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stdint.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "Walnut/Networking/Server.h"
+
+#include "Chunk.h"
+#include "JobSystem.h"
+#include "PacketBuffer.h"
+#include "ServerWorld.h"
+
+namespace Cubed
+{
+	struct ChunkStreamSettings
+	{
+		int32_t ViewDistance = 8;             // in chunks, clients get the square of columns this far around them
+		uint32_t BytesPerSecond = 512 * 1024; // chunk data per client, edits don't count against it
+		uint32_t BurstBytes = 64 * 1024;      // budget a client that had nothing to send can save up
+		uint32_t MaxChunksPerTick = 64;       // per client, bounds how much one send tick does
+		uint32_t MaxGeneratedPerTick = 16;    // per thread over all clients, generating is the slow part of loading
+		uint32_t MaxEditsPerPacket = 256;     // a chunk with more edits in one tick is sent whole instead
+		float EvictInterval = 5.0f;           // seconds between sweeps for unedited chunks no client is near
+	};
+
+	//
+	// ChunkStreamer - sends the world to clients as they move through it
+	//
+	// Every client has a queue of the chunks in range it hasn't been sent yet, nearest first,
+	// rebuilt whenever it crosses into another chunk column. Each send tick a client's budget
+	// grows by its share of BytesPerSecond and chunks come off the front of the queue until it
+	// runs out, so a client that just joined fills in around itself over a few seconds instead
+	// of the server pushing everything at once. Chunks that fall out of range are unloaded on
+	// both ends. Every EvictInterval the world drops the unedited chunks outside every
+	// client's range, they are generated again if anyone comes back for them.
+	//
+	// Chunks a client is about to be sent are loaded first, generated on the job system if
+	// they have to be. Clients take turns at that, nearest chunks first, so one that just
+	// joined doesn't hold up the others.
+	//
+	// The streamer remembers the version of every chunk each client has, edits to those go out
+	// as small ChunkEdits packets (encoded once, sent to everyone who has the chunk) and never
+	// wait on the budget, so edits show up right away and in order.
+	//
+	// Tick thread only. Sending is spread over the job system, one client per job.
+	//
+	class ChunkStreamer
+	{
+	public:
+		struct Statistics
+		{
+			uint64_t ChunksSent = 0;
+			uint64_t ChunkBytesSent = 0;
+			uint64_t ChunksUnloaded = 0;
+			uint64_t ChunksResent = 0;    // had more edits than fit in a ChunkEdits packet
+			uint64_t EditPacketsSent = 0;
+			uint64_t EditBytesSent = 0;
+			uint64_t QueuedChunks = 0;    // over every client, at the end of the last update
+		};
+	public:
+		void AddClient(uint32_t clientID);
+		void RemoveClient(uint32_t clientID);
+
+		// where the client's player is, chunks are streamed around the latest position
+		void SetPosition(uint32_t clientID, const glm::vec2& position);
+		bool HasChunk(uint32_t clientID, const ChunkCoord& coord) const;
+
+		// flushes the world's edits and sends everything due, dt is the time since the last update
+		void Update(ServerWorld& world, Walnut::Server& server, JobSystem& jobs, float dt);
+
+		// every client gets its queue rebuilt with the next update
+		void SetViewDistance(int32_t distance);
+
+		ChunkStreamSettings& GetSettings() { return m_Settings; }
+		Statistics GetStatistics() const;
+	private:
+		struct ClientStream
+		{
+			uint32_t ClientID = 0;
+
+			glm::vec2 Position{ 0.0f };
+			ChunkCoord Center;
+			bool HasCenter = false;
+
+			// chunks sent and the version they were at, edits keep it up to date
+			std::unordered_map<ChunkCoord, uint32_t, ChunkCoordHash> Sent;
+			// nearest last, so sending pops off the back
+			std::vector<ChunkCoord> Queue;
+			std::vector<ChunkCoord> Unloads;
+
+			float Budget = 0.0f; // bytes
+			bool Idle = false;   // told the client its queue ran dry, and it hasn't refilled since
+
+			Statistics Stats;
+		};
+	private:
+		// queues what came into range around the client's new center and unloads what left it
+		void Recenter(ClientStream& client, const ServerWorld& world);
+		void Send(ClientStream& client, const ServerWorld& world, Walnut::Server& server, const std::vector<ChunkEdits>& edits);
+		void Evict(ServerWorld& world);
+	private:
+		ChunkStreamSettings m_Settings;
+
+		std::unordered_map<uint32_t, ClientStream> m_Clients;
+		std::vector<ClientStream*> m_ClientList;
+		std::vector<ChunkCoord> m_Loads;
+
+		float m_EvictTimer = 0.0f;
+		std::unordered_set<ChunkCoord, ChunkCoordHash> m_KeptColumns; // y is always 0
+
+		// one per entry of the flushed edits, empty if that chunk has to be sent whole
+		std::vector<PacketBuffer> m_EditPackets;
+		std::vector<uint64_t> m_EditPacketSizes;
+
+		// of clients that have disconnected, so the totals don't go backwards
+		Statistics m_RemovedStats;
+	};
+}
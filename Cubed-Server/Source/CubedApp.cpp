@@ -1,16 +1,92 @@
 #include "Walnut/Application.h"
 #include "Walnut/EntryPoint.h"
 
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <string_view>
+
 #include "Walnut/Core/Log.h"
 #include "ServerLayer.h"
+#include "BenchmarkLayer.h"
+#include "TickBenchmark.h"
+#include "WorldBenchmark.h"
+
+// options that run one benchmark instead of serving
+static constexpr Cubed::BenchmarkMode s_BenchmarkModes[] = {
+	{ "--world-bench", Cubed::CreateBenchmark<Cubed::WorldBenchmark> },
+	{ "--tick-bench", Cubed::CreateBenchmark<Cubed::TickBenchmark> },
+};
+
+struct ServerArguments
+{
+	const Cubed::BenchmarkMode* Benchmark = nullptr; // if set, run this with BenchmarkValue instead of serving
+	uint32_t BenchmarkValue = 0;
+	uint32_t Seed = 0; // terrain seed, has to be the same every time a saved world is served
+};
+
+// Cubed-Server
+// Cubed-Server --seed <seed>
+// Cubed-Server --world-bench <chunk count>
+// Cubed-Server --tick-bench <player count>
+static bool ParseArguments(int argc, char** argv, ServerArguments& arguments)
+{
+	auto parse = [](std::string_view value, auto& out)
+	{
+		auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), out);
+		return error == std::errc() && end == value.data() + value.size();
+	};
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string_view option = argv[i];
+		if (i + 1 >= argc)
+		{
+			std::cerr << "Missing value for " << option << std::endl;
+			return false;
+		}
+
+		std::string_view value = argv[++i];
+		auto benchmark = std::find_if(std::begin(s_BenchmarkModes), std::end(s_BenchmarkModes),
+			[option](const Cubed::BenchmarkMode& mode) { return mode.Option == option; });
+
+		bool valid = true;
+		if (benchmark != std::end(s_BenchmarkModes))
+		{
+			arguments.Benchmark = benchmark;
+			valid = parse(value, arguments.BenchmarkValue) && arguments.BenchmarkValue > 0;
+		}
+		else if (option == "--seed")
+			valid = parse(value, arguments.Seed);
+		else
+			valid = false;
+
+		if (!valid)
+		{
+			std::cerr << "Invalid option " << option << ' ' << value << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
 
 Walnut::Application* Walnut::CreateApplication(int argc, char** argv)
 {
+	ServerArguments arguments;
+	if (!ParseArguments(argc, argv, arguments))
+		std::exit(1);
+
 	Walnut::ApplicationSpecification spec;
 	spec.Name = "Cubed Server";
 
 	Walnut::Application* app = new Walnut::Application(spec);
-	app->PushLayer<Cubed::ServerLayer>();
+	if (arguments.Benchmark)
+		app->PushLayer(std::make_shared<Cubed::BenchmarkLayer>(arguments.Benchmark->Create(arguments.BenchmarkValue)));
+	else
+		app->PushLayer(std::make_shared<Cubed::ServerLayer>(Cubed::WorldSettings{ .Terrain = { .Seed = arguments.Seed } }));
 
 	return app;
-}
\ No newline at end of file
+}
@@ -1,25 +1,49 @@
 #include "ServerLayer.h"
 
-#include <chrono>
+#include <algorithm>
+#include <charconv>
+#include <thread>
 
 #include "Walnut/Core/Log.h"
 #include "Walnut/Serialization/BufferStream.h"
 
+#include "PacketBuffer.h"
+#include "Profiler.h"
 #include "ServerPacket.h"
 
 using namespace Walnut;
 
 namespace Cubed
 {
-	static Buffer s_ScratchBuffer;
+	// players only move on the ground plane, so reach is measured across it
+	static constexpr float s_BlockEditReach = 8.0f;
+	// edits per second, plus enough saved up to dig a small hole in one go
+	static constexpr float s_BlockEditRate = 10.0f;
+	static constexpr float s_BlockEditBurst = 20.0f;
+
+	ServerLayer::ServerLayer(const WorldSettings& worldSettings)
+		: m_World(worldSettings)
+	{
+	}
 
 	// Layer overrides
 
 	void ServerLayer::OnAttach()
 	{
-		s_ScratchBuffer.Allocate(10 * 1024 * 1024); // 10MB of scratch buffer
+		CUBED_PROFILE_THREAD("Main");
 
 		m_Console.SetMessageSendCallback([this](std::string_view message) { OnConsoleMessage(message); });
+
+		m_JobSystem = std::make_unique<JobSystem>();
+
+		if (m_WorldStorage.Start())
+			m_World.SetStorage(&m_WorldStorage);
+		else
+			WL_WARN_TAG("Server", "World storage unavailable, edits won't be saved");
+
+		m_Shards.reserve(m_ShardLayout.ShardCount);
+		for (uint32_t i = 0; i < m_ShardLayout.ShardCount; i++)
+			m_Shards.emplace_back(i, m_ShardLayout);
 	
 		m_Server.SetClientConnectedCallback([this](const ClientInfo& clientInfo) { OnClientConnected(clientInfo); });
 		m_Server.SetClientDisconnectedCallback([this](const ClientInfo& clientInfo) { OnClientDisconnected(clientInfo); });
@@ -30,24 +54,47 @@ namespace Cubed
 
 	void ServerLayer::OnDetach()
 	{
-		s_ScratchBuffer.Release();
 		m_Server.Stop();
+
+		// edits since the last send tick haven't been queued yet
+		m_World.FlushEdits();
+		m_WorldStorage.Stop();
 	}
 
 	void ServerLayer::OnUpdate(float ts)
 	{
-		BufferStreamWriter stream(s_ScratchBuffer);
-		stream.WriteRaw(PacketType::ClientUpdate);
-		m_PlayerDataMutex.lock();
+		CUBED_PROFILE_ZONE("ServerLayer::OnUpdate");
+
+		if (uint32_t rate = m_RequestedSimulationRate.exchange(0))
+			m_TickScheduler.SetSimulationRate(rate);
+		if (uint32_t rate = m_RequestedSendRate.exchange(0))
+			m_TickScheduler.SetSendRate(rate);
+		if (uint32_t threads = m_RequestedThreadCount.exchange(0))
 		{
-			stream.WriteMap(m_PlayerData);
+			// old workers have to be joined before the new ones start
+			m_JobSystem.reset();
+			m_JobSystem = std::make_unique<JobSystem>(threads - 1);
 		}
-		m_PlayerDataMutex.unlock();
+		if (uint32_t distance = m_RequestedViewDistance.exchange(0))
+			m_ChunkStreamer.SetViewDistance((int32_t)distance);
+		if (uint32_t rate = m_RequestedChunkRate.exchange(0))
+			m_ChunkStreamer.GetSettings().BytesPerSecond = rate * 1024;
 
-		m_Server.SendBufferToAllClients(stream.GetBuffer());
+		// ts is variable, simulation always advances in fixed steps
+		uint32_t ticks = m_TickScheduler.WaitForTicks();
+		for (uint32_t i = 0; i < ticks; i++)
+		{
+			bool sendTick = m_TickScheduler.BeginTick();
+
+			OnSimulationTick(m_TickScheduler.GetTickInterval());
+			if (sendTick)
+			{
+				SendSnapshots();
+				StreamChunks();
+			}
 
-		using namespace std::chrono_literals;
-		std::this_thread::sleep_for(5ms);
+			m_TickScheduler.EndTick();
+		}
 	}
 
 	void ServerLayer::OnUIRender()
@@ -61,10 +108,313 @@ namespace Cubed
 	{
 		if (message.starts_with('/'))
 		{
+			if (message == "/netstats")
+			{
+				size_t clientCount = m_ClientCount;
+				uint64_t snapshotTicks = m_SnapshotTicks;
+				uint64_t bytesPerTick = snapshotTicks ? m_SnapshotBytesSent / snapshotTicks : 0;
+				uint64_t clientUpdates = snapshotTicks * std::max<size_t>(clientCount, 1);
+				m_Console.AddTaggedMessage("Server", "{} clients, {} players, {} bytes/tick over {} ticks, {} full snapshots, ~{} players in view per client, {} dropped updates, {} rejected inputs, {} lost inputs",
+					clientCount, m_PlayerCount.load(), bytesPerTick, snapshotTicks, m_FullSnapshotsSent.load(),
+					clientUpdates ? m_InterestEntriesSent / clientUpdates : 0, m_DroppedUpdates.load(), m_RejectedInputs.load(), m_SkippedInputs.load());
+
+				PacketBuffer::Statistics packetStats = PacketBuffer::GetStatistics();
+				m_Console.AddTaggedMessage("Server", "Packet buffers: {} heap allocations last send tick, {} total, {} reused, {} cross-thread frees",
+					m_PacketHeapAllocationsLastTick.load(), packetStats.HeapAllocations, packetStats.PoolAllocations, packetStats.CrossThreadFrees);
+				return;
+			}
+
+			if (message == "/tickstats")
+			{
+				TickScheduler::Statistics stats = m_TickScheduler.GetStatistics();
+				m_Console.AddTaggedMessage("Server", "{}Hz simulation, {}Hz send, {} ticks, p50 {:.3f}ms, p99 {:.3f}ms, max {:.3f}ms, {} overruns, {} skipped",
+					stats.SimulationRate, stats.SendRate, stats.TickCount, stats.P50TickDuration, stats.P99TickDuration,
+					stats.MaxTickDuration, stats.OverrunCount, stats.SkippedTicks);
+
+				JobSystem::Statistics jobStats = m_JobSystem->GetStatistics();
+				m_Console.AddTaggedMessage("Server", "{} threads, {} shards, {} jobs, {} stolen, {} shard handoffs",
+					jobStats.WorkerCount + 1, m_ShardLayout.ShardCount, jobStats.JobsExecuted, jobStats.JobsStolen, m_HandoffCount.load());
+				return;
+			}
+
+			if (message == "/worldstats")
+			{
+				m_Console.AddTaggedMessage("Server", "{} chunks in the world, {} block edits ({} rejected), {} chunks queued to send",
+					m_WorldChunkCount.load(), m_BlockEdits.load(), m_RejectedBlockEdits.load(), m_QueuedChunks.load());
+				m_Console.AddTaggedMessage("Server", "Chunks: {} sent ({} KB), {} unloaded, {} resent, {} edit packets ({} KB)",
+					m_ChunksSent.load(), m_ChunkBytesSent / 1024, m_ChunksUnloaded.load(), m_ChunksResent.load(),
+					m_ChunkEditPacketsSent.load(), m_ChunkEditBytesSent / 1024);
+
+				const TerrainSettings& terrain = m_World.GetSettings().Terrain;
+				m_Console.AddTaggedMessage("Server", "Terrain: seed {}, {} noise, {} chunks generated, {} evicted",
+					terrain.Seed, SimdLevelToString(GetSupportedSimdLevel()), m_ChunksGenerated.load(), m_ChunksEvicted.load());
+
+				WorldStorage::Statistics storageStats = m_WorldStorage.GetStatistics();
+				m_Console.AddTaggedMessage("Server", "Storage: {} chunks loaded, {} saved ({} KB) over {} flushes (last {:.2f}ms), {} pending, {} failed writes, {} regions open ({} upgraded), {} damaged",
+					storageStats.ChunksLoaded, storageStats.ChunksSaved, storageStats.BytesSaved / 1024, storageStats.Flushes,
+					storageStats.LastFlushTime, storageStats.PendingChunks, storageStats.FailedWrites, storageStats.RegionsOpen,
+					storageStats.RegionsUpgraded, storageStats.DamagedChunks);
+				return;
+			}
+
+			// "/save" - writes edited chunks out now instead of at the next flush interval
+			if (message == "/save")
+			{
+				m_WorldStorage.RequestFlush();
+				m_Console.AddTaggedMessage("Server", "Saving world to {}", m_WorldStorage.GetSettings().Directory.string());
+				return;
+			}
+
+#if CUBED_PROFILING
+			// "/profile" or "/profile <path>" - writes the last few seconds of every thread's zones as a
+			// Chrome trace, open it in chrome://tracing or ui.perfetto.dev
+			if (message == "/profile" || message.starts_with("/profile "))
+			{
+				std::string_view path = message.size() > 9 ? message.substr(9) : "ServerProfile.json";
+				if (Profiler::WriteChromeTrace(path))
+					m_Console.AddTaggedMessage("Server", "Wrote profile to {}", path);
+				else
+					m_Console.AddTaggedMessage("Server", "Could not write profile to {}", path);
+				return;
+			}
+#endif
+
+			// "/tickrate <hz>" and "/sendrate <hz>"
+			auto parseRate = [message](std::string_view command, uint32_t& rate)
+			{
+				if (!message.starts_with(command))
+					return false;
+
+				std::string_view arg = message.substr(command.size());
+				while (arg.starts_with(' '))
+					arg.remove_prefix(1);
+
+				auto [end, error] = std::from_chars(arg.data(), arg.data() + arg.size(), rate);
+				return error == std::errc() && rate > 0;
+			};
+
+			uint32_t rate;
+			if (parseRate("/tickrate", rate))
+			{
+				m_RequestedSimulationRate = rate;
+				m_Console.AddTaggedMessage("Server", "Simulation rate set to {}Hz", rate);
+				return;
+			}
+			if (parseRate("/sendrate", rate))
+			{
+				m_RequestedSendRate = rate;
+				m_Console.AddTaggedMessage("Server", "Send rate set to {}Hz", rate);
+				return;
+			}
+			// "/threads <n>" - threads (including the tick thread) the shards are spread over
+			if (parseRate("/threads", rate))
+			{
+				m_RequestedThreadCount = rate;
+				m_Console.AddTaggedMessage("Server", "Simulating on {} threads", rate);
+				return;
+			}
+			// "/viewdistance <chunks>" and "/chunkrate <KB/s>" - chunk streaming, per client
+			if (parseRate("/viewdistance", rate))
+			{
+				m_RequestedViewDistance = rate;
+				m_Console.AddTaggedMessage("Server", "Streaming chunks {} columns around each player", rate);
+				return;
+			}
+			if (parseRate("/chunkrate", rate))
+			{
+				m_RequestedChunkRate = rate;
+				m_Console.AddTaggedMessage("Server", "Streaming chunks at up to {} KB/s per client", rate);
+				return;
+			}
+
 			std::cout << "You called the " << message << " command!" << std::endl;
 		}
 	}
 
+	// ticking
+
+	void ServerLayer::OnSimulationTick(float dt)
+	{
+		CUBED_PROFILE_ZONE("ServerLayer::OnSimulationTick");
+
+		// movement is server authoritative, every shard steps its players through the inputs that
+		// arrived since the last tick (within each client's input budget), so every client's
+		// snapshot this tick is built from the same world
+		m_SimulationTime += dt;
+
+		for (auto& [clientID, budget] : m_BlockEditBudgets)
+			budget = std::min(budget + dt * s_BlockEditRate, s_BlockEditBurst);
+
+		RouteInboundEvents();
+		m_JobSystem->ParallelFor((uint32_t)m_Shards.size(), [this, dt](uint32_t i) { m_Shards[i].Simulate(dt); });
+		ApplyHandoffs();
+
+		size_t playerCount = 0;
+		for (const ServerShard& shard : m_Shards)
+			playerCount += shard.GetPlayerCount();
+
+		m_ClientCount = m_ClientShards.size();
+		m_PlayerCount = playerCount;
+	}
+
+	void ServerLayer::RouteInboundEvents()
+	{
+		CUBED_PROFILE_ZONE("ServerLayer::RouteInboundEvents");
+
+		InboundEvent event;
+		while (m_InboundEvents.Pop(event))
+		{
+			auto it = m_ClientShards.find(event.ClientID);
+			switch (event.EventType)
+			{
+			case InboundEvent::Type::Connected:
+				// any shard will do, it spawns the player and hands it to whoever owns the spawn point
+				if (it == m_ClientShards.end())
+				{
+					it = m_ClientShards.emplace(event.ClientID, event.ClientID % m_ShardLayout.ShardCount).first;
+					m_BlockEditBudgets[event.ClientID] = s_BlockEditBurst;
+					m_ChunkStreamer.AddClient(event.ClientID);
+				}
+				break;
+			case InboundEvent::Type::Disconnected:
+				if (it == m_ClientShards.end())
+					continue;
+
+				m_Shards[it->second].PushEvent(event);
+				m_ClientShards.erase(it);
+				m_BlockEditBudgets.erase(event.ClientID);
+				m_ChunkStreamer.RemoveClient(event.ClientID);
+				continue;
+			case InboundEvent::Type::SetBlock:
+				if (it != m_ClientShards.end() && CanEditBlock(event, it->second))
+					m_World.SetBlock(event.BlockPosition, event.Block);
+				else
+					m_RejectedBlockEdits++;
+				continue;
+			case InboundEvent::Type::Input:
+				// client may have disconnected after sending this
+				if (it == m_ClientShards.end())
+					continue;
+				break;
+			default:
+				continue;
+			}
+
+			m_Shards[it->second].PushEvent(event);
+		}
+	}
+
+	bool ServerLayer::CanEditBlock(const InboundEvent& event, uint32_t shard)
+	{
+		if (event.Block >= BlockTypeCount)
+			return false;
+
+		// clients can only change what they can see...
+		if (!m_ChunkStreamer.HasChunk(event.ClientID, ChunkCoord::FromBlock(event.BlockPosition)))
+			return false;
+
+		// ...and what their player can reach
+		glm::vec2 position;
+		if (!m_Shards[shard].GetPlayerPosition(event.ClientID, position))
+			return false;
+
+		glm::vec2 blockCenter((float)event.BlockPosition.x + 0.5f, (float)event.BlockPosition.z + 0.5f);
+		if (glm::length(blockCenter - position) > s_BlockEditReach)
+			return false;
+
+		float& budget = m_BlockEditBudgets[event.ClientID];
+		if (budget < 1.0f)
+			return false;
+
+		budget -= 1.0f;
+		return true;
+	}
+
+	void ServerLayer::ApplyHandoffs()
+	{
+		// shards only queue handoffs during their own phase, moving them across happens here
+		// on the tick thread once every shard is done, so nobody sees a half moved player
+		for (ServerShard& shard : m_Shards)
+		{
+			std::vector<ServerShard::Handoff>& handoffs = shard.GetOutgoingHandoffs();
+			for (ServerShard::Handoff& handoff : handoffs)
+			{
+				m_ClientShards[handoff.ClientID] = handoff.TargetShard;
+				m_Shards[handoff.TargetShard].AcceptHandoff(handoff);
+			}
+
+			m_HandoffCount += handoffs.size();
+			handoffs.clear();
+		}
+	}
+
+	void ServerLayer::SendSnapshots()
+	{
+		if (m_ClientShards.empty())
+			return;
+
+		CUBED_PROFILE_ZONE("ServerLayer::SendSnapshots");
+
+		ServerShard::SendContext context;
+		context.Server = &m_Server;
+		context.SnapshotID = m_NextSnapshotID++;
+		context.ServerTime = (uint32_t)(m_SimulationTime * 1000.0);
+		context.DeltaSettings = m_SnapshotSettings;
+		context.Interest = m_InterestSettings;
+		context.Shards = &m_Shards;
+
+		if (m_NextSnapshotID == NoSnapshotBaseline)
+			m_NextSnapshotID++;
+
+		uint64_t heapAllocations = PacketBuffer::GetStatistics().HeapAllocations;
+
+		// interest queries look into neighbouring shards, so every grid has to be built first
+		m_JobSystem->ParallelFor((uint32_t)m_Shards.size(), [this](uint32_t i) { m_Shards[i].BuildGrid(); });
+		m_JobSystem->ParallelFor((uint32_t)m_Shards.size(), [this, &context](uint32_t i) { m_Shards[i].SendSnapshots(context); });
+
+		for (ServerShard& shard : m_Shards)
+		{
+			ServerShard::Statistics& stats = shard.GetStatistics();
+			m_InterestEntriesSent += stats.InterestEntriesSent;
+			m_SnapshotBytesSent += stats.SnapshotBytesSent;
+			m_FullSnapshotsSent += stats.FullSnapshotsSent;
+			m_RejectedInputs += stats.InputsRejected;
+			m_SkippedInputs += stats.InputsSkipped;
+			stats = {};
+		}
+
+		m_SnapshotTicks++;
+		m_PacketHeapAllocationsLastTick = PacketBuffer::GetStatistics().HeapAllocations - heapAllocations;
+	}
+
+	void ServerLayer::StreamChunks()
+	{
+		CUBED_PROFILE_ZONE("ServerLayer::StreamChunks");
+
+		for (const auto& [clientID, shard] : m_ClientShards)
+		{
+			glm::vec2 position;
+			if (m_Shards[shard].GetPlayerPosition(clientID, position))
+				m_ChunkStreamer.SetPosition(clientID, position);
+		}
+
+		m_ChunkStreamer.Update(m_World, m_Server, *m_JobSystem, (float)(m_SimulationTime - m_LastChunkStreamTime));
+		m_LastChunkStreamTime = m_SimulationTime;
+
+		ChunkStreamer::Statistics stats = m_ChunkStreamer.GetStatistics();
+		m_WorldChunkCount = m_World.GetChunkCount();
+		m_BlockEdits = m_World.GetStatistics().BlockEdits;
+		m_ChunksGenerated = m_World.GetStatistics().ChunksGenerated;
+		m_ChunksEvicted = m_World.GetStatistics().ChunksEvicted;
+		m_ChunksSent = stats.ChunksSent;
+		m_ChunkBytesSent = stats.ChunkBytesSent;
+		m_ChunksUnloaded = stats.ChunksUnloaded;
+		m_ChunksResent = stats.ChunksResent;
+		m_ChunkEditPacketsSent = stats.EditPacketsSent;
+		m_ChunkEditBytesSent = stats.EditBytesSent;
+		m_QueuedChunks = stats.QueuedChunks;
+	}
+
 	// server callbacks
 
 	void ServerLayer::OnClientConnected(const ClientInfo& clientInfo)
@@ -72,38 +422,68 @@ namespace Cubed
 		WL_INFO_TAG("Server", "Client connected! ID = {}", clientInfo.ID);
 
 		//send back client ID to client so they can identify themselves
-		BufferStreamWriter stream(s_ScratchBuffer);
+		// (network thread, so this comes out of the network thread's own packet arena)
+		PacketBuffer packet = PacketBuffer::Allocate(sizeof(PacketType) + sizeof(clientInfo.ID));
+		BufferStreamWriter stream(packet.GetBuffer());
 
 		stream.WriteRaw(PacketType::ClientConnect);
 		stream.WriteRaw(clientInfo.ID);
 
 		m_Server.SendBufferToClient(clientInfo.ID, stream.GetBuffer());
+
+		// connect/disconnect events must never be lost, so wait for room if we have to
+		InboundEvent event{ .EventType = InboundEvent::Type::Connected, .ClientID = clientInfo.ID };
+		while (!m_InboundEvents.Push(event))
+			std::this_thread::yield();
 	}
 
 	void ServerLayer::OnClientDisconnected(const ClientInfo& clientInfo)
 	{
 		WL_INFO_TAG("Server", "Client disconnected! ID = {}", clientInfo.ID);
+
+		InboundEvent event{ .EventType = InboundEvent::Type::Disconnected, .ClientID = clientInfo.ID };
+		while (!m_InboundEvents.Push(event))
+			std::this_thread::yield();
 	}
 
 	void ServerLayer::OnDataReceived(const ClientInfo& clientInfo, const Buffer buffer)
 	{
+		CUBED_PROFILE_ZONE("ServerLayer::OnDataReceived");
+
 		BufferStreamReader stream(buffer);
 
 		PacketType type;
-		stream.ReadRaw(type);
+		if (!stream.ReadRaw(type))
+			return;
+
 		switch (type)
 		{
-		case PacketType::ClientUpdate:
+		case PacketType::ClientInput:
+		{
+			InboundEvent event{ .EventType = InboundEvent::Type::Input, .ClientID = clientInfo.ID };
+			BitReader bits(stream);
+			if (!bits.ReadVarUInt(event.AckedSnapshotID) || !ReadPlayerInputs(bits, event.Inputs.data(), event.InputCount))
+				break;
 
-			m_PlayerDataMutex.lock();
-			{
-				PlayerData& playerData = m_PlayerData[clientInfo.ID];
-				stream.ReadRaw<glm::vec2>(playerData.Position);
-				stream.ReadRaw<glm::vec2>(playerData.Velocity);
-			}
-			m_PlayerDataMutex.unlock();
+			// tick is too far behind to keep up, these inputs are lost and the client gets
+			// corrected by its next snapshot
+			if (!m_InboundEvents.Push(event))
+				m_DroppedUpdates++;
 
 			break;
 		}
+		case PacketType::SetBlock:
+		{
+			InboundEvent event{ .EventType = InboundEvent::Type::SetBlock, .ClientID = clientInfo.ID };
+			if (!stream.ReadRaw<int32_t>(event.BlockPosition.x) || !stream.ReadRaw<int32_t>(event.BlockPosition.y)
+				|| !stream.ReadRaw<int32_t>(event.BlockPosition.z) || !stream.ReadRaw<BlockID>(event.Block))
+				break;
+
+			if (!m_InboundEvents.Push(event))
+				m_DroppedUpdates++;
+
+			break;
+		}
+		}
 	}
 }
\ No newline at end of file
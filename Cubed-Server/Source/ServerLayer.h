@@ -1,18 +1,30 @@
 #pragma once
 
-#include <map>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
 #include "glm/glm.hpp"
 #include "Walnut/Layer.h"
 #include "Walnut/Networking/Server.h"
 
+#include "ChunkStreamer.h"
 #include "HeadlessConsole.h"
+#include "JobSystem.h"
+#include "MPSCQueue.h"
+#include "ServerShard.h"
+#include "ServerWorld.h"
+#include "TickScheduler.h"
+#include "WorldStorage.h"
 
 namespace Cubed
 {
 	class ServerLayer : public Walnut::Layer
 	{
 	public:
+		ServerLayer(const WorldSettings& worldSettings = {});
+
 		virtual void OnAttach() override;
 		virtual void OnDetach() override;
 
@@ -26,18 +38,81 @@ namespace Cubed
 		void OnClientConnected(const Walnut::ClientInfo& clientInfo);
 		void OnClientDisconnected(const Walnut::ClientInfo& clientInfo);
 		void OnDataReceived(const Walnut::ClientInfo& clientInfo, const Walnut::Buffer buffer);
+
+		// ticking, OnUpdate coordinates and the shards do the work
+		void OnSimulationTick(float dt);
+		void RouteInboundEvents();
+		// spends from the client's edit budget if the edit is one it's allowed to make
+		bool CanEditBlock(const InboundEvent& event, uint32_t shard);
+		void ApplyHandoffs();
+		void SendSnapshots();
+		void StreamChunks();
 	private:
 		HeadlessConsole m_Console;
 		Walnut::Server m_Server{ 8192 };
 
-		struct PlayerData
-		{
-			glm::vec2 Position;
-			glm::vec2 Velocity;
-		};
+		TickScheduler m_TickScheduler;
+
+		// rates requested from the console, applied on the tick thread (0 = no change)
+		std::atomic<uint32_t> m_RequestedSimulationRate = 0;
+		std::atomic<uint32_t> m_RequestedSendRate = 0;
+		std::atomic<uint32_t> m_RequestedThreadCount = 0;
+		std::atomic<uint32_t> m_RequestedViewDistance = 0;
+		std::atomic<uint32_t> m_RequestedChunkRate = 0; // in KB/s
+
+		// saves on a thread of its own, safe to use from anywhere
+		WorldStorage m_WorldStorage;
+
+		MPSCQueue<InboundEvent> m_InboundEvents{ 65536 };
+		std::atomic<uint64_t> m_DroppedUpdates = 0;
+
+		// everything below is owned by the tick thread
+
+		std::unique_ptr<JobSystem> m_JobSystem;
+
+		ShardLayout m_ShardLayout;
+		std::vector<ServerShard> m_Shards;
+
+		// which shard currently owns each client, so inbound events can be routed
+		std::unordered_map<uint32_t, uint32_t> m_ClientShards;
+		// block edits each client has left, refilled every tick
+		std::unordered_map<uint32_t, float> m_BlockEditBudgets;
+
+		// advances by exactly one tick interval per tick, snapshots are stamped with it
+		double m_SimulationTime = 0.0;
+
+		uint32_t m_NextSnapshotID = 1;
+		SnapshotDeltaSettings m_SnapshotSettings;
+		InterestSettings m_InterestSettings;
+
+		ServerWorld m_World;
+		ChunkStreamer m_ChunkStreamer;
+		double m_LastChunkStreamTime = 0.0;
+
+		// bandwidth stats for /netstats, written by the tick thread and read by the console
+		std::atomic<size_t> m_ClientCount = 0;
+		std::atomic<size_t> m_PlayerCount = 0;
+		std::atomic<uint64_t> m_InterestEntriesSent = 0;
+		std::atomic<uint64_t> m_SnapshotBytesSent = 0;
+		std::atomic<uint64_t> m_SnapshotTicks = 0;
+		std::atomic<uint64_t> m_FullSnapshotsSent = 0;
+		std::atomic<uint64_t> m_RejectedInputs = 0;
+		std::atomic<uint64_t> m_SkippedInputs = 0;
+		std::atomic<uint64_t> m_PacketHeapAllocationsLastTick = 0;
+		std::atomic<uint64_t> m_HandoffCount = 0;
 
-		// lock-safe map
-		std::mutex m_PlayerDataMutex;
-		std::map<uint32_t, PlayerData> m_PlayerData;
+		// world stats for /worldstats, same deal
+		std::atomic<size_t> m_WorldChunkCount = 0;
+		std::atomic<uint64_t> m_BlockEdits = 0;
+		std::atomic<uint64_t> m_RejectedBlockEdits = 0;
+		std::atomic<uint64_t> m_ChunksSent = 0;
+		std::atomic<uint64_t> m_ChunkBytesSent = 0;
+		std::atomic<uint64_t> m_ChunksUnloaded = 0;
+		std::atomic<uint64_t> m_ChunksResent = 0;
+		std::atomic<uint64_t> m_ChunkEditPacketsSent = 0;
+		std::atomic<uint64_t> m_ChunkEditBytesSent = 0;
+		std::atomic<uint64_t> m_QueuedChunks = 0;
+		std::atomic<uint64_t> m_ChunksGenerated = 0;
+		std::atomic<uint64_t> m_ChunksEvicted = 0;
 	};
 }
\ No newline at end of file
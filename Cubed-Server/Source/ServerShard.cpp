@@ -0,0 +1,254 @@
+#include "ServerShard.h"
+
+#include <algorithm>
+
+#include "Walnut/Serialization/BufferStream.h"
+
+#include "PacketBuffer.h"
+#include "ServerPacket.h"
+
+using namespace Walnut;
+
+namespace Cubed
+{
+	void ClientSnapshotState::Acknowledge(uint32_t snapshotID)
+	{
+		// stale or duplicate acks won't be in the pending list anymore
+		for (uint32_t i = 0; i < PendingCount; i++)
+		{
+			Snapshot& acked = GetPending(i);
+			if (acked.ID != snapshotID)
+				continue;
+
+			// swap rather than move so the old baseline's storage gets reused by the ring
+			AckedID = snapshotID;
+			std::swap(AckedBaseline, acked.Players);
+
+			// anything older than the acked snapshot can never become a baseline
+			PendingStart = (PendingStart + i + 1) % MaxPendingSnapshots;
+			PendingCount -= i + 1;
+
+			// a client that keeps up then only ever swaps between the first slot and its baseline,
+			// so just those two have to grow to fit its view rather than every slot in the ring
+			if (PendingCount == 0)
+				PendingStart = 0;
+			return;
+		}
+	}
+
+	ServerShard::ServerShard(uint32_t index, const ShardLayout& layout)
+		: m_Index(index), m_Layout(layout)
+	{
+	}
+
+	void ServerShard::AcceptHandoff(Handoff& handoff)
+	{
+		m_Players.Insert(handoff.ClientID, handoff.Data);
+		if (handoff.Client)
+			m_Clients.insert(std::move(handoff.Client));
+		else
+			m_Clients[handoff.ClientID] = {};
+	}
+
+	bool ServerShard::GetPlayerPosition(uint32_t clientID, glm::vec2& outPosition) const
+	{
+		size_t index = m_Players.GetIndex(clientID);
+		if (index == SIZE_MAX)
+			return false;
+
+		outPosition = m_Players.GetPositions()[index];
+		return true;
+	}
+
+	bool ServerShard::GetPlayer(uint32_t clientID, PlayerData& outData, uint32_t& outLastProcessedInput) const
+	{
+		auto it = m_Clients.find(clientID);
+		size_t index = m_Players.GetIndex(clientID);
+		if (it == m_Clients.end() || index == SIZE_MAX)
+			return false;
+
+		outData = m_Players.Get(index);
+		outLastProcessedInput = it->second.LastProcessedInput;
+		return true;
+	}
+
+	void ServerShard::Simulate(float dt)
+	{
+		float earned = dt * PlayerInputRate;
+		for (auto& [clientID, state] : m_Clients)
+			state.InputBudget = std::min(state.InputBudget + earned, MaxInputBurst);
+
+		for (const InboundEvent& event : m_Events)
+		{
+			switch (event.EventType)
+			{
+			case InboundEvent::Type::Connected:
+				// no baseline yet, first snapshot will be a full one
+				// (if spawn isn't in our stripes the handoff below sends the player on its way)
+				m_Clients[event.ClientID] = {};
+				m_Players.Insert(event.ClientID, GetSpawnPlayerData());
+				break;
+			case InboundEvent::Type::Disconnected:
+				m_Players.Remove(event.ClientID);
+				m_Clients.erase(event.ClientID);
+				break;
+			case InboundEvent::Type::Input:
+			{
+				auto it = m_Clients.find(event.ClientID);
+				size_t index = m_Players.GetIndex(event.ClientID);
+				if (it == m_Clients.end() || index == SIZE_MAX)
+					break;
+
+				// server is authoritative, the client only ever tells us what it pressed
+				ClientSnapshotState& state = it->second;
+				PlayerData player = m_Players.Get(index);
+				for (uint32_t i = 0; i < event.InputCount; i++)
+				{
+					const PlayerInput& input = event.Inputs[i];
+					if (input.Sequence <= state.LastProcessedInput)
+						continue; // already applied
+
+					// inputs arrive in order, so a gap means the inbound queue was full and dropped some.
+					// Carry on from here, the client forgets the lost ones once it sees we're past them.
+					// The first input can start anywhere, a reconnecting client keeps counting from where it was
+					if (state.LastProcessedInput != 0)
+						m_Statistics.InputsSkipped += input.Sequence - state.LastProcessedInput - 1;
+
+					// over budget inputs still count as processed, so the client reconciles without them
+					state.LastProcessedInput = input.Sequence;
+					if (state.InputBudget < 1.0f)
+					{
+						m_Statistics.InputsRejected++;
+						continue;
+					}
+
+					state.InputBudget -= 1.0f;
+					ApplyPlayerInput(player, input, m_MovementSettings);
+				}
+				m_Players.Set(index, player);
+
+				if (event.AckedSnapshotID != NoSnapshotBaseline)
+					state.Acknowledge(event.AckedSnapshotID);
+				break;
+			}
+			}
+		}
+		m_Events.clear();
+
+		// players that walked out of our stripes go over to whoever owns them now,
+		// removal swaps the last player into this index so only advance when keeping one
+		for (size_t i = 0; i < m_Players.Size();)
+		{
+			uint32_t target = m_Layout.GetShard(m_Players.GetPositions()[i]);
+			if (target == m_Index)
+			{
+				i++;
+				continue;
+			}
+
+			uint32_t clientID = m_Players.GetIDs()[i];
+			auto it = m_Clients.find(clientID);
+
+			Handoff& handoff = m_OutgoingHandoffs.emplace_back();
+			handoff.ClientID = clientID;
+			handoff.TargetShard = target;
+			handoff.Data = m_Players.Get(i);
+			handoff.Client = m_Clients.extract(it);
+
+			m_Players.Remove(clientID);
+		}
+	}
+
+	void ServerShard::BuildGrid()
+	{
+		m_SpatialGrid.Clear();
+		for (size_t i = 0; i < m_Players.Size(); i++)
+			m_SpatialGrid.Insert(m_Players.GetIDs()[i], m_Players.Get(i));
+		m_SpatialGrid.Build();
+	}
+
+	void ServerShard::SendSnapshots(const SendContext& context)
+	{
+		for (auto& [clientID, state] : m_Clients)
+		{
+			// client is not acknowledging, drop its baseline and send everything
+			if (state.PendingCount == MaxPendingSnapshots)
+			{
+				state.AckedID = NoSnapshotBaseline;
+				state.AckedBaseline.Clear();
+				state.PendingCount = 0;
+			}
+
+			if (state.AckedID == NoSnapshotBaseline)
+				m_Statistics.FullSnapshotsSent++;
+
+			// what the client currently believes is in view, for hysteresis
+			const EntityStore& previousView = state.PendingCount ? state.GetPending(state.PendingCount - 1).Players : state.AckedBaseline;
+			GatherInterest(context, clientID, previousView, m_Interest);
+			m_Statistics.InterestEntriesSent += m_Interest.Size();
+
+			// worst case: every player in view changed and everything in the baseline was removed,
+			// bit-packed players are always smaller than raw ones but var-uint IDs can take 5 bytes
+			uint64_t maxPacketSize = sizeof(PacketType) + sizeof(uint32_t) * 6 + sizeof(PlayerData)
+				+ m_Interest.Size() * (sizeof(uint32_t) + sizeof(PlayerData))
+				+ state.AckedBaseline.Size() * (sizeof(uint32_t) + 1);
+			PacketBuffer packet = PacketBuffer::Allocate(maxPacketSize);
+
+			BufferStreamWriter stream(packet.GetBuffer());
+			stream.WriteRaw(PacketType::ClientUpdate);
+			stream.WriteRaw<uint32_t>(context.SnapshotID);
+			stream.WriteRaw<uint32_t>(state.AckedID);
+			stream.WriteRaw<uint32_t>(context.ServerTime);
+
+			// exactly where the client's own player ended up, for its prediction
+			size_t self = m_Players.GetIndex(clientID);
+			stream.WriteRaw<uint32_t>(state.LastProcessedInput);
+			stream.WriteRaw<PlayerData>(self != SIZE_MAX ? m_Players.Get(self) : GetSpawnPlayerData());
+
+			Snapshot& sent = state.GetPending(state.PendingCount++);
+			sent.ID = context.SnapshotID;
+			WriteSnapshotDelta(stream, state.AckedBaseline, m_Interest, context.DeltaSettings, sent.Players);
+
+			// sockets are safe to send on from any thread
+			Buffer buffer = stream.GetBuffer();
+			if (context.Server)
+				context.Server->SendBufferToClient(clientID, buffer);
+			m_Statistics.SnapshotBytesSent += buffer.Size;
+		}
+	}
+
+	void ServerShard::GatherInterest(const SendContext& context, uint32_t clientID, const EntityStore& previousView, EntityStore& outInterest)
+	{
+		outInterest.Clear();
+
+		size_t self = m_Players.GetIndex(clientID);
+		if (self == SIZE_MAX)
+			return; // haven't heard where this client is yet
+
+		glm::vec2 center = m_Players.GetPositions()[self];
+		float queryRadius = context.Interest.Radius + context.Interest.Hysteresis;
+		float enterRadiusSquared = context.Interest.Radius * context.Interest.Radius;
+
+		// neighbouring players can live in any shard whose stripes the query overlaps,
+		// consecutive stripes belong to different shards until they wrap around
+		m_InterestQueryResults.clear();
+		int32_t firstStripe = m_Layout.GetStripe(center.x - queryRadius);
+		int32_t lastStripe = m_Layout.GetStripe(center.x + queryRadius);
+		uint32_t stripeCount = (uint32_t)std::min<int64_t>((int64_t)lastStripe - firstStripe + 1, m_Layout.ShardCount);
+		for (uint32_t i = 0; i < stripeCount; i++)
+		{
+			const ServerShard& shard = (*context.Shards)[m_Layout.GetShard(firstStripe + (int32_t)i)];
+			shard.GetGrid().Query(center, queryRadius, m_InterestQueryResults);
+		}
+
+		for (const SpatialGrid::Entry& entry : m_InterestQueryResults)
+		{
+			// anything between the inner and outer radius only stays if it was already visible
+			glm::vec2 diff = entry.Data.Position - center;
+			if (glm::dot(diff, diff) > enterRadiusSquared && !previousView.Contains(entry.ID))
+				continue;
+
+			outInterest.Insert(entry.ID, entry.Data);
+		}
+	}
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <map>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "Walnut/Networking/Server.h"
+
+#include "Chunk.h"
+#include "PlayerMovement.h"
+#include "Snapshot.h"
+#include "SpatialGrid.h"
+
+namespace Cubed
+{
+	// network callbacks never touch tick state directly, they push these into a queue and the
+	// tick thread hands each one to the shard that owns the client
+	struct InboundEvent
+	{
+		enum class Type : uint8_t { None = 0, Connected, Disconnected, Input, SetBlock };
+
+		Type EventType = Type::None;
+		uint32_t ClientID = 0;
+		uint32_t AckedSnapshotID = NoSnapshotBaseline;
+
+		uint32_t InputCount = 0;
+		std::array<PlayerInput, MaxInputsPerPacket> Inputs;
+
+		// SetBlock only, the world is the coordinator's so these never reach a shard
+		glm::ivec3 BlockPosition{ 0 };
+		BlockID Block = AirBlock;
+	};
+
+	// interest management, clients only hear about players near them
+	struct InterestSettings
+	{
+		float Radius = 64.0f;
+		// players already in view stay until they are this much further out, stops flickering at the edge
+		float Hysteresis = 8.0f;
+	};
+
+	// the world is cut into stripes along x which are dealt out to shards round robin,
+	// so a crowd in one spot still ends up spread over a few shards
+	struct ShardLayout
+	{
+		uint32_t ShardCount = 32;
+		float StripeWidth = 128.0f;
+
+		int32_t GetStripe(float x) const { return (int32_t)glm::floor(x / StripeWidth); }
+		uint32_t GetShard(int32_t stripe) const { return (uint32_t)(((int64_t)stripe % ShardCount + ShardCount) % ShardCount); }
+		uint32_t GetShard(const glm::vec2& position) const { return GetShard(GetStripe(position.x)); }
+	};
+
+	// if a client falls this far behind on acknowledgements we stop delta compressing and resync it
+	constexpr uint32_t MaxPendingSnapshots = 32;
+
+	// a client earns one input per input step simulated, plus this many on top for packets that
+	// arrive bunched up, anything past that is dropped instead of moving its player faster
+	constexpr float MaxInputBurst = 8.0f;
+
+	// per-client snapshot bookkeeping
+	struct ClientSnapshotState
+	{
+		// last input we applied to the client's player, echoed back in every snapshot for reconciliation
+		uint32_t LastProcessedInput = 0;
+		// inputs the client can still send before they start getting dropped
+		float InputBudget = MaxInputBurst;
+
+		// last snapshot the client told us it received, and its view of the world at that point
+		uint32_t AckedID = NoSnapshotBaseline;
+		EntityStore AckedBaseline;
+
+		// ring of snapshots sent but not yet acknowledged, oldest first
+		// (slots are reused in place so their storage sticks around between ticks)
+		std::array<Snapshot, MaxPendingSnapshots> Pending;
+		uint32_t PendingStart = 0;
+		uint32_t PendingCount = 0;
+
+		Snapshot& GetPending(uint32_t index) { return Pending[(PendingStart + index) % MaxPendingSnapshots]; }
+		void Acknowledge(uint32_t snapshotID);
+	};
+
+	//
+	// ServerShard - one slice of the world, simulated and serialized independently
+	//
+	// A shard owns the players standing in its stripes along with their clients' snapshot
+	// state, so shards can run their phases on separate threads without locking. The
+	// coordinator (ServerLayer) only touches shards between phases, to hand them inbound
+	// events and to move players that walked into another shard's stripe over to it.
+	//
+	class ServerShard
+	{
+	public:
+		using ClientMap = std::map<uint32_t, ClientSnapshotState>;
+
+		// a client, and its player, moving to another shard
+		struct Handoff
+		{
+			uint32_t ClientID = 0;
+			uint32_t TargetShard = 0;
+			PlayerData Data;
+			// the client's node, snapshot state and all, carried over without reallocating it
+			// (empty for a client that starts out in the target shard)
+			ClientMap::node_type Client;
+		};
+
+		// everything a send phase needs that isn't owned by the shard, shared read-only
+		struct SendContext
+		{
+			Walnut::Server* Server = nullptr; // snapshots are built but not sent without one, for benchmarks
+			uint32_t SnapshotID = NoSnapshotBaseline;
+			uint32_t ServerTime = 0; // in milliseconds
+			SnapshotDeltaSettings DeltaSettings;
+			InterestSettings Interest;
+			const std::vector<ServerShard>* Shards = nullptr;
+		};
+
+		// reset by the coordinator once it has collected them
+		struct Statistics
+		{
+			uint64_t InterestEntriesSent = 0;
+			uint64_t SnapshotBytesSent = 0;
+			uint64_t FullSnapshotsSent = 0;
+			uint64_t InputsRejected = 0; // over budget
+			uint64_t InputsSkipped = 0;  // never arrived, the inbound queue was full when they did
+		};
+	public:
+		ServerShard(uint32_t index, const ShardLayout& layout);
+
+		// coordinator only, between phases
+		void PushEvent(const InboundEvent& event) { m_Events.push_back(event); }
+		void AcceptHandoff(Handoff& handoff);
+		std::vector<Handoff>& GetOutgoingHandoffs() { return m_OutgoingHandoffs; }
+
+		Statistics& GetStatistics() { return m_Statistics; }
+		size_t GetClientCount() const { return m_Clients.size(); }
+		size_t GetPlayerCount() const { return m_Players.Size(); }
+		bool GetPlayerPosition(uint32_t clientID, glm::vec2& outPosition) const;
+		// the player and the last input applied to it, as its client's next snapshot will have them
+		bool GetPlayer(uint32_t clientID, PlayerData& outData, uint32_t& outLastProcessedInput) const;
+
+		// phases, each may run on any thread but only writes to its own shard
+		void Simulate(float dt);
+		void BuildGrid();
+		void SendSnapshots(const SendContext& context);
+
+		// other shards read this during the send phase, after every grid has been built
+		const SpatialGrid& GetGrid() const { return m_SpatialGrid; }
+	private:
+		void GatherInterest(const SendContext& context, uint32_t clientID, const EntityStore& previousView, EntityStore& outInterest);
+	private:
+		uint32_t m_Index;
+		ShardLayout m_Layout;
+		MovementSettings m_MovementSettings;
+
+		std::vector<InboundEvent> m_Events;
+		std::vector<Handoff> m_OutgoingHandoffs;
+
+		EntityStore m_Players;
+		ClientMap m_Clients;
+
+		SpatialGrid m_SpatialGrid;
+		std::vector<SpatialGrid::Entry> m_InterestQueryResults;
+		EntityStore m_Interest;
+
+		Statistics m_Statistics;
+	};
+}
@@ -0,0 +1,185 @@
+#include "ServerWorld.h"
+
+#include <cstring>
+
+#include "Profiler.h"
+#include "WorldStorage.h"
+
+namespace Cubed
+{
+	ServerWorld::ServerWorld(const WorldSettings& settings)
+		: m_Settings(settings), m_Terrain(settings.Terrain)
+	{
+		m_Air.Blocks = std::make_shared<Chunk>(AirBlock);
+		m_Stone.Blocks = std::make_shared<Chunk>(StoneBlock);
+		Encode(m_Air);
+		Encode(m_Stone);
+	}
+
+	const ServerWorld::WorldChunk* ServerWorld::Load(const ChunkCoord& coord)
+	{
+		if (!IsInRange(coord))
+			return nullptr;
+
+		auto [it, inserted] = m_Chunks.try_emplace(coord);
+		if (inserted && !LoadStored(coord, it->second))
+		{
+			it->second = Generate(coord);
+			m_Statistics.ChunksGenerated++;
+		}
+
+		return &it->second;
+	}
+
+	void ServerWorld::Load(const std::vector<ChunkCoord>& coords, JobSystem& jobs, uint32_t maxGenerated)
+	{
+		CUBED_PROFILE_ZONE("ServerWorld::Load");
+
+		// the map is only touched here, the jobs just fill in entries that already exist
+		m_Generating.clear();
+		for (const ChunkCoord& coord : coords)
+		{
+			if (!IsInRange(coord) || m_Chunks.contains(coord))
+				continue;
+
+			WorldChunk stored;
+			if (LoadStored(coord, stored))
+			{
+				m_Chunks.emplace(coord, std::move(stored));
+				continue;
+			}
+
+			if (m_Generating.size() < maxGenerated)
+				m_Generating.emplace_back(coord, &m_Chunks.try_emplace(coord).first->second);
+		}
+
+		jobs.ParallelFor((uint32_t)m_Generating.size(), [this](uint32_t i)
+		{
+			*m_Generating[i].second = Generate(m_Generating[i].first);
+		});
+		m_Statistics.ChunksGenerated += m_Generating.size();
+	}
+
+	bool ServerWorld::LoadStored(const ChunkCoord& coord, WorldChunk& outChunk)
+	{
+		if (!m_Storage)
+			return false;
+
+		auto blocks = std::make_shared<Chunk>();
+		if (!m_Storage->Load(coord, *blocks))
+			return false;
+
+		outChunk.Blocks = std::move(blocks);
+		Encode(outChunk);
+		m_Statistics.ChunksLoaded++;
+		return true;
+	}
+
+	const ServerWorld::WorldChunk* ServerWorld::Find(const ChunkCoord& coord) const
+	{
+		auto it = m_Chunks.find(coord);
+		return it != m_Chunks.end() ? &it->second : nullptr;
+	}
+
+	ServerWorld::WorldChunk ServerWorld::Generate(const ChunkCoord& coord) const
+	{
+		auto blocks = std::make_shared<Chunk>();
+		m_Terrain.Generate(coord, *blocks);
+		if (blocks->IsUniform())
+		{
+			BlockID block = blocks->GetPalette()[0];
+			if (block == AirBlock)
+				return m_Air;
+			if (block == StoneBlock)
+				return m_Stone;
+		}
+
+		WorldChunk chunk;
+		chunk.Blocks = std::move(blocks);
+		Encode(chunk);
+		return chunk;
+	}
+
+	bool ServerWorld::SetBlock(const glm::ivec3& position, BlockID block)
+	{
+		ChunkCoord coord = ChunkCoord::FromBlock(position);
+		uint32_t index = ChunkCoord::GetBlockIndex(position);
+		if (!Load(coord))
+			return false;
+
+		WorldChunk& chunk = m_Chunks.at(coord);
+		uint32_t x = index % ChunkSize, y = index / ChunkSize % ChunkSize, z = index / (ChunkSize * ChunkSize);
+
+		// already that block, nothing to copy, save or send
+		if (chunk.Blocks->Get(x, y, z) == block)
+			return true;
+
+		// first edit since the last flush, the chunk gets a copy of its own that stays writable
+		// until then, whoever was handed the old one keeps it as it was
+		auto [it, inserted] = m_EditIndices.try_emplace(coord, (uint32_t)m_Edits.size());
+		if (inserted)
+		{
+			auto blocks = std::make_shared<Chunk>(*chunk.Blocks);
+			chunk.Blocks = blocks;
+			chunk.Dirty = true;
+			m_EditedBlocks.push_back(std::move(blocks));
+
+			ChunkEdits& edits = m_Edits.emplace_back();
+			edits.Coord = coord;
+			edits.FromVersion = chunk.Version;
+		}
+
+		m_EditedBlocks[it->second]->Set(x, y, z, block);
+		m_Edits[it->second].Edits.push_back({ index, block });
+		m_Statistics.BlockEdits++;
+		return true;
+	}
+
+	const std::vector<ChunkEdits>& ServerWorld::FlushEdits()
+	{
+		CUBED_PROFILE_ZONE("ServerWorld::FlushEdits");
+
+		m_FlushedEdits.clear();
+		for (size_t i = 0; i < m_Edits.size(); i++)
+		{
+			ChunkEdits& edits = m_Edits[i];
+			WorldChunk& chunk = m_Chunks.at(edits.Coord);
+
+			// Set only grows the palette, repack once so blocks that were dug out don't keep
+			// the chunk at a wider bit width than it needs
+			m_Unpacked.resize(ChunkVolume);
+			m_EditedBlocks[i]->Unpack(m_Unpacked.data());
+			m_EditedBlocks[i]->Pack(m_Unpacked.data());
+
+			chunk.Version++;
+			m_Statistics.ChunkVersions++;
+			Encode(chunk);
+
+			// storage hands back what it was given even before it's on disk, so the chunk can go.
+			// Without storage the edits only live here
+			if (m_Storage)
+			{
+				m_Storage->Save(edits.Coord, chunk.Payload, chunk.PayloadSize);
+				chunk.Dirty = false;
+			}
+
+			edits.ToVersion = chunk.Version;
+			m_FlushedEdits.push_back(std::move(edits));
+		}
+
+		m_EditIndices.clear();
+		m_Edits.clear();
+		m_EditedBlocks.clear();
+		return m_FlushedEdits;
+	}
+
+	void ServerWorld::Encode(WorldChunk& chunk) const
+	{
+		// compressed into scratch first, the payload is kept for as long as the chunk is and
+		// shouldn't be sized for the worst case. Generation encodes on the job threads
+		thread_local std::vector<uint8_t> s_Compressed(MaxCompressedChunkSize);
+		chunk.PayloadSize = CompressChunk(*chunk.Blocks, m_Settings.Compression, s_Compressed.data());
+		chunk.Payload = PacketBuffer::Allocate(chunk.PayloadSize);
+		memcpy(chunk.Payload.GetData(), s_Compressed.data(), chunk.PayloadSize);
+	}
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "Chunk.h"
+#include "ChunkCompression.h"
+#include "JobSystem.h"
+#include "PacketBuffer.h"
+#include "TerrainGenerator.h"
+
+namespace Cubed
+{
+	class WorldStorage;
+
+	struct WorldSettings
+	{
+		// vertical extent in chunks, nothing outside of it is ever generated, edited or streamed
+		int32_t MinChunkY = -2;
+		int32_t MaxChunkY = 1;
+
+		// how chunks are compressed for clients and storage
+		ChunkCodec Compression = ChunkCodec::RunsLZ;
+
+		// the seed has to stay the same for the life of a saved world, only edited chunks are
+		// saved and everything else is generated again
+		TerrainSettings Terrain;
+	};
+
+	// everything that changed in one chunk since the last FlushEdits
+	struct ChunkEdits
+	{
+		ChunkCoord Coord;
+		uint32_t FromVersion = 0;
+		uint32_t ToVersion = 0;
+		std::vector<BlockEdit> Edits;
+	};
+
+	//
+	// ServerWorld - the authoritative block world
+	//
+	// Chunks are loaded from storage (or generated, if they were never saved) the first time
+	// anything asks for them. Generated chunks that come out all air or all stone share one
+	// chunk between them, so the sky and deep ground cost a map entry and not a copy of their
+	// blocks. Only edited chunks are saved, everything else can just be generated again from
+	// the seed (see TerrainGenerator.h). Either way Evict can drop a chunk once nobody is near
+	// it, unless it has edits storage hasn't been handed yet. Without storage that's every
+	// edited chunk, for the life of the world.
+	//
+	// Every chunk carries a version that goes up with each flush that edited it, and its
+	// compressed form (see ChunkCompression.h), encoded once and then copied into the packet
+	// of whoever it is sent to and handed to storage as is.
+	//
+	// Tick thread only, except for Find, which may be called from any thread as long as the
+	// tick thread isn't loading or editing at the same time.
+	//
+	class ServerWorld
+	{
+	public:
+		struct WorldChunk
+		{
+			std::shared_ptr<const Chunk> Blocks;
+			uint32_t Version = 1;
+			PacketBuffer Payload;
+			uint64_t PayloadSize = 0;
+			bool Dirty = false; // edited since it was last handed to storage, loading it again wouldn't give it back
+		};
+
+		struct Statistics
+		{
+			uint64_t ChunksGenerated = 0;
+			uint64_t ChunksLoaded = 0;  // from storage
+			uint64_t ChunkVersions = 0; // chunks changed by FlushEdits
+			uint64_t BlockEdits = 0;
+			uint64_t ChunksEvicted = 0;
+		};
+	public:
+		ServerWorld(const WorldSettings& settings = {});
+
+		// where chunks are loaded from and edited chunks are saved to, nullptr for neither.
+		// Set it before anything is loaded, chunks already in the world aren't looked up again
+		void SetStorage(WorldStorage* storage) { m_Storage = storage; }
+
+		// loads or generates the chunk if it doesn't exist yet, nullptr if it is out of the world's range
+		const WorldChunk* Load(const ChunkCoord& coord);
+		// same for many chunks at once, generation is spread over the job system. Generates at
+		// most maxGenerated chunks, the rest of the ones that need it are skipped and can be
+		// asked for again later. Stored chunks are always loaded
+		void Load(const std::vector<ChunkCoord>& coords, JobSystem& jobs, uint32_t maxGenerated);
+		const WorldChunk* Find(const ChunkCoord& coord) const;
+
+		bool IsInRange(const ChunkCoord& coord) const { return coord.Y >= m_Settings.MinChunkY && coord.Y <= m_Settings.MaxChunkY; }
+
+		// changes are visible right away, but only go out to clients with the next FlushEdits
+		bool SetBlock(const glm::ivec3& position, BlockID block);
+		// bumps the version and re-encodes every chunk edited since the last flush and queues
+		// it to be saved, the result stays valid until the next one
+		const std::vector<ChunkEdits>& FlushEdits();
+
+		// drops every chunk that isn't dirty and isn't kept, keep(coord) says whether anyone still
+		// needs it. Returns how many went, pointers to any of them are invalid after this
+		template<typename Keep>
+		size_t Evict(Keep&& keep)
+		{
+			size_t evicted = 0;
+			for (auto it = m_Chunks.begin(); it != m_Chunks.end();)
+			{
+				if (it->second.Dirty || keep(it->first))
+				{
+					++it;
+					continue;
+				}
+
+				it = m_Chunks.erase(it);
+				evicted++;
+			}
+
+			m_Statistics.ChunksEvicted += evicted;
+			return evicted;
+		}
+
+		const WorldSettings& GetSettings() const { return m_Settings; }
+		size_t GetChunkCount() const { return m_Chunks.size(); }
+		const Statistics& GetStatistics() const { return m_Statistics; }
+	private:
+		// safe to call from any thread
+		WorldChunk Generate(const ChunkCoord& coord) const;
+		bool LoadStored(const ChunkCoord& coord, WorldChunk& outChunk);
+		void Encode(WorldChunk& chunk) const;
+	private:
+		WorldSettings m_Settings;
+		WorldStorage* m_Storage = nullptr;
+		std::unordered_map<ChunkCoord, WorldChunk, ChunkCoordHash> m_Chunks;
+
+		TerrainGenerator m_Terrain;
+		WorldChunk m_Air, m_Stone;
+		std::vector<std::pair<ChunkCoord, WorldChunk*>> m_Generating;
+
+		// chunks edited since the last flush and their own copies of the blocks, in the same order
+		std::unordered_map<ChunkCoord, uint32_t, ChunkCoordHash> m_EditIndices;
+		std::vector<ChunkEdits> m_Edits;
+		std::vector<std::shared_ptr<Chunk>> m_EditedBlocks;
+		std::vector<ChunkEdits> m_FlushedEdits;
+		std::vector<BlockID> m_Unpacked;
+
+		Statistics m_Statistics;
+	};
+}
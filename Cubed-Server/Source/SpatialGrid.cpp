@@ -0,0 +1,114 @@
+#include "SpatialGrid.h"
+
+#include <bit>
+
+namespace Cubed
+{
+	SpatialGrid::SpatialGrid(float cellSize)
+		: m_CellSize(cellSize)
+	{
+	}
+
+	void SpatialGrid::Clear()
+	{
+		// keep every vector's capacity, the next rebuild is about the same size
+		m_Keys.clear();
+		m_Inserted.clear();
+		m_Entries.clear();
+		m_OccupiedCells = 0;
+	}
+
+	void SpatialGrid::Insert(uint32_t id, const PlayerData& data)
+	{
+		uint64_t key = GetCellKey(GetCellCoord(data.Position.x), GetCellCoord(data.Position.y));
+		m_Keys.push_back({ key, (uint32_t)m_Inserted.size() });
+		m_Inserted.push_back({ id, data });
+	}
+
+	void SpatialGrid::Build()
+	{
+		// ties broken by insertion order, so the same players always come out the same way
+		std::sort(m_Keys.begin(), m_Keys.end());
+
+		m_Entries.clear();
+		m_OccupiedCells = 0;
+		for (size_t i = 0; i < m_Keys.size(); i++)
+		{
+			m_Entries.push_back(m_Inserted[m_Keys[i].second]);
+			if (i == 0 || m_Keys[i].first != m_Keys[i - 1].first)
+				m_OccupiedCells++;
+		}
+
+		// only ever grows, a crowd that has since spread out just leaves the table emptier
+		size_t tableSize = std::max(std::bit_ceil(std::max<size_t>(m_OccupiedCells * 2, 16)), m_Cells.size());
+		m_Cells.assign(tableSize, Cell());
+
+		size_t mask = m_Cells.size() - 1;
+		for (size_t first = 0; first < m_Keys.size();)
+		{
+			uint64_t key = m_Keys[first].first;
+			size_t last = first + 1;
+			while (last < m_Keys.size() && m_Keys[last].first == key)
+				last++;
+
+			size_t i = GetCellHash(key) & mask;
+			while (m_Cells[i].Count != 0)
+				i = (i + 1) & mask;
+			m_Cells[i] = { key, (uint32_t)first, (uint32_t)(last - first) };
+
+			first = last;
+		}
+	}
+
+	const SpatialGrid::Cell* SpatialGrid::FindCell(uint64_t key) const
+	{
+		if (m_Cells.empty())
+			return nullptr;
+
+		size_t mask = m_Cells.size() - 1;
+		for (size_t i = GetCellHash(key) & mask;; i = (i + 1) & mask)
+		{
+			const Cell& cell = m_Cells[i];
+			if (cell.Count == 0)
+				return nullptr;
+			if (cell.Key == key)
+				return &cell;
+		}
+	}
+
+	void SpatialGrid::Query(const glm::vec2& center, float radius, std::vector<Entry>& results) const
+	{
+		int32_t minX = GetCellCoord(center.x - radius);
+		int32_t maxX = GetCellCoord(center.x + radius);
+		int32_t minY = GetCellCoord(center.y - radius);
+		int32_t maxY = GetCellCoord(center.y + radius);
+
+		float radiusSquared = radius * radius;
+		auto gather = [&](const Entry* entries, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				glm::vec2 diff = entries[i].Data.Position - center;
+				if (glm::dot(diff, diff) <= radiusSquared)
+					results.push_back(entries[i]);
+			}
+		};
+
+		// huge radius, cheaper to walk every entry than probe every cell in range
+		uint64_t cellsInRange = (uint64_t)((int64_t)maxX - minX + 1) * (uint64_t)((int64_t)maxY - minY + 1);
+		if (cellsInRange > m_OccupiedCells)
+		{
+			gather(m_Entries.data(), m_Entries.size());
+			return;
+		}
+
+		for (int32_t y = minY; y <= maxY; y++)
+		{
+			for (int32_t x = minX; x <= maxX; x++)
+			{
+				if (const Cell* cell = FindCell(GetCellKey(x, y)))
+					gather(&m_Entries[cell->First], cell->Count);
+			}
+		}
+	}
+}
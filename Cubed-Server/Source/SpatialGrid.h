@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "Snapshot.h"
+
+namespace Cubed
+{
+	//
+	// SpatialGrid - uniform grid over player positions, rebuilt every tick
+	//
+	// Inserted entries are sorted by cell in Build, so every cell ends up a contiguous run of
+	// entries, found through a small open addressing table keyed by cell. Nothing is freed
+	// between rebuilds, so steady state ticks don't allocate.
+	//
+	class SpatialGrid
+	{
+	public:
+		struct Entry
+		{
+			uint32_t ID;
+			PlayerData Data;
+		};
+	public:
+		SpatialGrid(float cellSize = 32.0f);
+
+		void Clear();
+		void Insert(uint32_t id, const PlayerData& data);
+		// sorts everything inserted since Clear into cells, queries only see what was built
+		void Build();
+
+		// appends every entry within radius of center to results
+		void Query(const glm::vec2& center, float radius, std::vector<Entry>& results) const;
+
+		float GetCellSize() const { return m_CellSize; }
+		size_t GetOccupiedCellCount() const { return m_OccupiedCells; }
+	private:
+		struct Cell
+		{
+			uint64_t Key = 0;
+			uint32_t First = 0; // into m_Entries
+			uint32_t Count = 0; // 0 marks an empty table entry
+		};
+
+		uint64_t GetCellKey(int32_t x, int32_t y) const { return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y; }
+		// clamped before the cast, which would be undefined for NaN or anything past the int
+		// range, and well inside it so a query's cell range still fits
+		int32_t GetCellCoord(float position) const
+		{
+			float cell = glm::floor(position / m_CellSize);
+			return cell >= -s_MaxCellCoord ? (int32_t)std::min(cell, s_MaxCellCoord) : -(int32_t)s_MaxCellCoord;
+		}
+
+		static size_t GetCellHash(uint64_t key) { return (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32); }
+		const Cell* FindCell(uint64_t key) const;
+	private:
+		static constexpr float s_MaxCellCoord = (float)(1 << 30);
+
+		float m_CellSize;
+
+		// cell key and index of everything inserted, sorted by Build
+		std::vector<std::pair<uint64_t, uint32_t>> m_Keys;
+		std::vector<Entry> m_Inserted;
+
+		std::vector<Entry> m_Entries; // grouped by cell
+		std::vector<Cell> m_Cells;    // power of two sized, never more than half full
+		size_t m_OccupiedCells = 0;
+	};
+}
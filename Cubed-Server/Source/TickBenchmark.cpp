@@ -0,0 +1,195 @@
+#include "TickBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "Walnut/Core/Log.h"
+
+#include "BenchmarkLayer.h"
+#include "JobSystem.h"
+#include "ServerShard.h"
+
+namespace Cubed
+{
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr uint32_t s_WarmupTicks = 60; // lets ring buffers, grids and baselines settle first
+	static constexpr uint32_t s_TickCount = 300;
+	static constexpr float s_ArenaSize = 1024.0f;
+	static constexpr uint32_t s_MaxEveryoneInViewPlayers = 500; // quadratic, takes forever past this
+
+	static float MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+	}
+
+	struct TickPercentiles
+	{
+		float Average = 0.0f;
+		float P50 = 0.0f;
+		float P99 = 0.0f;
+	};
+
+	static TickPercentiles GetPercentiles(std::vector<float>& times)
+	{
+		std::sort(times.begin(), times.end());
+		auto percentile = [&times](float p) { return times.empty() ? 0.0f : times[(size_t)(p * (times.size() - 1))]; };
+
+		float total = 0.0f;
+		for (float time : times)
+			total += time;
+
+		return { times.empty() ? 0.0f : total / times.size(), percentile(0.5f), percentile(0.99f) };
+	}
+
+	TickBenchmark::TickBenchmark(uint32_t playerCount)
+		: m_PlayerCount(playerCount)
+	{
+	}
+
+	bool TickBenchmark::Run()
+	{
+		WL_INFO_TAG("TickBenchmark", "{} ticks per run on {} threads, {}x{} arena",
+			s_TickCount, JobSystem::GetDefaultWorkerCount() + 1, s_ArenaSize, s_ArenaSize);
+
+		uint32_t previous = 0;
+		for (uint32_t divisor : { 8u, 4u, 2u, 1u })
+		{
+			uint32_t playerCount = std::max(m_PlayerCount / divisor, 1u);
+			if (playerCount == previous)
+				continue;
+
+			BenchmarkTicks(playerCount, false);
+			if (playerCount <= s_MaxEveryoneInViewPlayers)
+				BenchmarkTicks(playerCount, true);
+			previous = playerCount;
+		}
+
+		return true;
+	}
+
+	void TickBenchmark::BenchmarkTicks(uint32_t playerCount, bool everyoneInView)
+	{
+		struct Player
+		{
+			uint32_t Shard = 0;
+			uint32_t NextInputSequence = 1;
+			int8_t MoveX = 0;
+			int8_t MoveY = 0;
+		};
+
+		JobSystem jobs;
+		ShardLayout layout;
+		std::vector<ServerShard> shards;
+		shards.reserve(layout.ShardCount);
+		for (uint32_t i = 0; i < layout.ShardCount; i++)
+			shards.emplace_back(i, layout);
+
+		// client IDs are indices + 1
+		std::mt19937 random(BenchmarkSeed);
+		std::uniform_real_distribution<float> position(-s_ArenaSize * 0.5f, s_ArenaSize * 0.5f);
+		std::vector<Player> players(playerCount);
+		for (uint32_t i = 0; i < playerCount; i++)
+		{
+			// handing a player over is how a shard takes one in from anywhere, no need to walk there from spawn
+			ServerShard::Handoff handoff;
+			handoff.ClientID = i + 1;
+			handoff.Data = GetSpawnPlayerData();
+			handoff.Data.Position = { position(random), position(random) };
+			handoff.TargetShard = layout.GetShard(handoff.Data.Position);
+
+			players[i].Shard = handoff.TargetShard;
+			shards[handoff.TargetShard].AcceptHandoff(handoff);
+		}
+
+		ServerShard::SendContext context;
+		context.Shards = &shards;
+		if (everyoneInView)
+			context.Interest.Radius = s_ArenaSize * 4.0f;
+
+		std::vector<float> simulateTimes, gridTimes, sendTimes, tickTimes;
+		uint64_t bytesSent = 0, interestEntries = 0;
+
+		for (uint32_t tick = 0; tick < s_WarmupTicks + s_TickCount; tick++)
+		{
+			// one input per player per tick, acknowledging the snapshot from the tick before
+			for (uint32_t i = 0; i < playerCount; i++)
+			{
+				Player& player = players[i];
+				if (random() % 60 == 0 || player.NextInputSequence == 1)
+				{
+					player.MoveX = (int8_t)(random() % 3) - 1;
+					player.MoveY = (int8_t)(random() % 3) - 1;
+				}
+
+				InboundEvent event;
+				event.EventType = InboundEvent::Type::Input;
+				event.ClientID = i + 1;
+				event.AckedSnapshotID = context.SnapshotID;
+				event.InputCount = 1;
+				event.Inputs[0] = { player.NextInputSequence++, player.MoveX, player.MoveY };
+				shards[player.Shard].PushEvent(event);
+			}
+
+			context.SnapshotID++;
+			context.ServerTime = (uint32_t)((uint64_t)tick * 1000 / PlayerInputRate);
+
+			Clock::time_point start = Clock::now();
+			jobs.ParallelFor((uint32_t)shards.size(), [&shards](uint32_t i) { shards[i].Simulate(PlayerInputInterval); });
+			for (ServerShard& shard : shards)
+			{
+				for (ServerShard::Handoff& handoff : shard.GetOutgoingHandoffs())
+				{
+					players[handoff.ClientID - 1].Shard = handoff.TargetShard;
+					shards[handoff.TargetShard].AcceptHandoff(handoff);
+				}
+				shard.GetOutgoingHandoffs().clear();
+			}
+			float simulateTime = MillisecondsSince(start);
+
+			Clock::time_point gridStart = Clock::now();
+			jobs.ParallelFor((uint32_t)shards.size(), [&shards](uint32_t i) { shards[i].BuildGrid(); });
+			float gridTime = MillisecondsSince(gridStart);
+
+			Clock::time_point sendStart = Clock::now();
+			jobs.ParallelFor((uint32_t)shards.size(), [&shards, &context](uint32_t i) { shards[i].SendSnapshots(context); });
+			float sendTime = MillisecondsSince(sendStart);
+			float tickTime = MillisecondsSince(start);
+
+			for (ServerShard& shard : shards)
+			{
+				ServerShard::Statistics& stats = shard.GetStatistics();
+				if (tick >= s_WarmupTicks)
+				{
+					bytesSent += stats.SnapshotBytesSent;
+					interestEntries += stats.InterestEntriesSent;
+				}
+				stats = {};
+			}
+
+			if (tick < s_WarmupTicks)
+				continue;
+
+			simulateTimes.push_back(simulateTime);
+			gridTimes.push_back(gridTime);
+			sendTimes.push_back(sendTime);
+			tickTimes.push_back(tickTime);
+		}
+
+		TickPercentiles simulate = GetPercentiles(simulateTimes);
+		TickPercentiles grid = GetPercentiles(gridTimes);
+		TickPercentiles send = GetPercentiles(sendTimes);
+		TickPercentiles total = GetPercentiles(tickTimes);
+		uint64_t snapshots = (uint64_t)s_TickCount * playerCount;
+
+		const char* name = everyoneInView ? "everyone in view" : "interest";
+		WL_INFO_TAG("TickBenchmark", "{} players, {}: tick avg {:.3f}ms, p50 {:.3f}ms, p99 {:.3f}ms, {:.2f}us per player",
+			playerCount, name, total.Average, total.P50, total.P99, total.Average * 1000.0f / playerCount);
+		WL_INFO_TAG("TickBenchmark", "{} players, {}: simulate p50 {:.3f}ms p99 {:.3f}ms, grid p50 {:.3f}ms p99 {:.3f}ms, snapshots p50 {:.3f}ms p99 {:.3f}ms",
+			playerCount, name, simulate.P50, simulate.P99, grid.P50, grid.P99, send.P50, send.P99);
+		WL_INFO_TAG("TickBenchmark", "{} players, {}: ~{} players in view, {} bytes per snapshot",
+			playerCount, name, interestEntries / snapshots, bytesSent / snapshots);
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace Cubed
+{
+	//
+	// TickBenchmark - times server ticks against player count
+	//
+	// Runs the shards the way ServerLayer does, minus the sockets: every player sends one input
+	// and acknowledges the last snapshot each tick, then the shards simulate, rebuild their
+	// grids and build everyone's snapshot. Players wander a fixed 1024x1024 arena, so the
+	// crowd gets denser as the count goes up, like it does in the load test. Reports each
+	// phase at 1/8, 1/4, 1/2 and all of the requested player count, and for up to 500
+	// players the same again with everyone in view, which is what interest management saves.
+	//
+	// Every tick sends snapshots here, the real server only sends on its send ticks.
+	//
+	class TickBenchmark
+	{
+	public:
+		TickBenchmark(uint32_t playerCount);
+
+		bool Run();
+	private:
+		void BenchmarkTicks(uint32_t playerCount, bool everyoneInView);
+	private:
+		uint32_t m_PlayerCount;
+	};
+}
@@ -0,0 +1,142 @@
+#include "TickScheduler.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "Profiler.h"
+
+namespace Cubed
+{
+	static constexpr size_t s_DurationHistorySize = 1024;
+
+	// OS sleeps can overshoot by around a millisecond, so sleep short and yield for the rest
+	static constexpr std::chrono::microseconds s_SleepSlack{ 1500 };
+
+	TickScheduler::TickScheduler(uint32_t simulationRate, uint32_t sendRate, uint32_t maxCatchUpTicks)
+		: m_MaxCatchUpTicks(maxCatchUpTicks)
+	{
+		SetSimulationRate(simulationRate);
+		SetSendRate(sendRate);
+
+		m_TickDurations.reserve(s_DurationHistorySize);
+		m_LastTime = Clock::now();
+	}
+
+	void TickScheduler::SetSimulationRate(uint32_t hz)
+	{
+		{
+			std::scoped_lock<std::mutex> lock(m_StatisticsMutex);
+			m_SimulationRate = std::max(hz, 1u);
+		}
+		m_TickInterval = Seconds(1.0f / (float)m_SimulationRate);
+
+		// can't send more often than we simulate
+		if (m_SendRate > m_SimulationRate)
+			SetSendRate(m_SimulationRate);
+	}
+
+	void TickScheduler::SetSendRate(uint32_t hz)
+	{
+		{
+			std::scoped_lock<std::mutex> lock(m_StatisticsMutex);
+			m_SendRate = std::clamp(hz, 1u, m_SimulationRate);
+		}
+		m_SendInterval = Seconds(1.0f / (float)m_SendRate);
+		m_SendAccumulator = Seconds(0.0f);
+	}
+
+	uint32_t TickScheduler::WaitForTicks()
+	{
+		CUBED_PROFILE_ZONE("TickScheduler::WaitForTicks");
+
+		Clock::time_point now = Clock::now();
+		m_Accumulator += std::chrono::duration_cast<Seconds>(now - m_LastTime);
+		m_LastTime = now;
+
+		if (m_Accumulator < m_TickInterval)
+		{
+			Clock::time_point deadline = now + std::chrono::duration_cast<Clock::duration>(m_TickInterval - m_Accumulator);
+			if (deadline - now > s_SleepSlack)
+				std::this_thread::sleep_until(deadline - s_SleepSlack);
+
+			while (Clock::now() < deadline)
+				std::this_thread::yield();
+
+			now = Clock::now();
+			m_Accumulator += std::chrono::duration_cast<Seconds>(now - m_LastTime);
+			m_LastTime = now;
+		}
+
+		uint32_t ticks = (uint32_t)(m_Accumulator / m_TickInterval);
+		m_Accumulator -= m_TickInterval * (float)ticks;
+
+		// too far behind, drop the extra ticks instead of spiralling
+		if (ticks > m_MaxCatchUpTicks)
+		{
+			std::scoped_lock<std::mutex> lock(m_StatisticsMutex);
+			m_SkippedTicks += ticks - m_MaxCatchUpTicks;
+			ticks = m_MaxCatchUpTicks;
+		}
+
+		return ticks;
+	}
+
+	bool TickScheduler::BeginTick()
+	{
+		m_TickStart = Clock::now();
+
+		m_SendAccumulator += m_TickInterval;
+		if (m_SendAccumulator + m_TickInterval * 0.5f < m_SendInterval)
+			return false;
+
+		m_SendAccumulator = std::max(m_SendAccumulator - m_SendInterval, Seconds(0.0f));
+		return true;
+	}
+
+	void TickScheduler::EndTick()
+	{
+		float duration = std::chrono::duration<float, std::milli>(Clock::now() - m_TickStart).count();
+		{
+			std::scoped_lock<std::mutex> lock(m_StatisticsMutex);
+			if (m_TickDurations.size() < s_DurationHistorySize)
+				m_TickDurations.push_back(duration);
+			else
+				m_TickDurations[m_TickCount % s_DurationHistorySize] = duration;
+
+			if (duration > std::chrono::duration<float, std::milli>(m_TickInterval).count())
+				m_OverrunCount++;
+
+			m_TickCount++;
+		}
+	}
+
+	TickScheduler::Statistics TickScheduler::GetStatistics() const
+	{
+		Statistics stats;
+		std::vector<float> durations;
+		{
+			std::scoped_lock<std::mutex> lock(m_StatisticsMutex);
+			stats.SimulationRate = m_SimulationRate;
+			stats.SendRate = m_SendRate;
+			stats.TickCount = m_TickCount;
+			stats.OverrunCount = m_OverrunCount;
+			stats.SkippedTicks = m_SkippedTicks;
+			durations = m_TickDurations;
+		}
+
+		if (durations.empty())
+			return stats;
+
+		auto percentile = [&durations](float p)
+		{
+			auto it = durations.begin() + (size_t)(p * (float)(durations.size() - 1));
+			std::nth_element(durations.begin(), it, durations.end());
+			return *it;
+		};
+
+		stats.P50TickDuration = percentile(0.50f);
+		stats.P99TickDuration = percentile(0.99f);
+		stats.MaxTickDuration = *std::max_element(durations.begin(), durations.end());
+		return stats;
+	}
+}
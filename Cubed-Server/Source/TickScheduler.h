@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace Cubed
+{
+	//
+	// TickScheduler - fixed timestep scheduler for the server
+	//
+	// Simulation ticks run at a fixed rate from an accumulator, with a cap on how many ticks
+	// can be caught up in one go. Network send ticks run at their own (lower or equal) rate
+	// and are only ever issued on simulation tick boundaries.
+	//
+	class TickScheduler
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		struct Statistics
+		{
+			uint32_t SimulationRate = 0;
+			uint32_t SendRate = 0;
+
+			uint64_t TickCount = 0;
+			uint64_t OverrunCount = 0; // ticks that took longer than the tick interval
+			uint64_t SkippedTicks = 0; // ticks dropped because we were too far behind to catch up
+
+			// over the last s_DurationHistorySize ticks, in milliseconds
+			float P50TickDuration = 0.0f;
+			float P99TickDuration = 0.0f;
+			float MaxTickDuration = 0.0f;
+		};
+	public:
+		TickScheduler(uint32_t simulationRate = 60, uint32_t sendRate = 30, uint32_t maxCatchUpTicks = 5);
+
+		void SetSimulationRate(uint32_t hz);
+		void SetSendRate(uint32_t hz);
+
+		float GetTickInterval() const { return m_TickInterval.count(); }
+
+		// sleeps until the next simulation tick is due, then returns how many ticks to run
+		uint32_t WaitForTicks();
+
+		// call around every simulation tick so overruns and durations get tracked,
+		// BeginTick returns true if this tick should also send network state
+		bool BeginTick();
+		void EndTick();
+
+		Statistics GetStatistics() const;
+	private:
+		using Seconds = std::chrono::duration<float>;
+
+		uint32_t m_SimulationRate = 0;
+		uint32_t m_SendRate = 0;
+		uint32_t m_MaxCatchUpTicks = 0;
+
+		Seconds m_TickInterval{ 0.0f };
+		Seconds m_SendInterval{ 0.0f };
+
+		Clock::time_point m_LastTime;
+		Seconds m_Accumulator{ 0.0f };
+		Seconds m_SendAccumulator{ 0.0f };
+
+		Clock::time_point m_TickStart;
+
+		// statistics (and the rates) are read from the console thread
+		mutable std::mutex m_StatisticsMutex;
+		uint64_t m_TickCount = 0;
+		uint64_t m_OverrunCount = 0;
+		uint64_t m_SkippedTicks = 0;
+		std::vector<float> m_TickDurations; // ring buffer, in milliseconds
+	};
+}
@@ -0,0 +1,270 @@
+#include "WorldBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <thread>
+
+#include "Walnut/Core/Log.h"
+
+#include "BenchmarkLayer.h"
+#include "ServerWorld.h"
+#include "WorldStorage.h"
+
+namespace Cubed
+{
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr BlockID s_StoneBlock = 1;
+	static constexpr BlockID s_GrassBlock = 2;
+	static constexpr BlockID s_DirtBlock = 3;
+	static constexpr BlockID s_OreBlock = 4;
+
+	// ticks per benchmark pass, at a fixed rate so the flusher gets the idle time it would in game
+	static constexpr uint32_t s_TickCount = 300;
+	static constexpr uint32_t s_TickRate = 60;
+	static constexpr uint32_t s_EditsPerTick = 64;
+
+	static float MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+	}
+
+	// cheap lattice value noise in [0, 1], rolling hills are all the terrain needs to be
+	static float HashLattice(int32_t x, int32_t z)
+	{
+		uint32_t h = (uint32_t)x * 374761393u + (uint32_t)z * 668265263u;
+		h = (h ^ (h >> 13)) * 1274126177u;
+		return (float)((h ^ (h >> 16)) & 0xffffff) / (float)0xffffff;
+	}
+
+	static float ValueNoise(float x, float z)
+	{
+		int32_t ix = (int32_t)std::floor(x), iz = (int32_t)std::floor(z);
+		auto smooth = [](float t) { return t * t * (3.0f - 2.0f * t); };
+		float fx = smooth(x - ix), fz = smooth(z - iz);
+
+		auto lerp = [](float a, float b, float t) { return a + (b - a) * t; };
+		return lerp(lerp(HashLattice(ix, iz), HashLattice(ix + 1, iz), fx),
+			lerp(HashLattice(ix, iz + 1), HashLattice(ix + 1, iz + 1), fx), fz);
+	}
+
+	static void PrintPercentiles(const char* name, std::vector<float>& times)
+	{
+		std::sort(times.begin(), times.end());
+		auto percentile = [&times](float p) { return times.empty() ? 0.0f : times[(size_t)(p * (times.size() - 1))]; };
+
+		float total = 0.0f;
+		for (float time : times)
+			total += time;
+
+		WL_INFO_TAG("WorldBenchmark", "{}: avg {:.3f}ms, p50 {:.3f}ms, p99 {:.3f}ms, max {:.3f}ms",
+			name, times.empty() ? 0.0f : total / times.size(), percentile(0.5f), percentile(0.99f), percentile(1.0f));
+	}
+
+	static uint64_t GetDirectorySize(const std::filesystem::path& directory)
+	{
+		uint64_t size = 0;
+		for (const auto& entry : std::filesystem::directory_iterator(directory))
+		{
+			if (entry.is_regular_file())
+				size += entry.file_size();
+		}
+		return size;
+	}
+
+	WorldBenchmark::WorldBenchmark(uint32_t chunkCount)
+		: m_ChunkCount(chunkCount)
+	{
+	}
+
+	bool WorldBenchmark::Run()
+	{
+		std::filesystem::remove_all(m_Directory);
+
+		GenerateChunks();
+		BenchmarkSave();
+		BenchmarkLoad();
+		BenchmarkTicks(false);
+		BenchmarkTicks(true);
+
+		std::filesystem::remove_all(m_Directory);
+
+		return true;
+	}
+
+	void WorldBenchmark::GenerateChunks()
+	{
+		WorldSettings worldSettings;
+		int32_t height = worldSettings.MaxChunkY - worldSettings.MinChunkY + 1;
+		int32_t columns = (int32_t)((m_ChunkCount + height - 1) / height);
+		m_WorldSize = std::max((int32_t)std::ceil(std::sqrt((float)columns)), 1);
+
+		std::mt19937 random(BenchmarkSeed);
+		std::vector<BlockID> blocks(ChunkVolume);
+		std::vector<uint8_t> compressed(MaxCompressedChunkSize);
+		Chunk chunk;
+		uint64_t totalSize = 0;
+
+		for (int32_t cz = 0; cz < m_WorldSize && m_Coords.size() < m_ChunkCount; cz++)
+		{
+			for (int32_t cx = 0; cx < m_WorldSize && m_Coords.size() < m_ChunkCount; cx++)
+			{
+				for (int32_t cy = worldSettings.MinChunkY; cy <= worldSettings.MaxChunkY && m_Coords.size() < m_ChunkCount; cy++)
+				{
+					for (uint32_t z = 0; z < ChunkSize; z++)
+					{
+						for (uint32_t x = 0; x < ChunkSize; x++)
+						{
+							float worldX = (float)(cx * (int32_t)ChunkSize + (int32_t)x);
+							float worldZ = (float)(cz * (int32_t)ChunkSize + (int32_t)z);
+							int32_t surface = (int32_t)((ValueNoise(worldX / 48.0f, worldZ / 48.0f) - 0.5f) * 48.0f
+								+ (ValueNoise(worldX / 9.0f, worldZ / 9.0f) - 0.5f) * 6.0f);
+
+							for (uint32_t y = 0; y < ChunkSize; y++)
+							{
+								int32_t worldY = cy * (int32_t)ChunkSize + (int32_t)y;
+
+								BlockID block = AirBlock;
+								if (worldY < surface - 4)
+									block = random() % 64 == 0 ? s_OreBlock : s_StoneBlock;
+								else if (worldY < surface - 1)
+									block = s_DirtBlock;
+								else if (worldY < surface)
+									block = s_GrassBlock;
+								blocks[Chunk::GetIndex(x, y, z)] = block;
+							}
+						}
+					}
+
+					chunk.Pack(blocks.data());
+
+					uint64_t size = CompressChunk(chunk, worldSettings.Compression, compressed.data());
+					PacketBuffer payload = PacketBuffer::Allocate(size);
+					memcpy(payload.GetData(), compressed.data(), size);
+
+					m_Coords.push_back({ cx, cy, cz });
+					m_Payloads.push_back(std::move(payload));
+					m_PayloadSizes.push_back(size);
+					totalSize += size;
+				}
+			}
+		}
+
+		WL_INFO_TAG("WorldBenchmark", "Generated {} chunks ({}x{} columns), {:.1f}MB encoded, {:.1f}KB per chunk",
+			m_Coords.size(), m_WorldSize, m_WorldSize, totalSize / (1024.0f * 1024.0f), totalSize / 1024.0f / std::max<size_t>(m_Coords.size(), 1));
+	}
+
+	void WorldBenchmark::BenchmarkSave()
+	{
+		WorldStorage storage({ .Directory = m_Directory, .FlushInterval = 3600.0f });
+		if (!storage.Start())
+			return;
+
+		Clock::time_point start = Clock::now();
+		for (size_t i = 0; i < m_Coords.size(); i++)
+			storage.Save(m_Coords[i], m_Payloads[i], m_PayloadSizes[i]);
+		float queueTime = MillisecondsSince(start);
+
+		storage.Flush();
+		float totalTime = MillisecondsSince(start);
+
+		WorldStorage::Statistics stats = storage.GetStatistics();
+		storage.Stop();
+
+		float megabytes = stats.BytesSaved / (1024.0f * 1024.0f);
+		WL_INFO_TAG("WorldBenchmark", "Save: {} chunks, {:.1f}MB in {:.1f}ms ({:.2f}ms queueing), {:.1f}MB/s, {:.0f} chunks/s",
+			stats.ChunksSaved, megabytes, totalTime, queueTime, megabytes / (totalTime / 1000.0f), stats.ChunksSaved / (totalTime / 1000.0f));
+		WL_INFO_TAG("WorldBenchmark", "Save: {} region files, {:.1f}MB on disk",
+			stats.RegionsOpen, GetDirectorySize(m_Directory) / (1024.0f * 1024.0f));
+	}
+
+	void WorldBenchmark::BenchmarkLoad()
+	{
+		WorldStorage storage({ .Directory = m_Directory });
+		if (!storage.Start())
+			return;
+
+		std::vector<float> times;
+		times.reserve(m_Coords.size());
+
+		Chunk chunk;
+		std::vector<uint8_t> encoded(MaxCompressedChunkSize);
+		uint32_t mismatches = 0;
+		float totalTime = 0.0f;
+		for (size_t i = 0; i < m_Coords.size(); i++)
+		{
+			Clock::time_point start = Clock::now();
+			bool loaded = storage.Load(m_Coords[i], chunk);
+			times.push_back(MillisecondsSince(start));
+			totalTime += times.back();
+
+			// has to come back exactly as it was saved, compressing is deterministic
+			uint64_t size = loaded ? CompressChunk(chunk, WorldSettings().Compression, encoded.data()) : 0;
+			if (!loaded || size != m_PayloadSizes[i] || memcmp(encoded.data(), m_Payloads[i].GetData(), size) != 0)
+				mismatches++;
+		}
+
+		WorldStorage::Statistics stats = storage.GetStatistics();
+		storage.Stop();
+
+		float megabytes = 0.0f;
+		for (uint64_t size : m_PayloadSizes)
+			megabytes += size / (1024.0f * 1024.0f);
+
+		WL_INFO_TAG("WorldBenchmark", "Cold load: {} chunks in {:.1f}ms, {:.1f}MB/s, {:.0f} chunks/s, {} region files opened, {} mismatched",
+			stats.ChunksLoaded, totalTime, megabytes / (totalTime / 1000.0f), stats.ChunksLoaded / (totalTime / 1000.0f),
+			stats.RegionsOpen, mismatches);
+		PrintPercentiles("Cold load per chunk", times);
+	}
+
+	void WorldBenchmark::BenchmarkTicks(bool saving)
+	{
+		// flushes as soon as there is anything, the worst case for contention with the tick
+		WorldStorage storage({ .Directory = m_Directory, .FlushInterval = 1.0f / s_TickRate });
+		if (!storage.Start())
+			return;
+
+		// both passes edit the same saved terrain, only one of them saves the edits
+		ServerWorld world;
+		world.SetStorage(&storage);
+		for (const ChunkCoord& coord : m_Coords)
+			world.Load(coord);
+		if (!saving)
+			world.SetStorage(nullptr);
+
+		std::mt19937 random(BenchmarkSeed);
+		const WorldSettings& worldSettings = world.GetSettings();
+		std::uniform_int_distribution<int32_t> horizontal(0, m_WorldSize * (int32_t)ChunkSize - 1);
+		std::uniform_int_distribution<int32_t> vertical(worldSettings.MinChunkY * (int32_t)ChunkSize, (worldSettings.MaxChunkY + 1) * (int32_t)ChunkSize - 1);
+		std::uniform_int_distribution<uint32_t> blockType(AirBlock, s_OreBlock);
+
+		std::vector<float> times;
+		times.reserve(s_TickCount);
+
+		auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / s_TickRate));
+		Clock::time_point nextTick = Clock::now();
+		for (uint32_t tick = 0; tick < s_TickCount; tick++)
+		{
+			std::this_thread::sleep_until(nextTick);
+			nextTick += interval;
+
+			Clock::time_point start = Clock::now();
+			for (uint32_t i = 0; i < s_EditsPerTick; i++)
+				world.SetBlock({ horizontal(random), vertical(random), horizontal(random) }, (BlockID)blockType(random));
+			world.FlushEdits();
+			times.push_back(MillisecondsSince(start));
+		}
+
+		storage.Flush();
+		WorldStorage::Statistics stats = storage.GetStatistics();
+		storage.Stop();
+
+		const char* name = saving ? "Ticks while saving" : "Ticks without saving";
+		WL_INFO_TAG("WorldBenchmark", "{}: {} edits per tick, {} chunk saves over {} flushes, last flush {:.2f}ms",
+			name, s_EditsPerTick, stats.ChunksSaved, stats.Flushes, stats.LastFlushTime);
+		PrintPercentiles(name, times);
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <filesystem>
+#include <vector>
+
+#include "Chunk.h"
+#include "PacketBuffer.h"
+
+namespace Cubed
+{
+	//
+	// WorldBenchmark - times world storage on generated terrain
+	//
+	// Saves every chunk of a generated world through WorldStorage (save throughput), loads them
+	// all back through a fresh one that has nothing open yet (cold load), then runs a stretch of
+	// ticks that edit the world with and without the flusher saving behind them, to show what
+	// saving costs the tick. Runs in a directory of its own that is deleted afterwards.
+	//
+	// Cold load only starts with nothing open, the files are still in the OS page cache from
+	// being written just before.
+	//
+	class WorldBenchmark
+	{
+	public:
+		WorldBenchmark(uint32_t chunkCount);
+
+		bool Run();
+	private:
+		void GenerateChunks();
+		void BenchmarkSave();
+		void BenchmarkLoad();
+		void BenchmarkTicks(bool saving);
+	private:
+		uint32_t m_ChunkCount;
+		std::filesystem::path m_Directory = "WorldBenchmark";
+
+		// encoded, like the world hands them to storage
+		std::vector<ChunkCoord> m_Coords;
+		std::vector<PacketBuffer> m_Payloads;
+		std::vector<uint64_t> m_PayloadSizes;
+		int32_t m_WorldSize = 0; // in chunk columns along x and z
+	};
+}
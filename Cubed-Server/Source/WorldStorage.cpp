@@ -0,0 +1,404 @@
+#include "WorldStorage.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "Walnut/Core/Log.h"
+#include "Walnut/Serialization/BufferStream.h"
+
+#include "ChunkCompression.h"
+#include "Profiler.h"
+
+using namespace Walnut;
+
+namespace Cubed
+{
+	// a chunk as a region file of that version holds it, version 1 is the plain chunk format
+	static bool DecodeChunk(uint32_t version, const uint8_t* data, uint64_t size, Chunk& outChunk)
+	{
+		if (version != 1)
+			return DecompressChunk(data, size, outChunk);
+
+		BufferStreamReader stream(Buffer((void*)data, size));
+		return outChunk.Deserialize(stream);
+	}
+
+	WorldStorage::WorldStorage(const WorldStorageSettings& settings)
+		: m_Settings(settings)
+	{
+	}
+
+	WorldStorage::~WorldStorage()
+	{
+		Stop();
+	}
+
+	bool WorldStorage::Start()
+	{
+		std::error_code error;
+		std::filesystem::create_directories(m_Settings.Directory, error);
+		if (error)
+		{
+			WL_ERROR("Could not create world directory! {} ({})", m_Settings.Directory.string(), error.message());
+			return false;
+		}
+
+		std::scoped_lock lock(m_Mutex);
+		if (m_Running)
+			return true;
+
+		m_Running = true;
+		m_Flusher = std::thread([this]() { FlusherMain(); });
+		return true;
+	}
+
+	void WorldStorage::Stop()
+	{
+		{
+			std::scoped_lock lock(m_Mutex);
+			if (!m_Running)
+				return;
+
+			m_Running = false;
+		}
+
+		m_FlusherWake.notify_one();
+		m_Flusher.join();
+
+		// a Load in the middle of reading one keeps it open until it's done
+		std::scoped_lock lock(m_RegionMutex);
+		m_Regions.clear();
+	}
+
+	bool WorldStorage::Load(const ChunkCoord& coord, Chunk& outChunk)
+	{
+		PendingChunk pending;
+		{
+			std::scoped_lock lock(m_Mutex);
+			if (auto it = m_Pending.find(coord); it != m_Pending.end())
+				pending = it->second;
+			else if (auto it = m_Writing.find(coord); it != m_Writing.end())
+				pending = it->second;
+		}
+
+		std::vector<uint8_t> data;
+		bool loaded;
+		if (pending.Payload)
+		{
+			loaded = DecompressChunk(pending.Payload.GetData(), pending.Size, outChunk);
+		}
+		else
+		{
+			RegionCoord regionCoord = RegionCoord::FromChunk(coord);
+			std::shared_ptr<RegionFile> region = GetRegion(regionCoord, false);
+			uint32_t version = region ? region->GetVersion() : 0;
+			bool read = region && region->Read(coord, data);
+
+			// the flusher swapped in the upgraded file while this was reading the old one
+			if (!read && region && !region->IsOpen())
+			{
+				region = GetRegion(regionCoord, false);
+				version = region ? region->GetVersion() : 0;
+				read = region && region->Read(coord, data);
+			}
+
+			if (!read)
+				return false;
+
+			loaded = DecodeChunk(version, data.data(), data.size(), outChunk);
+		}
+
+		if (!loaded)
+			WL_ERROR("Saved chunk {}, {}, {} is damaged, it will be generated again!", coord.X, coord.Y, coord.Z);
+
+		std::scoped_lock lock(m_Mutex);
+		if (loaded)
+			m_Statistics.ChunksLoaded++;
+		else
+			m_Statistics.DamagedChunks++;
+		return loaded;
+	}
+
+	void WorldStorage::Save(const ChunkCoord& coord, const PacketBuffer& payload, uint64_t size)
+	{
+		std::scoped_lock lock(m_Mutex);
+		m_Pending[coord] = { payload, size };
+		m_SaveCount++;
+	}
+
+	void WorldStorage::RequestFlush()
+	{
+		{
+			std::scoped_lock lock(m_Mutex);
+			m_FlushRequested = true;
+		}
+		m_FlusherWake.notify_one();
+	}
+
+	void WorldStorage::Flush()
+	{
+		std::unique_lock lock(m_Mutex);
+		if (!m_Running)
+			return;
+
+		uint64_t target = m_SaveCount;
+		m_FlushRequested = true;
+		m_FlusherWake.notify_one();
+		m_FlushDone.wait(lock, [this, target]() { return m_WrittenCount >= target || !m_Running; });
+	}
+
+	WorldStorage::Statistics WorldStorage::GetStatistics() const
+	{
+		Statistics stats;
+		{
+			std::scoped_lock lock(m_Mutex);
+			stats = m_Statistics;
+			stats.PendingChunks = m_Pending.size() + m_Writing.size();
+		}
+
+		std::scoped_lock lock(m_RegionMutex);
+		for (const auto& [coord, region] : m_Regions)
+		{
+			if (region)
+				stats.RegionsOpen++;
+		}
+		return stats;
+	}
+
+	std::shared_ptr<RegionFile> WorldStorage::GetRegion(const RegionCoord& coord, bool create)
+	{
+		std::scoped_lock lock(m_RegionMutex);
+
+		auto [it, inserted] = m_Regions.try_emplace(coord);
+		if (it->second || (!inserted && !create))
+			return it->second;
+
+		std::filesystem::path path = GetRegionPath(coord);
+		if (!create && !std::filesystem::exists(path))
+			return nullptr;
+
+		auto region = std::make_shared<RegionFile>();
+		if (!region->Open(path))
+		{
+			WL_ERROR("Could not open region file! {}", path.string());
+			return nullptr;
+		}
+
+		if (region->GetVersion() != RegionFile::CurrentVersion)
+		{
+			{
+				std::scoped_lock lock(m_Mutex);
+				m_Upgrades.push_back(coord);
+			}
+			m_FlusherWake.notify_one();
+		}
+
+		it->second = region;
+		return region;
+	}
+
+	std::filesystem::path WorldStorage::GetRegionPath(const RegionCoord& coord) const
+	{
+		std::string name = "r." + std::to_string(coord.X) + "." + std::to_string(coord.Y) + "." + std::to_string(coord.Z) + ".region";
+		return m_Settings.Directory / name;
+	}
+
+	std::shared_ptr<RegionFile> WorldStorage::UpgradeRegion(const RegionCoord& coord)
+	{
+		std::shared_ptr<RegionFile> region;
+		{
+			std::scoped_lock lock(m_RegionMutex);
+			if (auto it = m_Regions.find(coord); it != m_Regions.end())
+				region = it->second;
+		}
+
+		// queued twice, or already upgraded on its way to being written
+		if (!region || region->GetVersion() == RegionFile::CurrentVersion)
+			return region;
+
+		CUBED_PROFILE_ZONE("WorldStorage::UpgradeRegion");
+
+		std::filesystem::path path = GetRegionPath(coord);
+		std::filesystem::path upgradedPath = path;
+		upgradedPath += ".upgrade";
+
+		// left behind if the server went down during the last try
+		std::error_code error;
+		std::filesystem::remove(upgradedPath, error);
+
+		// loads keep reading the old file in the meantime, only the flusher writes
+		auto upgraded = std::make_shared<RegionFile>();
+		if (!upgraded->Open(upgradedPath))
+		{
+			WL_ERROR("Could not upgrade region file! {}", path.string());
+			return region;
+		}
+
+		std::vector<uint8_t> data;
+		std::vector<uint8_t> compressed(MaxCompressedChunkSize);
+		uint32_t chunkCount = 0, damagedCount = 0;
+		bool written = true;
+		for (uint32_t slot = 0; slot < RegionChunkCount && written; slot++)
+		{
+			ChunkCoord chunkCoord = coord.GetChunk(slot);
+			if (!region->Read(chunkCoord, data))
+				continue;
+
+			Chunk chunk;
+			if (!DecodeChunk(region->GetVersion(), data.data(), data.size(), chunk))
+			{
+				WL_ERROR("Saved chunk {}, {}, {} is damaged, it will be generated again!", chunkCoord.X, chunkCoord.Y, chunkCoord.Z);
+				damagedCount++;
+				continue;
+			}
+
+			// ServerWorld's default, chunks saved from now on use whatever it's set to
+			uint64_t size = CompressChunk(chunk, ChunkCodec::RunsLZ, compressed.data());
+			written = upgraded->Write(chunkCoord, compressed.data(), size);
+			chunkCount++;
+		}
+		damagedCount += (uint32_t)region->GetStatistics().DamagedChunks;
+
+		// the new file has to be complete on disk before it takes the old one's place
+		if (!written || !upgraded->Flush())
+		{
+			upgraded->Close();
+			std::filesystem::remove(upgradedPath, error);
+			WL_ERROR("Could not upgrade region file! {}", path.string());
+			return region;
+		}
+		upgraded->Close();
+
+		// loads wait for the swap, a file can't be replaced while it's open everywhere. Only a
+		// rename and a reopen, not worth reading the old file in the meantime
+		{
+			std::scoped_lock lock(m_RegionMutex);
+			region->Close();
+			std::filesystem::rename(upgradedPath, path, error);
+			if (error || !upgraded->Open(path))
+			{
+				// whatever is at path now is complete, be it the old file or the new one
+				std::filesystem::remove(upgradedPath, error);
+				if (!region->Open(path))
+					m_Regions.erase(coord);
+				WL_ERROR("Could not upgrade region file! {}", path.string());
+				return region->IsOpen() ? region : nullptr;
+			}
+			m_Regions[coord] = upgraded;
+		}
+
+		WL_INFO("Upgraded region file {}, {} chunks compressed, {} damaged", path.string(), chunkCount, damagedCount);
+
+		std::scoped_lock lock(m_Mutex);
+		m_Statistics.DamagedChunks += damagedCount;
+		m_Statistics.RegionsUpgraded++;
+		return upgraded;
+	}
+
+	void WorldStorage::FlusherMain()
+	{
+		CUBED_PROFILE_THREAD("World Storage");
+
+		auto interval = std::chrono::duration<float>(m_Settings.FlushInterval);
+
+		std::unique_lock lock(m_Mutex);
+		while (true)
+		{
+			m_FlusherWake.wait_for(lock, interval, [this]() { return m_FlushRequested || !m_Upgrades.empty() || !m_Running; });
+			bool stopping = !m_Running;
+			m_FlushRequested = false;
+
+			// left for the next start when stopping, the file reads fine as it is
+			std::vector<RegionCoord> upgrades;
+			if (!stopping)
+				upgrades.swap(m_Upgrades);
+
+			uint64_t saveCount = m_SaveCount;
+			m_Writing.swap(m_Pending);
+			lock.unlock();
+
+			for (const RegionCoord& coord : upgrades)
+				UpgradeRegion(coord);
+
+			auto start = std::chrono::steady_clock::now();
+			std::vector<ChunkCoord> failed;
+			WriteChunks(failed);
+			float flushTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			lock.lock();
+
+			// back in the queue for the next flush, unless the chunk was saved again since. Counts
+			// as saving it again, so a Flush still waits for the retry
+			for (const ChunkCoord& coord : failed)
+			{
+				auto it = m_Writing.find(coord);
+				if (m_Pending.try_emplace(coord, std::move(it->second)).second)
+					m_SaveCount++;
+				m_Writing.erase(it);
+			}
+			m_Statistics.FailedWrites += failed.size();
+
+			for (const auto& [coord, pending] : m_Writing)
+				m_Statistics.BytesSaved += pending.Size;
+			m_Statistics.ChunksSaved += m_Writing.size();
+			if (!m_Writing.empty())
+			{
+				m_Statistics.Flushes++;
+				m_Statistics.LastFlushTime = flushTime;
+			}
+			m_Writing.clear();
+
+			m_WrittenCount = saveCount;
+			m_FlushDone.notify_all();
+
+			// Stop comes after the last Save, so this pass got everything it could
+			if (stopping)
+			{
+				if (!m_Pending.empty())
+					WL_ERROR("Could not save {} chunks, their edits are lost!", m_Pending.size());
+				break;
+			}
+		}
+	}
+
+	void WorldStorage::WriteChunks(std::vector<ChunkCoord>& outFailed)
+	{
+		if (m_Writing.empty())
+			return;
+
+		CUBED_PROFILE_ZONE("WorldStorage::WriteChunks");
+
+		std::vector<std::shared_ptr<RegionFile>> written;
+		std::vector<RegionCoord> notUpgraded; // tried once this pass, not again for every chunk in it
+		for (const auto& [coord, pending] : m_Writing)
+		{
+			// writing into an old file would mix the two formats
+			RegionCoord regionCoord = RegionCoord::FromChunk(coord);
+			std::shared_ptr<RegionFile> region = GetRegion(regionCoord, true);
+			if (region && region->GetVersion() != RegionFile::CurrentVersion
+				&& std::find(notUpgraded.begin(), notUpgraded.end(), regionCoord) == notUpgraded.end())
+			{
+				region = UpgradeRegion(regionCoord);
+				if (region && region->GetVersion() != RegionFile::CurrentVersion)
+					notUpgraded.push_back(regionCoord);
+			}
+
+			if (!region || region->GetVersion() != RegionFile::CurrentVersion || !region->Write(coord, pending.Payload.GetData(), pending.Size))
+			{
+				outFailed.push_back(coord);
+				continue;
+			}
+
+			if (std::find(written.begin(), written.end(), region) == written.end())
+				written.push_back(region);
+		}
+
+		for (const std::shared_ptr<RegionFile>& region : written)
+			region->Flush();
+
+		if (!outFailed.empty())
+			WL_ERROR("Could not save {} chunks, trying again on the next flush!", outFailed.size());
+	}
+}
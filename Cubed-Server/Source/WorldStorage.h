@@ -0,0 +1,132 @@
+#pragma once
+
+#include <stdint.h>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Chunk.h"
+#include "PacketBuffer.h"
+#include "RegionFile.h"
+
+namespace Cubed
+{
+	struct WorldStorageSettings
+	{
+		std::filesystem::path Directory = "World";
+		float FlushInterval = 5.0f; // in seconds, at most how much of the latest edits a crash loses
+	};
+
+	//
+	// WorldStorage - saved chunks, in region files on disk
+	//
+	// Nothing is read at startup, region files are opened the first time a chunk in them is
+	// loaded or saved. Saving just queues the chunk's encoded payload: a flusher thread of its
+	// own writes everything queued to the region files every FlushInterval (or when asked to)
+	// and syncs them, so the tick never waits on the disk. A chunk saved again before the
+	// flusher gets to it is only written once, and loads see queued chunks before they've
+	// reached the disk.
+	//
+	// Chunks go in compressed, as in ChunkCompression.h. Region files from before that hold the
+	// plain chunk format instead: one is read as it is when it's first opened, and handed to the
+	// flusher, which compresses every chunk in it into a new file and then swaps that in for the
+	// old one, so a crash halfway leaves the old one as it was. Nothing is written to a region
+	// until it's been upgraded, the flusher does that first if it gets to the region's chunks
+	// before its upgrade.
+	//
+	// A chunk that couldn't be written stays queued and is tried again on the next flush, only
+	// what is still failing when the flusher stops is lost, and that is logged.
+	//
+	// Everything may be called from any thread.
+	//
+	class WorldStorage
+	{
+	public:
+		struct Statistics
+		{
+			uint64_t ChunksLoaded = 0;
+			uint64_t ChunksSaved = 0;     // written to a region file, saving a chunk twice before a flush counts once
+			uint64_t FailedWrites = 0;    // every time a chunk couldn't be written, it's retried on the next flush
+			uint64_t BytesSaved = 0;
+			uint64_t DamagedChunks = 0;   // didn't decode, or were damaged in an old region file being upgraded
+			uint32_t RegionsUpgraded = 0;
+			uint64_t Flushes = 0;
+			uint64_t PendingChunks = 0;   // saved but not written yet
+			uint32_t RegionsOpen = 0;
+			float LastFlushTime = 0.0f;   // ms, writing and syncing
+		};
+	public:
+		WorldStorage(const WorldStorageSettings& settings = {});
+		~WorldStorage();
+
+		// creates the directory and starts the flusher
+		bool Start();
+		// writes out everything still queued, then stops the flusher
+		void Stop();
+
+		// the chunk as last saved, false if it never was (or what's on disk is damaged)
+		bool Load(const ChunkCoord& coord, Chunk& outChunk);
+		// payload is shared rather than copied, so it must not change afterwards
+		void Save(const ChunkCoord& coord, const PacketBuffer& payload, uint64_t size);
+
+		// wakes the flusher now instead of at the next interval
+		void RequestFlush();
+		// blocks until everything saved so far is on disk, or failed to get there (see FailedWrites)
+		void Flush();
+
+		const WorldStorageSettings& GetSettings() const { return m_Settings; }
+		Statistics GetStatistics() const;
+	private:
+		struct PendingChunk
+		{
+			PacketBuffer Payload;
+			uint64_t Size = 0;
+		};
+
+		using PendingMap = std::unordered_map<ChunkCoord, PendingChunk, ChunkCoordHash>;
+	private:
+		// nullptr if the region has no file and create isn't set, or it couldn't be opened. A
+		// file in an older version is opened as it is and queued for an upgrade
+		std::shared_ptr<RegionFile> GetRegion(const RegionCoord& coord, bool create);
+		std::filesystem::path GetRegionPath(const RegionCoord& coord) const;
+		// compresses every chunk of a region file in an older version into a new file and swaps
+		// that in for it, flusher thread only. The region as it is now, the old one on failure
+		std::shared_ptr<RegionFile> UpgradeRegion(const RegionCoord& coord);
+		void FlusherMain();
+		// writes m_Writing out, flusher thread only. Chunks that couldn't be written go in outFailed
+		void WriteChunks(std::vector<ChunkCoord>& outFailed);
+	private:
+		WorldStorageSettings m_Settings;
+
+		// regions that were looked for, nullptr if they have no file yet. Shared with whoever is
+		// reading or writing one, so Stop can let go of them while a Load is still reading
+		mutable std::mutex m_RegionMutex;
+		std::unordered_map<RegionCoord, std::shared_ptr<RegionFile>, RegionCoordHash> m_Regions;
+
+		// guards everything below
+		mutable std::mutex m_Mutex;
+		std::condition_variable m_FlusherWake;
+		std::condition_variable m_FlushDone;
+		std::thread m_Flusher;
+		bool m_Running = false;
+		bool m_FlushRequested = false;
+
+		// saved since the flusher last woke up, and what it is writing now. Only the flusher
+		// changes m_Writing, and only while holding the lock, so it reads it without one
+		PendingMap m_Pending;
+		PendingMap m_Writing;
+
+		// regions opened in an older version, for the flusher to upgrade
+		std::vector<RegionCoord> m_Upgrades;
+
+		// every Save bumps the first, the flusher sets the second to what it has written up to
+		uint64_t m_SaveCount = 0;
+		uint64_t m_WrittenCount = 0;
+
+		Statistics m_Statistics;
+	};
+}
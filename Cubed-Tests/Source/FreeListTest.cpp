@@ -0,0 +1,166 @@
+#include "FreeListTest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "Walnut/Core/Log.h"
+
+#include "BenchmarkLayer.h"
+#include "FreeListAllocator.h"
+
+namespace Cubed
+{
+	static constexpr uint64_t s_Size = 64ull * 1024 * 1024; // GPUAllocator's device local block size
+	static constexpr float s_TargetUsage = 0.75f;
+
+	static bool Fits(uint64_t gapOffset, uint64_t gapSize, uint64_t size, uint64_t alignment)
+	{
+		uint64_t offset = (gapOffset + alignment - 1) & ~(alignment - 1);
+		return offset - gapOffset + size <= gapSize;
+	}
+
+	FreeListTest::FreeListTest(uint32_t operationCount)
+		: m_OperationCount(operationCount)
+	{
+	}
+
+	bool FreeListTest::Run()
+	{
+		FreeListAllocator allocator(s_Size);
+		std::map<uint64_t, uint64_t> live; // offset -> size, what the allocator should think
+		std::vector<uint64_t> liveOffsets; // the same, to pick one to free at random
+		uint64_t used = 0;
+
+		auto forEachGap = [&live](auto&& callback)
+		{
+			uint64_t end = 0;
+			for (auto [offset, size] : live)
+			{
+				if (offset > end)
+					callback(end, offset - end);
+				end = offset + size;
+			}
+			if (end < s_Size)
+				callback(end, s_Size - end);
+		};
+
+		uint32_t errors = 0;
+		auto checkStatistics = [&]()
+		{
+			uint32_t gaps = 0;
+			uint64_t largestGap = 0;
+			forEachGap([&](uint64_t offset, uint64_t size) { gaps++; largestGap = std::max(largestGap, size); });
+
+			FreeListAllocator::Statistics stats = allocator.GetStatistics();
+			if (stats.Used != used || stats.Allocations != live.size() || stats.FreeRanges != gaps || stats.LargestFreeRange != largestGap)
+				errors++;
+		};
+
+		// same operations every run so results are comparable, sizes spread evenly over orders
+		// of magnitude, from small uniform buffers up to big chunk meshes
+		std::mt19937 random(BenchmarkSeed);
+		std::uniform_real_distribution<float> sizeExponent(8.0f, 20.0f);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		uint32_t allocations = 0, frees = 0, failures = 0, fragmentationFailures = 0;
+		double fragmentationSum = 0.0;
+		float maxFragmentation = 0.0f;
+		uint32_t fragmentationSamples = 0;
+
+		auto freeAt = [&](size_t index)
+		{
+			uint64_t offset = liveOffsets[index];
+			allocator.Free(offset);
+			used -= live[offset];
+			live.erase(offset);
+			liveOffsets[index] = liveOffsets.back();
+			liveOffsets.pop_back();
+			frees++;
+		};
+
+		for (uint32_t operation = 0; operation < m_OperationCount; operation++)
+		{
+			// keeps usage hovering around the target once it gets there
+			float allocateChance = used < s_TargetUsage * s_Size ? 0.7f : 0.3f;
+			if (liveOffsets.empty() || unit(random) < allocateChance)
+			{
+				uint64_t size = (uint64_t)std::exp2(sizeExponent(random));
+				// buffers want 16 to 256, optimally tiled images up to 64K
+				uint64_t alignment = random() % 16 == 0 ? 65536 : 16ull << (random() % 5);
+
+				// the allocator is best fit, so it has to pick the smallest gap this fits in
+				uint64_t smallestFit = UINT64_MAX;
+				forEachGap([&](uint64_t gapOffset, uint64_t gapSize)
+				{
+					if (Fits(gapOffset, gapSize, size, alignment))
+						smallestFit = std::min(smallestFit, gapSize);
+				});
+
+				uint64_t offset = allocator.Allocate(size, alignment);
+				if (offset == FreeListAllocator::InvalidOffset)
+				{
+					failures++;
+					fragmentationFailures += s_Size - used >= size;
+					errors += smallestFit != UINT64_MAX;
+				}
+				else
+				{
+					auto next = live.lower_bound(offset);
+					uint64_t gapStart = next == live.begin() ? 0 : std::prev(next)->first + std::prev(next)->second;
+					uint64_t gapEnd = next == live.end() ? s_Size : next->first;
+					if (offset % alignment != 0 || offset < gapStart || offset + size > gapEnd || gapEnd - gapStart != smallestFit)
+						errors++;
+
+					live.emplace(offset, size);
+					liveOffsets.push_back(offset);
+					used += size;
+					allocations++;
+				}
+			}
+			else
+			{
+				freeAt(random() % liveOffsets.size());
+
+				// freeing something that isn't allocated is ignored
+				if (operation % 1024 == 0)
+					allocator.Free(s_Size);
+			}
+
+			checkStatistics();
+
+			if (used >= s_TargetUsage * s_Size * 0.9f)
+			{
+				float fragmentation = allocator.GetStatistics().GetFragmentation();
+				fragmentationSum += fragmentation;
+				maxFragmentation = std::max(maxFragmentation, fragmentation);
+				fragmentationSamples++;
+			}
+		}
+
+		uint32_t churnAllocations = (uint32_t)live.size();
+		while (!liveOffsets.empty())
+		{
+			freeAt(random() % liveOffsets.size());
+			checkStatistics();
+		}
+
+		// everything merged back into one range
+		FreeListAllocator::Statistics stats = allocator.GetStatistics();
+		if (!allocator.IsEmpty() || stats.FreeRanges != 1 || stats.LargestFreeRange != s_Size || stats.GetFragmentation() != 0.0f)
+			errors++;
+
+		WL_INFO_TAG("FreeListTest", "{} operations on {}MB: {} allocations, {} frees, {} live at the end of the churn",
+			m_OperationCount, s_Size / (1024 * 1024), allocations, frees, churnAllocations);
+		WL_INFO_TAG("FreeListTest", "around {:.0f}% used: fragmentation avg {:.3f} max {:.3f}, {} allocations failed, {} of them with enough free space in total",
+			s_TargetUsage * 100.0f, fragmentationSum / std::max(fragmentationSamples, 1u), maxFragmentation, failures, fragmentationFailures);
+
+		if (errors > 0)
+			WL_ERROR_TAG("FreeListTest", "allocator disagreed with what's live in {} checks!", errors);
+
+		return errors == 0;
+	}
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace Cubed
+{
+	//
+	// FreeListTest - throws random allocations and frees at FreeListAllocator and checks it
+	//
+	// Works on a 64MB range, the size of a device local GPU block, with sizes and alignments
+	// like buffers and images. It fills to about three quarters, churns there, and then frees
+	// everything. After every operation the allocator has to agree with a plain map of what's
+	// live: nothing out of bounds, misaligned or overlapping, the used total and count match,
+	// and the free ranges are exactly the gaps between allocations, so every free merged with
+	// its neighbours. Each allocation has to land in the smallest gap it fits, and it may only
+	// fail if no gap can hold it. Fragmentation is reported over the churn, along with how
+	// often an allocation failed only because the free space was split up.
+	//
+	class FreeListTest
+	{
+	public:
+		FreeListTest(uint32_t operationCount);
+
+		bool Run();
+	private:
+		uint32_t m_OperationCount;
+	};
+}
@@ -0,0 +1,216 @@
+#include "InterpolationTest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "Walnut/Core/Log.h"
+
+#include "BenchmarkLayer.h"
+#include "Interpolation.h"
+#include "Snapshot.h"
+
+namespace Cubed
+{
+	static constexpr double s_Duration = 20.0;
+	static constexpr double s_WarmupTime = 1.0; // long enough for the clock offset to settle and the buffer to fill
+	static constexpr uint32_t s_SendRate = 30;
+	static constexpr double s_FrameInterval = 1.0 / 144.0;
+	static constexpr double s_LocalClockOffset = -100.0; // the client's clock started a while after the server's
+
+	static constexpr float s_PlayerSpeed = 15.0f; // MovementSettings::Speed / Friction, flat out
+	static constexpr float s_SnapTolerance = 0.05f; // half of what a player moves in a frame
+	static constexpr float s_MaxInterpolationError = 0.05f;
+	static constexpr float s_MaxRotationError = 2.0f; // degrees
+
+	struct Circle
+	{
+		glm::vec2 Center;
+		float Radius;
+		float Phase;
+		float AngularSpeed; // radians per second, negative runs clockwise
+	};
+
+	static PlayerData GetTruth(const Circle& circle, double time)
+	{
+		double angle = circle.Phase + circle.AngularSpeed * time;
+		glm::vec2 direction((float)std::cos(angle), (float)std::sin(angle));
+
+		PlayerData data;
+		data.Position = circle.Center + direction * circle.Radius;
+		data.Velocity = glm::vec2(-direction.y, direction.x) * circle.Radius * circle.AngularSpeed;
+		// heading wraps through 360 every lap, which is what interpolation has to get the short way round
+		data.Rotation = { 0.0f, (float)std::fmod(angle * 180.0 / 3.14159265358979, 360.0), 0.0f };
+		return data;
+	}
+
+	static float GetAngleDifference(float a, float b)
+	{
+		float difference = std::fmod(std::fabs(a - b), 360.0f);
+		return std::min(difference, 360.0f - difference);
+	}
+
+	InterpolationTest::InterpolationTest(uint32_t playerCount)
+		: m_PlayerCount(playerCount)
+	{
+	}
+
+	bool InterpolationTest::Run()
+	{
+		InterpolationSettings settings;
+		WL_INFO_TAG("InterpolationTest", "{} players for {}s per scenario, sent at {}Hz, rendered at 144Hz, {}ms delay",
+			m_PlayerCount, s_Duration, s_SendRate, settings.Delay * 1000.0f);
+
+		RunScenario({ .Name = "steady" });
+		RunScenario({ .Name = "jitter", .Jitter = 0.03 });
+		RunScenario({ .Name = "jitter and loss", .Jitter = 0.03, .DropChance = 0.1f, .Smooth = false });
+		RunScenario({ .Name = "stalls", .Jitter = 0.01, .StallInterval = 5.0, .StallLength = 0.5, .Smooth = false });
+
+		if (m_Failures > 0)
+			WL_ERROR_TAG("InterpolationTest", "{} checks failed!", m_Failures);
+
+		return m_Failures == 0;
+	}
+
+	void InterpolationTest::RunScenario(const Scenario& scenario)
+	{
+		struct Packet
+		{
+			double ServerTime = 0.0;
+			double Arrival = 0.0; // on the server's clock
+			EntityStore Players;
+		};
+
+		// IDs are indices + 1
+		std::mt19937 random(BenchmarkSeed);
+		std::uniform_real_distribution<float> center(-200.0f, 200.0f);
+		std::uniform_real_distribution<float> radius(8.0f, 64.0f);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::vector<Circle> circles(m_PlayerCount);
+		for (Circle& circle : circles)
+		{
+			circle.Center = { center(random), center(random) };
+			circle.Radius = radius(random);
+			circle.Phase = unit(random) * 6.2831853f;
+			circle.AngularSpeed = (random() % 2 ? 1.0f : -1.0f) * s_PlayerSpeed / circle.Radius;
+		}
+
+		PlayerQuantization quantization;
+		std::vector<Packet> packets;
+		uint32_t dropped = 0;
+		for (uint32_t send = 0; send < (uint32_t)(s_Duration * s_SendRate); send++)
+		{
+			// whole milliseconds, like ClientUpdate's server time
+			double serverTime = (double)(send * 1000 / s_SendRate) / 1000.0;
+			bool stalled = scenario.StallInterval > 0.0 && std::fmod(serverTime, scenario.StallInterval) >= scenario.StallInterval - scenario.StallLength;
+			if (stalled || unit(random) < scenario.DropChance)
+			{
+				dropped++;
+				continue;
+			}
+
+			Packet& packet = packets.emplace_back();
+			packet.ServerTime = serverTime;
+			packet.Arrival = serverTime + scenario.Latency + scenario.Jitter * (unit(random) * 2.0 - 1.0);
+			for (uint32_t i = 0; i < m_PlayerCount; i++)
+				packet.Players.Insert(i + 1, QuantizePlayerData(GetTruth(circles[i], serverTime), quantization));
+		}
+		std::stable_sort(packets.begin(), packets.end(), [](const Packet& a, const Packet& b) { return a.Arrival < b.Arrival; });
+
+		InterpolationBuffer buffer;
+		const InterpolationSettings& settings = buffer.GetSettings();
+		EntityStore rendered, previous;
+		const Packet* newest = nullptr;
+		size_t nextPacket = 0;
+		double previousRenderTime = 0.0;
+
+		uint32_t reordered = 0, frames = 0, missing = 0, interpolatedSamples = 0;
+		uint32_t interpolatedFrames = 0, interpolationErrors = 0, extrapolatedFrames = 0, clampedFrames = 0, boundViolations = 0, snaps = 0;
+		double interpolationErrorSum = 0.0;
+		float maxInterpolationError = 0.0f, maxRotationError = 0.0f, maxExtrapolationError = 0.0f, maxSnap = 0.0f;
+
+		for (double now = 0.0; now < s_Duration; now += s_FrameInterval)
+		{
+			for (; nextPacket < packets.size() && packets[nextPacket].Arrival <= now; nextPacket++)
+			{
+				const Packet& packet = packets[nextPacket];
+				if (newest && packet.ServerTime < newest->ServerTime)
+					reordered++;
+				else
+					newest = &packet;
+
+				buffer.PushSnapshot(packet.ServerTime, packet.Arrival + s_LocalClockOffset, packet.Players);
+			}
+
+			double localTime = now + s_LocalClockOffset;
+			InterpolationBuffer::Statistics stats = buffer.Sample(localTime, rendered);
+			double renderTime = localTime + buffer.GetServerTimeOffset() - settings.Delay;
+
+			if (now >= s_WarmupTime && newest)
+			{
+				frames++;
+				interpolatedFrames += stats.Interpolated;
+				extrapolatedFrames += stats.Extrapolated;
+				clampedFrames += stats.Clamped;
+
+				for (uint32_t i = 0; i < m_PlayerCount; i++)
+				{
+					size_t index = rendered.GetIndex(i + 1);
+					size_t previousIndex = previous.GetIndex(i + 1);
+					if (index == SIZE_MAX || previousIndex == SIZE_MAX)
+					{
+						missing++;
+						continue;
+					}
+
+					PlayerData result = rendered.Get(index);
+					PlayerData truth = GetTruth(circles[i], renderTime);
+					float error = glm::length(result.Position - truth.Position);
+
+					if (renderTime <= newest->ServerTime)
+					{
+						float rotationError = GetAngleDifference(result.Rotation.y, truth.Rotation.y);
+						interpolatedSamples++;
+						interpolationErrorSum += error;
+						maxInterpolationError = std::max(maxInterpolationError, error);
+						maxRotationError = std::max(maxRotationError, rotationError);
+						if (error > s_MaxInterpolationError || rotationError > s_MaxRotationError)
+							interpolationErrors++;
+					}
+					else
+					{
+						// never further from the last keyframe than its velocity covers in MaxExtrapolation
+						PlayerData last = newest->Players.Get(newest->Players.GetIndex(i + 1));
+						float reach = glm::length(last.Velocity) * settings.MaxExtrapolation;
+						if (glm::length(result.Position - last.Position) > reach + 1e-3f)
+							boundViolations++;
+						maxExtrapolationError = std::max(maxExtrapolationError, error);
+					}
+
+					// anything beyond what the player actually covered between the two render times is a visible snap
+					float jump = glm::length(result.Position - previous.GetPositions()[previousIndex]);
+					float snap = jump - s_PlayerSpeed * (float)std::fabs(renderTime - previousRenderTime);
+					maxSnap = std::max(maxSnap, snap);
+					if (snap > s_SnapTolerance)
+						snaps++;
+				}
+			}
+
+			std::swap(previous, rendered);
+			previousRenderTime = renderTime;
+		}
+
+		uint64_t samples = std::max<uint64_t>((uint64_t)frames * m_PlayerCount, 1);
+		WL_INFO_TAG("InterpolationTest", "{}: {} packets, {} dropped, {} reordered, interpolated {:.1f}% of samples, error avg {:.4f} max {:.4f}, rotation max {:.2f} degrees",
+			scenario.Name, packets.size(), dropped, reordered, interpolatedFrames * 100.0f / samples, interpolationErrorSum / std::max(interpolatedSamples, 1u), maxInterpolationError, maxRotationError);
+		WL_INFO_TAG("InterpolationTest", "{}: extrapolated {} samples, clamped {}, error max {:.3f}, {} past the extrapolation bound, {} snaps, largest {:.3f}",
+			scenario.Name, extrapolatedFrames, clampedFrames, maxExtrapolationError, boundViolations, snaps, maxSnap);
+
+		uint32_t failures = missing + interpolationErrors + boundViolations + (scenario.Smooth ? snaps + extrapolatedFrames + clampedFrames : 0);
+		if (failures > 0)
+			WL_ERROR_TAG("InterpolationTest", "{}: {} missing players, {} interpolation errors, {} bound violations{}",
+				scenario.Name, missing, interpolationErrors, boundViolations, scenario.Smooth ? ", and the delay should have covered every snap and extrapolation" : "");
+		m_Failures += failures;
+	}
+}
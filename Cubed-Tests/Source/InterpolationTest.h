@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace Cubed
+{
+	//
+	// InterpolationTest - feeds InterpolationBuffer synthetic packet streams and checks what it renders
+	//
+	// Players run circles at walking speed, and the server sends their quantized state at the
+	// default 30Hz send rate. Packets go through a fake network with latency, jitter (which
+	// reorders them), loss, and stalls. Every 144Hz frame is sampled and checked against the
+	// true path at the render time: how far off it is, how far it jumped since the last frame
+	// beyond what the player actually moved, and, once keyframes run out, that it never
+	// goes further than MaxExtrapolation along the last velocity. Scenarios the default delay
+	// should cover must render without a single snap.
+	//
+	class InterpolationTest
+	{
+	public:
+		InterpolationTest(uint32_t playerCount);
+
+		bool Run();
+	private:
+		struct Scenario
+		{
+			const char* Name;
+			double Latency = 0.05;
+			double Jitter = 0.0;      // latency varies by up to this much either way
+			float DropChance = 0.0f;
+			double StallInterval = 0.0; // every this many seconds nothing gets through...
+			double StallLength = 0.0;   // ...for this long
+			bool Smooth = true;         // the delay covers everything, so no snaps allowed
+		};
+
+		void RunScenario(const Scenario& scenario);
+	private:
+		uint32_t m_PlayerCount;
+		uint32_t m_Failures = 0;
+	};
+}
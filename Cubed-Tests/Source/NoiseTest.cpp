@@ -0,0 +1,132 @@
+#include "NoiseTest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+#include "Walnut/Core/Log.h"
+
+#include "BenchmarkLayer.h"
+#include "JobSystem.h"
+#include "TerrainGenerator.h"
+
+namespace Cubed
+{
+	// the server's default world height, see WorldSettings
+	static constexpr int32_t s_MinChunkY = -2;
+	static constexpr int32_t s_MaxChunkY = 1;
+
+	NoiseTest::NoiseTest(uint32_t chunkCount)
+		: m_ChunkCount(chunkCount)
+	{
+	}
+
+	bool NoiseTest::Run()
+	{
+		int32_t height = s_MaxChunkY - s_MinChunkY + 1;
+		int32_t columns = (int32_t)((m_ChunkCount + height - 1) / height);
+		int32_t side = std::max((int32_t)std::ceil(std::sqrt((float)columns)), 1);
+		for (int32_t z = 0; z < side && m_Coords.size() < m_ChunkCount; z++)
+		{
+			for (int32_t x = 0; x < side && m_Coords.size() < m_ChunkCount; x++)
+			{
+				for (int32_t y = s_MinChunkY; y <= s_MaxChunkY && m_Coords.size() < m_ChunkCount; y++)
+					m_Coords.push_back({ x, y, z });
+			}
+		}
+
+		SimdLevel supported = GetSupportedSimdLevel();
+		uint32_t threadCount = JobSystem::GetDefaultWorkerCount() + 1;
+		WL_INFO_TAG("NoiseTest", "{} chunks on up to {} threads, best SIMD level {}",
+			m_Coords.size(), threadCount, SimdLevelToString(supported));
+
+		for (uint32_t level = 0; level <= (uint32_t)supported; level++)
+		{
+			if ((SimdLevel)level != SimdLevel::Scalar)
+				CompareNoise((SimdLevel)level);
+			CompareChunks((SimdLevel)level, 1);
+			if (threadCount > 1)
+				CompareChunks((SimdLevel)level, threadCount);
+		}
+
+		if (m_Mismatches > 0)
+			WL_ERROR_TAG("NoiseTest", "{} noise points and chunks came out different from the scalar path!", m_Mismatches);
+
+		return m_Mismatches == 0;
+	}
+
+	void NoiseTest::CompareNoise(SimdLevel level)
+	{
+		// random points over a wide range, plus every lattice point and half point of a small
+		// grid, where the simplex picks are ties
+		constexpr uint32_t count = 1 << 18;
+		std::mt19937 random(BenchmarkSeed);
+		std::uniform_real_distribution<float> distribution(-10000.0f, 10000.0f);
+		std::vector<float> x(count), y(count), z(count), scalar(count), result(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (i < 32 * 32 * 32)
+			{
+				x[i] = (float)(i % 32) * 0.5f - 8.0f;
+				y[i] = (float)(i / 32 % 32) * 0.5f - 8.0f;
+				z[i] = (float)(i / 1024) * 0.5f - 8.0f;
+				continue;
+			}
+
+			x[i] = distribution(random);
+			y[i] = distribution(random);
+			z[i] = distribution(random);
+		}
+
+		auto compare = [&](const char* name, auto&& noise)
+		{
+			noise(SimdLevel::Scalar, scalar.data());
+			noise(level, result.data());
+
+			uint32_t mismatches = 0;
+			for (uint32_t i = 0; i < count; i++)
+				mismatches += memcmp(&scalar[i], &result[i], sizeof(float)) != 0;
+
+			WL_INFO_TAG("NoiseTest", "{} {}: {} of {} points differ from scalar", SimdLevelToString(level), name, mismatches, count);
+			m_Mismatches += mismatches;
+		};
+
+		compare("2D noise", [&](SimdLevel simd, float* out) { SimplexNoise2D(BenchmarkSeed, x.data(), y.data(), out, count, simd); });
+		compare("3D noise", [&](SimdLevel simd, float* out) { SimplexNoise3D(BenchmarkSeed, x.data(), y.data(), z.data(), out, count, simd); });
+	}
+
+	void NoiseTest::CompareChunks(SimdLevel level, uint32_t threadCount)
+	{
+		TerrainGenerator generator({ .Seed = BenchmarkSeed }, level);
+		JobSystem jobs(threadCount - 1);
+
+		std::vector<Chunk> chunks(m_Coords.size());
+		jobs.ParallelFor((uint32_t)m_Coords.size(), [&](uint32_t i)
+		{
+			generator.Generate(m_Coords[i], chunks[i]);
+		});
+
+		// the first run is scalar on one thread, the reference for all the others
+		std::vector<BlockID> blocks(ChunkVolume);
+		bool reference = m_Reference.empty();
+		if (reference)
+			m_Reference.resize(m_Coords.size() * ChunkVolume);
+
+		uint32_t mismatches = 0;
+		for (size_t i = 0; i < chunks.size(); i++)
+		{
+			BlockID* expected = m_Reference.data() + i * ChunkVolume;
+			chunks[i].Unpack(reference ? expected : blocks.data());
+			if (!reference && memcmp(expected, blocks.data(), ChunkVolume * sizeof(BlockID)) != 0)
+				mismatches++;
+		}
+
+		if (!reference)
+		{
+			WL_INFO_TAG("NoiseTest", "{} on {} threads: {} of {} chunks differ from the reference",
+				SimdLevelToString(level), threadCount, mismatches, chunks.size());
+		}
+		m_Mismatches += mismatches;
+	}
+}
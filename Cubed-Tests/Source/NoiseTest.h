@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "Chunk.h"
+#include "Noise.h"
+
+namespace Cubed
+{
+	//
+	// NoiseTest - checks every SIMD level generates the same terrain as the scalar path
+	//
+	// Raw 2D and 3D noise on every SIMD level the CPU has is compared bit for bit against the
+	// scalar path, on random points and on lattice points where the simplex picks are ties.
+	// Then a square of chunk columns is generated on one thread and across a job system on
+	// every level, and compared block for block against the scalar single thread run. Any
+	// difference fails the run.
+	//
+	class NoiseTest
+	{
+	public:
+		NoiseTest(uint32_t chunkCount);
+
+		bool Run();
+	private:
+		void CompareNoise(SimdLevel level);
+		void CompareChunks(SimdLevel level, uint32_t threadCount);
+	private:
+		uint32_t m_ChunkCount;
+		std::vector<ChunkCoord> m_Coords;
+
+		// from the scalar single thread run, what every other run has to match
+		std::vector<BlockID> m_Reference;
+
+		uint64_t m_Mismatches = 0;
+	};
+}
@@ -0,0 +1,196 @@
+#include "ReplayTest.h"
+
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#include "Walnut/Core/Log.h"
+
+#include "PlayerMovement.h"
+#include "ServerShard.h"
+
+namespace Cubed
+{
+	using Clock = std::chrono::steady_clock;
+
+	struct RecordedSegment
+	{
+		int8_t MoveX;
+		int8_t MoveY;
+		uint32_t Steps;
+	};
+
+	// about 25 seconds of someone running around, tapping keys and standing still
+	static constexpr RecordedSegment s_Recording[] = {
+		{ 1, 0, 90 }, { 0, 0, 30 }, { 1, 1, 60 }, { -1, 0, 45 }, { 0, -1, 120 }, { 0, 0, 60 },
+		{ -1, 1, 75 }, { 1, -1, 20 }, { 0, 1, 5 }, { 0, 0, 3 }, { 0, 1, 5 }, { 0, 0, 3 },
+		{ 1, 0, 1 }, { -1, 0, 1 }, { 1, 0, 1 }, { -1, 0, 1 }, { 0, 1, 1 }, { 0, -1, 1 },
+		{ -1, -1, 200 }, { 1, 1, 2 }, { 0, 0, 12 }, { 1, -1, 33 }, { -1, 0, 7 }, { 0, 1, 150 },
+		// long enough for friction to take velocity into denormals, where flush-to-zero builds differ
+		{ 0, 0, 600 },
+		{ 1, 0, 40 }, { 1, 1, 40 }, { 0, 1, 40 }, { -1, 1, 40 }, { -1, 0, 40 }, { -1, -1, 40 }, { 0, -1, 40 }, { 1, -1, 40 },
+		{ 0, 0, 90 },
+	};
+
+	// recorded from a known good build, only update these for a deliberate change to movement,
+	// clients and servers on the old values won't agree with ones on the new
+	static constexpr uint32_t s_GoldenPosition[2] = { 0xc31eb58d, 0xc2bf099a };
+	static constexpr uint32_t s_GoldenVelocity[2] = { 0x36ddbbee, 0xb6ddbbee };
+	static constexpr uint32_t s_GoldenRotation[3] = { 0x41f00000, 0x43a52af7, 0x00000000 };
+	static constexpr uint64_t s_GoldenHash = 0xd76bbf5403950682ull;
+
+	// FNV-1a over the raw bytes of every step
+	static uint64_t HashPlayer(uint64_t hash, const PlayerData& data)
+	{
+		const uint8_t* bytes = (const uint8_t*)&data;
+		for (size_t i = 0; i < sizeof(PlayerData); i++)
+			hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+		return hash;
+	}
+
+	static bool MatchesGolden(const float* values, const uint32_t* golden, uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (std::bit_cast<uint32_t>(values[i]) != golden[i])
+				return false;
+		}
+		return true;
+	}
+
+	// inputs lost in a row, more than a second of them, like the server's inbound queue filling up
+	static constexpr uint32_t s_LostInputs = PlayerInputRate * 3 / 2;
+
+	// the client predicting and the server simulating side by side, a snapshot after every
+	// packet, with everything the client sends for a while in the middle lost on the way. The
+	// server has to carry on from the next packet it gets, and the client has to be corrected
+	// once and then agree with it again, with nothing left waiting on the server
+	static bool ReplayLostInputs(const std::vector<PlayerInput>& inputs, uint32_t& outMispredictions)
+	{
+		ShardLayout layout;
+		layout.ShardCount = 1;
+		ServerShard shard(0, layout);
+		shard.PushEvent({ .EventType = InboundEvent::Type::Connected, .ClientID = 1 });
+
+		MovementSettings settings;
+		PlayerData client = GetSpawnPlayerData();
+		PendingInputs pending;
+		PlayerData server;
+		uint32_t lastProcessedInput = 0;
+
+		size_t lostStart = inputs.size() / 3 & ~(size_t)1;
+		size_t lostEnd = lostStart + s_LostInputs;
+		outMispredictions = 0;
+		for (size_t i = 0; i < inputs.size(); i += 2)
+		{
+			InboundEvent event{ .EventType = InboundEvent::Type::Input, .ClientID = 1 };
+			event.InputCount = (uint32_t)std::min<size_t>(inputs.size() - i, 2);
+			for (uint32_t j = 0; j < event.InputCount; j++)
+			{
+				event.Inputs[j] = inputs[i + j];
+				ApplyPlayerInput(client, inputs[i + j], settings);
+				pending.Push(inputs[i + j]);
+			}
+
+			if (i < lostStart || i >= lostEnd)
+				shard.PushEvent(event);
+			shard.Simulate(PlayerInputInterval);
+			shard.Simulate(PlayerInputInterval);
+
+			if (!shard.GetPlayer(1, server, lastProcessedInput))
+				return false;
+
+			PlayerData corrected = pending.Reconcile(server, lastProcessedInput, settings);
+			outMispredictions += std::memcmp(&corrected, &client, sizeof(PlayerData)) != 0;
+			client = corrected;
+		}
+
+		ServerShard::Statistics& stats = shard.GetStatistics();
+		return lastProcessedInput == inputs.back().Sequence && pending.Size() == 0 && outMispredictions == 1
+			&& stats.InputsSkipped == s_LostInputs && stats.InputsRejected == 0;
+	}
+
+	ReplayTest::ReplayTest(uint32_t passCount)
+		: m_PassCount(passCount)
+	{
+	}
+
+	bool ReplayTest::Run()
+	{
+		std::vector<PlayerInput> inputs;
+		uint32_t sequence = 1;
+		for (const RecordedSegment& segment : s_Recording)
+		{
+			for (uint32_t i = 0; i < segment.Steps; i++)
+				inputs.push_back({ sequence++, segment.MoveX, segment.MoveY });
+		}
+
+		// the client's prediction, every pass has to come out the same
+		MovementSettings settings;
+		PlayerData player;
+		uint64_t hash = 0;
+		uint32_t mismatchedPasses = 0;
+
+		Clock::time_point start = Clock::now();
+		for (uint32_t pass = 0; pass < m_PassCount; pass++)
+		{
+			player = GetSpawnPlayerData();
+			hash = 0xcbf29ce484222325ull;
+			for (const PlayerInput& input : inputs)
+			{
+				ApplyPlayerInput(player, input, settings);
+				hash = HashPlayer(hash, player);
+			}
+
+			if (hash != s_GoldenHash || !MatchesGolden(&player.Position.x, s_GoldenPosition, 2)
+				|| !MatchesGolden(&player.Velocity.x, s_GoldenVelocity, 2) || !MatchesGolden(&player.Rotation.x, s_GoldenRotation, 3))
+				mismatchedPasses++;
+		}
+		float stepTime = std::chrono::duration<float, std::nano>(Clock::now() - start).count() / ((uint64_t)m_PassCount * inputs.size());
+
+		// the server's side, one shard that owns everything so the player never gets handed over
+		ShardLayout layout;
+		layout.ShardCount = 1;
+		ServerShard shard(0, layout);
+		shard.PushEvent({ .EventType = InboundEvent::Type::Connected, .ClientID = 1 });
+		for (size_t i = 0; i < inputs.size(); i += 2)
+		{
+			// two inputs per packet at 30Hz, simulated at 60Hz
+			InboundEvent event{ .EventType = InboundEvent::Type::Input, .ClientID = 1 };
+			event.InputCount = (uint32_t)std::min<size_t>(inputs.size() - i, 2);
+			for (uint32_t j = 0; j < event.InputCount; j++)
+				event.Inputs[j] = inputs[i + j];
+
+			shard.PushEvent(event);
+			shard.Simulate(PlayerInputInterval);
+			shard.Simulate(PlayerInputInterval);
+		}
+
+		glm::vec2 serverPosition;
+		bool serverMatches = shard.GetPlayerPosition(1, serverPosition) && MatchesGolden(&serverPosition.x, s_GoldenPosition, 2)
+			&& shard.GetStatistics().InputsRejected == 0;
+
+		uint32_t mispredictions;
+		bool recovered = ReplayLostInputs(inputs, mispredictions);
+
+		WL_INFO_TAG("ReplayTest", "{} inputs, {} passes, {:.1f}ns per step, {} passes mismatched, server {}",
+			inputs.size(), m_PassCount, stepTime, mismatchedPasses, serverMatches ? "matches" : "mismatched");
+		WL_INFO_TAG("ReplayTest", "{} inputs lost on the way to the server, {} mispredictions after, client {}",
+			s_LostInputs, mispredictions, recovered ? "recovered" : "did not recover");
+
+		if (mismatchedPasses > 0 || !serverMatches)
+		{
+			WL_ERROR_TAG("ReplayTest", "Movement is no longer bit-identical to the recording! Got hash {:016x}, position {:08x} {:08x}, velocity {:08x} {:08x}, rotation {:08x} {:08x} {:08x}",
+				hash, std::bit_cast<uint32_t>(player.Position.x), std::bit_cast<uint32_t>(player.Position.y),
+				std::bit_cast<uint32_t>(player.Velocity.x), std::bit_cast<uint32_t>(player.Velocity.y),
+				std::bit_cast<uint32_t>(player.Rotation.x), std::bit_cast<uint32_t>(player.Rotation.y), std::bit_cast<uint32_t>(player.Rotation.z));
+		}
+
+		if (!recovered)
+			WL_ERROR_TAG("ReplayTest", "Client and server did not get back in step after losing inputs!");
+
+		return mismatchedPasses == 0 && serverMatches && recovered;
+	}
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace Cubed
+{
+	//
+	// ReplayTest - replays a recorded input sequence and checks movement is still bit-identical
+	//
+	// Prediction and reconciliation only work if ApplyPlayerInput lands on exactly the same bits
+	// on every client and the server. The recording walks in every direction, taps keys, and
+	// stands still long enough for friction to take velocity into denormals. Its final state,
+	// and a hash of every step along the way, have to match golden values recorded from a
+	// known good build. The server replays the same inputs through ServerShard::Simulate, in
+	// packets of two like the bots send, and has to end up at the same position. A compiler
+	// flag or code change that moves any of these by a single bit fails the test.
+	//
+	// Then the client and server run side by side with over a second of the client's inputs
+	// lost in the middle. The server has to carry on past them and the client has to be back
+	// in step after a single correction.
+	//
+	class ReplayTest
+	{
+	public:
+		ReplayTest(uint32_t passCount);
+
+		bool Run();
+	private:
+		uint32_t m_PassCount;
+	};
+}
@@ -0,0 +1,370 @@
+#include "SnapshotTest.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "Walnut/Core/Log.h"
+#include "Walnut/Serialization/BufferStream.h"
+
+#include "BenchmarkLayer.h"
+#include "BitStream.h"
+#include "Snapshot.h"
+
+using namespace Walnut;
+
+namespace Cubed
+{
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr uint32_t s_FieldCount = 100000;
+	static constexpr uint32_t s_Passes = 100;
+	static constexpr uint32_t s_DeltaTicks = 300;
+	static constexpr uint32_t s_TruncatedPlayers = 16;
+	static constexpr uint32_t s_MaxPlayerBytes = 32; // generous, a full player with a 5 byte ID is about 17
+	static constexpr float s_TimeStep = 1.0f / 60.0f;
+
+	// half a step plus float rounding in Quantize, which can cost up to about 1/128 of a step
+	static constexpr float s_MaxStepError = 0.52f;
+
+	static uint32_t GetMask(uint32_t bitCount)
+	{
+		return bitCount >= 32 ? UINT32_MAX : (1u << bitCount) - 1;
+	}
+
+	static float NanosecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<float, std::nano>(Clock::now() - start).count();
+	}
+
+	static float MegabytesPerSecond(uint64_t bytes, float nanoseconds)
+	{
+		return (float)bytes / (1024.0f * 1024.0f) / std::max(nanoseconds * 1e-9f, 1e-9f);
+	}
+
+	static bool operator==(const PlayerData& a, const PlayerData& b)
+	{
+		return a.Position == b.Position && a.Velocity == b.Velocity && a.Rotation == b.Rotation;
+	}
+
+	// in steps of the quantization, against the value clamped to its range
+	static float GetStepError(float decoded, float original, const Quantization& quantization)
+	{
+		float clamped = std::clamp(original, -quantization.Range, quantization.Range);
+		return std::fabs(decoded - clamped) / quantization.Precision;
+	}
+
+	static float GetAngleStepError(float decoded, float original, uint32_t bitCount)
+	{
+		float difference = std::fmod(std::fabs(decoded - original), 360.0f);
+		return std::min(difference, 360.0f - difference) / (360.0f / (float)(1u << bitCount));
+	}
+
+	static PlayerData MakePlayer(std::mt19937& random, float positionRange, float velocityRange)
+	{
+		std::uniform_real_distribution<float> position(-positionRange, positionRange);
+		std::uniform_real_distribution<float> velocity(-velocityRange, velocityRange);
+		std::uniform_real_distribution<float> rotation(-720.0f, 720.0f);
+
+		PlayerData data;
+		data.Position = { position(random), position(random) };
+		// a quarter of them standing still, which goes out as a single bit
+		data.Velocity = random() % 4 == 0 ? glm::vec2(0.0f) : glm::vec2(velocity(random), velocity(random));
+		data.Rotation = { rotation(random), rotation(random), rotation(random) };
+		return data;
+	}
+
+	SnapshotTest::SnapshotTest(uint32_t playerCount)
+		: m_PlayerCount(playerCount)
+	{
+	}
+
+	bool SnapshotTest::Run()
+	{
+		WL_INFO_TAG("SnapshotTest", "{} players, {} passes each", m_PlayerCount, s_Passes);
+
+		TestPrimitives();
+		TestPlayers();
+		TestDeltas();
+
+		if (m_Failures > 0)
+			WL_ERROR_TAG("SnapshotTest", "{} round trip failures!", m_Failures);
+
+		return m_Failures == 0;
+	}
+
+	void SnapshotTest::TestPrimitives()
+	{
+		struct Field
+		{
+			enum class Type { Bits = 0, VarUInt, SignedDelta };
+
+			Type FieldType;
+			uint32_t Value = 0;
+			int32_t Delta = 0;
+			uint32_t BitCount = 0; // width of plain bits, max bits of a signed delta
+		};
+
+		// random widths, so fields straddle the 32 bit scratch flush at every offset
+		std::mt19937 random(BenchmarkSeed);
+		std::vector<Field> fields(s_FieldCount);
+		for (Field& field : fields)
+		{
+			field.FieldType = (Field::Type)(random() % 3);
+			switch (field.FieldType)
+			{
+				case Field::Type::Bits:
+					field.BitCount = 1 + random() % 32;
+					field.Value = (uint32_t)random() & GetMask(field.BitCount);
+					break;
+				case Field::Type::VarUInt:
+					field.Value = (uint32_t)random() >> (random() % 32);
+					break;
+				case Field::Type::SignedDelta:
+				{
+					// any difference of two values up to BitCount wide, most of them small
+					field.BitCount = 1 + random() % 31;
+					int32_t magnitude = (int32_t)((uint32_t)random() & GetMask(random() % (field.BitCount + 1)));
+					field.Delta = random() % 2 ? magnitude : -magnitude;
+					break;
+				}
+			}
+		}
+
+		std::vector<uint8_t> bytes(fields.size() * 8);
+		BufferStreamWriter writer(Buffer(bytes.data(), bytes.size()));
+		BitWriter bits(writer);
+		for (const Field& field : fields)
+		{
+			switch (field.FieldType)
+			{
+				case Field::Type::Bits:        bits.WriteBits(field.Value, field.BitCount); break;
+				case Field::Type::VarUInt:     bits.WriteVarUInt(field.Value); break;
+				case Field::Type::SignedDelta: bits.WriteSignedDelta(field.Delta, field.BitCount); break;
+			}
+		}
+		bits.Flush();
+		uint64_t size = writer.GetStreamPosition();
+
+		BufferStreamReader reader(Buffer(bytes.data(), size));
+		BitReader bitReader(reader);
+		uint32_t mismatches = bits.IsGood() ? 0 : 1;
+		for (const Field& field : fields)
+		{
+			uint32_t value = 0;
+			int32_t delta = 0;
+			bool valid = false;
+			switch (field.FieldType)
+			{
+				case Field::Type::Bits:        valid = bitReader.ReadBits(value, field.BitCount); break;
+				case Field::Type::VarUInt:     valid = bitReader.ReadVarUInt(value); break;
+				case Field::Type::SignedDelta: valid = bitReader.ReadSignedDelta(delta, field.BitCount); break;
+			}
+
+			if (!valid || value != field.Value || delta != field.Delta)
+				mismatches++;
+		}
+
+		WL_INFO_TAG("SnapshotTest", "primitives: {} fields in {} bytes, {} mismatched", fields.size(), size, mismatches);
+		m_Failures += mismatches;
+	}
+
+	void SnapshotTest::TestPlayers()
+	{
+		PlayerQuantization quantization;
+
+		// a tenth past the range on every side, those have to come back clamped
+		std::mt19937 random(BenchmarkSeed);
+		std::vector<PlayerData> players(m_PlayerCount);
+		for (PlayerData& player : players)
+			player = MakePlayer(random, quantization.Position.Range * 1.1f, quantization.Velocity.Range * 1.1f);
+
+		std::vector<uint8_t> bytes(players.size() * s_MaxPlayerBytes);
+		uint64_t size = 0;
+		bool good = true;
+
+		Clock::time_point start = Clock::now();
+		for (uint32_t pass = 0; pass < s_Passes; pass++)
+		{
+			BufferStreamWriter writer(Buffer(bytes.data(), bytes.size()));
+			BitWriter bits(writer);
+			for (const PlayerData& player : players)
+				WritePlayerData(bits, player, quantization);
+			bits.Flush();
+
+			good &= bits.IsGood();
+			size = writer.GetStreamPosition();
+		}
+		float encodeTime = NanosecondsSince(start);
+
+		std::vector<PlayerData> decoded(players.size());
+		start = Clock::now();
+		for (uint32_t pass = 0; pass < s_Passes; pass++)
+		{
+			BufferStreamReader reader(Buffer(bytes.data(), size));
+			BitReader bits(reader);
+			for (PlayerData& player : decoded)
+				good &= ReadPlayerData(bits, player, quantization);
+		}
+		float decodeTime = NanosecondsSince(start);
+
+		uint32_t mismatches = good ? 0 : 1;
+		float positionError = 0.0f, velocityError = 0.0f, rotationError = 0.0f;
+		for (size_t i = 0; i < players.size(); i++)
+		{
+			const PlayerData& original = players[i];
+			const PlayerData& result = decoded[i];
+			if (!(result == QuantizePlayerData(original, quantization)))
+				mismatches++;
+
+			for (int axis = 0; axis < 2; axis++)
+			{
+				positionError = std::max(positionError, GetStepError(result.Position[axis], original.Position[axis], quantization.Position));
+				velocityError = std::max(velocityError, GetStepError(result.Velocity[axis], original.Velocity[axis], quantization.Velocity));
+			}
+			for (int axis = 0; axis < 3; axis++)
+				rotationError = std::max(rotationError, GetAngleStepError(result.Rotation[axis], original.Rotation[axis], quantization.AngleBits));
+		}
+
+		if (positionError > s_MaxStepError || velocityError > s_MaxStepError || rotationError > s_MaxStepError)
+			mismatches++;
+
+		// every prefix of a stream is missing at least one bit a reader needs
+		uint32_t truncatedCount = std::min<uint32_t>(s_TruncatedPlayers, (uint32_t)players.size());
+		std::vector<uint8_t> truncated(truncatedCount * s_MaxPlayerBytes);
+		BufferStreamWriter writer(Buffer(truncated.data(), truncated.size()));
+		{
+			BitWriter bits(writer);
+			for (uint32_t i = 0; i < truncatedCount; i++)
+				WritePlayerData(bits, players[i], quantization);
+		}
+
+		uint64_t truncatedSize = writer.GetStreamPosition();
+		uint32_t truncationsRead = 0;
+		for (uint64_t length = 0; length < truncatedSize; length++)
+		{
+			BufferStreamReader reader(Buffer(truncated.data(), length));
+			BitReader bits(reader);
+			bool valid = true;
+			PlayerData player;
+			for (uint32_t i = 0; i < truncatedCount && valid; i++)
+				valid = ReadPlayerData(bits, player, quantization);
+
+			if (valid)
+				truncationsRead++;
+		}
+
+		uint64_t entities = (uint64_t)s_Passes * std::max<size_t>(players.size(), 1);
+		WL_INFO_TAG("SnapshotTest", "players: {:.1f} bytes each, max error position {:.3f} steps, velocity {:.3f}, rotation {:.3f}, {} mismatched, {} of {} truncations read",
+			(float)size / std::max<size_t>(players.size(), 1), positionError, velocityError, rotationError, mismatches, truncationsRead, truncatedSize);
+		WL_INFO_TAG("SnapshotTest", "players: encode {:.1f}ns per player ({:.0f}MB/s), decode {:.1f}ns per player ({:.0f}MB/s)",
+			encodeTime / entities, MegabytesPerSecond(size * s_Passes, encodeTime), decodeTime / entities, MegabytesPerSecond(size * s_Passes, decodeTime));
+
+		m_Failures += mismatches + truncationsRead;
+	}
+
+	void SnapshotTest::TestDeltas()
+	{
+		SnapshotDeltaSettings settings;
+		const PlayerQuantization& quantization = settings.Quantization;
+
+		// a view can lag the real position by the threshold, plus half a step on each axis
+		float maxDistance = settings.PositionThreshold + quantization.Position.Precision * s_MaxStepError * std::sqrt(2.0f);
+
+		std::mt19937 random(BenchmarkSeed);
+		EntityStore current;
+		std::vector<uint32_t> ids(m_PlayerCount);
+		uint32_t nextID = 1;
+		for (uint32_t& id : ids)
+		{
+			id = nextID++;
+			current.Insert(id, MakePlayer(random, 512.0f, 8.0f));
+		}
+
+		// the client starts out with nothing, so the first delta is a full snapshot
+		EntityStore serverView, clientView, decodedView;
+		std::vector<uint8_t> bytes(ids.size() * s_MaxPlayerBytes + 16);
+		uint64_t size = 0, totalBytes = 0, changedPlayers = 0;
+		float encodeTime = 0.0f, decodeTime = 0.0f;
+		uint32_t mismatchedViews = 0, outOfBounds = 0, truncationsRead = 0, truncationsTried = 0;
+
+		for (uint32_t tick = 0; tick < s_DeltaTicks; tick++)
+		{
+			// everyone moves, a few change direction, about one in a hundred leave and someone new joins
+			std::vector<glm::vec2>& positions = current.GetPositions();
+			std::vector<glm::vec2>& velocities = current.GetVelocities();
+			std::vector<glm::vec3>& rotations = current.GetRotations();
+			for (size_t i = 0; i < current.Size(); i++)
+			{
+				if (random() % 60 == 0)
+					velocities[i] = MakePlayer(random, 512.0f, 8.0f).Velocity;
+				positions[i] += velocities[i] * s_TimeStep;
+				if (velocities[i] != glm::vec2(0.0f))
+					rotations[i].y += 90.0f * s_TimeStep;
+			}
+
+			for (uint32_t i = 0; i < m_PlayerCount / 100; i++)
+			{
+				uint32_t& id = ids[random() % ids.size()];
+				current.Remove(id);
+				id = nextID++;
+				current.Insert(id, MakePlayer(random, 512.0f, 8.0f));
+			}
+
+			Clock::time_point start = Clock::now();
+			BufferStreamWriter writer(Buffer(bytes.data(), bytes.size()));
+			changedPlayers += WriteSnapshotDelta(writer, clientView, current, settings, serverView);
+			encodeTime += NanosecondsSince(start);
+			size = writer.GetStreamPosition();
+			totalBytes += size;
+
+			start = Clock::now();
+			BufferStreamReader reader(Buffer(bytes.data(), size));
+			bool valid = ReadSnapshotDelta(reader, clientView, quantization, decodedView);
+			decodeTime += NanosecondsSince(start);
+
+			// the client has to end up with exactly what the server will use as the next baseline
+			bool match = valid && reader.GetStreamPosition() == size && decodedView.Size() == serverView.Size();
+			for (size_t i = 0; i < serverView.Size() && match; i++)
+			{
+				size_t index = decodedView.GetIndex(serverView.GetIDs()[i]);
+				match = index != SIZE_MAX && decodedView.Get(index) == serverView.Get(i);
+			}
+			if (!match)
+				mismatchedViews++;
+
+			for (size_t i = 0; i < current.Size(); i++)
+			{
+				size_t index = serverView.GetIndex(current.GetIDs()[i]);
+				if (index == SIZE_MAX || glm::length(serverView.GetPositions()[index] - positions[i]) > maxDistance)
+					outOfBounds++;
+			}
+
+			// every prefix of the last delta has to fail to read, sampled on big ones
+			if (tick == s_DeltaTicks - 1)
+			{
+				EntityStore truncatedView;
+				uint64_t stride = std::max<uint64_t>(size / 256, 1);
+				for (uint64_t length = 0; length < size; length += stride)
+				{
+					BufferStreamReader truncated(Buffer(bytes.data(), length));
+					if (ReadSnapshotDelta(truncated, clientView, quantization, truncatedView))
+						truncationsRead++;
+					truncationsTried++;
+				}
+			}
+
+			std::swap(clientView, decodedView);
+		}
+
+		uint64_t entities = (uint64_t)s_DeltaTicks * std::max<uint32_t>(m_PlayerCount, 1);
+		WL_INFO_TAG("SnapshotTest", "deltas: {} ticks, {:.0f} bytes and {:.0f} changed players per tick, encode {:.1f}ns per player, decode {:.1f}ns per player",
+			s_DeltaTicks, (float)totalBytes / s_DeltaTicks, (float)changedPlayers / s_DeltaTicks, encodeTime / entities, decodeTime / entities);
+		WL_INFO_TAG("SnapshotTest", "deltas: {} views mismatched, {} players further than {:.3f} from their view, {} of {} truncations read",
+			mismatchedViews, outOfBounds, maxDistance, truncationsRead, truncationsTried);
+
+		m_Failures += mismatchedViews + outOfBounds + truncationsRead;
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace Cubed
+{
+	//
+	// SnapshotTest - checks the bit-packed snapshot encoding round trips and times it
+	//
+	// The BitStream primitives are written at random widths and read back. Random players,
+	// some out of range, go through WritePlayerData and ReadPlayerData, and have to come back
+	// exactly as QuantizePlayerData predicts and within half a step of the original. Then a
+	// crowd moves, joins and leaves for a few seconds of ticks. Each tick's delta is read back
+	// on top of the client's view, and has to rebuild exactly the view the server thinks it
+	// sent. Truncated streams have to fail to read. Reports the worst errors and encode and
+	// decode speed per player, any mismatch fails the run.
+	//
+	class SnapshotTest
+	{
+	public:
+		SnapshotTest(uint32_t playerCount);
+
+		bool Run();
+	private:
+		void TestPrimitives();
+		void TestPlayers();
+		void TestDeltas();
+	private:
+		uint32_t m_PlayerCount;
+		uint32_t m_Failures = 0;
+	};
+}
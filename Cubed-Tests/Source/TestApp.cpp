@@ -0,0 +1,80 @@
+#include "Walnut/Application.h"
+#include "Walnut/EntryPoint.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <string_view>
+#include <vector>
+
+#include "Walnut/Core/Log.h"
+
+#include "BenchmarkLayer.h"
+#include "FreeListTest.h"
+#include "InterpolationTest.h"
+#include "NoiseTest.h"
+#include "ReplayTest.h"
+#include "SnapshotTest.h"
+
+struct TestCase
+{
+	std::string_view Name;
+	std::function<bool()> (*Create)(uint32_t value);
+	uint32_t Value;
+};
+
+// every test with a size that keeps the whole run to a few seconds
+static constexpr TestCase s_Tests[] = {
+	{ "freelist", Cubed::CreateBenchmark<Cubed::FreeListTest>, 200000 },   // operations
+	{ "interp", Cubed::CreateBenchmark<Cubed::InterpolationTest>, 100 },   // players
+	{ "noise", Cubed::CreateBenchmark<Cubed::NoiseTest>, 64 },             // chunks
+	{ "replay", Cubed::CreateBenchmark<Cubed::ReplayTest>, 10 },           // passes
+	{ "snapshot", Cubed::CreateBenchmark<Cubed::SnapshotTest>, 1000 },     // players
+};
+
+// Cubed-Tests [test name...]
+// runs every test when no names are given, exits with 1 if any of them fails
+Walnut::Application* Walnut::CreateApplication(int argc, char** argv)
+{
+	std::vector<const TestCase*> tests;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string_view name = argv[i];
+		auto test = std::find_if(std::begin(s_Tests), std::end(s_Tests),
+			[name](const TestCase& test) { return test.Name == name; });
+		if (test == std::end(s_Tests))
+		{
+			std::cerr << "Unknown test " << name << std::endl;
+			std::exit(1);
+		}
+
+		tests.push_back(test);
+	}
+
+	if (tests.empty())
+	{
+		for (const TestCase& test : s_Tests)
+			tests.push_back(&test);
+	}
+
+	Walnut::ApplicationSpecification spec;
+	spec.Name = "Cubed Tests";
+
+	Walnut::Application* app = new Walnut::Application(spec);
+	app->PushLayer(std::make_shared<Cubed::BenchmarkLayer>([tests]()
+	{
+		uint32_t failed = 0;
+		for (const TestCase* test : tests)
+		{
+			bool passed = test->Create(test->Value)();
+			WL_INFO_TAG("Tests", "{}: {}", test->Name, passed ? "passed" : "FAILED");
+			failed += !passed;
+		}
+
+		WL_INFO_TAG("Tests", "{} of {} tests passed", tests.size() - failed, tests.size());
+		return failed == 0;
+	}));
+
+	return app;
+}
@@ -0,0 +1,26 @@
+#!/bin/bash
+
+# Snapshot bytes per send tick at 10, 100 and 1000 bots against a fresh local server.
+# Each run ends on the load test's final report, which covers the last 10 seconds, once
+# every bot has connected. Its "snapshots:" line is the number.
+# Usage: scripts/BenchmarkSnapshots.sh [duration in seconds per run, over 10]
+
+export LD_LIBRARY_PATH=`realpath /Walnut/Walnut-Modules/Walnut-Networking/vendor/GameNetworkingSockets/bin/Linux`
+
+DURATION=${1:-30}
+CONFIG=Release-linux-x86_64
+
+for BOTS in 10 100 1000; do
+	# the console reads stdin, keep it open so it doesn't spin on EOF
+	sleep infinity | bin/$CONFIG/Cubed-Server/Cubed-Server > /dev/null &
+	SERVER=$!
+	sleep 2
+
+	echo "=== $BOTS bots ==="
+	bin/$CONFIG/Cubed-LoadTest/Cubed-LoadTest --bots $BOTS --duration $DURATION --report $((DURATION - 10)) \
+		| grep -A2 "Final:"
+
+	kill $SERVER
+	pkill -P $$ sleep
+	wait 2> /dev/null
+done
@@ -0,0 +1,5 @@
+#!/bin/bash
+
+export LD_LIBRARY_PATH=`realpath /Walnut/Walnut-Modules/Walnut-Networking/vendor/GameNetworkingSockets/bin/Linux`
+
+exec bin/Debug-linux-x86_64/Cubed-Tests/Cubed-Tests "$@"